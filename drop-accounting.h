@@ -0,0 +1,454 @@
+/*
+ * Aggregated packet drop accounting
+ * Counts drops by node, device, layer and reason in one flat counter array
+ * sized at install time, instead of logging every drop with NS_LOG_WARN and
+ * a string context. Trace sinks are bound to their (node, device) slot, so a
+ * drop costs one array increment.
+ *
+ * Layers and trace sources:
+ *   PHY     PhyTxDrop, PhyRxDrop (receive error model)
+ *   DEVICE  MacTxDrop while the link is down
+ *   QUEUE   device TxQueue Drop (queue full)
+ *   QDISC   root queue disc DropBeforeEnqueue / DropAfterDequeue
+ *   IP      Ipv4L3Protocol Drop (no route, TTL expired, interface down)
+ * Policers and firewalls outside ns-3 report their drops through Record().
+ *
+ * Usage (after addresses are assigned, so the default queue discs exist):
+ *   DropAccounting drops;
+ *   drops.InstallAll();
+ *   drops.EnablePeriodicSummary(Seconds(5), Seconds(simTime));
+ *   drops.EnableSampledLog(100);           // print every 100th drop
+ *   drops.PublishMetrics(metrics);         // wan_drops{layer,reason}
+ *   ...
+ *   drops.PrintReport(std::cout);
+ */
+
+#ifndef DROP_ACCOUNTING_H
+#define DROP_ACCOUNTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include "metrics-registry.h"
+
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+namespace ns3
+{
+
+class DropAccounting
+{
+public:
+    enum Layer
+    {
+        LAYER_PHY,
+        LAYER_DEVICE,
+        LAYER_QUEUE,
+        LAYER_QDISC,
+        LAYER_IP,
+        N_LAYERS
+    };
+
+    enum Reason
+    {
+        QUEUE_FULL,
+        INTERFACE_DOWN,
+        NO_ROUTE,
+        TTL_EXPIRED,
+        POLICER,     // policers and AQM early drops
+        PHY_ERROR,
+        OTHER,
+        N_REASONS
+    };
+
+    static const char* LayerName(uint32_t layer);
+    static const char* ReasonName(uint32_t reason);
+    // Reason an Ipv4L3Protocol Drop trace is counted under; shared with the
+    // other Ipv4 Drop sinks so they classify drops the same way
+    static Reason FromIpv4(Ipv4L3Protocol::DropReason reason);
+
+    DropAccounting();
+
+    // Size the counters for the current NodeList and connect trace sinks
+    void InstallAll();
+
+    // For drops decided outside the traced ns-3 models (policers, firewalls)
+    void Record(uint32_t node, uint32_t device, Layer layer, Reason reason, Ptr<const Packet> packet);
+
+    void EnablePeriodicSummary(Time interval, Time stop);
+    // Print one in every n drops (0 disables)
+    void EnableSampledLog(uint32_t n) { m_sampleEvery = n; }
+
+    uint64_t GetTotal() const;
+    uint64_t GetTotal(Reason reason) const;
+    uint64_t GetCount(uint32_t node, uint32_t device, Layer layer, Reason reason) const;
+
+    void PrintReport(std::ostream& os) const;
+
+    // Export drop totals by layer and reason on every registry export
+    void PublishMetrics(MetricsRegistry& registry);
+
+private:
+    uint32_t Slot(uint32_t node, uint32_t device) const { return node * m_nDevices + device; }
+    uint32_t Index(uint32_t slot, uint32_t layer, uint32_t reason) const
+    {
+        return (slot * N_LAYERS + layer) * N_REASONS + reason;
+    }
+
+    void Count(uint32_t slot, Layer layer, Reason reason, uint32_t bytes, uint64_t uid);
+    void PrintCounters(std::ostream& os, const std::vector<uint64_t>& counts) const;
+    void PeriodicSummary(Time interval, Time stop);
+
+    // Trace sinks; the slot is bound at connect time
+    static void PhyTxDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet);
+    static void PhyRxDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet);
+    static void MacTxDrop(DropAccounting* self, Ptr<NetDevice> device, Ptr<const Packet> packet);
+    static void QueueDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet);
+    static void QdiscDrop(DropAccounting* self,
+                          uint32_t slot,
+                          Ptr<const QueueDiscItem> item,
+                          const char* reason);
+    static void Ipv4Drop(DropAccounting* self,
+                         uint32_t node,
+                         const Ipv4Header& header,
+                         Ptr<const Packet> packet,
+                         Ipv4L3Protocol::DropReason reason,
+                         Ptr<Ipv4> ipv4,
+                         uint32_t interface);
+
+    uint32_t m_nNodes;
+    uint32_t m_nDevices;               // per node, including the loopback
+    std::vector<uint64_t> m_packets;   // [node][device][layer][reason]
+    std::vector<uint64_t> m_bytes;
+    std::vector<uint64_t> m_lastSummary;
+
+    uint32_t m_sampleEvery;
+    uint64_t m_nSeen;
+};
+
+inline const char* DropAccounting::LayerName(uint32_t layer)
+{
+    static const char* names[N_LAYERS] = {"PHY", "DEVICE", "QUEUE", "QDISC", "IP"};
+    return layer < N_LAYERS ? names[layer] : "?";
+}
+
+inline const char* DropAccounting::ReasonName(uint32_t reason)
+{
+    static const char* names[N_REASONS] =
+        {"QUEUE_FULL", "INTERFACE_DOWN", "NO_ROUTE", "TTL_EXPIRED", "POLICER", "PHY_ERROR", "OTHER"};
+    return reason < N_REASONS ? names[reason] : "?";
+}
+
+inline DropAccounting::DropAccounting()
+    : m_nNodes(0),
+      m_nDevices(0),
+      m_sampleEvery(0),
+      m_nSeen(0)
+{
+}
+
+inline void DropAccounting::InstallAll()
+{
+    m_nNodes = NodeList::GetNNodes();
+    m_nDevices = 1;
+    for (uint32_t n = 0; n < m_nNodes; n++)
+    {
+        m_nDevices = std::max(m_nDevices, NodeList::GetNode(n)->GetNDevices());
+    }
+    m_packets.assign(m_nNodes * m_nDevices * N_LAYERS * N_REASONS, 0);
+    m_bytes.assign(m_packets.size(), 0);
+    m_lastSummary.assign(m_packets.size(), 0);
+
+    for (uint32_t n = 0; n < m_nNodes; n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> device = node->GetDevice(d);
+            uint32_t slot = Slot(n, d);
+            device->TraceConnectWithoutContext("PhyTxDrop",
+                                               MakeBoundCallback(&DropAccounting::PhyTxDrop, this, slot));
+            device->TraceConnectWithoutContext("PhyRxDrop",
+                                               MakeBoundCallback(&DropAccounting::PhyRxDrop, this, slot));
+            device->TraceConnectWithoutContext("MacTxDrop",
+                                               MakeBoundCallback(&DropAccounting::MacTxDrop, this, device));
+
+            if (Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device))
+            {
+                p2p->GetQueue()->TraceConnectWithoutContext(
+                    "Drop",
+                    MakeBoundCallback(&DropAccounting::QueueDrop, this, slot));
+            }
+            if (Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : Ptr<QueueDisc>())
+            {
+                qdisc->TraceConnectWithoutContext(
+                    "DropBeforeEnqueue",
+                    MakeBoundCallback(&DropAccounting::QdiscDrop, this, slot));
+                qdisc->TraceConnectWithoutContext(
+                    "DropAfterDequeue",
+                    MakeBoundCallback(&DropAccounting::QdiscDrop, this, slot));
+            }
+        }
+
+        if (Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>())
+        {
+            ipv4->TraceConnectWithoutContext("Drop",
+                                             MakeBoundCallback(&DropAccounting::Ipv4Drop, this, n));
+        }
+    }
+}
+
+inline void DropAccounting::Count(uint32_t slot, Layer layer, Reason reason, uint32_t bytes, uint64_t uid)
+{
+    uint32_t i = Index(slot, layer, reason);
+    m_packets[i]++;
+    m_bytes[i] += bytes;
+
+    if (m_sampleEvery > 0 && m_nSeen++ % m_sampleEvery == 0)
+    {
+        std::cout << "[drop] t=" << Simulator::Now().GetSeconds() << "s node "
+                  << slot / m_nDevices << " dev " << slot % m_nDevices << " "
+                  << LayerName(layer) << " " << ReasonName(reason) << " uid " << uid << " "
+                  << bytes << " bytes\n";
+    }
+}
+
+inline void DropAccounting::Record(uint32_t node,
+                                   uint32_t device,
+                                   Layer layer,
+                                   Reason reason,
+                                   Ptr<const Packet> packet)
+{
+    if (node >= m_nNodes || device >= m_nDevices)
+    {
+        return;
+    }
+    Count(Slot(node, device), layer, reason, packet->GetSize(), packet->GetUid());
+}
+
+inline void DropAccounting::PhyTxDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Count(slot, LAYER_PHY, OTHER, packet->GetSize(), packet->GetUid());
+}
+
+inline void DropAccounting::PhyRxDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Count(slot, LAYER_PHY, PHY_ERROR, packet->GetSize(), packet->GetUid());
+}
+
+// PointToPointNetDevice fires MacTxDrop both for a down link and for a full
+// queue; the latter is already counted by the queue's own Drop trace
+inline void DropAccounting::MacTxDrop(DropAccounting* self,
+                                      Ptr<NetDevice> device,
+                                      Ptr<const Packet> packet)
+{
+    if (device->IsLinkUp())
+    {
+        return;
+    }
+    self->Count(self->Slot(device->GetNode()->GetId(), device->GetIfIndex()),
+                LAYER_DEVICE,
+                INTERFACE_DOWN,
+                packet->GetSize(),
+                packet->GetUid());
+}
+
+inline void DropAccounting::QueueDrop(DropAccounting* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Count(slot, LAYER_QUEUE, QUEUE_FULL, packet->GetSize(), packet->GetUid());
+}
+
+inline void DropAccounting::QdiscDrop(DropAccounting* self,
+                                      uint32_t slot,
+                                      Ptr<const QueueDiscItem> item,
+                                      const char* reason)
+{
+    // Queue discs report free-form reasons; limit overflows are queue-full,
+    // everything else (RED/CoDel early drops, policing) counts as POLICER
+    bool overflow = std::strstr(reason, "limit") || std::strstr(reason, "full") ||
+                    std::strstr(reason, "Overlimit");
+    self->Count(slot,
+                LAYER_QDISC,
+                overflow ? QUEUE_FULL : POLICER,
+                item->GetSize(),
+                item->GetPacket()->GetUid());
+}
+
+inline DropAccounting::Reason DropAccounting::FromIpv4(Ipv4L3Protocol::DropReason reason)
+{
+    switch (reason)
+    {
+    case Ipv4L3Protocol::DROP_TTL_EXPIRED:
+        return TTL_EXPIRED;
+    case Ipv4L3Protocol::DROP_NO_ROUTE:
+    case Ipv4L3Protocol::DROP_ROUTE_ERROR:   // RouteInput found no route on a transit router
+        return NO_ROUTE;
+    case Ipv4L3Protocol::DROP_INTERFACE_DOWN:
+        return INTERFACE_DOWN;
+    default:
+        return OTHER;
+    }
+}
+
+inline void DropAccounting::Ipv4Drop(DropAccounting* self,
+                                     uint32_t node,
+                                     const Ipv4Header& header,
+                                     Ptr<const Packet> packet,
+                                     Ipv4L3Protocol::DropReason reason,
+                                     Ptr<Ipv4> ipv4,
+                                     uint32_t interface)
+{
+    Reason r = FromIpv4(reason);
+    uint32_t device = 0;
+    if (interface < ipv4->GetNInterfaces())
+    {
+        device = ipv4->GetNetDevice(interface)->GetIfIndex();
+    }
+    self->Count(self->Slot(node, device), LAYER_IP, r, packet->GetSize(), packet->GetUid());
+}
+
+inline uint64_t DropAccounting::GetTotal() const
+{
+    uint64_t total = 0;
+    for (uint64_t c : m_packets)
+    {
+        total += c;
+    }
+    return total;
+}
+
+inline uint64_t DropAccounting::GetTotal(Reason reason) const
+{
+    uint64_t total = 0;
+    for (uint32_t i = reason; i < m_packets.size(); i += N_REASONS)
+    {
+        total += m_packets[i];
+    }
+    return total;
+}
+
+inline uint64_t DropAccounting::GetCount(uint32_t node, uint32_t device, Layer layer, Reason reason) const
+{
+    if (node >= m_nNodes || device >= m_nDevices)
+    {
+        return 0;
+    }
+    return m_packets[Index(Slot(node, device), layer, reason)];
+}
+
+inline void DropAccounting::EnablePeriodicSummary(Time interval, Time stop)
+{
+    Simulator::Schedule(interval, &DropAccounting::PeriodicSummary, this, interval, stop);
+}
+
+inline void DropAccounting::PeriodicSummary(Time interval, Time stop)
+{
+    std::vector<uint64_t> delta(m_packets.size());
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < m_packets.size(); i++)
+    {
+        delta[i] = m_packets[i] - m_lastSummary[i];
+        total += delta[i];
+    }
+    m_lastSummary = m_packets;
+
+    std::cout << "[drops] t=" << Simulator::Now().GetSeconds() << "s: " << total
+              << " in the last " << interval.GetSeconds() << "s\n";
+    if (total > 0)
+    {
+        PrintCounters(std::cout, delta);
+    }
+
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &DropAccounting::PeriodicSummary, this, interval, stop);
+    }
+}
+
+// Summed over nodes and devices to keep the label set small; the per-device
+// breakdown stays in PrintReport
+inline void DropAccounting::PublishMetrics(MetricsRegistry& registry)
+{
+    registry.AddCollector([this](MetricsRegistry& r) {
+        std::vector<uint64_t> packets(N_LAYERS * N_REASONS, 0);
+        std::vector<uint64_t> bytes(N_LAYERS * N_REASONS, 0);
+        for (uint32_t slot = 0; slot < m_nNodes * m_nDevices; slot++)
+        {
+            for (uint32_t i = 0; i < N_LAYERS * N_REASONS; i++)
+            {
+                packets[i] += m_packets[Index(slot, 0, 0) + i];
+                bytes[i] += m_bytes[Index(slot, 0, 0) + i];
+            }
+        }
+        for (uint32_t layer = 0; layer < N_LAYERS; layer++)
+        {
+            for (uint32_t reason = 0; reason < N_REASONS; reason++)
+            {
+                uint32_t i = layer * N_REASONS + reason;
+                if (packets[i] == 0)
+                {
+                    continue;
+                }
+                MetricsRegistry::Labels labels = {{"layer", LayerName(layer)},
+                                                  {"reason", ReasonName(reason)}};
+                r.GetCounter("wan_drops", "Packets dropped", labels).Set(packets[i]);
+                r.GetCounter("wan_dropped_bytes", "Bytes dropped", labels).Set(bytes[i]);
+            }
+        }
+    });
+}
+
+inline void DropAccounting::PrintCounters(std::ostream& os, const std::vector<uint64_t>& counts) const
+{
+    for (uint32_t slot = 0; slot < m_nNodes * m_nDevices; slot++)
+    {
+        for (uint32_t layer = 0; layer < N_LAYERS; layer++)
+        {
+            for (uint32_t reason = 0; reason < N_REASONS; reason++)
+            {
+                uint64_t c = counts[Index(slot, layer, reason)];
+                if (c == 0)
+                {
+                    continue;
+                }
+                os << "  node " << std::setw(3) << slot / m_nDevices << " dev " << std::setw(2)
+                   << slot % m_nDevices << "  " << std::setw(6) << LayerName(layer) << "  "
+                   << std::setw(14) << ReasonName(reason) << "  " << c << "\n";
+            }
+        }
+    }
+}
+
+inline void DropAccounting::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Drop Accounting ===\n";
+    uint64_t bytes = 0;
+    for (uint64_t b : m_bytes)
+    {
+        bytes += b;
+    }
+    os << "Total drops: " << GetTotal() << " packets, " << bytes << " bytes\n";
+    for (uint32_t reason = 0; reason < N_REASONS; reason++)
+    {
+        uint64_t c = GetTotal(static_cast<Reason>(reason));
+        if (c > 0)
+        {
+            os << "  " << ReasonName(reason) << ": " << c << "\n";
+        }
+    }
+    if (GetTotal() > 0)
+    {
+        os << "By node/device/layer:\n";
+        PrintCounters(os, m_packets);
+    }
+}
+
+} // namespace ns3
+
+#endif // DROP_ACCOUNTING_H
@@ -0,0 +1,350 @@
+/*
+ * Round-trip times of UdpEcho exchanges, per path and failure phase
+ * Times every request of the tracked UdpEchoClients from its Tx to the
+ * echoed reply's Rx, and splits it at the UdpEchoServer's Rx into the
+ * forward and return legs. The echo server sends back the packet it
+ * received, so request and reply share a packet UID and need no header.
+ *
+ * Samples are kept apart by the phase the request was sent in:
+ *   pre-failure   before the failure time
+ *   failover      from the failure until the failover window ends
+ *   post-failure  after it
+ * and summarised as sent/replied/lost counts, RTT percentiles and mean
+ * forward and return delay.
+ *
+ * Outstanding requests live in a fixed ring per path indexed by UID, and
+ * RTTs go into log-linear histograms (16 buckets per octave from 1 µs, so
+ * percentiles are within 3%), so tracking costs no allocation per packet.
+ * A request still unanswered when its slot is reused, or older than the
+ * timeout at the end of the run, counts as lost.
+ *
+ * Usage:
+ *   EchoRttTracker rtt;
+ *   rtt.SetPhases(Seconds(failureTime), Seconds(failureTime + 2));
+ *   rtt.AddClient("HQ->DC", clientApps.Get(0));
+ *   rtt.AddServer(serverApps.Get(0));
+ *   ...
+ *   rtt.PrintReport(std::cout);
+ */
+
+#ifndef ECHO_RTT_TRACKER_H
+#define ECHO_RTT_TRACKER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class EchoRttTracker
+{
+public:
+    enum Phase
+    {
+        PRE_FAILURE,
+        FAILOVER,
+        POST_FAILURE,
+        N_PHASES
+    };
+
+    EchoRttTracker();
+    ~EchoRttTracker();
+
+    // Phase boundaries by request send time; without them every sample is
+    // pre-failure
+    void SetPhases(Time failure, Time failoverEnd);
+    // Unanswered requests older than this count as lost (default 2 s)
+    void SetTimeout(Time timeout) { m_timeout = timeout; }
+
+    // Track a UdpEchoClient under a path name
+    void AddClient(const std::string& name, Ptr<Application> client);
+    // Split RTTs at this UdpEchoServer
+    void AddServer(Ptr<Application> server);
+
+    void PrintReport(std::ostream& os) const;
+
+private:
+    // Log-linear histogram of microseconds: exact below 32 µs, then 16
+    // buckets per octave
+    class Histogram
+    {
+    public:
+        static const uint32_t SUB_BUCKETS = 16;
+        static const uint32_t N_BUCKETS = SUB_BUCKETS * 28 + 2 * SUB_BUCKETS;   // up to ~2 h
+
+        Histogram();
+        void Add(int64_t ns);
+        uint64_t GetCount() const { return m_count; }
+        // Value in ms at quantile q (0..1)
+        double Quantile(double q) const;
+        double GetMax() const { return m_max / 1e6; }
+
+    private:
+        static uint32_t Index(uint64_t us);
+
+        uint32_t m_buckets[N_BUCKETS];
+        uint64_t m_count;
+        int64_t m_min;
+        int64_t m_max;
+    };
+
+    struct Pending
+    {
+        uint64_t uid;
+        int64_t sent;       // ns
+        int64_t served;     // server Rx, -1 before
+        uint8_t phase;
+        bool open;
+    };
+
+    struct PhaseStats
+    {
+        uint64_t sent;
+        uint64_t replied;
+        uint64_t lost;
+        Histogram rtt;
+        int64_t forwardSum;  // ns, over replies seen by the server
+        int64_t returnSum;
+        uint64_t split;
+    };
+
+    // Outstanding requests per path; a power of two
+    static const uint32_t RING = 256;
+
+    struct Path
+    {
+        EchoRttTracker* tracker;
+        std::string name;
+        Pending ring[RING];
+        PhaseStats phases[N_PHASES];
+    };
+
+    Phase PhaseAt(int64_t ns) const;
+
+    static void Sent(Path* path, Ptr<const Packet> packet);
+    static void Replied(Path* path, Ptr<const Packet> packet);
+    static void Served(EchoRttTracker* self, Ptr<const Packet> packet);
+
+    // Heap-allocated once per path so the trace sinks can keep pointers
+    std::vector<Path*> m_paths;
+    int64_t m_failure;
+    int64_t m_failoverEnd;
+    Time m_timeout;
+};
+
+inline EchoRttTracker::Histogram::Histogram()
+    : m_count(0),
+      m_min(INT64_MAX),
+      m_max(0)
+{
+    std::memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+inline uint32_t EchoRttTracker::Histogram::Index(uint64_t us)
+{
+    if (us < 2 * SUB_BUCKETS)
+    {
+        return us;
+    }
+    uint32_t shift = 63 - __builtin_clzll(us) - 4;   // us >> shift is in [16, 32)
+    return std::min<uint64_t>(N_BUCKETS - 1, SUB_BUCKETS * shift + (us >> shift));
+}
+
+inline void EchoRttTracker::Histogram::Add(int64_t ns)
+{
+    ns = std::max<int64_t>(ns, 0);
+    m_buckets[Index(ns / 1000)]++;
+    m_count++;
+    m_min = std::min(m_min, ns);
+    m_max = std::max(m_max, ns);
+}
+
+inline double EchoRttTracker::Histogram::Quantile(double q) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(q * m_count + 0.5));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < N_BUCKETS; i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+        {
+            // Midpoint of the bucket, within the observed range
+            double low;
+            double width;
+            if (i < 2 * SUB_BUCKETS)
+            {
+                low = i;
+                width = 1;
+            }
+            else
+            {
+                uint32_t shift = i / SUB_BUCKETS - 1;
+                low = double(uint64_t(i - SUB_BUCKETS * shift) << shift);
+                width = double(uint64_t(1) << shift);
+            }
+            double ns = (low + width / 2) * 1000;
+            return std::min<double>(m_max, std::max<double>(m_min, ns)) / 1e6;
+        }
+    }
+    return m_max / 1e6;
+}
+
+inline EchoRttTracker::EchoRttTracker()
+    : m_failure(INT64_MAX),
+      m_failoverEnd(INT64_MAX),
+      m_timeout(Seconds(2))
+{
+}
+
+inline EchoRttTracker::~EchoRttTracker()
+{
+    for (Path* path : m_paths)
+    {
+        delete path;
+    }
+}
+
+inline void EchoRttTracker::SetPhases(Time failure, Time failoverEnd)
+{
+    m_failure = failure.GetNanoSeconds();
+    m_failoverEnd = std::max(failoverEnd, failure).GetNanoSeconds();
+}
+
+inline EchoRttTracker::Phase EchoRttTracker::PhaseAt(int64_t ns) const
+{
+    return ns < m_failure ? PRE_FAILURE : ns < m_failoverEnd ? FAILOVER : POST_FAILURE;
+}
+
+inline void EchoRttTracker::AddClient(const std::string& name, Ptr<Application> client)
+{
+    Path* path = new Path();
+    path->tracker = this;
+    path->name = name;
+    m_paths.push_back(path);
+    client->TraceConnectWithoutContext("Tx", MakeBoundCallback(&EchoRttTracker::Sent, path));
+    client->TraceConnectWithoutContext("Rx", MakeBoundCallback(&EchoRttTracker::Replied, path));
+}
+
+inline void EchoRttTracker::AddServer(Ptr<Application> server)
+{
+    server->TraceConnectWithoutContext("Rx", MakeBoundCallback(&EchoRttTracker::Served, this));
+}
+
+inline void EchoRttTracker::Sent(Path* path, Ptr<const Packet> packet)
+{
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    Pending& slot = path->ring[packet->GetUid() & (RING - 1)];
+    if (slot.open)
+    {
+        path->phases[slot.phase].lost++;   // evicted unanswered
+    }
+    slot.uid = packet->GetUid();
+    slot.sent = now;
+    slot.served = -1;
+    slot.phase = path->tracker->PhaseAt(now);
+    slot.open = true;
+    path->phases[slot.phase].sent++;
+}
+
+inline void EchoRttTracker::Served(EchoRttTracker* self, Ptr<const Packet> packet)
+{
+    for (Path* path : self->m_paths)
+    {
+        Pending& slot = path->ring[packet->GetUid() & (RING - 1)];
+        if (slot.open && slot.uid == packet->GetUid() && slot.served < 0)
+        {
+            slot.served = Simulator::Now().GetNanoSeconds();
+            return;
+        }
+    }
+}
+
+inline void EchoRttTracker::Replied(Path* path, Ptr<const Packet> packet)
+{
+    Pending& slot = path->ring[packet->GetUid() & (RING - 1)];
+    if (!slot.open || slot.uid != packet->GetUid())
+    {
+        return;   // duplicate, or a reply to an evicted request
+    }
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    PhaseStats& stats = path->phases[slot.phase];
+    stats.replied++;
+    stats.rtt.Add(now - slot.sent);
+    if (slot.served >= 0)
+    {
+        stats.forwardSum += slot.served - slot.sent;
+        stats.returnSum += now - slot.served;
+        stats.split++;
+    }
+    slot.open = false;
+}
+
+inline void EchoRttTracker::PrintReport(std::ostream& os) const
+{
+    static const char* phaseNames[N_PHASES] = {"pre-failure", "failover", "post-failure"};
+    int64_t now = Simulator::Now().GetNanoSeconds();
+
+    os << "\n=== Echo Round-Trip Times (ms) ===\n";
+    if (m_failure != INT64_MAX)
+    {
+        os << "Phases by send time: failure at " << m_failure / 1e9 << " s, failover until "
+           << m_failoverEnd / 1e9 << " s\n";
+    }
+    os << "  path          phase          sent replied  lost     p50     p90     p99     max     fwd     ret\n";
+    os << std::fixed << std::setprecision(2);
+    for (const Path* path : m_paths)
+    {
+        // Requests still open: lost once older than the timeout, otherwise
+        // in flight when the run ended and left out
+        uint64_t lost[N_PHASES] = {};
+        uint64_t inFlight[N_PHASES] = {};
+        for (const Pending& slot : path->ring)
+        {
+            if (slot.open)
+            {
+                (now - slot.sent > m_timeout.GetNanoSeconds() ? lost : inFlight)[slot.phase]++;
+            }
+        }
+        for (uint32_t p = 0; p < N_PHASES; p++)
+        {
+            const PhaseStats& s = path->phases[p];
+            if (s.sent == 0)
+            {
+                continue;
+            }
+            os << "  " << std::left << std::setw(14) << path->name << std::setw(13) << phaseNames[p]
+               << std::right << std::setw(6) << s.sent - inFlight[p] << std::setw(8) << s.replied
+               << std::setw(6) << s.lost + lost[p];
+            if (s.replied > 0)
+            {
+                os << std::setw(8) << s.rtt.Quantile(0.5) << std::setw(8) << s.rtt.Quantile(0.9)
+                   << std::setw(8) << s.rtt.Quantile(0.99) << std::setw(8) << s.rtt.GetMax();
+            }
+            else
+            {
+                os << std::setw(8) << "-" << std::setw(8) << "-" << std::setw(8) << "-" << std::setw(8) << "-";
+            }
+            if (s.split > 0)
+            {
+                os << std::setw(8) << s.forwardSum / 1e6 / s.split << std::setw(8) << s.returnSum / 1e6 / s.split;
+            }
+            os << "\n";
+        }
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+} // namespace ns3
+
+#endif /* ECHO_RTT_TRACKER_H */
@@ -1,5 +1,5 @@
 /*  EXERCISE 1 — Triangle WAN Topology with Failover
- *  Generates NetAnim XML + FlowMonitor XML
+ *  Generates NetAnim XML + columnar FlowMonitor output (.fmc + CSV)
  */
 
 #include "ns3/core-module.h"
@@ -10,6 +10,9 @@
 #include "ns3/netanim-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "flow-monitor-columnar.h"
+#include "ladder-scheduler.h"
+
 using namespace ns3;
 
 void FailLink(Ptr<NetDevice> a, Ptr<NetDevice> b)
@@ -22,6 +25,15 @@ void FailLink(Ptr<NetDevice> a, Ptr<NetDevice> b)
 
 int main(int argc, char *argv[])
 {
+    std::string scheduler = "map";
+    CommandLine cmd;
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+    cmd.Parse(argc, argv);
+    if (!SelectScheduler(scheduler))
+    {
+        return 1;
+    }
+
     NodeContainer n;
     n.Create(3); // 0=HQ, 1=Branch, 2=DC
 
@@ -89,7 +101,9 @@ int main(int argc, char *argv[])
     Simulator::Stop(Seconds(15.0));
     Simulator::Run();
 
-    mon->SerializeToXmlFile("exercise1_flow.xml", true, true);
+    FlowMonitorColumnar flows(mon, fm.GetClassifier());
+    flows.WriteBinary("exercise1_flow.fmc");
+    flows.WriteCsv("exercise1_flow");
 
     Simulator::Destroy();
     return 0;
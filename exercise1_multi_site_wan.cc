@@ -15,13 +15,20 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/netanim-module.h"
 
+#include "ladder-scheduler.h"
+#include "memory-accounting.h"
+#include "packet-trace-format.h"
+#include "selective-pcap.h"
+#include "routing-snapshot.h"
+#include "trace-replay.h"
+#include "echo-rtt-tracker.h"
+#include "path-recorder.h"
+#include "link-utilization.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("MultiSiteWANRedundant");
 
-// Packet send timestamp storage (map packet UID -> send time)
-static std::map<uint32_t, Time> packetSentTimes;
-
 // Safely bring the IPv4 interface associated with a NetDevice down.
 // This method works across NetDevice types where IPv4 is installed.
 void BringInterfaceDown(Ptr<NetDevice> device)
@@ -66,40 +73,58 @@ void DisableLinkPair(Ptr<NetDevice> devA, Ptr<NetDevice> devB)
     NS_LOG_UNCOND(">>> Link pair disabled at " << Simulator::Now().GetSeconds() << "s");
 }
 
-// Trace callback: record client-side Tx time for a packet UID
-void TxCallback(std::string context, Ptr<const Packet> packet)
-{
-    // store send time for this UID (client Tx)
-    packetSentTimes[packet->GetUid()] = Simulator::Now();
-}
-
-// Trace callback: server-side Rx; compute one-way client->server latency using same UID
-void RxCallback(std::string context, Ptr<const Packet> packet)
-{
-    auto it = packetSentTimes.find(packet->GetUid());
-    if (it != packetSentTimes.end())
-    {
-        Time latency = Simulator::Now() - it->second;
-        NS_LOG_INFO("Packet UID=" << packet->GetUid() << " one-way latency (client->server): "
-                    << latency.GetMilliSeconds() << " ms at t=" << Simulator::Now().GetSeconds() << "s");
-    }
-}
-
 int main(int argc, char *argv[])
 {
     // Simulation parameters (default values)
     double simTime = 20.0;
     bool enablePcap = false;
+    std::string pcapDevices = "all";
+    std::string pcapFilter = "";
+    uint32_t pcapSnapLen = 0;
+    double pcapFileSize = 0;
+    double pcapFileTime = 0;
+    uint32_t pcapRing = 0;
     bool verbose = true;
     double linkFailureTime = 10.0;
+    double failoverWindow = 2.0;
+    std::string packetTrace = "";
+    double memInterval = 0.0;
+    std::string scheduler = "map";
+    std::string replayFile = "";
+    std::string replaySites = "";
+    double replayWindow = 1.0;
+    bool recordPaths = true;
+    double utilInterval = 0.1;
+    double utilGrowth = 20.0;
 
     CommandLine cmd;
     cmd.AddValue("simTime", "Simulation time in seconds", simTime);
     cmd.AddValue("pcap", "Enable PCAP tracing", enablePcap);
+    cmd.AddValue("pcapDevices", "Devices to capture: all, <node> or <node>/<device>, comma separated", pcapDevices);
+    cmd.AddValue("pcapFilter", "Capture filter, e.g. \"udp and dst port 9\" or \"dscp ef\"", pcapFilter);
+    cmd.AddValue("pcapSnapLen", "Bytes kept per captured packet (0 = whole packet)", pcapSnapLen);
+    cmd.AddValue("pcapFileSize", "Start a new capture file after this many MB (0 = no limit)", pcapFileSize);
+    cmd.AddValue("pcapFileTime", "Start a new capture file after this many seconds (0 = no limit)", pcapFileTime);
+    cmd.AddValue("pcapRing", "Keep only the last N capture files per device (0 = keep all)", pcapRing);
     cmd.AddValue("verbose", "Enable verbose logging", verbose);
     cmd.AddValue("failureTime", "Time to trigger link failure", linkFailureTime);
+    cmd.AddValue("failoverWindow", "Seconds after the failure reported as the failover phase", failoverWindow);
+    cmd.AddValue("packetTrace", "Write a binary packet trace to this file instead of NetAnim packet XML", packetTrace);
+    cmd.AddValue("memInterval", "Memory accounting sample interval in seconds (0 = off; heap row needs -DMEMORY_ACCOUNTING_HOOKS)", memInterval);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+    cmd.AddValue("replay", "Replay a flow log (CSV) or pcap file between the sites", replayFile);
+    cmd.AddValue("replaySites", "Trace prefixes per site, e.g. hq=10.10.0.0/16,branch=10.20.0.0/16,dc=10.30.0.0/16", replaySites);
+    cmd.AddValue("replayWindow", "Seconds of trace scheduled ahead while replaying", replayWindow);
+    cmd.AddValue("recordPaths", "Record the path of every packet and report it per flow", recordPaths);
+    cmd.AddValue("utilInterval", "Link utilization sample interval in seconds (0 = off)", utilInterval);
+    cmd.AddValue("utilGrowth", "Traffic growth in percent for the link saturation list", utilGrowth);
     cmd.Parse(argc, argv);
 
+    if (!SelectScheduler(scheduler))
+    {
+        return 1;
+    }
+
     if (verbose)
     {
         LogComponentEnable("MultiSiteWANRedundant", LOG_LEVEL_INFO);
@@ -115,6 +140,9 @@ int main(int argc, char *argv[])
     Ptr<Node> hq = nodes.Get(0);
     Ptr<Node> branch = nodes.Get(1);
     Ptr<Node> dc = nodes.Get(2);
+    Names::Add("HQ", hq);
+    Names::Add("Branch", branch);
+    Names::Add("DC", dc);
 
     // Install internet stack
     InternetStackHelper stack;
@@ -262,9 +290,27 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Print routing tables at 2s to file
-    Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>("multi-site-routes.txt", std::ios::out);
-    Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(2.0), routingStream);
+    // Snapshot routing tables at 2s (only changes are logged; rebuild any
+    // table with routing-snapshot-replay --log=multi-site-routes.rlog)
+    RoutingSnapshot routingSnapshot("multi-site-routes.rlog");
+    routingSnapshot.SnapshotAt(Seconds(2.0));
+
+    // Per-packet paths, to tell rerouted traffic from lost traffic after
+    // the HQ-DC failure
+    PathRecorder paths;
+    if (recordPaths)
+    {
+        paths.Install(nodes);
+    }
+
+    // Per-direction WAN link utilization for circuit upgrade planning
+    LinkUtilization utilization;
+    if (utilInterval > 0)
+    {
+        utilization.InstallAll();
+        utilization.SetGrowth(utilGrowth / 100.0);
+        utilization.EnableSampling(Seconds(utilInterval), Seconds(simTime));
+    }
 
     // === Applications ===
     NS_LOG_INFO("Setting up applications");
@@ -293,16 +339,56 @@ int main(int argc, char *argv[])
     clientApps2.Start(Seconds(2.5));
     clientApps2.Stop(Seconds(simTime));
 
+    // Production traffic from a trace, on top of the echo clients. Each
+    // site receives on an address whose route fails over with the HQ-DC link
+    TraceReplay replay;
+    if (!replayFile.empty())
+    {
+        replay.AddSite("hq", hq, ifHqBranch.GetAddress(0));
+        replay.AddSite("branch", branch, ifBranchDc.GetAddress(0));
+        replay.AddSite("dc", dc, ifHqDc.GetAddress(1));
+        if (!replay.SetPrefixes(replaySites) || !replay.Open(replayFile))
+        {
+            return 1;
+        }
+        replay.SetWindow(Seconds(replayWindow));
+        replay.Start(Seconds(2.0), Seconds(simTime));
+    }
+
     // === Tracing and FlowMonitor ===
-    Config::Connect("/NodeList/*/ApplicationList/*/$ns3::UdpEchoClient/Tx", MakeCallback(&TxCallback));
-    Config::Connect("/NodeList/*/ApplicationList/*/$ns3::UdpEchoServer/Rx", MakeCallback(&RxCallback));
+    // Echo RTT per client, split at the DC server and by failure phase
+    EchoRttTracker rtt;
+    rtt.SetPhases(Seconds(linkFailureTime), Seconds(linkFailureTime + failoverWindow));
+    rtt.AddClient("HQ->DC", clientApps.Get(0));
+    rtt.AddClient("Branch->DC", clientApps2.Get(0));
+    rtt.AddServer(serverApps.Get(0));
 
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
 
+    MemoryAccounting memory;
+    if (memInterval > 0)
+    {
+        memory.AddQueues();
+        memory.AddFlowMonitor(monitor);
+        memory.EnableSampling(Seconds(memInterval), Seconds(simTime));
+    }
+
+    SelectivePcap pcap("multi-site-wan");
     if (enablePcap)
     {
-        p2p.EnablePcapAll("multi-site-wan");
+        pcap.SetSnapLen(pcapSnapLen);
+        pcap.SetRotation(uint64_t(pcapFileSize * 1024 * 1024), Seconds(pcapFileTime), pcapRing);
+        if (!pcap.SetFilter(pcapFilter) || !pcap.Enable(pcapDevices))
+        {
+            return 1;
+        }
+    }
+
+    PacketTracer packetTracer;
+    if (!packetTrace.empty() && packetTracer.Open(packetTrace))
+    {
+        packetTracer.InstallAll();
     }
 
     // === NetAnim ===
@@ -319,7 +405,14 @@ int main(int argc, char *argv[])
     anim.UpdateNodeColor(branch, 0, 0, 255);
     anim.UpdateNodeColor(dc, 255, 0, 0);
 
-    anim.EnablePacketMetadata(true);
+    if (packetTracer.IsOpen())
+    {
+        anim.SkipPacketTracing();
+    }
+    else
+    {
+        anim.EnablePacketMetadata(true);
+    }
 
     // === Schedule link failure: disable both NetDevices of HQ-DC link ===
     Simulator::Schedule(Seconds(linkFailureTime), [=]() {
@@ -327,10 +420,8 @@ int main(int argc, char *argv[])
         DisableLinkPair(devHqDc.Get(0), devHqDc.Get(1));
     });
 
-    // Print routing table 1s after failure
-    Simulator::Schedule(Seconds(linkFailureTime + 1.0), [routingStream]() {
-        Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(0.0), routingStream);
-    });
+    // Snapshot routing tables 1s after failure
+    routingSnapshot.SnapshotAt(Seconds(linkFailureTime + 1.0));
 
     // === Run ===
     NS_LOG_INFO("Starting simulation for " << simTime << " seconds");
@@ -339,6 +430,12 @@ int main(int argc, char *argv[])
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
 
+    if (packetTracer.IsOpen())
+    {
+        packetTracer.Close();
+        std::cout << "Packet trace: " << packetTracer.GetNRecords() << " records in " << packetTrace << "\n";
+    }
+
     // === After run: FlowMonitor stats ===
     monitor->CheckForLostPackets();
 
@@ -367,6 +464,16 @@ int main(int argc, char *argv[])
         std::cout << "\n";
     }
 
+    rtt.PrintReport(std::cout);
+    if (recordPaths)
+    {
+        paths.PrintReport(std::cout);
+    }
+    if (utilInterval > 0)
+    {
+        utilization.PrintReport(std::cout);
+    }
+
     // Informational scalability analysis
     std::cout << "\n=== Scalability Analysis ===\n";
     int n = 10;
@@ -376,11 +483,25 @@ int main(int argc, char *argv[])
     std::cout << "  Links required: " << (n * (n - 1)) / 2 << "\n";
     std::cout << "  Recommendation: Use dynamic routing (OSPF) for scalability\n";
 
+    routingSnapshot.PrintSummary(std::cout);
+    if (!replayFile.empty())
+    {
+        replay.PrintReport(std::cout);
+    }
+    if (enablePcap)
+    {
+        pcap.PrintSummary(std::cout);
+    }
+    if (memInterval > 0)
+    {
+        memory.PrintReport(std::cout);
+    }
+
     Simulator::Destroy();
 
     NS_LOG_INFO("Simulation completed");
     NS_LOG_INFO("NetAnim file: multi-site-wan-redundant.xml");
-    NS_LOG_INFO("Routing tables: multi-site-routes.txt");
+    NS_LOG_INFO("Routing snapshots: multi-site-routes.rlog");
 
     return 0;
 }
@@ -13,6 +13,15 @@
 #include "ns3/traffic-control-module.h"
 #include "ns3/netanim-module.h"
 
+#include "fluid-background.h"
+#include "ladder-scheduler.h"
+#include "memory-accounting.h"
+#include "metrics-registry.h"
+#include "packet-trace-format.h"
+#include "profiling-scheduler.h"
+#include "realtime-emulation.h"
+#include "selective-pcap.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("QoSMixedTraffic");
@@ -125,16 +134,67 @@ int main(int argc, char *argv[])
     // Simulation parameters
     double simTime = 30.0;
     bool enablePcap = false;
+    std::string pcapDevices = "all";
+    std::string pcapFilter = "";
+    uint32_t pcapSnapLen = 0;
+    double pcapFileSize = 0;
+    double pcapFileTime = 0;
+    uint32_t pcapRing = 0;
     bool enableQos = true;
     bool createCongestion = true;
+    std::string packetTrace = "";
+    bool profile = false;
+    uint32_t profileSample = 8;
+    double memInterval = 0.0;
+    std::string metricsFile = "";
+    double metricsInterval = 1.0;
+    bool metricsWallClock = false;
+    std::string scheduler = "map";
+    bool realtime = false;
+    double rtHardLimit = 0;            // ms, 0 = best effort
+    std::string rtIngress = "";
+    std::string rtEgress = "";
+    bool fluid = false;
     
     CommandLine cmd;
     cmd.AddValue("simTime", "Simulation time in seconds", simTime);
     cmd.AddValue("pcap", "Enable PCAP tracing", enablePcap);
+    cmd.AddValue("pcapDevices", "Devices to capture: all, <node> or <node>/<device>, comma separated", pcapDevices);
+    cmd.AddValue("pcapFilter", "Capture filter, e.g. \"udp and dst port 9\" or \"dscp ef\"", pcapFilter);
+    cmd.AddValue("pcapSnapLen", "Bytes kept per captured packet (0 = whole packet)", pcapSnapLen);
+    cmd.AddValue("pcapFileSize", "Start a new capture file after this many MB (0 = no limit)", pcapFileSize);
+    cmd.AddValue("pcapFileTime", "Start a new capture file after this many seconds (0 = no limit)", pcapFileTime);
+    cmd.AddValue("pcapRing", "Keep only the last N capture files per device (0 = keep all)", pcapRing);
     cmd.AddValue("qos", "Enable QoS priority queuing", enableQos);
     cmd.AddValue("congestion", "Create congestion scenario", createCongestion);
+    cmd.AddValue("packetTrace", "Write a binary packet trace to this file instead of NetAnim packet XML", packetTrace);
+    cmd.AddValue("profile", "Profile simulator events by callback", profile);
+    cmd.AddValue("profileSample", "Time one event in N when profiling", profileSample);
+    cmd.AddValue("memInterval", "Memory accounting sample interval in seconds (0 = off; heap row needs -DMEMORY_ACCOUNTING_HOOKS)", memInterval);
+    cmd.AddValue("metrics", "Write live OpenMetrics counters to this file", metricsFile);
+    cmd.AddValue("metricsInterval", "Seconds between metrics exports", metricsInterval);
+    cmd.AddValue("metricsWallClock", "Interpret metricsInterval as wall-clock seconds", metricsWallClock);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+    cmd.AddValue("realtime", "Run in real time so real traffic can pass through the WAN", realtime);
+    cmd.AddValue("rtHardLimit", "Abort when this many ms behind wall clock (0 = best effort)", rtHardLimit);
+    cmd.AddValue("rtIngress", "Real endpoint on the router's LAN side: tap:<name> or exec:<command>", rtIngress);
+    cmd.AddValue("rtEgress", "Real endpoint on the server: tap:<name> or exec:<command>", rtEgress);
+    cmd.AddValue("fluid", "Model the FTP transfers as fluid TCP flows; VoIP stays packet-level", fluid);
     cmd.Parse(argc, argv);
     
+    if (realtime)
+    {
+        RealtimeEmulation::Enable(MilliSeconds(rtHardLimit));
+    }
+    if (!SelectScheduler(scheduler))
+    {
+        return 1;
+    }
+    if (profile)
+    {
+        ProfilingScheduler::Install(profileSample, SchedulerTypeName(scheduler));
+    }
+    
     LogComponentEnable("QoSMixedTraffic", LOG_LEVEL_INFO);
     
     NS_LOG_INFO("Creating QoS-enabled WAN topology");
@@ -171,6 +231,23 @@ int main(int argc, char *argv[])
     p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("50p"));
     NetDeviceContainer devRouterServer = p2p.Install(router, server);
     
+    // Hybrid mode: the FTP transfers become fluid TCP flows on the WAN
+    // link. The buffer is what they see in the packet run: the FTP band's
+    // FIFO (1000p) over the 50p device queue with QoS, and without it
+    // fq_codel's 5 ms target (about 5 packets) over the device queue.
+    // Either qdisc keeps VoIP apart from FTP, so VoIP only waits behind
+    // the device queue.
+    FluidBackground fluidFtp;
+    if (fluid)
+    {
+        if (!fluidFtp.Install(devRouterServer, MilliSeconds(2)))
+        {
+            return 1;
+        }
+        fluidFtp.SetTcp(536, 131072);   // ns-3 TcpSocket defaults
+        fluidFtp.SetBuffer(enableQos ? 1050 : 55, 50);
+    }
+    
     // ========================================================================
     // TRAFFIC CONTROL (QoS) CONFIGURATION
     // ========================================================================
@@ -205,6 +282,19 @@ int main(int argc, char *argv[])
     address.SetBase("10.1.2.0", "255.255.255.0");
     Ipv4InterfaceContainer ifRouterServer = address.Assign(devRouterServer);
     
+    // Real traffic enters at the router and leaves at the server; the
+    // endpoint subnets must exist before global routing is populated
+    RealtimeEmulation emulation;
+    if (realtime)
+    {
+        if ((!rtIngress.empty() && !emulation.AddEndpoint(router, rtIngress, "10.99.1.0", "255.255.255.0")) ||
+            (!rtEgress.empty() && !emulation.AddEndpoint(server, rtEgress, "10.99.2.0", "255.255.255.0")))
+        {
+            return 1;
+        }
+        emulation.EnableLagMonitor(MilliSeconds(100), Seconds(simTime));
+    }
+    
     // Enable global routing
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
     
@@ -249,20 +339,31 @@ int main(int argc, char *argv[])
     ftpSinkApp.Start(Seconds(1.0));
     ftpSinkApp.Stop(Seconds(simTime));
     
-    // FTP client (bulk send)
-    BulkSendHelper ftpClient("ns3::TcpSocketFactory",
-                             InetSocketAddress(ifRouterServer.GetAddress(1), ftpPort));
-    ftpClient.SetAttribute("MaxBytes", UintegerValue(createCongestion ? 10000000 : 1000000));
-    ftpClient.SetAttribute("SendSize", UintegerValue(1460));
-    
-    ApplicationContainer ftpClientApp = ftpClient.Install(client);
-    ftpClientApp.Start(Seconds(3.0));
-    ftpClientApp.Stop(Seconds(simTime));
+    // FTP client (bulk send), or a fluid flow of the same size
+    uint64_t ftpBytes = createCongestion ? 10000000 : 1000000;
+    if (fluid)
+    {
+        fluidFtp.AddFlow(Seconds(3.0), ftpBytes);
+        fluidFtp.Start(Seconds(simTime));
+    }
+    else
+    {
+        BulkSendHelper ftpClient("ns3::TcpSocketFactory",
+                                 InetSocketAddress(ifRouterServer.GetAddress(1), ftpPort));
+        ftpClient.SetAttribute("MaxBytes", UintegerValue(ftpBytes));
+        ftpClient.SetAttribute("SendSize", UintegerValue(1460));
+        
+        ApplicationContainer ftpClientApp = ftpClient.Install(client);
+        ftpClientApp.Start(Seconds(3.0));
+        ftpClientApp.Stop(Seconds(simTime));
+    }
     
     NS_LOG_INFO("FTP traffic: 1460 bytes (MSS), TCP bulk transfer, DSCP BE (0)");
     
     // --- Additional FTP flows to create congestion ---
-    if (createCongestion)
+    // Nothing listens on ports 22-24, so these connections are refused and
+    // carry no data; the fluid model leaves them out to match
+    if (createCongestion && !fluid)
     {
         NS_LOG_INFO("Creating additional FTP flows for congestion");
         
@@ -286,13 +387,60 @@ int main(int argc, char *argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     
+    MemoryAccounting memory;
+    if (memInterval > 0)
+    {
+        memory.AddQueues();
+        memory.AddFlowMonitor(monitor);
+        memory.EnableSampling(Seconds(memInterval), Seconds(simTime));
+    }
+    
+    // ========================================================================
+    // LIVE METRICS EXPORT
+    // ========================================================================
+    
+    MetricsRegistry metrics;
+    if (!metricsFile.empty())
+    {
+        metrics.AddQueueDepth();
+        metrics.AddFlowMonitor(monitor,
+                               DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()),
+                               [voipPort](const Ipv4FlowClassifier::FiveTuple& t) {
+                                   return std::string(t.destinationPort == voipPort ? "voip" : "ftp");
+                               });
+        if (metricsWallClock)
+        {
+            metrics.EnableWallClockExport(metricsFile, metricsInterval, Seconds(simTime));
+        }
+        else
+        {
+            metrics.EnableExport(metricsFile, Seconds(metricsInterval), Seconds(simTime));
+        }
+    }
+    
     // ========================================================================
     // PCAP TRACING
     // ========================================================================
     
+    SelectivePcap pcap("qos-mixed-traffic");
     if (enablePcap)
     {
-        p2p.EnablePcapAll("qos-mixed-traffic");
+        pcap.SetSnapLen(pcapSnapLen);
+        pcap.SetRotation(uint64_t(pcapFileSize * 1024 * 1024), Seconds(pcapFileTime), pcapRing);
+        if (!pcap.SetFilter(pcapFilter) || !pcap.Enable(pcapDevices))
+        {
+            return 1;
+        }
+    }
+    
+    // ========================================================================
+    // BINARY PACKET TRACE
+    // ========================================================================
+    
+    PacketTracer packetTracer;
+    if (!packetTrace.empty() && packetTracer.Open(packetTrace))
+    {
+        packetTracer.InstallAll();
     }
     
     // ========================================================================
@@ -313,7 +461,14 @@ int main(int argc, char *argv[])
     anim.UpdateNodeColor(router, 255, 165, 0);  // Orange
     anim.UpdateNodeColor(server, 0, 0, 255);    // Blue
     
-    anim.EnablePacketMetadata(true);
+    if (packetTracer.IsOpen())
+    {
+        anim.SkipPacketTracing();
+    }
+    else
+    {
+        anim.EnablePacketMetadata(true);
+    }
     
     // ========================================================================
     // RUN SIMULATION
@@ -326,6 +481,12 @@ int main(int argc, char *argv[])
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
     
+    if (packetTracer.IsOpen())
+    {
+        packetTracer.Close();
+        std::cout << "Packet trace: " << packetTracer.GetNRecords() << " records in " << packetTrace << "\n";
+    }
+    
     // ========================================================================
     // PERFORMANCE ANALYSIS
     // ========================================================================
@@ -394,6 +555,18 @@ int main(int argc, char *argv[])
         std::cout << "\n";
     }
     
+    if (fluid)
+    {
+        fluidFtp.PrintReport(std::cout);
+        std::cout << "\n";
+        for (uint32_t i = 0; i < fluidFtp.GetNFlows(); i++)
+        {
+            ftpThroughput += fluidFtp.GetThroughput(i);
+            ftpLoss += fluidFtp.GetLossPercent(i);
+            ftpFlows++;
+        }
+    }
+    
     // Summary
     std::cout << "========================================\n";
     std::cout << "SUMMARY\n";
@@ -444,6 +617,33 @@ int main(int argc, char *argv[])
         std::cout << "! Enable QoS to improve VoIP performance\n";
     }
     
+    if (enablePcap)
+    {
+        pcap.PrintSummary(std::cout);
+    }
+    
+    if (memInterval > 0)
+    {
+        memory.PrintReport(std::cout);
+    }
+    
+    if (!metricsFile.empty() && metrics.Export())
+    {
+        std::cout << "Metrics: " << metrics.GetNExports() << " exports to " << metricsFile << "\n";
+    }
+    
+    if (realtime)
+    {
+        emulation.StopProcesses();
+        emulation.PrintReport(std::cout);
+    }
+    
+    if (ProfilingScheduler* profiler = ProfilingScheduler::GetInstance())
+    {
+        profiler->PrintReport(std::cout, 15);
+        profiler->WriteFolded("qos-mixed-traffic-profile.folded");
+    }
+    
     Simulator::Destroy();
     
     NS_LOG_INFO("Simulation completed");
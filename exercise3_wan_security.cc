@@ -12,6 +12,11 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/netanim-module.h"
 
+#include "ladder-scheduler.h"
+#include "packet-trace-format.h"
+#include "profiling-scheduler.h"
+#include "realtime-emulation.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("WANSecuritySimulation");
@@ -299,6 +304,14 @@ int main(int argc, char *argv[])
     bool enableRateLimiting = false;
     bool enableEavesdropping = false;
     uint32_t numAttackers = 5;
+    std::string packetTrace = "";
+    bool profile = false;
+    uint32_t profileSample = 8;
+    std::string scheduler = "map";
+    bool realtime = false;
+    double rtHardLimit = 0;            // ms, 0 = best effort
+    std::string rtIngress = "";
+    std::string rtEgress = "";
     
     CommandLine cmd;
     cmd.AddValue("simTime", "Simulation time in seconds", simTime);
@@ -307,8 +320,29 @@ int main(int argc, char *argv[])
     cmd.AddValue("ratelimit", "Enable rate limiting", enableRateLimiting);
     cmd.AddValue("eavesdrop", "Enable eavesdropping simulation", enableEavesdropping);
     cmd.AddValue("attackers", "Number of DDoS attackers", numAttackers);
+    cmd.AddValue("packetTrace", "Write a binary packet trace to this file instead of NetAnim packet XML", packetTrace);
+    cmd.AddValue("profile", "Profile simulator events by callback", profile);
+    cmd.AddValue("profileSample", "Time one event in N when profiling", profileSample);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+    cmd.AddValue("realtime", "Run in real time so real traffic can pass through the WAN", realtime);
+    cmd.AddValue("rtHardLimit", "Abort when this many ms behind wall clock (0 = best effort)", rtHardLimit);
+    cmd.AddValue("rtIngress", "Real endpoint on the router's LAN side: tap:<name> or exec:<command>", rtIngress);
+    cmd.AddValue("rtEgress", "Real endpoint on the server: tap:<name> or exec:<command>", rtEgress);
     cmd.Parse(argc, argv);
     
+    if (realtime)
+    {
+        RealtimeEmulation::Enable(MilliSeconds(rtHardLimit));
+    }
+    if (!SelectScheduler(scheduler))
+    {
+        return 1;
+    }
+    if (profile)
+    {
+        ProfilingScheduler::Install(profileSample, SchedulerTypeName(scheduler));
+    }
+    
     LogComponentEnable("WANSecuritySimulation", LOG_LEVEL_INFO);
     
     NS_LOG_INFO("=== WAN Security Simulation ===");
@@ -384,6 +418,19 @@ int main(int argc, char *argv[])
         }
     }
     
+    // Real traffic enters at the router and leaves at the server; the
+    // endpoint subnets must exist before global routing is populated
+    RealtimeEmulation emulation;
+    if (realtime)
+    {
+        if ((!rtIngress.empty() && !emulation.AddEndpoint(router, rtIngress, "10.99.1.0", "255.255.255.0")) ||
+            (!rtEgress.empty() && !emulation.AddEndpoint(server, rtEgress, "10.99.2.0", "255.255.255.0")))
+        {
+            return 1;
+        }
+        emulation.EnableLagMonitor(MilliSeconds(100), Seconds(simTime));
+    }
+    
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
     
     // ========================================================================
@@ -473,6 +520,16 @@ int main(int argc, char *argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     
+    // ========================================================================
+    // BINARY PACKET TRACE
+    // ========================================================================
+    
+    PacketTracer packetTracer;
+    if (!packetTrace.empty() && packetTracer.Open(packetTrace))
+    {
+        packetTracer.InstallAll();
+    }
+    
     // ========================================================================
     // NETANIM CONFIGURATION
     // ========================================================================
@@ -509,7 +566,14 @@ int main(int argc, char *argv[])
         }
     }
     
-    anim.EnablePacketMetadata(true);
+    if (packetTracer.IsOpen())
+    {
+        anim.SkipPacketTracing();
+    }
+    else
+    {
+        anim.EnablePacketMetadata(true);
+    }
     
     // ========================================================================
     // RUN SIMULATION
@@ -520,6 +584,12 @@ int main(int argc, char *argv[])
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
     
+    if (packetTracer.IsOpen())
+    {
+        packetTracer.Close();
+        std::cout << "Packet trace: " << packetTracer.GetNRecords() << " records in " << packetTrace << "\n";
+    }
+    
     // ========================================================================
     // SECURITY ANALYSIS
     // ========================================================================
@@ -614,6 +684,18 @@ int main(int argc, char *argv[])
         std::cout << "ℹ  Expected throughput reduction: ~5-10%\n";
     }
     
+    if (realtime)
+    {
+        emulation.StopProcesses();
+        emulation.PrintReport(std::cout);
+    }
+    
+    if (ProfilingScheduler* profiler = ProfilingScheduler::GetInstance())
+    {
+        profiler->PrintReport(std::cout, 15);
+        profiler->WriteFolded("wan-security-profile.folded");
+    }
+    
     Simulator::Destroy();
     
     NS_LOG_INFO("Simulation completed");
@@ -11,6 +11,9 @@
 #include "ns3/netanim-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "flow-monitor-columnar.h"
+#include "ladder-scheduler.h"
+
 using namespace ns3;
 
 void DisableDevice(Ptr<NetDevice> a, Ptr<NetDevice> b)
@@ -22,6 +25,14 @@ void DisableDevice(Ptr<NetDevice> a, Ptr<NetDevice> b)
 
 int main(int argc, char *argv[])
 {
+  std::string scheduler = "map";
+  CommandLine cmd;
+  cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+  cmd.Parse(argc, argv);
+  if (!SelectScheduler(scheduler)) {
+    return 1;
+  }
+
   NodeContainer branch, dc, dr;
   branch.Create(1); dc.Create(1); dr.Create(1);
 
@@ -94,7 +105,9 @@ int main(int argc, char *argv[])
 
   Simulator::Stop(Seconds(18.0));
   Simulator::Run();
-  monitor->SerializeToXmlFile("exercise4_flow.xml", true, true);
+  FlowMonitorColumnar flows(monitor, fm.GetClassifier());
+  flows.WriteBinary("exercise4_flow.fmc");
+  flows.WriteCsv("exercise4_flow");
   Simulator::Destroy();
   return 0;
 }
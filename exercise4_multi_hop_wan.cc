@@ -13,6 +13,15 @@
 #include "ns3/netanim-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 
+#include "drop-accounting.h"
+#include "ladder-scheduler.h"
+#include "link-utilization.h"
+#include "metrics-registry.h"
+#include "profiling-scheduler.h"
+#include "route-change-log.h"
+#include "selective-pcap.h"
+#include "wan-traffic-engineering.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("MultiHopWANFaultTolerance");
@@ -22,11 +31,14 @@ Ptr<NetDevice> g_primaryLinkDevice;
 bool g_linkFailed = false;
 
 // Function to simulate link failure
+// NetDevice has no SetDown(); bring the IPv4 interface down instead so the
+// routing protocols are notified
 void SimulateLinkFailure()
 {
     NS_LOG_WARN("=== SIMULATING PRIMARY LINK FAILURE at t=" 
                 << Simulator::Now().GetSeconds() << "s ===");
-    g_primaryLinkDevice->SetDown();
+    Ptr<Ipv4> ipv4 = g_primaryLinkDevice->GetNode()->GetObject<Ipv4>();
+    ipv4->SetDown(ipv4->GetInterfaceForDevice(g_primaryLinkDevice));
     g_linkFailed = true;
 }
 
@@ -35,10 +47,18 @@ void RestoreLink()
 {
     NS_LOG_INFO("=== RESTORING PRIMARY LINK at t=" 
                 << Simulator::Now().GetSeconds() << "s ===");
-    g_primaryLinkDevice->SetUp();
+    Ptr<Ipv4> ipv4 = g_primaryLinkDevice->GetNode()->GetObject<Ipv4>();
+    ipv4->SetUp(ipv4->GetInterfaceForDevice(g_primaryLinkDevice));
     g_linkFailed = false;
 }
 
+// Re-place the traffic matrix on the surviving links and show the result
+void RecomputeTrafficEngineering(TeController* te)
+{
+    te->Compute();
+    te->PrintReport(std::cout);
+}
+
 // Custom trace callback for packet transmission
 void TxTrace(std::string context, Ptr<const Packet> packet)
 {
@@ -51,30 +71,69 @@ void RxTrace(std::string context, Ptr<const Packet> packet)
     NS_LOG_DEBUG("Packet received: " << packet->GetSize() << " bytes");
 }
 
-// Callback for packet drops
-void PacketDropTrace(std::string context, Ptr<const Packet> packet)
-{
-    NS_LOG_WARN("Packet DROPPED: " << packet->GetSize() << " bytes at " 
-                << Simulator::Now().GetSeconds() << "s");
-}
-
 int main(int argc, char *argv[])
 {
     // Simulation parameters
     double simTime = 30.0;
     double failureTime = 10.0;
     bool enablePcap = false;
+    std::string pcapDevices = "all";
+    std::string pcapFilter = "";
+    uint32_t pcapSnapLen = 0;
+    double pcapFileSize = 0;
+    double pcapFileTime = 0;
+    uint32_t pcapRing = 0;
     bool useDynamicRouting = false;  // false = static routing, true = OSPF
     bool restoreLink = false;
+    double dropSummaryInterval = 5.0;  // 0 = final report only
+    uint32_t dropSample = 0;           // print every Nth drop, 0 = none
+    bool enableTe = false;
+    double teLoad = 55.0;              // Mbps of bulk replication traffic
+    bool profile = false;
+    uint32_t profileSample = 8;
+    std::string metricsFile = "";
+    double metricsInterval = 1.0;
+    bool metricsWallClock = false;
+    std::string scheduler = "map";
+    double utilInterval = 0.1;
+    double utilGrowth = 20.0;
     
     CommandLine cmd;
     cmd.AddValue("simTime", "Simulation time in seconds", simTime);
     cmd.AddValue("failureTime", "Time to trigger link failure", failureTime);
     cmd.AddValue("pcap", "Enable PCAP tracing", enablePcap);
+    cmd.AddValue("pcapDevices", "Devices to capture: all, <node> or <node>/<device>, comma separated", pcapDevices);
+    cmd.AddValue("pcapFilter", "Capture filter, e.g. \"udp and dst port 9\" or \"dscp ef\"", pcapFilter);
+    cmd.AddValue("pcapSnapLen", "Bytes kept per captured packet (0 = whole packet)", pcapSnapLen);
+    cmd.AddValue("pcapFileSize", "Start a new capture file after this many MB (0 = no limit)", pcapFileSize);
+    cmd.AddValue("pcapFileTime", "Start a new capture file after this many seconds (0 = no limit)", pcapFileTime);
+    cmd.AddValue("pcapRing", "Keep only the last N capture files per device (0 = keep all)", pcapRing);
     cmd.AddValue("dynamic", "Use OSPF instead of static routing", useDynamicRouting);
     cmd.AddValue("restore", "Restore link after failure", restoreLink);
+    cmd.AddValue("dropSummary", "Drop summary interval in seconds (0 = final report only)",
+                 dropSummaryInterval);
+    cmd.AddValue("dropSample", "Log every Nth dropped packet (0 = none)", dropSample);
+    cmd.AddValue("te", "Place bulk traffic on bandwidth-aware TE paths", enableTe);
+    cmd.AddValue("teLoad", "Bulk Client -> DR-B traffic in Mbps (with --te)", teLoad);
+    cmd.AddValue("profile", "Profile simulator events by callback", profile);
+    cmd.AddValue("profileSample", "Time one event in N when profiling", profileSample);
+    cmd.AddValue("metrics", "Write live OpenMetrics counters to this file", metricsFile);
+    cmd.AddValue("metricsInterval", "Seconds between metrics exports", metricsInterval);
+    cmd.AddValue("metricsWallClock", "Interpret metricsInterval as wall-clock seconds", metricsWallClock);
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+    cmd.AddValue("utilInterval", "Link utilization sample interval in seconds (0 = off)", utilInterval);
+    cmd.AddValue("utilGrowth", "Traffic growth in percent for the link saturation list", utilGrowth);
     cmd.Parse(argc, argv);
     
+    if (!SelectScheduler(scheduler))
+    {
+        return 1;
+    }
+    if (profile)
+    {
+        ProfilingScheduler::Install(profileSample, SchedulerTypeName(scheduler));
+    }
+    
     LogComponentEnable("MultiHopWANFaultTolerance", LOG_LEVEL_INFO);
     
     NS_LOG_INFO("=== RegionalBank Multi-Hop WAN Simulation ===");
@@ -96,6 +155,10 @@ int main(int argc, char *argv[])
     Ptr<Node> dcA = nodes.Get(1);        // Data Center (Main Router)
     Ptr<Node> drB = nodes.Get(2);        // Disaster Recovery (Server)
     Ptr<Node> clientEnd = nodes.Get(3);  // End client at Branch-C
+    Names::Add("Branch-C", branchC);
+    Names::Add("DC-A", dcA);
+    Names::Add("DR-B", drB);
+    Names::Add("Client", clientEnd);
     
     // Install Internet stack
     InternetStackHelper stack;
@@ -256,10 +319,26 @@ int main(int argc, char *argv[])
         NS_LOG_INFO("Using Global Routing (OSPF-like) for dynamic convergence");
     }
     
-    // Print initial routing tables
-    Ptr<OutputStreamWrapper> routingStream = 
-        Create<OutputStreamWrapper>("multi-hop-routes.txt", std::ios::out);
-    Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(1.0), routingStream);
+    // Log route changes as they happen: initial tables at start-up, then
+    // only the entries each failure/restore/recompute event changes
+    // (rebuild any table with routing-snapshot-replay)
+    RouteChangeLog routeLog("multi-hop-routes.rlog");
+    routeLog.InstallAll();
+    
+    // Traffic engineering: the Client -> DR-B bulk demand does not fit the
+    // 10 Mbps Branch-DC hop of the shortest path, so CSPF places it on the
+    // backup link and splits off the remainder
+    TeController te;
+    if (enableTe)
+    {
+        te.Install(nodes);
+        te.AddDemand("bulk replication", branchC, drB,
+                     Ipv4Address("172.16.1.0"), Ipv4Mask("255.255.255.0"),
+                     ifDcDr.GetAddress(1), Ipv4Mask("255.255.255.255"),
+                     static_cast<uint64_t>(teLoad * 1e6));
+        te.Compute();
+        te.PrintReport(std::cout);
+    }
     
     // ========================================================================
     // APPLICATION SETUP
@@ -285,6 +364,31 @@ int main(int argc, char *argv[])
     clientApps.Start(Seconds(2.0));
     clientApps.Stop(Seconds(simTime));
     
+    if (enableTe)
+    {
+        // Bulk replication: several UDP flows so the ingress can hash them
+        // across the demand's LSPs
+        const uint32_t nBulkFlows = 8;
+        for (uint32_t i = 0; i < nBulkFlows; i++)
+        {
+            uint16_t port = 9000 + i;
+            PacketSinkHelper sink("ns3::UdpSocketFactory",
+                                  InetSocketAddress(Ipv4Address::GetAny(), port));
+            ApplicationContainer sinkApps = sink.Install(drB);
+            sinkApps.Start(Seconds(1.0));
+            sinkApps.Stop(Seconds(simTime));
+            
+            OnOffHelper bulk("ns3::UdpSocketFactory", InetSocketAddress(ifDcDr.GetAddress(1), port));
+            bulk.SetAttribute("DataRate", DataRateValue(DataRate(teLoad * 1e6 / nBulkFlows)));
+            bulk.SetAttribute("PacketSize", UintegerValue(1400));
+            bulk.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+            bulk.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+            ApplicationContainer bulkApps = bulk.Install(clientEnd);
+            bulkApps.Start(Seconds(3.0));
+            bulkApps.Stop(Seconds(simTime));
+        }
+    }
+    
     // ========================================================================
     // LINK FAILURE SIMULATION
     // ========================================================================
@@ -292,23 +396,26 @@ int main(int argc, char *argv[])
     if (failureTime > 0 && failureTime < simTime)
     {
         Simulator::Schedule(Seconds(failureTime), &SimulateLinkFailure);
-        
-        // Print routing tables after failure
-        Simulator::Schedule(Seconds(failureTime + 1.0),
-                           &Ipv4RoutingHelper::PrintRoutingTableAllAt,
-                           Seconds(failureTime + 1.0),
-                           routingStream);
+        if (enableTe)
+        {
+            Simulator::Schedule(Seconds(failureTime + 0.05), &RecomputeTrafficEngineering, &te);
+        }
         
         // Optionally restore link
         if (restoreLink && failureTime + 10.0 < simTime)
         {
             Simulator::Schedule(Seconds(failureTime + 10.0), &RestoreLink);
+            if (enableTe)
+            {
+                Simulator::Schedule(Seconds(failureTime + 10.05), &RecomputeTrafficEngineering, &te);
+            }
             
             // Recalculate routes if using dynamic routing
             if (useDynamicRouting)
             {
                 Simulator::Schedule(Seconds(failureTime + 10.1),
-                                   &Ipv4GlobalRoutingHelper::RecomputeRoutingTables);
+                                   &RouteChangeLog::RecomputeGlobalRoutes,
+                                   &routeLog);
             }
         }
     }
@@ -323,18 +430,66 @@ int main(int argc, char *argv[])
     Config::Connect("/NodeList/*/ApplicationList/*/$ns3::UdpEchoServer/Rx",
                     MakeCallback(&RxTrace));
     
-    // Track packet drops
-    Config::Connect("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/PhyTxDrop",
-                    MakeCallback(&PacketDropTrace));
+    // Count packet drops per node/device/layer/reason
+    DropAccounting drops;
+    drops.InstallAll();
+    drops.EnableSampledLog(dropSample);
+    if (dropSummaryInterval > 0)
+    {
+        drops.EnablePeriodicSummary(Seconds(dropSummaryInterval), Seconds(simTime));
+    }
+    
+    // Per-direction link utilization for circuit upgrade planning
+    LinkUtilization utilization;
+    if (utilInterval > 0)
+    {
+        utilization.InstallAll();
+        utilization.SetGrowth(utilGrowth / 100.0);
+        utilization.EnableSampling(Seconds(utilInterval), Seconds(simTime));
+    }
     
     // Flow Monitor
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     
     // PCAP tracing
+    SelectivePcap pcap("multi-hop-wan");
     if (enablePcap)
     {
-        p2p.EnablePcapAll("multi-hop-wan");
+        pcap.SetSnapLen(pcapSnapLen);
+        pcap.SetRotation(uint64_t(pcapFileSize * 1024 * 1024), Seconds(pcapFileTime), pcapRing);
+        if (!pcap.SetFilter(pcapFilter) || !pcap.Enable(pcapDevices))
+        {
+            return 1;
+        }
+    }
+    
+    // Live drops, route changes, queue depth and per-class delay
+    MetricsRegistry metrics;
+    if (!metricsFile.empty())
+    {
+        metrics.AddQueueDepth();
+        drops.PublishMetrics(metrics);
+        routeLog.PublishMetrics(metrics);
+        if (utilInterval > 0)
+        {
+            utilization.PublishMetrics(metrics);
+        }
+        metrics.AddFlowMonitor(monitor,
+                               DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()),
+                               [serverPort](const Ipv4FlowClassifier::FiveTuple& t) {
+                                   return std::string(t.destinationPort == serverPort ? "echo"
+                                                      : t.destinationPort >= 9000 ? "bulk"
+                                                                                  : "other");
+                               });
+        if (metricsWallClock)
+        {
+            metrics.EnableWallClockExport(metricsFile, metricsInterval, Seconds(simTime));
+        }
+        else
+        {
+            metrics.EnableExport(metricsFile, Seconds(metricsInterval), Seconds(simTime));
+        }
     }
     
     // ========================================================================
@@ -362,8 +517,7 @@ int main(int argc, char *argv[])
     anim.UpdateNodeColor(drB, 255, 0, 0);         // Red
     
     anim.EnablePacketMetadata(true);
-    anim.EnableIpv4RouteTracking("multi-hop-route-tracking.xml", 
-                                  Seconds(0), Seconds(simTime), Seconds(1));
+    routeLog.EnableAnimation(&anim);
     
     // ========================================================================
     // RUN SIMULATION
@@ -475,12 +629,37 @@ int main(int argc, char *argv[])
     std::cout << "  For critical banking applications: USE OSPF\n";
     std::cout << "  Reason: Automatic failover essential for business continuity\n";
     
+    drops.PrintReport(std::cout);
+    routeLog.PrintSummary(std::cout);
+    if (utilInterval > 0)
+    {
+        utilization.PrintReport(std::cout);
+    }
+    if (!metricsFile.empty() && metrics.Export())
+    {
+        std::cout << "Metrics: " << metrics.GetNExports() << " exports to " << metricsFile << "\n";
+    }
+    if (enableTe)
+    {
+        te.PrintReport(std::cout);
+    }
+    
+    if (enablePcap)
+    {
+        pcap.PrintSummary(std::cout);
+    }
+    
+    if (ProfilingScheduler* profiler = ProfilingScheduler::GetInstance())
+    {
+        profiler->PrintReport(std::cout, 15);
+        profiler->WriteFolded("multi-hop-wan-profile.folded");
+    }
+    
     Simulator::Destroy();
     
     NS_LOG_INFO("Simulation completed");
     NS_LOG_INFO("NetAnim file: multi-hop-wan-fault-tolerance.xml");
-    NS_LOG_INFO("Routing tables: multi-hop-routes.txt");
-    NS_LOG_INFO("Route tracking: multi-hop-route-tracking.xml");
+    NS_LOG_INFO("Route change log: multi-hop-routes.rlog");
     
     return 0;
 }
@@ -1,6 +1,29 @@
 /* exercise5.cc
- * Simple PBR demo: a router chooses path for traffic based on source port (application class).
- * Implementation toggles static next-hop for flows to a destination based on a simple policy.
+ * PBR demo: a router chooses the path for traffic to 10.200.0.2 based on the
+ * destination port (application class): video (4000) and data (5000).
+ *
+ * Three controllers are compared on the same scenario:
+ *  - toggle: the original PbrController, flipping 10.200.0.0/24 between the
+ *    primary and secondary cloud every 5 s; both classes always share a path
+ *  - pbr:    fixed Ipv4PolicyRouting rules (wan-policy-routing.h) ahead of
+ *    static routing: video on the 5 ms primary, data on the 30 ms secondary
+ *  - sdwan:  SdWanController, which measures both paths in-band with
+ *    TWAMP-light (twamp-light.h: one-way delay, jitter, loss) and moves each class's policy rule to a path that meets
+ *    the class SLA, with hysteresis against oscillation
+ * 10.200.0.2 is an anycast address configured on both clouds. With
+ * --impair, cross traffic congests the primary link for a while. The report
+ * gives per-class SLA compliance (share of 1 s intervals meeting the SLA,
+ * from FlowMonitor) for each controller.
+ *
+ *   exercise5 --mode=all --impair=true
+ *
+ * Route changes replace next hops in place (Ipv4PolicyRouting::ReplaceNextHop),
+ * so steering never leaves a window without a route. --flipInterval stresses
+ * this: the toggle flips every few milliseconds, the static fallback route
+ * is left out so the policy rule is the only route, and the run reports the
+ * no-route drops seen by DropAccounting, which must stay at zero.
+ *
+ *   exercise5 --mode=toggle --flipInterval=2 --impair=false
  */
 
 #include "ns3/core-module.h"
@@ -11,60 +34,332 @@
 #include "ns3/netanim-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "drop-accounting.h"
+#include "flow-monitor-columnar.h"
+#include "ladder-scheduler.h"
+#include "twamp-light.h"
+#include "wan-policy-routing.h"
+
 using namespace ns3;
 
 class PbrController {
 public:
-  PbrController(Ptr<Node> router, Ptr<Ipv4> ipv4)
-    : m_router(router), m_ipv4(ipv4), m_state(true) {}
+  // interfaces/gateways: router interface and next hop of the primary and
+  // secondary cloud
+  PbrController(Ptr<Node> router, Ptr<Ipv4PolicyRouting> policy, const uint32_t interfaces[2],
+                const Ipv4Address gateways[2], Time period = Seconds(5.0))
+    : m_router(router), m_policy(policy), m_period(period), m_state(true),
+      m_hasRule(false), m_rule(0), m_nToggles(0)
+  {
+    for (uint32_t i = 0; i < 2; i++) {
+      m_interfaces[i] = interfaces[i];
+      m_gateways[i] = gateways[i];
+    }
+  }
 
   void Start()
   {
-    // Evaluate every 5s: toggle route state (primary <-> secondary)
-    Simulator::Schedule(Seconds(5.0), &PbrController::Toggle, this);
+    // Evaluate every period: toggle route state (primary <-> secondary)
+    Simulator::Schedule(m_period, &PbrController::Toggle, this);
   }
 
+  // Destination network that we want to steer, as one policy rule whose
+  // next hop is replaced in place: no window without a route and no scan
+  // of the routing table
   void Toggle()
   {
-    // Destination network that we want to steer
-    Ipv4Address destNet("10.200.0.0");
-    Ipv4Mask mask("255.255.255.0");
-
-    Ipv4StaticRoutingHelper helper;
-    Ptr<Ipv4StaticRouting> staticRouting = helper.GetStaticRouting(m_ipv4);
-
-    // Remove any existing routes to destNet (naive)
-    uint32_t n = staticRouting->GetNRoutes();
-    for (int i = (int)n - 1; i >= 0; --i) {
-      Ipv4RoutingTableEntry e = staticRouting->GetRoute(i);
-      if (e.GetDestNetwork() == destNet && e.GetDestNetworkMask() == mask) {
-        staticRouting->RemoveRoute(i);
-      }
-    }
-
-    if (m_state) {
-      // Add route via primary (outIf=1)
-      staticRouting->AddNetworkRouteTo(destNet, mask, Ipv4Address("10.100.1.2"), 1);
-      std::cout << "PBR: steering via PRIMARY at " << Simulator::Now().GetSeconds() << "s\n";
+    Ipv4Address gateway = m_gateways[m_state ? 0 : 1];
+    uint32_t interface = m_interfaces[m_state ? 0 : 1];
+    if (!m_hasRule) {
+      Ipv4PolicyRule rule;
+      rule.destination = Ipv4Address("10.200.0.0");
+      rule.destinationLength = 24;
+      rule.interface = interface;
+      rule.gateway = gateway;
+      m_rule = m_policy->AddRule(rule);
+      m_hasRule = true;
     } else {
-      // Add route via secondary (outIf=2)
-      staticRouting->AddNetworkRouteTo(destNet, mask, Ipv4Address("10.100.2.2"), 2);
-      std::cout << "PBR: steering via SECONDARY at " << Simulator::Now().GetSeconds() << "s\n";
+      m_policy->ReplaceNextHop(m_rule, interface, gateway);
+    }
+    if (m_period >= Seconds(1.0)) {
+      std::cout << "PBR: steering via " << (m_state ? "PRIMARY" : "SECONDARY") << " at "
+                << Simulator::Now().GetSeconds() << "s\n";
     }
+    m_nToggles++;
     m_state = !m_state;
-    Simulator::Schedule(Seconds(5.0), &PbrController::Toggle, this);
+    Simulator::Schedule(m_period, &PbrController::Toggle, this);
   }
 
+  uint32_t GetNToggles() const { return m_nToggles; }
+
 private:
   Ptr<Node> m_router;
-  Ptr<Ipv4> m_ipv4;
+  Ptr<Ipv4PolicyRouting> m_policy;
+  uint32_t m_interfaces[2];
+  Ipv4Address m_gateways[2];
+  Time m_period;
   bool m_state;
+  bool m_hasRule;
+  uint32_t m_rule;
+  uint32_t m_nToggles;
 };
 
-int main(int argc, char *argv[])
+// ============================================================================
+// SLA CLASSES
+// ============================================================================
+
+struct SlaClass {
+  std::string name;
+  uint16_t port;         // destination port
+  uint32_t preferred;    // path index the class uses when all is well
+  double maxDelay;       // one-way, ms
+  double maxJitter;      // ms
+  double maxLoss;        // ratio
+};
+
+static const Ipv4Address g_service("10.200.0.2");  // anycast, on both clouds
+
+// Paths: 0 = primary (5 ms), 1 = secondary (30 ms)
+static std::vector<SlaClass> g_classes = {
+  {"video", 4000, 0, 50.0, 10.0, 0.01},
+  {"data", 5000, 1, 150.0, 50.0, 0.02},
+};
+
+// Policy rule sending one class's UDP traffic to the service via a path
+static Ipv4PolicyRule ClassRule(const SlaClass& c, uint32_t interface, Ipv4Address gateway)
+{
+  Ipv4PolicyRule rule;
+  rule.destination = g_service;
+  rule.destinationLength = 32;
+  rule.protocol = 17;
+  rule.dstPort = c.port;
+  rule.interface = interface;
+  rule.gateway = gateway;
+  return rule;
+}
+
+static bool MeetsSla(const SlaClass& c, double delayMs, double jitterMs, double loss)
 {
-  CommandLine cmd; cmd.Parse(argc, argv);
+  return delayMs <= c.maxDelay && jitterMs <= c.maxJitter && loss <= c.maxLoss;
+}
+
+// ============================================================================
+// SD-WAN CONTROLLER
+// ============================================================================
+
+// Measures every path with a TWAMP-light sender pinned to that path (in-band:
+// test packets queue behind the application traffic), evaluates each path
+// against each class SLA once per interval and moves a class's policy rule
+// only when its current path has failed for several intervals in a row and
+// another path passes. A class returns to its preferred path only after that
+// path has passed for longer and the hold-down since the last move expired.
+class SdWanController {
+public:
+  struct Path {
+    std::string name;
+    uint32_t interface;       // on the router
+    Ipv4Address gateway;      // reflector address on the far end
+    Ptr<TwampLightSender> probe;
+    // last evaluation
+    double delay;             // one-way, ms
+    double jitter;            // ms
+    double loss;
+  };
 
+  SdWanController(Ptr<Node> router, Ptr<Ipv4> ipv4, Ptr<Ipv4PolicyRouting> policy)
+    : m_router(router), m_ipv4(ipv4), m_policy(policy),
+      m_probeInterval(MilliSeconds(50)), m_evalInterval(Seconds(1.0)),
+      m_probeTimeout(Seconds(1.0)), m_holdDown(Seconds(5.0)),
+      m_failThreshold(2), m_recoverThreshold(5), m_nSwitches(0) {}
+
+  // The far end runs a TwampLightReflector
+  void AddPath(std::string name, uint32_t interface, Ipv4Address gateway)
+  {
+    Path p;
+    p.name = name; p.interface = interface; p.gateway = gateway;
+    p.delay = 0; p.jitter = 0; p.loss = 0;
+    m_paths.push_back(p);
+  }
+
+  void Start()
+  {
+    TwampLightHelper twamp;
+    twamp.SetAttribute("Interval", TimeValue(m_probeInterval));
+    twamp.SetAttribute("Timeout", TimeValue(m_probeTimeout));
+    twamp.SetAttribute("PacketSize", UintegerValue(64));
+    for (Path& p : m_paths) {
+      p.probe = twamp.InstallSender(m_router, p.gateway, m_ipv4->GetNetDevice(p.interface));
+      p.probe->SetStartTime(Seconds(0));
+    }
+    // Every class starts on its preferred path
+    m_current.clear();
+    m_rules.clear();
+    m_lastSwitch.assign(g_classes.size(), Seconds(0));
+    m_passStreak.assign(g_classes.size(), std::vector<uint32_t>(m_paths.size(), 0));
+    m_failStreak.assign(g_classes.size(), std::vector<uint32_t>(m_paths.size(), 0));
+    for (const SlaClass& c : g_classes) {
+      const Path& p = m_paths[c.preferred];
+      m_current.push_back(c.preferred);
+      m_rules.push_back(m_policy->AddRule(ClassRule(c, p.interface, p.gateway)));
+    }
+    Simulator::Schedule(m_evalInterval, &SdWanController::Evaluate, this);
+  }
+
+  uint32_t GetNSwitches() const { return m_nSwitches; }
+
+private:
+  void Evaluate()
+  {
+    Time now = Simulator::Now();
+    for (Path& p : m_paths) {
+      TwampLightStats stats = p.probe->TakeIntervalStats();
+      p.loss = stats.GetLoss();
+      if (stats.received > 0) {
+        p.delay = stats.GetMeanForwardDelay() * 1e3;
+        p.jitter = stats.GetJitter() * 1e3;
+      } else if (stats.lost > 0) {
+        p.delay = 1e9;  // nothing came back this interval
+      }
+    }
+
+    for (uint32_t c = 0; c < g_classes.size(); c++) {
+      for (uint32_t i = 0; i < m_paths.size(); i++) {
+        bool pass = MeetsSla(g_classes[c], m_paths[i].delay, m_paths[i].jitter, m_paths[i].loss);
+        m_passStreak[c][i] = pass ? m_passStreak[c][i] + 1 : 0;
+        m_failStreak[c][i] = pass ? 0 : m_failStreak[c][i] + 1;
+      }
+
+      uint32_t current = m_current[c];
+      uint32_t preferred = g_classes[c].preferred;
+      uint32_t target = current;
+      if (m_failStreak[c][current] >= m_failThreshold) {
+        // Leave a failing path, for the preferred one if it passes
+        for (uint32_t i = 0; i < m_paths.size(); i++) {
+          if (i != current && m_passStreak[c][i] > 0 && (target == current || i == preferred)) {
+            target = i;
+          }
+        }
+      } else if (current != preferred && now - m_lastSwitch[c] >= m_holdDown &&
+                 m_passStreak[c][preferred] >= m_recoverThreshold) {
+        // Fall back to the preferred path once it is stable again
+        target = preferred;
+      }
+      if (target != current) {
+        Steer(c, current, target);
+      }
+    }
+    Simulator::Schedule(m_evalInterval, &SdWanController::Evaluate, this);
+  }
+
+  void Steer(uint32_t c, uint32_t from, uint32_t to)
+  {
+    const SlaClass& cls = g_classes[c];
+    m_policy->ReplaceNextHop(m_rules[c], m_paths[to].interface, m_paths[to].gateway);
+    m_current[c] = to;
+    m_lastSwitch[c] = Simulator::Now();
+    m_nSwitches++;
+    const Path& p = m_paths[from];
+    std::cout << "SD-WAN: " << cls.name << " " << p.name << " -> " << m_paths[to].name
+              << " at " << Simulator::Now().GetSeconds() << "s (" << p.name << ": delay "
+              << p.delay << " ms, jitter " << p.jitter << " ms, loss " << p.loss * 100 << "%)\n";
+  }
+
+  Ptr<Node> m_router;
+  Ptr<Ipv4> m_ipv4;
+  Ptr<Ipv4PolicyRouting> m_policy;
+  std::vector<Path> m_paths;
+  std::vector<uint32_t> m_current;                  // per class
+  std::vector<uint32_t> m_rules;                    // policy rule id per class
+  std::vector<Time> m_lastSwitch;
+  std::vector<std::vector<uint32_t>> m_passStreak;  // [class][path]
+  std::vector<std::vector<uint32_t>> m_failStreak;
+  Time m_probeInterval;
+  Time m_evalInterval;
+  Time m_probeTimeout;
+  Time m_holdDown;
+  uint32_t m_failThreshold;
+  uint32_t m_recoverThreshold;
+  uint32_t m_nSwitches;
+};
+
+// ============================================================================
+// SLA COMPLIANCE
+// ============================================================================
+
+struct ClassCompliance {
+  uint32_t intervals;
+  uint32_t compliant;
+  uint64_t txPackets;
+  uint64_t rxPackets;
+  double delaySum;   // ms, over received packets
+};
+
+struct ScenarioResult {
+  std::string mode;
+  std::vector<ClassCompliance> classes;
+  uint32_t switches;
+  uint64_t noRouteDrops;
+  uint64_t generation;   // policy rule set version at the end of the run
+};
+
+// Per-interval FlowMonitor deltas, judged against each flow's class SLA
+class ComplianceMeter {
+public:
+  ComplianceMeter(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Time interval)
+    : m_monitor(monitor), m_classifier(classifier), m_interval(interval),
+      m_classes(g_classes.size(), ClassCompliance{0, 0, 0, 0, 0}) {}
+
+  void Start(Time at) { Simulator::Schedule(at, &ComplianceMeter::Sample, this); }
+  const std::vector<ClassCompliance>& GetClasses() const { return m_classes; }
+
+private:
+  void Sample()
+  {
+    std::map<FlowId, FlowMonitor::FlowStats> stats = m_monitor->GetFlowStats();
+    for (auto& flow : stats) {
+      Ipv4FlowClassifier::FiveTuple t = m_classifier->FindFlow(flow.first);
+      for (uint32_t c = 0; c < g_classes.size(); c++) {
+        if (t.destinationPort != g_classes[c].port) {
+          continue;
+        }
+        FlowMonitor::FlowStats& prev = m_previous[flow.first];
+        uint64_t tx = flow.second.txPackets - prev.txPackets;
+        uint64_t rx = flow.second.rxPackets - prev.rxPackets;
+        double delay = (flow.second.delaySum - prev.delaySum).GetMilliSeconds();
+        double jitter = (flow.second.jitterSum - prev.jitterSum).GetMilliSeconds();
+        prev = flow.second;
+        if (tx == 0) {
+          continue;
+        }
+        // Packets still in flight count as lost for this interval
+        double loss = rx >= tx ? 0 : double(tx - rx) / tx;
+        double meanDelay = rx > 0 ? delay / rx : 1e9;
+        double meanJitter = rx > 1 ? jitter / (rx - 1) : 0;
+        ClassCompliance& cc = m_classes[c];
+        cc.intervals++;
+        cc.compliant += MeetsSla(g_classes[c], meanDelay, meanJitter, loss) ? 1 : 0;
+        cc.txPackets += tx;
+        cc.rxPackets += rx;
+        cc.delaySum += delay;
+      }
+    }
+    Simulator::Schedule(m_interval, &ComplianceMeter::Sample, this);
+  }
+
+  Ptr<FlowMonitor> m_monitor;
+  Ptr<Ipv4FlowClassifier> m_classifier;
+  Time m_interval;
+  std::vector<ClassCompliance> m_classes;
+  std::map<FlowId, FlowMonitor::FlowStats> m_previous;
+};
+
+// ============================================================================
+// SCENARIO
+// ============================================================================
+
+static ScenarioResult RunScenario(std::string mode, double simTime, bool impair,
+                                  double impairStart, double impairStop, double flipInterval)
+{
   NodeContainer client, router, cloudA, cloudB;
   client.Create(1); router.Create(1); cloudA.Create(1); cloudB.Create(1);
 
@@ -92,56 +387,100 @@ int main(int argc, char *argv[])
   addr.SetBase("10.100.1.0", "255.255.255.0"); Ipv4InterfaceContainer ifr_ca = addr.Assign(drca);
   addr.SetBase("10.100.2.0", "255.255.255.0"); Ipv4InterfaceContainer ifr_cb = addr.Assign(drcb);
 
+  // The service address lives on both clouds so either path reaches a server
+  for (Ptr<Node> cloud : {cloudA.Get(0), cloudB.Get(0)}) {
+    cloud->GetObject<Ipv4>()->AddAddress(1, Ipv4InterfaceAddress(g_service, Ipv4Mask("255.255.255.255")));
+  }
+
   // Setup static default routing for client -> router
   Ipv4StaticRoutingHelper staticHelper;
   Ptr<Ipv4StaticRouting> clientRt = staticHelper.GetStaticRouting(client.Get(0)->GetObject<Ipv4>());
   clientRt->SetDefaultRoute(ifcr.GetAddress(1), 1);
 
-  // Add initial route on router to cloudA (primary)
+  // Router interfaces of the two cloud circuits, from their devices (0 is
+  // the loopback, the client link comes first)
   Ptr<Ipv4> ipv4Router = router.Get(0)->GetObject<Ipv4>();
+  uint32_t interfaces[] = {uint32_t(ipv4Router->GetInterfaceForDevice(drca.Get(0))),
+                           uint32_t(ipv4Router->GetInterfaceForDevice(drcb.Get(0)))};
+  Ipv4Address gateways[] = {ifr_ca.GetAddress(1), ifr_cb.GetAddress(1)};
+
+  // Static fallback route to cloudA (primary). Left out of the flip stress
+  // run: with it, a swap that left the policy rule without a next hop would
+  // still be routed and the no-route check could never fail
   Ptr<Ipv4StaticRouting> routerRt = staticHelper.GetStaticRouting(ipv4Router);
-  routerRt->AddNetworkRouteTo(Ipv4Address("10.200.0.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.100.1.2"), 1);
+  if (flipInterval <= 0) {
+    routerRt->AddNetworkRouteTo(Ipv4Address("10.200.0.0"), Ipv4Mask("255.255.255.0"), gateways[0], interfaces[0]);
+  }
 
   // Application flows:
   // Video (port 4000) - should be kept low-latency (we will observe it)
-  uint16_t videoPort = 4000;
-  OnOffHelper video("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address("10.200.0.2"), videoPort));
+  uint16_t videoPort = g_classes[0].port;
+  OnOffHelper video("ns3::UdpSocketFactory", InetSocketAddress(g_service, videoPort));
   video.SetAttribute("PacketSize", UintegerValue(200));
   video.SetAttribute("DataRate", StringValue("256kbps"));
-  video.SetAttribute("OnTime", StringString("ns3::ConstantRandomVariable[Constant=1]"));
-  video.SetAttribute("OffTime", StringString("ns3::ConstantRandomVariable[Constant=0]"));
+  video.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+  video.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
   ApplicationContainer videoApp = video.Install(client.Get(0));
   videoApp.Start(Seconds(2.0));
-  videoApp.Stop(Seconds(30.0));
+  videoApp.Stop(Seconds(simTime - 2.0));
 
   // Data flow (port 5000)
-  uint16_t dataPort = 5000;
-  OnOffHelper data("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address("10.200.0.2"), dataPort));
+  uint16_t dataPort = g_classes[1].port;
+  OnOffHelper data("ns3::UdpSocketFactory", InetSocketAddress(g_service, dataPort));
   data.SetAttribute("PacketSize", UintegerValue(1400));
   data.SetAttribute("DataRate", StringValue("1Mbps"));
-  data.SetAttribute("OnTime", StringString("ns3::ConstantRandomVariable[Constant=1]"));
-  data.SetAttribute("OffTime", StringString("ns3::ConstantRandomVariable[Constant=0]"));
+  data.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+  data.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
   ApplicationContainer dataApp = data.Install(client.Get(0));
   dataApp.Start(Seconds(3.0));
-  dataApp.Stop(Seconds(30.0));
+  dataApp.Stop(Seconds(simTime - 2.0));
 
-  // Sinks on cloudA initially (destination 10.200.0.2)
+  // Sinks on both clouds so either can receive a steered class
   PacketSinkHelper sink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), videoPort));
-  sink.Install(cloudA.Get(0))->Start(Seconds(0.0));
+  sink.Install(cloudA.Get(0)).Start(Seconds(0.0));
+  sink.Install(cloudB.Get(0)).Start(Seconds(0.0));
   PacketSinkHelper sinkD("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), dataPort));
-  sinkD.Install(cloudA.Get(0))->Start(Seconds(0.0));
+  sinkD.Install(cloudA.Get(0)).Start(Seconds(0.0));
+  sinkD.Install(cloudB.Get(0)).Start(Seconds(0.0));
 
-  // CloudB also listens so policy can steer there (we don't reconfigure sinks for brevity)
-  PacketSinkHelper sinkB("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), videoPort));
-  sinkB.Install(cloudB.Get(0))->Start(Seconds(0.0));
-  sinkD.Install(cloudB.Get(0))->Start(Seconds(0.0));
+  // Cross traffic congesting the primary link
+  if (impair) {
+    uint16_t crossPort = 6000;
+    OnOffHelper cross("ns3::UdpSocketFactory", InetSocketAddress(ifr_ca.GetAddress(1), crossPort));
+    cross.SetAttribute("PacketSize", UintegerValue(1400));
+    cross.SetAttribute("DataRate", StringValue("6Mbps"));
+    cross.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+    cross.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+    ApplicationContainer crossApp = cross.Install(router.Get(0));
+    crossApp.Start(Seconds(impairStart));
+    crossApp.Stop(Seconds(impairStop));
+    PacketSinkHelper crossSink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), crossPort));
+    crossSink.Install(cloudA.Get(0)).Start(Seconds(0.0));
+  }
 
-  // Start PBR controller
-  PbrController controller(router.Get(0), ipv4Router);
-  controller.Start();
+  // Start the controller under test; policy routing sits ahead of static
+  // routing and only sees rules in pbr/sdwan mode
+  Ipv4PolicyRoutingHelper policyHelper;
+  Ptr<Ipv4PolicyRouting> policy = policyHelper.Install(router.Get(0), 10);
+  PbrController toggle(router.Get(0), policy, interfaces, gateways,
+                       flipInterval > 0 ? MilliSeconds(flipInterval) : Seconds(5.0));
+  SdWanController sdwan(router.Get(0), ipv4Router, policy);
+  if (mode == "toggle") {
+    toggle.Start();
+  } else if (mode == "pbr") {
+    for (const SlaClass& c : g_classes) {
+      policy->AddRule(ClassRule(c, interfaces[c.preferred], gateways[c.preferred]));
+    }
+  } else {
+    TwampLightHelper twamp;
+    twamp.InstallReflector(NodeContainer(cloudA, cloudB)).Start(Seconds(0.0));
+    sdwan.AddPath("PRIMARY", interfaces[0], gateways[0]);
+    sdwan.AddPath("SECONDARY", interfaces[1], gateways[1]);
+    Simulator::Schedule(Seconds(1.0), &SdWanController::Start, &sdwan);
+  }
 
   // NetAnim + FlowMonitor
-  AnimationInterface anim("exercise5_anim.xml");
+  AnimationInterface anim(mode == "sdwan" ? "exercise5_anim.xml" : "exercise5_" + mode + "_anim.xml");
   anim.SetConstantPosition(client.Get(0), 10, 50);
   anim.SetConstantPosition(router.Get(0), 60, 50);
   anim.SetConstantPosition(cloudA.Get(0), 110, 30);
@@ -149,10 +488,85 @@ int main(int argc, char *argv[])
 
   FlowMonitorHelper fm;
   Ptr<FlowMonitor> monitor = fm.InstallAll();
+  ComplianceMeter meter(monitor, DynamicCast<Ipv4FlowClassifier>(fm.GetClassifier()), Seconds(1.0));
+  meter.Start(Seconds(4.0));
+
+  DropAccounting drops;
+  drops.InstallAll();
 
-  Simulator::Stop(Seconds(32.0));
+  std::cout << "\n=== Running " << mode << " controller ===\n";
+  Simulator::Stop(Seconds(simTime));
   Simulator::Run();
-  monitor->SerializeToXmlFile("exercise5_flow.xml", true, true);
+  std::string flowBase = mode == "sdwan" ? "exercise5_flow" : "exercise5_" + mode + "_flow";
+  FlowMonitorColumnar flows(monitor, fm.GetClassifier());
+  flows.WriteBinary(flowBase + ".fmc");
+  flows.WriteCsv(flowBase);
+
+  ScenarioResult result;
+  result.mode = mode;
+  result.classes = meter.GetClasses();
+  result.switches = mode == "toggle" ? toggle.GetNToggles()
+                    : mode == "pbr" ? 0 : sdwan.GetNSwitches();
+  result.noRouteDrops = drops.GetTotal(DropAccounting::NO_ROUTE);
+  result.generation = policy->GetGeneration();
   Simulator::Destroy();
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  std::string mode = "all";
+  double simTime = 32.0;
+  bool impair = true;
+  double impairStart = 10.0;
+  double impairStop = 20.0;
+  double flipInterval = 0;   // ms, 0 = the 5 s toggle
+  std::string scheduler = "map";
+
+  CommandLine cmd;
+  cmd.AddValue("mode", "Controller: toggle, pbr, sdwan or all", mode);
+  cmd.AddValue("simTime", "Simulation time in seconds", simTime);
+  cmd.AddValue("impair", "Congest the primary path with cross traffic", impair);
+  cmd.AddValue("impairStart", "Cross traffic start (s)", impairStart);
+  cmd.AddValue("impairStop", "Cross traffic stop (s)", impairStop);
+  cmd.AddValue("flipInterval", "Toggle period in ms for the hitless-swap stress (0 = 5 s)", flipInterval);
+  cmd.AddValue("scheduler", "Event scheduler: map, heap, list, calendar, priority or ladder", scheduler);
+  cmd.Parse(argc, argv);
+  if (!SelectScheduler(scheduler)) {
+    return 1;
+  }
+
+  std::vector<ScenarioResult> results;
+  for (std::string m : {"toggle", "pbr", "sdwan"}) {
+    if (mode == m || mode == "all") {
+      results.push_back(RunScenario(m, simTime, impair, impairStart, impairStop, flipInterval));
+    }
+  }
+
+  std::cout << "\n=== Per-class SLA compliance (1 s intervals) ===\n";
+  for (uint32_t c = 0; c < g_classes.size(); c++) {
+    const SlaClass& cls = g_classes[c];
+    std::cout << cls.name << " (delay <= " << cls.maxDelay << " ms, jitter <= " << cls.maxJitter
+              << " ms, loss <= " << cls.maxLoss * 100 << "%)\n";
+    for (const ScenarioResult& r : results) {
+      const ClassCompliance& cc = r.classes[c];
+      double compliance = cc.intervals > 0 ? 100.0 * cc.compliant / cc.intervals : 0;
+      double loss = cc.txPackets > 0 && cc.rxPackets < cc.txPackets
+                        ? 100.0 * (cc.txPackets - cc.rxPackets) / cc.txPackets : 0;
+      double delay = cc.rxPackets > 0 ? cc.delaySum / cc.rxPackets : 0;
+      std::cout << "  " << r.mode << ": " << compliance << "% compliant (" << cc.compliant << "/"
+                << cc.intervals << "), mean delay " << delay << " ms, loss " << loss << "%\n";
+    }
+  }
+  bool hitless = true;
+  for (const ScenarioResult& r : results) {
+    std::cout << "Route changes (" << r.mode << "): " << r.switches << ", rule generation "
+              << r.generation << ", no-route drops " << r.noRouteDrops << "\n";
+    hitless = hitless && r.noRouteDrops == 0;
+  }
+  if (!hitless) {
+    std::cout << "FAIL: packets were dropped for lack of a route during route changes\n";
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,239 @@
+/*
+ * FIB lookup benchmark
+ * Loads a synthetic full-table-sized prefix set into both Ipv4StaticRouting
+ * (linear list) and Ipv4FibRouting (DIR-24-8) on the same router and compares
+ * install time, RouteOutput lookup cost and memory.
+ *
+ * Example: fib-lookup-benchmark --prefixes=800000 --lookups=2000000
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "wan-fib-routing.h"
+
+#include <chrono>
+#include <random>
+#include <unordered_set>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("FibLookupBenchmark");
+
+// Prefix length mix of a typical Internet table: mostly /24, few longer than /24
+static uint8_t DrawPrefixLength(std::mt19937& rng)
+{
+    uint32_t r = rng() % 1000;
+    if (r < 600) return 24;
+    if (r < 700) return 23;
+    if (r < 780) return 22;
+    if (r < 840) return 21;
+    if (r < 880) return 20;
+    if (r < 910) return 19;
+    if (r < 930) return 16;
+    if (r < 990) return 8 + rng() % 16;
+    return 25 + rng() % 8;
+}
+
+static double ElapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t nPrefixes = 100000;
+    uint32_t nStaticPrefixes = 0;
+    uint32_t nLookups = 1000000;
+    uint32_t nStaticLookups = 1000;
+    uint32_t seed = 1;
+
+    CommandLine cmd;
+    cmd.AddValue("prefixes", "Number of prefixes in the FIB", nPrefixes);
+    cmd.AddValue("staticPrefixes", "Prefixes in the linear static table (0 = same as FIB)", nStaticPrefixes);
+    cmd.AddValue("lookups", "Number of FIB lookups", nLookups);
+    cmd.AddValue("staticLookups", "Number of static-table lookups (linear, keep small)", nStaticLookups);
+    cmd.AddValue("seed", "Seed for the synthetic table", seed);
+    cmd.Parse(argc, argv);
+
+    if (nStaticPrefixes == 0 || nStaticPrefixes > nPrefixes)
+    {
+        nStaticPrefixes = nPrefixes;
+    }
+    nStaticLookups = std::min(nStaticLookups, nLookups);
+
+    // Router with two upstream peers, so routes alternate between interfaces
+    NodeContainer nodes;
+    nodes.Create(3);
+    Ptr<Node> router = nodes.Get(0);
+
+    Ipv4FibRoutingHelper fibHelper;
+    Ipv4StaticRoutingHelper staticHelper;
+    Ipv4ListRoutingHelper list;
+    list.Add(fibHelper, 10);
+    list.Add(staticHelper, 0);
+
+    InternetStackHelper stack;
+    stack.SetRoutingHelper(list);
+    stack.Install(nodes);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("10Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("1ms"));
+    NetDeviceContainer devA = p2p.Install(router, nodes.Get(1));
+    NetDeviceContainer devB = p2p.Install(router, nodes.Get(2));
+
+    Ipv4AddressHelper address;
+    address.SetBase("192.168.1.0", "255.255.255.252");
+    Ipv4InterfaceContainer ifA = address.Assign(devA);
+    address.SetBase("192.168.2.0", "255.255.255.252");
+    Ipv4InterfaceContainer ifB = address.Assign(devB);
+
+    Ptr<Ipv4> ipv4 = router->GetObject<Ipv4>();
+    Ptr<Ipv4FibRouting> fib = fibHelper.GetFibRouting(ipv4);
+    Ptr<Ipv4StaticRouting> staticRouting = staticHelper.GetStaticRouting(ipv4);
+    uint32_t ifIndexA = ipv4->GetInterfaceForDevice(devA.Get(0));
+    uint32_t ifIndexB = ipv4->GetInterfaceForDevice(devB.Get(0));
+
+    // ========================================================================
+    // SYNTHETIC TABLE
+    // ========================================================================
+
+    std::mt19937 rng(seed);
+    std::vector<Ipv4FibRoute> routes;
+    std::unordered_set<uint64_t> seen;
+    routes.reserve(nPrefixes);
+    while (routes.size() < nPrefixes)
+    {
+        uint8_t length = DrawPrefixLength(rng);
+        uint32_t prefix = (0x01000000 + rng() % 0xdf000000) & (0xffffffffu << (32 - length));
+        if (!seen.insert((uint64_t(prefix) << 6) | length).second)
+        {
+            continue;
+        }
+        bool viaA = rng() & 1;
+        routes.push_back({Ipv4Address(prefix),
+                          length,
+                          viaA ? ifA.GetAddress(1) : ifB.GetAddress(1),
+                          viaA ? ifIndexA : ifIndexB,
+                          0});
+    }
+
+    std::cout << "\n=== FIB Lookup Benchmark ===\n";
+    std::cout << "Prefixes: " << nPrefixes << " (static table: " << nStaticPrefixes << ")\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nStaticPrefixes; i++)
+    {
+        const Ipv4FibRoute& r = routes[i];
+        staticRouting->AddNetworkRouteTo(r.network,
+                                         Ipv4Mask(0xffffffffu << (32 - r.prefixLength)),
+                                         r.gateway,
+                                         r.interface);
+    }
+    double staticInstall = ElapsedSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    fib->BulkInstall(routes);
+    double fibInstall = ElapsedSeconds(start);
+
+    // Half of the destinations fall inside a loaded prefix, half are random
+    std::vector<Ipv4Address> destinations;
+    destinations.reserve(nLookups);
+    for (uint32_t i = 0; i < nLookups; i++)
+    {
+        if (i & 1)
+        {
+            destinations.push_back(Ipv4Address(rng()));
+        }
+        else
+        {
+            const Ipv4FibRoute& r = routes[rng() % nStaticPrefixes];
+            uint32_t host = r.prefixLength == 32 ? 0 : rng() & (0xffffffffu >> r.prefixLength);
+            destinations.push_back(Ipv4Address(r.network.Get() | host));
+        }
+    }
+
+    // ========================================================================
+    // LOOKUPS
+    // ========================================================================
+
+    Ipv4Header header;
+    Socket::SocketErrno sockerr;
+
+    uint32_t fibHits = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nLookups; i++)
+    {
+        header.SetDestination(destinations[i]);
+        if (fib->RouteOutput(0, header, 0, sockerr))
+        {
+            fibHits++;
+        }
+    }
+    double fibLookup = ElapsedSeconds(start);
+
+    uint32_t staticHits = 0;
+    std::vector<Ipv4Address> staticGateways(nStaticLookups);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nStaticLookups; i++)
+    {
+        header.SetDestination(destinations[i]);
+        Ptr<Ipv4Route> route = staticRouting->RouteOutput(0, header, 0, sockerr);
+        if (route)
+        {
+            staticHits++;
+            staticGateways[i] = route->GetGateway();
+        }
+    }
+    double staticLookup = ElapsedSeconds(start);
+
+    // Both tables must agree wherever they hold the same prefixes
+    uint32_t mismatches = 0;
+    if (nStaticPrefixes == nPrefixes)
+    {
+        for (uint32_t i = 0; i < nStaticLookups; i++)
+        {
+            header.SetDestination(destinations[i]);
+            Ptr<Ipv4Route> route = fib->RouteOutput(0, header, 0, sockerr);
+            Ipv4Address gateway = route ? route->GetGateway() : Ipv4Address();
+            if (gateway != staticGateways[i])
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    // ========================================================================
+    // REPORT
+    // ========================================================================
+
+    double fibNs = fibLookup * 1e9 / nLookups;
+    double staticNs = nStaticLookups > 0 ? staticLookup * 1e9 / nStaticLookups : 0;
+
+    std::cout << "\nInstall time:\n";
+    std::cout << "  Ipv4StaticRouting (AddNetworkRouteTo): " << staticInstall << " s\n";
+    std::cout << "  Ipv4FibRouting (BulkInstall):          " << fibInstall << " s\n";
+
+    std::cout << "\nRouteOutput lookup cost:\n";
+    std::cout << "  Ipv4StaticRouting: " << staticNs << " ns/lookup (" << nStaticLookups
+              << " lookups, " << staticHits << " hits)\n";
+    std::cout << "  Ipv4FibRouting:    " << fibNs << " ns/lookup (" << nLookups << " lookups, "
+              << fibHits << " hits, " << (fibLookup > 0 ? nLookups / fibLookup / 1e6 : 0)
+              << " Mlookups/s)\n";
+    if (fibNs > 0 && staticNs > 0)
+    {
+        std::cout << "  Speedup: " << staticNs / fibNs << "x\n";
+    }
+
+    std::cout << "\nFIB memory: " << fib->GetMemoryUsage() / (1024.0 * 1024.0) << " MB\n";
+    if (nStaticPrefixes == nPrefixes)
+    {
+        std::cout << "Next-hop mismatches vs static table: " << mismatches << "\n";
+    }
+
+    Simulator::Destroy();
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,533 @@
+/*
+ * Columnar FlowMonitor export
+ * Replacement for FlowMonitor::SerializeToXmlFile on large runs: every
+ * per-flow statistic becomes one contiguous column, so a 100k-flow run is
+ * written with a handful of sequential writes and analysis tools can mmap
+ * the file and read a column without parsing anything.
+ *
+ * Binary layout (.fmc, host byte order, all offsets 8-byte aligned):
+ *   FlowColumnFileHeader    32 bytes, magic "FMCOL001"
+ *   FlowColumnDescriptor[]  64 bytes each: name, type, count, offset
+ *   column data
+ *
+ * Flow columns hold one value per flow, in flow id order. Variable-length
+ * data is stored CSR style: "<name>.offsets" has nFlows + 1 entries and
+ * flow i owns elements [offsets[i], offsets[i + 1]) of the value columns.
+ *   delay/jitter/packet_size/flow_interruptions histograms
+ *       <h>.bin_width (per flow), <h>.offsets, <h>.counts (bin i starts
+ *       at i * bin_width)
+ *   drops.offsets, drops.packets, drops.bytes (indexed by drop reason)
+ * Probe statistics form a separate table of (probe, flow) rows, columns
+ * prefixed "probe.".
+ *
+ * WriteCsv writes the same data as <base>-flows.csv, <base>-histograms.csv
+ * (non-empty bins only) and <base>-probes.csv.
+ *
+ * Usage:
+ *   FlowMonitorColumnar flows(monitor, flowmonHelper.GetClassifier());
+ *   flows.WriteBinary("run_flow.fmc");
+ *   flows.WriteCsv("run_flow");
+ */
+
+#ifndef FLOW_MONITOR_COLUMNAR_H
+#define FLOW_MONITOR_COLUMNAR_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+// ============================================================================
+// FILE FORMAT
+// ============================================================================
+
+struct FlowColumnFileHeader
+{
+    char magic[8];       // "FMCOL001"
+    uint32_t byteOrder;  // 0x01020304 as written by the producer
+    uint32_t nColumns;
+    uint64_t nFlows;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FlowColumnFileHeader) == 32, "FlowColumnFileHeader must stay 32 bytes");
+
+struct FlowColumnDescriptor
+{
+    enum Type
+    {
+        U32 = 1,
+        U64 = 2,
+        I64 = 3,
+        F64 = 4
+    };
+
+    char name[40];       // NUL-terminated
+    uint32_t type;
+    uint32_t elementSize;
+    uint64_t count;      // elements
+    uint64_t offset;     // from the start of the file
+};
+
+static_assert(sizeof(FlowColumnDescriptor) == 64, "FlowColumnDescriptor must stay 64 bytes");
+
+// ============================================================================
+// EXPORTER
+// ============================================================================
+
+class FlowMonitorColumnar
+{
+public:
+    // Snapshots the monitor (after CheckForLostPackets), like
+    // SerializeToXmlFile's enableHistograms/enableProbes flags
+    FlowMonitorColumnar(Ptr<FlowMonitor> monitor,
+                        Ptr<FlowClassifier> classifier,
+                        bool histograms = true,
+                        bool probes = true);
+
+    bool WriteBinary(std::string filename) const;
+    bool WriteCsv(std::string basename) const;
+
+    uint64_t GetNFlows() const { return m_nFlows; }
+
+private:
+    struct Column
+    {
+        std::string name;
+        uint32_t type;
+        uint32_t elementSize;
+        uint64_t count;
+        std::vector<uint8_t> data;
+
+        template <class T>
+        void Push(T value)
+        {
+            std::size_t at = data.size();
+            data.resize(at + sizeof(T));
+            std::memcpy(&data[at], &value, sizeof(T));
+            count++;
+        }
+
+        template <class T>
+        T At(uint64_t i) const
+        {
+            T value;
+            std::memcpy(&value, &data[i * sizeof(T)], sizeof(T));
+            return value;
+        }
+    };
+
+    Column& Add(std::string name, FlowColumnDescriptor::Type type);
+    const Column* Find(std::string name) const;
+    void AddHistogram(std::string name, const std::vector<const Histogram*>& histograms);
+
+    uint64_t m_nFlows;
+    std::vector<Column> m_columns;
+};
+
+inline FlowMonitorColumnar::Column& FlowMonitorColumnar::Add(std::string name,
+                                                             FlowColumnDescriptor::Type type)
+{
+    Column c;
+    c.name = name;
+    c.type = type;
+    c.elementSize = (type == FlowColumnDescriptor::U32) ? 4 : 8;
+    c.count = 0;
+    c.data.reserve(m_nFlows * c.elementSize);
+    m_columns.push_back(c);
+    return m_columns.back();
+}
+
+inline const FlowMonitorColumnar::Column* FlowMonitorColumnar::Find(std::string name) const
+{
+    for (const Column& c : m_columns)
+    {
+        if (c.name == name)
+        {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+inline FlowMonitorColumnar::FlowMonitorColumnar(Ptr<FlowMonitor> monitor,
+                                                Ptr<FlowClassifier> classifier,
+                                                bool histograms,
+                                                bool probes)
+{
+    monitor->CheckForLostPackets();
+    const FlowMonitor::FlowStatsContainer& stats = monitor->GetFlowStats();
+    Ptr<Ipv4FlowClassifier> ipv4 = DynamicCast<Ipv4FlowClassifier>(classifier);
+    m_nFlows = stats.size();
+    // Add() may reallocate m_columns, so columns are filled by index
+    m_columns.reserve(64);
+
+    const char* scalars[] = {"flow_id",        "src_addr",        "dst_addr",        "protocol",
+                             "src_port",       "dst_port",        "tx_packets",      "rx_packets",
+                             "lost_packets",   "times_forwarded", "tx_bytes",        "rx_bytes",
+                             "first_tx_ns",    "last_tx_ns",      "first_rx_ns",     "last_rx_ns",
+                             "delay_sum_ns",   "jitter_sum_ns",   "last_delay_ns"};
+    for (uint32_t i = 0; i < 19; i++)
+    {
+        Add(scalars[i], i < 10 ? FlowColumnDescriptor::U32
+                        : i < 12 ? FlowColumnDescriptor::U64
+                                 : FlowColumnDescriptor::I64);
+    }
+    std::size_t dropBase = m_columns.size();
+    Add("drops.offsets", FlowColumnDescriptor::U64).Push<uint64_t>(0);
+    Add("drops.packets", FlowColumnDescriptor::U32);
+    Add("drops.bytes", FlowColumnDescriptor::U64);
+
+    std::vector<const Histogram*> delay, jitter, size, interruptions;
+    for (const auto& kv : stats)
+    {
+        const FlowMonitor::FlowStats& s = kv.second;
+        Ipv4FlowClassifier::FiveTuple t = {};
+        if (ipv4)
+        {
+            t = ipv4->FindFlow(kv.first);
+        }
+        uint32_t u32[] = {kv.first,
+                          ipv4 ? t.sourceAddress.Get() : 0,
+                          ipv4 ? t.destinationAddress.Get() : 0,
+                          ipv4 ? t.protocol : 0u,
+                          t.sourcePort,
+                          t.destinationPort,
+                          s.txPackets,
+                          s.rxPackets,
+                          s.lostPackets,
+                          s.timesForwarded};
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            m_columns[i].Push(u32[i]);
+        }
+        m_columns[10].Push(s.txBytes);
+        m_columns[11].Push(s.rxBytes);
+        int64_t i64[] = {s.timeFirstTxPacket.GetNanoSeconds(),
+                         s.timeLastTxPacket.GetNanoSeconds(),
+                         s.timeFirstRxPacket.GetNanoSeconds(),
+                         s.timeLastRxPacket.GetNanoSeconds(),
+                         s.delaySum.GetNanoSeconds(),
+                         s.jitterSum.GetNanoSeconds(),
+                         s.lastDelay.GetNanoSeconds()};
+        for (uint32_t i = 0; i < 7; i++)
+        {
+            m_columns[12 + i].Push(i64[i]);
+        }
+
+        std::size_t nReasons = std::max(s.packetsDropped.size(), s.bytesDropped.size());
+        for (std::size_t r = 0; r < nReasons; r++)
+        {
+            m_columns[dropBase + 1].Push<uint32_t>(r < s.packetsDropped.size() ? s.packetsDropped[r] : 0);
+            m_columns[dropBase + 2].Push<uint64_t>(r < s.bytesDropped.size() ? s.bytesDropped[r] : 0);
+        }
+        m_columns[dropBase].Push<uint64_t>(m_columns[dropBase + 1].count);
+
+        delay.push_back(&s.delayHistogram);
+        jitter.push_back(&s.jitterHistogram);
+        size.push_back(&s.packetSizeHistogram);
+        interruptions.push_back(&s.flowInterruptionsHistogram);
+    }
+
+    if (histograms)
+    {
+        AddHistogram("delay", delay);
+        AddHistogram("jitter", jitter);
+        AddHistogram("packet_size", size);
+        AddHistogram("flow_interruptions", interruptions);
+    }
+
+    if (probes)
+    {
+        std::size_t probeBase = m_columns.size();
+        Add("probe.probe_id", FlowColumnDescriptor::U32);
+        Add("probe.flow_id", FlowColumnDescriptor::U32);
+        Add("probe.packets", FlowColumnDescriptor::U32);
+        Add("probe.bytes", FlowColumnDescriptor::U64);
+        Add("probe.delay_from_first_probe_sum_ns", FlowColumnDescriptor::I64);
+        const FlowMonitor::FlowProbeContainer& all = monitor->GetAllProbes();
+        for (uint32_t p = 0; p < all.size(); p++)
+        {
+            for (const auto& kv : all[p]->GetStats())
+            {
+                m_columns[probeBase].Push<uint32_t>(p);
+                m_columns[probeBase + 1].Push<uint32_t>(kv.first);
+                m_columns[probeBase + 2].Push<uint32_t>(kv.second.packets);
+                m_columns[probeBase + 3].Push<uint64_t>(kv.second.bytes);
+                m_columns[probeBase + 4].Push<int64_t>(kv.second.delayFromFirstProbeSum.GetNanoSeconds());
+            }
+        }
+    }
+}
+
+// Histogram bins are uniform and start at zero, so only the width and the
+// dense counts up to the last used bin are kept
+inline void FlowMonitorColumnar::AddHistogram(std::string name,
+                                              const std::vector<const Histogram*>& histograms)
+{
+    std::size_t base = m_columns.size();
+    Add(name + ".bin_width", FlowColumnDescriptor::F64);
+    Add(name + ".offsets", FlowColumnDescriptor::U64).Push<uint64_t>(0);
+    Add(name + ".counts", FlowColumnDescriptor::U32);
+    for (const Histogram* h : histograms)
+    {
+        // Histogram's bin accessors are not const-qualified
+        Histogram& hist = const_cast<Histogram&>(*h);
+        uint32_t nBins = hist.GetNBins();
+        m_columns[base].Push<double>(nBins > 0 ? hist.GetBinWidth(0) : 0.0);
+        for (uint32_t b = 0; b < nBins; b++)
+        {
+            m_columns[base + 2].Push<uint32_t>(hist.GetBinCount(b));
+        }
+        m_columns[base + 1].Push<uint64_t>(m_columns[base + 2].count);
+    }
+}
+
+inline bool FlowMonitorColumnar::WriteBinary(std::string filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+    {
+        std::cerr << "FlowMonitorColumnar: cannot write " << filename << "\n";
+        return false;
+    }
+
+    FlowColumnFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "FMCOL001", 8);
+    header.byteOrder = 0x01020304;
+    header.nColumns = m_columns.size();
+    header.nFlows = m_nFlows;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header) + m_columns.size() * sizeof(FlowColumnDescriptor);
+    for (const Column& c : m_columns)
+    {
+        FlowColumnDescriptor d;
+        std::memset(&d, 0, sizeof(d));
+        std::strncpy(d.name, c.name.c_str(), sizeof(d.name) - 1);
+        d.type = c.type;
+        d.elementSize = c.elementSize;
+        d.count = c.count;
+        d.offset = offset;
+        out.write(reinterpret_cast<const char*>(&d), sizeof(d));
+        offset += (c.data.size() + 7) / 8 * 8;
+    }
+
+    static const char pad[8] = {0};
+    for (const Column& c : m_columns)
+    {
+        out.write(reinterpret_cast<const char*>(c.data.data()), c.data.size());
+        out.write(pad, (8 - c.data.size() % 8) % 8);
+    }
+    return bool(out);
+}
+
+inline bool FlowMonitorColumnar::WriteCsv(std::string basename) const
+{
+    std::ofstream flows(basename + "-flows.csv");
+    std::ofstream hist(basename + "-histograms.csv");
+    std::ofstream probes(basename + "-probes.csv");
+    if (!flows || !hist || !probes)
+    {
+        std::cerr << "FlowMonitorColumnar: cannot write " << basename << "-*.csv\n";
+        return false;
+    }
+
+    // Per-flow table: every column with one value per flow
+    std::vector<const Column*> scalars;
+    for (const Column& c : m_columns)
+    {
+        if (c.name.find('.') == std::string::npos)
+        {
+            scalars.push_back(&c);
+        }
+    }
+    for (std::size_t i = 0; i < scalars.size(); i++)
+    {
+        flows << (i ? "," : "") << scalars[i]->name;
+    }
+    flows << "\n";
+    for (uint64_t f = 0; f < m_nFlows; f++)
+    {
+        for (std::size_t i = 0; i < scalars.size(); i++)
+        {
+            const Column& c = *scalars[i];
+            flows << (i ? "," : "");
+            if (c.name == "src_addr" || c.name == "dst_addr")
+            {
+                flows << Ipv4Address(c.At<uint32_t>(f));
+            }
+            else if (c.type == FlowColumnDescriptor::U32)
+            {
+                flows << c.At<uint32_t>(f);
+            }
+            else if (c.type == FlowColumnDescriptor::U64)
+            {
+                flows << c.At<uint64_t>(f);
+            }
+            else
+            {
+                flows << c.At<int64_t>(f);
+            }
+        }
+        flows << "\n";
+    }
+
+    const Column* ids = Find("flow_id");
+    hist << "flow_id,histogram,bin_start,bin_width,count\n";
+    for (const char* name : {"delay", "jitter", "packet_size", "flow_interruptions"})
+    {
+        const Column* width = Find(std::string(name) + ".bin_width");
+        const Column* offsets = Find(std::string(name) + ".offsets");
+        const Column* counts = Find(std::string(name) + ".counts");
+        if (!width || !offsets || !counts)
+        {
+            continue;
+        }
+        for (uint64_t f = 0; f < m_nFlows; f++)
+        {
+            double w = width->At<double>(f);
+            uint64_t first = offsets->At<uint64_t>(f);
+            for (uint64_t b = first; b < offsets->At<uint64_t>(f + 1); b++)
+            {
+                uint32_t n = counts->At<uint32_t>(b);
+                if (n > 0)
+                {
+                    hist << ids->At<uint32_t>(f) << "," << name << "," << (b - first) * w << "," << w
+                         << "," << n << "\n";
+                }
+            }
+        }
+    }
+
+    probes << "probe_id,flow_id,packets,bytes,delay_from_first_probe_sum_ns\n";
+    if (const Column* probeIds = Find("probe.probe_id"))
+    {
+        const Column* flowIds = Find("probe.flow_id");
+        const Column* packets = Find("probe.packets");
+        const Column* bytes = Find("probe.bytes");
+        const Column* delay = Find("probe.delay_from_first_probe_sum_ns");
+        for (uint64_t r = 0; r < probeIds->count; r++)
+        {
+            probes << probeIds->At<uint32_t>(r) << "," << flowIds->At<uint32_t>(r) << ","
+                   << packets->At<uint32_t>(r) << "," << bytes->At<uint64_t>(r) << ","
+                   << delay->At<int64_t>(r) << "\n";
+        }
+    }
+    return bool(flows) && bool(hist) && bool(probes);
+}
+
+// ============================================================================
+// READER
+// ============================================================================
+
+// Maps a .fmc file read-only; columns are returned in place, no copying
+class FlowColumnReader
+{
+public:
+    FlowColumnReader() : m_base(nullptr), m_length(0) {}
+    ~FlowColumnReader() { Close(); }
+
+    bool Open(std::string filename);
+    void Close();
+
+    uint64_t GetNFlows() const { return Header()->nFlows; }
+    uint32_t GetNColumns() const { return Header()->nColumns; }
+    const FlowColumnDescriptor& GetDescriptor(uint32_t i) const { return Descriptors()[i]; }
+
+    // Null if the column is missing or T does not match its element size
+    template <class T>
+    const T* GetColumn(std::string name, uint64_t* count = nullptr) const
+    {
+        for (uint32_t i = 0; i < GetNColumns(); i++)
+        {
+            const FlowColumnDescriptor& d = Descriptors()[i];
+            if (name == d.name && d.elementSize == sizeof(T))
+            {
+                if (count)
+                {
+                    *count = d.count;
+                }
+                return reinterpret_cast<const T*>(m_base + d.offset);
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    const FlowColumnFileHeader* Header() const
+    {
+        return reinterpret_cast<const FlowColumnFileHeader*>(m_base);
+    }
+    const FlowColumnDescriptor* Descriptors() const
+    {
+        return reinterpret_cast<const FlowColumnDescriptor*>(m_base + sizeof(FlowColumnFileHeader));
+    }
+
+    const uint8_t* m_base;
+    std::size_t m_length;
+};
+
+inline bool FlowColumnReader::Open(std::string filename)
+{
+    Close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(FlowColumnFileHeader))
+    {
+        std::cerr << "FlowColumnReader: cannot read " << filename << "\n";
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "FlowColumnReader: mmap failed for " << filename << "\n";
+        return false;
+    }
+    m_base = static_cast<const uint8_t*>(base);
+    m_length = st.st_size;
+
+    bool valid = std::memcmp(Header()->magic, "FMCOL001", 8) == 0 && Header()->byteOrder == 0x01020304 &&
+                 sizeof(FlowColumnFileHeader) + uint64_t(GetNColumns()) * sizeof(FlowColumnDescriptor) <=
+                     m_length;
+    for (uint32_t i = 0; valid && i < GetNColumns(); i++)
+    {
+        const FlowColumnDescriptor& d = Descriptors()[i];
+        valid = d.offset + d.count * d.elementSize <= m_length;
+    }
+    if (!valid)
+    {
+        std::cerr << "FlowColumnReader: " << filename << " is not a valid columnar flow file\n";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+inline void FlowColumnReader::Close()
+{
+    if (m_base)
+    {
+        ::munmap(const_cast<uint8_t*>(m_base), m_length);
+        m_base = nullptr;
+        m_length = 0;
+    }
+}
+
+} // namespace ns3
+
+#endif /* FLOW_MONITOR_COLUMNAR_H */
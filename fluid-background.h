@@ -0,0 +1,481 @@
+/*
+ * Fluid model for background bulk traffic
+ * Replaces long TCP bulk transfers over a bottleneck with rate equations,
+ * so only the foreground traffic under study is simulated packet by
+ * packet. Each flow follows the TCP window model of Misra, Gong and
+ * Towsley ("Fluid-based Analysis of a Network of AQM Routers Supporting
+ * TCP Flows", SIGCOMM 2000):
+ *   dW/dt = 1/R - W/2 * l         (W/R in slow start, until the first loss)
+ *   dq/dt = sum W/R - (C - foreground rate)
+ *   R     = R0 + q/C
+ * where l is the flow's rate of loss events (at most one per RTT, as
+ * NewReno halves once per window), W is capped by the receive window and
+ * losses come from a drop-tail buffer that overflows. CUBIC grows its
+ * window differently, but with a buffer of a BDP or more both keep the
+ * link full. A flow sends its byte count plus retransmissions and ends
+ * when its last byte has left the buffer. The state advances in steps of
+ * R/8 (at most maxStep), and not at all while no flow is active, so a
+ * transfer costs a few hundred events instead of several per segment.
+ *
+ * The bottleneck is moved onto a FluidChannel, which delays every
+ * foreground packet in the loaded direction by the part of the fluid
+ * backlog it has to wait behind: the device queue when a priority or
+ * flow-queueing qdisc keeps foreground packets apart from the bulk
+ * traffic, the whole buffer when both share one FIFO. Foreground bytes on
+ * the link are metered and taken off the capacity left to the fluid.
+ * Foreground packets keep their own transmission time and are not dropped
+ * by the fluid.
+ *
+ * Usage (once the bottleneck devices exist, before PopulateRoutingTables):
+ *   FluidBackground fluid;
+ *   fluid.Install(devRouterServer, MilliSeconds(2)); // RTT outside the link
+ *   fluid.SetTcp(536, 131072);                       // segment, receive window
+ *   fluid.SetBuffer(1050, 50);                       // packets: all, shared
+ *   fluid.AddFlow(Seconds(3.0), 10000000);
+ *   fluid.Start(Seconds(simTime));
+ *   ...
+ *   fluid.PrintReport(std::cout);
+ */
+
+#ifndef FLUID_BACKGROUND_H
+#define FLUID_BACKGROUND_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace ns3
+{
+
+class FluidBackground;
+
+// Point-to-point channel that holds back packets sent by its first device
+// for the fluid queueing delay
+class FluidChannel : public PointToPointChannel
+{
+public:
+    static TypeId GetTypeId();
+    FluidChannel();
+
+    void SetFluid(FluidBackground* fluid) { m_fluid = fluid; }
+
+    bool TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime) override;
+
+private:
+    FluidBackground* m_fluid;
+};
+
+class FluidBackground
+{
+public:
+    FluidBackground();
+
+    // Move the link between devices.Get(0) and devices.Get(1) onto a
+    // FluidChannel; the fluid flows run from the first device to the
+    // second. accessRtt is the round trip of the flows outside the link.
+    bool Install(NetDeviceContainer devices, Time accessRtt);
+    // Segment payload and receive window of the modelled TCP flows
+    // (defaults are ns-3's TcpSocket defaults: 536 and 131072 bytes)
+    void SetTcp(uint32_t segmentSize, uint32_t receiveWindow);
+    // Bottleneck buffer, and how much of it foreground packets wait
+    // behind, in packets of the fluid flows
+    void SetBuffer(uint32_t packets, uint32_t sharedPackets);
+    // Longest integration step (default 10 ms)
+    void SetMaxStep(Time step) { m_maxStep = step; }
+
+    void AddFlow(Time start, uint64_t bytes);
+    void Start(Time stop);
+
+    // Extra delay for a foreground packet of this many bytes entering the
+    // link now; called by FluidChannel
+    Time ForegroundDelay(uint32_t bytes);
+
+    uint32_t GetNFlows() const { return m_flows.size(); }
+    // IP-level throughput from first send to last delivery, as FlowMonitor
+    // computes it for packet flows
+    double GetThroughput(uint32_t i) const;
+    double GetLossPercent(uint32_t i) const;
+
+    void PrintReport(std::ostream& os) const;
+
+private:
+    struct Flow
+    {
+        double start;          // s
+        uint64_t bytes;
+        double window;         // segments
+        bool slowStart;
+        double remaining;      // payload still to send, retransmissions included
+        double queued;         // wire bytes in the bottleneck buffer
+        double sent;           // segments
+        double lost;
+        double delivered;
+        double firstTx;        // s, -1 before the first segment
+        double lastRx;
+        bool done;
+    };
+
+    void Step();
+    bool Active(const Flow& flow, double now) const;
+    double Rtt() const { return m_baseRtt + m_queue * 8 / m_capacity; }
+    double WireSize() const { return m_segment + 42.0; }   // TCP/IP and PPP headers
+
+    // Time constant of the foreground rate estimate, s
+    static constexpr double FOREGROUND_TAU = 0.1;
+
+    Ptr<FluidChannel> m_channel;
+    Ptr<UniformRandomVariable> m_uniform;
+    std::vector<Flow> m_flows;
+    double m_capacity;         // bit/s
+    double m_accessRtt;        // s
+    double m_linkDelay;
+    double m_baseRtt;
+    uint32_t m_segment;
+    uint32_t m_window;
+    uint32_t m_bufferPackets;
+    uint32_t m_sharedPackets;
+    Time m_maxStep;
+    Time m_stop;
+
+    double m_queue;            // wire bytes
+    double m_last;             // time of the previous step, s
+    double m_foregroundBytes;  // since the previous step
+    double m_foregroundRate;   // bit/s
+    uint64_t m_steps;
+    double m_busyTime;         // s with an active flow or a backlog
+    double m_queueIntegral;    // byte-seconds
+    double m_maxQueue;
+    double m_servedBytes;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FluidChannel);
+
+inline TypeId FluidChannel::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::FluidChannel")
+                            .SetParent<PointToPointChannel>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<FluidChannel>();
+    return tid;
+}
+
+inline FluidChannel::FluidChannel()
+    : m_fluid(nullptr)
+{
+}
+
+inline FluidBackground::FluidBackground()
+    : m_capacity(0),
+      m_accessRtt(0),
+      m_linkDelay(0),
+      m_baseRtt(0),
+      m_segment(536),
+      m_window(131072),
+      m_bufferPackets(100),
+      m_sharedPackets(100),
+      m_maxStep(MilliSeconds(10)),
+      m_queue(0),
+      m_last(0),
+      m_foregroundBytes(0),
+      m_foregroundRate(0),
+      m_steps(0),
+      m_busyTime(0),
+      m_queueIntegral(0),
+      m_maxQueue(0),
+      m_servedBytes(0)
+{
+}
+
+inline bool FluidBackground::Install(NetDeviceContainer devices, Time accessRtt)
+{
+    Ptr<PointToPointNetDevice> src = DynamicCast<PointToPointNetDevice>(devices.Get(0));
+    Ptr<PointToPointNetDevice> dst = DynamicCast<PointToPointNetDevice>(devices.Get(1));
+    if (!src || !dst)
+    {
+        std::cerr << "FluidBackground: the bottleneck must be a point-to-point link\n";
+        return false;
+    }
+
+    DataRateValue rate;
+    src->GetAttribute("DataRate", rate);
+    TimeValue delay;
+    src->GetChannel()->GetAttribute("Delay", delay);
+    m_capacity = rate.Get().GetBitRate();
+    m_accessRtt = accessRtt.GetSeconds();
+    m_linkDelay = delay.Get().GetSeconds();
+
+    // The devices stay as configured (queues, qdiscs, addresses); only the
+    // channel between them is replaced
+    m_channel = CreateObject<FluidChannel>();
+    m_channel->SetAttribute("Delay", delay);
+    m_channel->SetFluid(this);
+    src->Attach(m_channel);
+    dst->Attach(m_channel);
+    m_uniform = CreateObject<UniformRandomVariable>();
+    return true;
+}
+
+inline void FluidBackground::SetTcp(uint32_t segmentSize, uint32_t receiveWindow)
+{
+    m_segment = segmentSize;
+    m_window = receiveWindow;
+}
+
+inline void FluidBackground::SetBuffer(uint32_t packets, uint32_t sharedPackets)
+{
+    m_bufferPackets = packets;
+    m_sharedPackets = std::min(sharedPackets, packets);
+}
+
+inline void FluidBackground::AddFlow(Time start, uint64_t bytes)
+{
+    Flow flow;
+    flow.start = start.GetSeconds();
+    flow.bytes = bytes;
+    flow.window = 10;   // ns-3 InitialCwnd
+    flow.slowStart = true;
+    flow.remaining = bytes;
+    flow.queued = 0;
+    flow.sent = 0;
+    flow.lost = 0;
+    flow.delivered = 0;
+    flow.firstTx = -1;
+    flow.lastRx = -1;
+    flow.done = false;
+    m_flows.push_back(flow);
+}
+
+inline void FluidBackground::Start(Time stop)
+{
+    if (!m_channel)
+    {
+        std::cerr << "FluidBackground: Install must come before Start\n";
+        return;
+    }
+    m_stop = stop;
+    m_baseRtt = m_accessRtt + 2 * m_linkDelay + WireSize() * 8 / m_capacity;
+    m_last = Simulator::Now().GetSeconds();
+    Simulator::ScheduleNow(&FluidBackground::Step, this);
+}
+
+// A flow sends once its handshake is done and until all bytes are out
+inline bool FluidBackground::Active(const Flow& flow, double now) const
+{
+    return !flow.done && now >= flow.start + m_baseRtt;
+}
+
+inline void FluidBackground::Step()
+{
+    double now = Simulator::Now().GetSeconds();
+    double dt = now - m_last;
+    m_last = now;
+    m_steps++;
+
+    if (dt > 0)
+    {
+        double gain = dt / (dt + FOREGROUND_TAU);
+        m_foregroundRate += gain * (m_foregroundBytes * 8 / dt - m_foregroundRate);
+        m_foregroundBytes = 0;
+
+        // Explicit Euler over [now - dt, now] from the state at its start
+        double rtt = Rtt();
+        double wire = WireSize();
+        double serviceBytes = std::max(0.0, m_capacity - m_foregroundRate) / 8 * dt;
+        double bufferBytes = m_bufferPackets * wire;
+
+        std::vector<double> offered(m_flows.size(), 0.0);
+        double totalOffered = 0;
+        for (std::size_t i = 0; i < m_flows.size(); i++)
+        {
+            Flow& flow = m_flows[i];
+            if (Active(flow, now - dt) && flow.remaining > 0)
+            {
+                double bytes = flow.window * wire / rtt * dt;
+                offered[i] = std::min(bytes, flow.remaining / m_segment * wire);
+                totalOffered += offered[i];
+            }
+        }
+
+        // Drop-tail: whatever would overflow the buffer is lost, spread
+        // over the flows in proportion to what they offered
+        double overflow = m_queue + totalOffered - serviceBytes - bufferBytes;
+        double lossFraction = overflow > 0 && totalOffered > 0 ? std::min(1.0, overflow / totalOffered) : 0;
+        double arrived = totalOffered * (1 - lossFraction);
+        double served = std::min(m_queue + arrived, serviceBytes);
+        double backlog = m_queue + arrived;
+
+        for (std::size_t i = 0; i < m_flows.size(); i++)
+        {
+            Flow& flow = m_flows[i];
+            if (offered[i] > 0)
+            {
+                double segments = offered[i] / wire;
+                double lost = segments * lossFraction;
+                if (flow.firstTx < 0)
+                {
+                    flow.firstTx = now - dt;
+                }
+                flow.sent += segments;
+                flow.lost += lost;
+                flow.remaining -= (segments - lost) * m_segment;
+                if (flow.remaining < 1)
+                {
+                    flow.remaining = 0;
+                }
+                flow.queued += offered[i] - lost * wire;
+
+                if (lost > 0 && flow.slowStart)
+                {
+                    flow.slowStart = false;
+                    flow.window /= 2;
+                }
+                else
+                {
+                    double increase = flow.slowStart ? flow.window / rtt : 1 / rtt;
+                    double events = std::min(lost / dt, 1 / rtt);
+                    flow.window += (increase - flow.window / 2 * events) * dt;
+                }
+                flow.window = std::max(1.0, std::min(flow.window, double(m_window) / m_segment));
+            }
+
+            // FIFO service, shared in proportion to each flow's backlog
+            if (flow.queued > 0 && backlog > 0)
+            {
+                double out = std::min(flow.queued, served * flow.queued / backlog);
+                flow.queued -= out;
+                flow.delivered += out / wire;
+                flow.lastRx = now;
+            }
+            if (!flow.done && flow.firstTx >= 0 && flow.remaining <= 0 && flow.queued < 1)
+            {
+                flow.done = true;
+                flow.queued = 0;
+            }
+        }
+
+        m_queue = std::max(0.0, backlog - served);
+        m_servedBytes += served;
+        m_queueIntegral += m_queue * dt;
+        m_maxQueue = std::max(m_maxQueue, m_queue);
+        if (totalOffered > 0 || m_queue > 0)
+        {
+            m_busyTime += dt;
+        }
+    }
+
+    if (now >= m_stop.GetSeconds())
+    {
+        return;
+    }
+
+    // Idle until the next flow starts, otherwise a fraction of an RTT
+    bool busy = m_queue > 0;
+    double nextStart = -1;
+    for (const Flow& flow : m_flows)
+    {
+        if (flow.done)
+        {
+            continue;
+        }
+        double begin = flow.start + m_baseRtt;
+        if (begin <= now)
+        {
+            busy = true;
+        }
+        else if (nextStart < 0 || begin < nextStart)
+        {
+            nextStart = begin;
+        }
+    }
+    Time next;
+    if (busy)
+    {
+        next = std::min(m_maxStep, std::max(MicroSeconds(100), Seconds(Rtt() / 8)));
+    }
+    else if (nextStart >= 0)
+    {
+        next = Seconds(nextStart - now);
+    }
+    else
+    {
+        return;
+    }
+    Simulator::Schedule(std::min(next, m_stop - Simulator::Now()), &FluidBackground::Step, this);
+}
+
+inline Time FluidBackground::ForegroundDelay(uint32_t bytes)
+{
+    m_foregroundBytes += bytes;
+    double wire = WireSize();
+    double shared = std::min(m_queue, m_sharedPackets * wire);
+    if (shared <= 0)
+    {
+        return Time(0);
+    }
+    // The fluid packet at the head of the queue is already partly sent
+    double ahead = std::max(0.0, shared - m_uniform->GetValue(0, 1) * wire);
+    return Seconds(ahead * 8 / m_capacity);
+}
+
+inline double FluidBackground::GetThroughput(uint32_t i) const
+{
+    const Flow& flow = m_flows[i];
+    double duration = flow.lastRx - flow.firstTx;
+    return duration > 0 ? flow.delivered * (m_segment + 40) * 8 / duration / 1e6 : 0;
+}
+
+inline double FluidBackground::GetLossPercent(uint32_t i) const
+{
+    const Flow& flow = m_flows[i];
+    return flow.sent > 0 ? flow.lost / flow.sent * 100 : 0;
+}
+
+inline void FluidBackground::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Fluid Background Traffic ===\n";
+    os << "Bottleneck " << m_capacity / 1e6 << " Mbps, base RTT " << m_baseRtt * 1e3 << " ms, buffer "
+       << m_bufferPackets << " packets (" << m_sharedPackets << " shared with foreground), "
+       << m_steps << " fluid steps\n";
+    os << std::fixed << std::setprecision(2);
+    for (uint32_t i = 0; i < m_flows.size(); i++)
+    {
+        const Flow& flow = m_flows[i];
+        os << "  flow " << i + 1 << ": start " << flow.start << " s, " << flow.bytes << " bytes, "
+           << flow.delivered << " segments delivered, loss " << GetLossPercent(i) << "%, "
+           << GetThroughput(i) << " Mbps";
+        if (flow.done)
+        {
+            os << ", finished at " << flow.lastRx << " s";
+        }
+        os << "\n";
+    }
+    if (m_busyTime > 0)
+    {
+        os << "  Busy " << m_busyTime << " s, utilization " << m_servedBytes * 8 / (m_capacity * m_busyTime) * 100
+           << "%, mean queue " << m_queueIntegral / m_busyTime / WireSize() << " packets, max "
+           << m_maxQueue / WireSize() << "\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+inline bool FluidChannel::TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime)
+{
+    // Only the arrival is deferred: the sending device finishes the
+    // transmission on its own timer, so it does not stall behind the fluid
+    if (m_fluid && src == GetSource(0))
+    {
+        txTime += m_fluid->ForegroundDelay(p->GetSize());
+    }
+    return PointToPointChannel::TransmitStart(p, src, txTime);
+}
+
+} // namespace ns3
+
+#endif /* FLUID_BACKGROUND_H */
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Accuracy and speed of exercise2's fluid background mode against packets.
+
+Runs each QoS scenario over the same random streams twice, once with the
+FTP transfers as real TCP packets and once with --fluid=1, and compares
+the means of what the exercise is about: VoIP delay, jitter and loss, and
+the FTP transfer's goodput and loss. The FTP figures are taken from the
+data flow to port 21 only; the packet run's "Total Throughput" also
+counts the ACK stream and the refused connections to ports 22-24, which
+the fluid model has no counterpart for. A metric passes when the fluid
+mean is within --tolerance of the packet mean, or within the metric's
+absolute floor for values near zero. The wall-clock speedup of the fluid
+runs is reported and must reach --min-speedup.
+
+Usage (after ./ns3 build):
+  fluid-validation.py --ns3 ~/ns-3-dev
+  fluid-validation.py --ns3 ~/ns-3-dev --scenarios qos-off --runs 10 --tolerance 0.05
+  fluid-validation.py --ns3 ~/ns-3-dev -- --congestion=0
+
+Arguments after -- are passed to both modes of every scenario.
+"""
+
+import argparse
+import concurrent.futures
+import importlib.util
+import os
+import re
+import shutil
+import statistics
+import sys
+import tempfile
+
+# metric: absolute difference that always passes
+METRICS = {
+    "voip.mean_delay_ms": 2.0,
+    "voip.mean_jitter_ms": 0.5,
+    "voip.loss_pct": 0.5,
+    "ftp.data_mbps": 0.05,
+    "ftp.data_loss_pct": 0.5,
+}
+
+FTP_PORT = 21
+NUMBER = r"(-?[0-9.]+(?:e[-+]?[0-9]+)?)"
+
+
+def load_regression():
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scenario-regression.py")
+    spec = importlib.util.spec_from_file_location("scenario_regression", path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def parse_ftp_data(output):
+    """Goodput and loss of the FTP data flow: the FlowMonitor block of the
+    flow to port 21 in a packet run, the fluid report in a fluid run"""
+    results = {}
+    block = None
+    for line in output.splitlines():
+        m = re.match(r"^\s+flow 1: .*loss ([0-9.]+)%, ([0-9.]+) Mbps", line)
+        if m:
+            results["ftp.data_loss_pct"] = float(m.group(1))
+            results["ftp.data_mbps"] = float(m.group(2))
+        if re.match(r"^Flow \d+ ", line):
+            block = {}
+        elif block is not None and not line.strip():
+            if block.get("port") == FTP_PORT and "mbps" in block:
+                results["ftp.data_mbps"] = block["mbps"]
+                results["ftp.data_loss_pct"] = block.get("loss", 0.0)
+            block = None
+        elif block is not None:
+            m = re.match(r"^\s+\S+ -> \S+:(\d+)$", line)
+            if m:
+                block["port"] = int(m.group(1))
+            m = re.match(r"^\s+Throughput: " + NUMBER + " Mbps", line)
+            if m:
+                block["mbps"] = float(m.group(1))
+            m = re.match(r"^\s+Packet Loss: " + NUMBER + "%", line)
+            if m:
+                block["loss"] = float(m.group(1))
+    return results
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("--ns3", required=True, help="ns-3 tree the exercises were built in")
+    ap.add_argument("--scenarios", default="qos,qos-off",
+                    help="comma separated exercise2 scenarios from scenario-regression.py")
+    ap.add_argument("--runs", type=int, default=5, help="RngRuns per scenario and mode")
+    ap.add_argument("--first-run", type=int, default=1, help="first RngRun")
+    ap.add_argument("--tolerance", type=float, default=0.10,
+                    help="allowed relative difference of the fluid mean")
+    ap.add_argument("--min-speedup", type=float, default=10.0,
+                    help="required packet/fluid wall time ratio (0 = report only)")
+    ap.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="parallel processes")
+    ap.add_argument("extra", nargs="*", help="arguments for both modes (after --)")
+    opts = ap.parse_args()
+
+    regression = load_regression()
+    names = [n for n in opts.scenarios.split(",") if n]
+    for name in names:
+        if name not in regression.SCENARIOS or \
+                regression.SCENARIOS[name][0] != "exercise2_qos_implementation":
+            ap.error("%s is not an exercise2 scenario of scenario-regression.py" % name)
+    program = regression.SCENARIOS[names[0]][0]
+    executable = regression.find_program(opts.ns3, program)
+    if executable is None:
+        ap.error("no built executable for %s under %s/build" % (program, opts.ns3))
+
+    root = tempfile.mkdtemp(prefix="fluid-validation-")
+
+    def run(name, fluid, rng_run):
+        _, args, parser = regression.SCENARIOS[name]
+        args = args + opts.extra + (["--fluid=1"] if fluid else [])
+        workdir = os.path.join(root, "%s-%s-%d" % (name, "fluid" if fluid else "packet", rng_run))
+        os.makedirs(workdir)
+        code, output, wall, _ = regression.run_once(opts.ns3, executable, args, workdir, rng_run)
+        shutil.rmtree(workdir, ignore_errors=True)
+        if code != 0:
+            raise RuntimeError("%s %s RngRun=%d exited with %d:\n%s"
+                               % (name, "fluid" if fluid else "packet", rng_run, code,
+                                  "\n".join(output.splitlines()[-10:])))
+        results = parser(output)
+        results.update(parse_ftp_data(output))
+        return name, fluid, results, wall
+
+    jobs = [(name, fluid, rng_run) for name in names for fluid in (False, True)
+            for rng_run in range(opts.first_run, opts.first_run + opts.runs)]
+    collected = {}
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, opts.jobs)) as pool:
+        futures = [pool.submit(run, *job) for job in jobs]
+        try:
+            for future in concurrent.futures.as_completed(futures):
+                name, fluid, results, wall = future.result()
+                entry = collected.setdefault((name, fluid), {"wall": [], "results": {}})
+                entry["wall"].append(wall)
+                for key, value in results.items():
+                    entry["results"].setdefault(key, []).append(value)
+        except RuntimeError as e:
+            print("FAIL %s" % e, file=sys.stderr)
+            for future in futures:
+                future.cancel()
+            return 1
+    shutil.rmtree(root, ignore_errors=True)
+
+    failed = 0
+    for name in names:
+        packet, fluid = collected[(name, False)], collected[(name, True)]
+        print("\n=== %s: %d runs per mode (RngRun %d-%d) ===" % (
+            name, opts.runs, opts.first_run, opts.first_run + opts.runs - 1))
+        print("%-22s %12s %12s %9s" % ("metric", "packet", "fluid", "diff"))
+        for key, floor in METRICS.items():
+            if key not in packet["results"] or key not in fluid["results"]:
+                print("%-22s missing from the %s runs"
+                      % (key, "packet" if key not in packet["results"] else "fluid"))
+                failed += 1
+                continue
+            p = statistics.mean(packet["results"][key])
+            f = statistics.mean(fluid["results"][key])
+            diff = (f - p) / p * 100 if p else 0.0
+            ok = abs(f - p) <= max(opts.tolerance * abs(p), floor)
+            failed += not ok
+            print("%-22s %12.4g %12.4g %+8.1f%%%s" % (key, p, f, diff, "" if ok else "  FAIL"))
+
+        speedup = sum(packet["wall"]) / max(sum(fluid["wall"]), 1e-9)
+        ok = opts.min_speedup <= 0 or speedup >= opts.min_speedup
+        failed += not ok
+        print("%-22s %11.3fs %11.3fs %8.1fx%s" % ("wall (mean)", statistics.mean(packet["wall"]),
+                                                   statistics.mean(fluid["wall"]), speedup,
+                                                   "" if ok else "  FAIL"))
+
+    print("\n%d check(s) failed" % failed)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,321 @@
+/*
+ * Ladder queue scheduler
+ * An O(1) amortised event queue after Tang, Goh and Thng, "Ladder Queue: An
+ * O(1) Priority Queue Structure for Large-Scale Discrete Event Simulation"
+ * (ACM TOMACS 15(3), 2005). Events live in three tiers:
+ *   Top     unsorted vector for far-future events (time >= m_topStart)
+ *   Ladder  rungs of time buckets; each rung splits one bucket of the rung
+ *           above it into narrower buckets, down to MAX_RUNGS
+ *   Bottom  a short sorted run of the most imminent events
+ * Only Bottom is ever sorted, and only THRESHOLD events at a time, so the
+ * cost per event does not grow with the queue size the way the map and heap
+ * schedulers' O(log n) does. It pays off for event-heavy scenarios (DDoS,
+ * many VoIP calls, large meshes) with tens of thousands of pending events.
+ *
+ * Equal timestamps are ordered by event uid like every ns-3 scheduler, so
+ * results do not depend on the scheduler chosen.
+ *
+ * Usage:
+ *   SelectScheduler("ladder");              // or map, heap, list, calendar, priority
+ * or, from a CommandLine string:
+ *   if (!SelectScheduler(schedulerName)) { return 1; }
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class LadderScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId();
+    LadderScheduler();
+
+    void Insert(const Event& ev) override;
+    bool IsEmpty() const override;
+    Event PeekNext() const override;
+    Event RemoveNext() override;
+    void Remove(const Event& ev) override;
+
+    // Bucket size above which a bucket is split into a new rung
+    static const uint32_t THRESHOLD = 50;
+    static const uint32_t MAX_RUNGS = 8;
+
+private:
+    struct Rung
+    {
+        uint64_t start;    // time of bucket 0
+        uint64_t width;    // time span of one bucket
+        uint32_t current;  // first bucket not yet handed down
+        uint64_t count;    // events in this rung
+        std::vector<std::vector<Event>> buckets;
+
+        uint64_t CurrentStart() const { return start + current * width; }
+    };
+
+    // Bottom is kept in descending order so the next event is at the back
+    static bool Later(const Event& a, const Event& b) { return b.key < a.key; }
+
+    void InsertBottom(const Event& ev);
+    void Refill();
+    void SpawnRung(uint64_t start, uint64_t end, std::vector<Event>& events);
+    void BucketToBottom(std::vector<Event>& bucket);
+
+    std::vector<Event> m_top;
+    uint64_t m_topMin;
+    uint64_t m_topMax;
+    uint64_t m_topStart;       // events at or after this time go to Top
+
+    std::vector<Rung> m_rungs; // m_rungs[0] is the widest
+    std::vector<Event> m_bottom;
+    uint64_t m_size;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LadderScheduler);
+
+inline TypeId LadderScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::LadderScheduler")
+                            .SetParent<Scheduler>()
+                            .SetGroupName("Core")
+                            .AddConstructor<LadderScheduler>();
+    return tid;
+}
+
+inline LadderScheduler::LadderScheduler()
+    : m_topMin(UINT64_MAX),
+      m_topMax(0),
+      m_topStart(0),
+      m_size(0)
+{
+}
+
+inline bool LadderScheduler::IsEmpty() const
+{
+    return m_size == 0;
+}
+
+// Each rung's buckets end where the current bucket of the rung above
+// starts, so an event belongs to the first rung (widest first) whose
+// current bucket it does not precede; anything earlier than every rung is
+// due before all of them and goes straight into Bottom
+inline void LadderScheduler::Insert(const Event& ev)
+{
+    m_size++;
+    uint64_t ts = ev.key.m_ts;
+    if (ts >= m_topStart)
+    {
+        m_top.push_back(ev);
+        m_topMin = std::min(m_topMin, ts);
+        m_topMax = std::max(m_topMax, ts);
+        return;
+    }
+    for (Rung& rung : m_rungs)
+    {
+        if (ts >= rung.CurrentStart())
+        {
+            rung.buckets[(ts - rung.start) / rung.width].push_back(ev);
+            rung.count++;
+            return;
+        }
+    }
+    InsertBottom(ev);
+}
+
+inline void LadderScheduler::InsertBottom(const Event& ev)
+{
+    m_bottom.insert(std::upper_bound(m_bottom.begin(), m_bottom.end(), ev, &LadderScheduler::Later),
+                    ev);
+    // Many events landing below the ladder (e.g. a burst at the current
+    // time) would make Bottom's sorted inserts linear; hand them back to a
+    // new rung that ends where the lowest rung (or Top) begins
+    if (m_bottom.size() > 2 * THRESHOLD && m_rungs.size() < MAX_RUNGS &&
+        m_bottom.front().key.m_ts != m_bottom.back().key.m_ts)
+    {
+        uint64_t end = m_rungs.empty() ? m_topStart : m_rungs.back().CurrentStart();
+        std::vector<Event> events;
+        events.swap(m_bottom);
+        SpawnRung(events.back().key.m_ts, end, events);
+    }
+}
+
+inline void LadderScheduler::SpawnRung(uint64_t start, uint64_t end, std::vector<Event>& events)
+{
+    Rung rung;
+    rung.start = start;
+    rung.width = std::max<uint64_t>(1, (end - start + events.size() - 1) / events.size());
+    rung.current = 0;
+    rung.count = events.size();
+    rung.buckets.resize((end - start + rung.width - 1) / rung.width);
+    for (const Event& ev : events)
+    {
+        rung.buckets[(ev.key.m_ts - start) / rung.width].push_back(ev);
+    }
+    m_rungs.push_back(std::move(rung));
+}
+
+// Only called with Bottom empty; the bucket's storage is reused for it
+inline void LadderScheduler::BucketToBottom(std::vector<Event>& bucket)
+{
+    std::sort(bucket.begin(), bucket.end(), &LadderScheduler::Later);
+    m_bottom.swap(bucket);
+    bucket.clear();
+}
+
+// Move the next non-empty bucket down to Bottom, splitting buckets that
+// are too large into new rungs and starting a new epoch from Top when the
+// ladder runs dry
+inline void LadderScheduler::Refill()
+{
+    while (m_bottom.empty())
+    {
+        if (m_rungs.empty())
+        {
+            NS_ASSERT(!m_top.empty());
+            std::vector<Event> events;
+            events.swap(m_top);
+            m_topStart = m_topMax + 1;
+            uint64_t start = m_topMin;
+            m_topMin = UINT64_MAX;
+            m_topMax = 0;
+            SpawnRung(start, m_topStart, events);
+            continue;
+        }
+
+        Rung& rung = m_rungs.back();
+        if (rung.count == 0)
+        {
+            m_rungs.pop_back();
+            continue;
+        }
+        while (rung.buckets[rung.current].empty())
+        {
+            rung.current++;
+        }
+        std::vector<Event>& bucket = rung.buckets[rung.current];
+        uint64_t bucketStart = rung.CurrentStart();
+        uint64_t width = rung.width;
+        rung.count -= bucket.size();
+        rung.current++;
+
+        if (bucket.size() > THRESHOLD && width > 1 && m_rungs.size() < MAX_RUNGS)
+        {
+            std::vector<Event> events;
+            events.swap(bucket);
+            SpawnRung(bucketStart, bucketStart + width, events); // invalidates rung
+        }
+        else
+        {
+            BucketToBottom(bucket);
+        }
+    }
+}
+
+inline Scheduler::Event LadderScheduler::PeekNext() const
+{
+    NS_ASSERT(!IsEmpty());
+    // Refilling Bottom only moves events between tiers
+    const_cast<LadderScheduler*>(this)->Refill();
+    return m_bottom.back();
+}
+
+inline Scheduler::Event LadderScheduler::RemoveNext()
+{
+    NS_ASSERT(!IsEmpty());
+    Refill();
+    Event ev = m_bottom.back();
+    m_bottom.pop_back();
+    m_size--;
+    return ev;
+}
+
+inline void LadderScheduler::Remove(const Event& ev)
+{
+    auto erase = [&ev](std::vector<Event>& events) {
+        for (std::size_t i = 0; i < events.size(); i++)
+        {
+            if (events[i].key.m_uid == ev.key.m_uid)
+            {
+                events.erase(events.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    uint64_t ts = ev.key.m_ts;
+    bool found = false;
+    if (ts >= m_topStart)
+    {
+        found = erase(m_top);
+    }
+    else
+    {
+        for (Rung& rung : m_rungs)
+        {
+            if (ts >= rung.CurrentStart())
+            {
+                found = erase(rung.buckets[(ts - rung.start) / rung.width]);
+                rung.count -= found;
+                break;
+            }
+        }
+        if (!found)
+        {
+            auto it = std::lower_bound(m_bottom.begin(), m_bottom.end(), ev, &LadderScheduler::Later);
+            if (it != m_bottom.end() && it->key.m_uid == ev.key.m_uid)
+            {
+                m_bottom.erase(it);
+                found = true;
+            }
+        }
+    }
+    NS_ASSERT_MSG(found, "LadderScheduler: removing an event that is not scheduled");
+    m_size -= found;
+}
+
+// Scheduler names accepted by SelectScheduler, with their ns-3 TypeIds
+inline std::string SchedulerTypeName(const std::string& name)
+{
+    static const std::map<std::string, std::string> types = {
+        {"map", "ns3::MapScheduler"},
+        {"heap", "ns3::HeapScheduler"},
+        {"list", "ns3::ListScheduler"},
+        {"calendar", "ns3::CalendarScheduler"},
+        {"priority", "ns3::PriorityQueueScheduler"},
+        {"ladder", "ns3::LadderScheduler"},
+    };
+    auto it = types.find(name);
+    return it != types.end() ? it->second : "";
+}
+
+// Install the named scheduler. Binding SchedulerType as well keeps it in
+// effect for programs that run several simulations with Simulator::Destroy
+// in between.
+inline bool SelectScheduler(const std::string& name)
+{
+    std::string type = SchedulerTypeName(name);
+    if (type.empty())
+    {
+        std::cerr << "Unknown scheduler '" << name
+                  << "' (expected map, heap, list, calendar, priority or ladder)\n";
+        return false;
+    }
+    GlobalValue::Bind("SchedulerType", TypeIdValue(TypeId::LookupByName(type)));
+    Simulator::SetScheduler(ObjectFactory(type));
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -0,0 +1,316 @@
+/*
+ * Per-link utilization time series and capacity planning report
+ * Counts the bytes every point-to-point device puts on the wire (PhyTxBegin,
+ * one addition per packet) and turns the counters into a utilization sample
+ * per direction at a fixed interval. Each direction of a link is reported on
+ * its own, since WAN circuits are usually loaded asymmetrically.
+ *
+ * Report per direction:
+ *   mean, p95 and max utilization over the sampled intervals
+ *   time above the threshold (default 80%)
+ *   headroom: traffic growth until the p95 interval reaches line rate
+ *             ("-" when p95 is idle, capped at ">1000%")
+ * followed by the directions whose p95 would reach line rate if all traffic
+ * grew by the planning growth (default 20%).
+ *
+ * Usage (after the point-to-point links are installed):
+ *   LinkUtilization util;
+ *   util.InstallAll();
+ *   util.EnableSampling(Seconds(0.1), Seconds(simTime));
+ *   util.SetGrowth(0.3);                   // plan for +30% traffic
+ *   util.PublishMetrics(metrics);          // wan_link_utilization{link}
+ *   ...
+ *   util.PrintReport(std::cout);
+ */
+
+#ifndef LINK_UTILIZATION_H
+#define LINK_UTILIZATION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "metrics-registry.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class LinkUtilization
+{
+public:
+    LinkUtilization();
+
+    // Connect every point-to-point device of the current NodeList
+    void InstallAll();
+    // Connect one device, reported as name (default "<node> -> <peer>")
+    void Install(Ptr<NetDevice> device, const std::string& name = "");
+
+    void EnableSampling(Time interval, Time stop);
+    // Utilization counted as "time above" (0..1, default 0.8)
+    void SetThreshold(double threshold) { m_threshold = threshold; }
+    // Traffic growth for the saturation list (0.2 = +20%)
+    void SetGrowth(double growth) { m_growth = growth; }
+
+    uint32_t GetNLinks() const { return m_links.size(); }
+    // Utilization of a direction in sampled interval i (0..1)
+    double GetSample(uint32_t link, uint32_t i) const { return m_links[link].samples[i]; }
+    uint32_t GetNSamples() const { return m_nSamples; }
+
+    void PrintReport(std::ostream& os) const;
+
+    // Export the last interval's utilization per direction on every export
+    void PublishMetrics(MetricsRegistry& registry);
+
+private:
+    struct Link
+    {
+        std::string name;
+        double capacity;               // bit/s
+        uint64_t bytes;                // counted by the trace sink
+        uint64_t lastBytes;            // at the previous sample
+        std::vector<float> samples;
+    };
+
+    struct Summary
+    {
+        double mean;
+        double p95;
+        double max;
+        uint32_t above;                // intervals above the threshold
+    };
+
+    void PeriodicSample(Time interval, Time stop);
+    Summary Summarize(const Link& link) const;
+    static std::string NodeName(Ptr<Node> node);
+
+    // Trace sink; the link index is bound at connect time
+    static void PhyTxBegin(LinkUtilization* self, uint32_t link, Ptr<const Packet> packet);
+
+    std::vector<Link> m_links;
+    uint32_t m_nSamples;
+    Time m_interval;
+    double m_threshold;
+    double m_growth;
+};
+
+inline LinkUtilization::LinkUtilization()
+    : m_nSamples(0),
+      m_interval(Seconds(0)),
+      m_threshold(0.8),
+      m_growth(0.2)
+{
+}
+
+inline std::string LinkUtilization::NodeName(Ptr<Node> node)
+{
+    std::string name = Names::FindName(node);
+    return name.empty() ? "node " + std::to_string(node->GetId()) : name;
+}
+
+inline void LinkUtilization::InstallAll()
+{
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            if (DynamicCast<PointToPointNetDevice>(node->GetDevice(d)))
+            {
+                Install(node->GetDevice(d));
+            }
+        }
+    }
+}
+
+inline void LinkUtilization::Install(Ptr<NetDevice> device, const std::string& name)
+{
+    Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device);
+    if (!p2p)
+    {
+        std::cerr << "LinkUtilization: " << NodeName(device->GetNode()) << " device "
+                  << device->GetIfIndex() << " is not a point-to-point device\n";
+        return;
+    }
+
+    Link link;
+    link.name = name;
+    if (link.name.empty())
+    {
+        link.name = NodeName(device->GetNode());
+        Ptr<Channel> channel = p2p->GetChannel();
+        for (uint32_t i = 0; channel && i < channel->GetNDevices(); i++)
+        {
+            if (channel->GetDevice(i) != device)
+            {
+                link.name += " -> " + NodeName(channel->GetDevice(i)->GetNode());
+            }
+        }
+    }
+    DataRateValue rate;
+    p2p->GetAttribute("DataRate", rate);
+    link.capacity = rate.Get().GetBitRate();
+    link.bytes = 0;
+    link.lastBytes = 0;
+    link.samples.assign(m_nSamples, 0.0f);   // idle before it was installed
+
+    uint32_t index = m_links.size();
+    m_links.push_back(link);
+    p2p->TraceConnectWithoutContext("PhyTxBegin", MakeBoundCallback(&LinkUtilization::PhyTxBegin, this, index));
+}
+
+inline void LinkUtilization::PhyTxBegin(LinkUtilization* self, uint32_t link, Ptr<const Packet> packet)
+{
+    self->m_links[link].bytes += packet->GetSize();
+}
+
+inline void LinkUtilization::EnableSampling(Time interval, Time stop)
+{
+    m_interval = interval;
+    uint32_t expected = uint32_t((stop - Simulator::Now()).GetSeconds() / interval.GetSeconds()) + 1;
+    for (Link& link : m_links)
+    {
+        link.samples.reserve(expected);
+        link.lastBytes = link.bytes;
+    }
+    Simulator::Schedule(interval, &LinkUtilization::PeriodicSample, this, interval, stop);
+}
+
+inline void LinkUtilization::PeriodicSample(Time interval, Time stop)
+{
+    m_nSamples++;
+    for (Link& link : m_links)
+    {
+        double bits = (link.bytes - link.lastBytes) * 8.0;
+        link.lastBytes = link.bytes;
+        link.samples.push_back(link.capacity > 0 ? bits / (link.capacity * interval.GetSeconds()) : 0.0);
+    }
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &LinkUtilization::PeriodicSample, this, interval, stop);
+    }
+}
+
+inline LinkUtilization::Summary LinkUtilization::Summarize(const Link& link) const
+{
+    Summary s = {0, 0, 0, 0};
+    if (link.samples.empty())
+    {
+        return s;
+    }
+    double sum = 0;
+    for (float u : link.samples)
+    {
+        sum += u;
+        s.max = std::max<double>(s.max, u);
+        s.above += u > m_threshold;
+    }
+    s.mean = sum / link.samples.size();
+
+    std::vector<float> sorted(link.samples);
+    size_t rank = std::min(sorted.size() - 1, size_t(0.95 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    s.p95 = sorted[rank];
+    return s;
+}
+
+inline void LinkUtilization::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Link Utilization (" << m_nSamples << " samples, every " << m_interval.GetSeconds()
+       << " s) ===\n";
+    if (m_nSamples == 0)
+    {
+        os << "  no samples (EnableSampling not called or the run ended first)\n";
+        return;
+    }
+
+    std::vector<std::pair<Summary, uint32_t>> rows;
+    uint32_t idle = 0;
+    for (uint32_t i = 0; i < m_links.size(); i++)
+    {
+        Summary s = Summarize(m_links[i]);
+        if (s.max == 0)
+        {
+            idle++;
+            continue;
+        }
+        rows.push_back({s, i});
+    }
+    std::sort(rows.begin(), rows.end(), [](const std::pair<Summary, uint32_t>& a,
+                                           const std::pair<Summary, uint32_t>& b) {
+        return a.first.p95 > b.first.p95;
+    });
+
+    os << "  " << std::left << std::setw(26) << "link" << std::right << std::setw(9) << "Mbps"
+       << std::setw(8) << "mean%" << std::setw(8) << "p95%" << std::setw(8) << "max%" << std::setw(9)
+       << ">" + std::to_string(int(m_threshold * 100 + 0.5)) + "% s" << std::setw(10) << "headroom" << "\n";
+    os << std::fixed << std::setprecision(1);
+    for (const auto& row : rows)
+    {
+        const Link& link = m_links[row.second];
+        const Summary& s = row.first;
+        os << "  " << std::left << std::setw(26) << link.name << std::right << std::setw(9)
+           << link.capacity / 1e6 << std::setw(8) << s.mean * 100 << std::setw(8) << s.p95 * 100
+           << std::setw(8) << s.max * 100 << std::setw(9) << s.above * m_interval.GetSeconds();
+        if (s.p95 >= 1.0)
+        {
+            os << std::setw(10) << "none";
+        }
+        else if (s.p95 <= 0)
+        {
+            // Idle in at least 95% of the intervals, only bursts
+            os << std::setw(10) << "-";
+        }
+        else if (s.p95 < 1.0 / 11)
+        {
+            os << std::setw(10) << ">1000%";
+        }
+        else
+        {
+            os << std::setw(9) << (1.0 / s.p95 - 1.0) * 100 << "%";
+        }
+        os << "\n";
+    }
+    if (idle > 0)
+    {
+        os << "  (" << idle << " idle directions not shown)\n";
+    }
+
+    os << "At +" << m_growth * 100 << "% traffic, p95 reaches line rate on:";
+    bool any = false;
+    for (const auto& row : rows)
+    {
+        if (row.first.p95 * (1.0 + m_growth) >= 1.0)
+        {
+            os << (any ? ", " : " ") << m_links[row.second].name;
+            any = true;
+        }
+    }
+    os << (any ? "\n" : " none\n");
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+inline void LinkUtilization::PublishMetrics(MetricsRegistry& registry)
+{
+    registry.AddCollector([this](MetricsRegistry& r) {
+        for (const Link& link : m_links)
+        {
+            if (link.samples.empty())
+            {
+                continue;
+            }
+            r.GetGauge("wan_link_utilization", "Utilization of the last sampled interval (0-1)",
+                       {{"link", link.name}})
+                .Set(link.samples.back());
+        }
+    });
+}
+
+} // namespace ns3
+
+#endif /* LINK_UTILIZATION_H */
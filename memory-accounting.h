@@ -0,0 +1,431 @@
+/*
+ * Memory accounting
+ * Live counts and bytes per category, sampled during the run, with the
+ * peak of each and the simulation time it occurred, so a scenario can be
+ * sized before it is scaled up into the OOM killer.
+ *
+ * Sources:
+ *   heap            all operator new/delete traffic (live blocks and usable
+ *                   bytes), only in programs built with
+ *                   -DMEMORY_ACCOUNTING_HOOKS, since replacing the global
+ *                   allocator costs every allocation a counter update;
+ *                   packet tags, headers and buffers are part of this total
+ *   queued packets  device queues plus root queue discs (AddQueues)
+ *   flow monitor    flow records with their histograms and drop vectors,
+ *                   and the packets it is still tracking, i.e. sent but not
+ *                   yet received or declared lost (AddFlowMonitor)
+ *   containers      any std::map / std::unordered_map / std::vector the
+ *                   scenario keeps, e.g. per-packet timestamp maps
+ *                   (AddContainer)
+ *   process RSS     resident set size from /proc/self/statm
+ * Anything else can be added with AddSource and a sampling callback.
+ *
+ * Object sizes are estimates from sizeof plus typical allocator and
+ * container node overhead; the heap and RSS rows are measured.
+ *
+ * Usage (heap row: build with -DMEMORY_ACCOUNTING_HOOKS, or define it
+ * before the include in one .cc per program):
+ *   #include "memory-accounting.h"
+ *   MemoryAccounting mem;
+ *   mem.AddQueues();
+ *   mem.AddFlowMonitor(monitor);
+ *   mem.AddContainer("sent-time map", sentTimes);
+ *   mem.EnableSampling(Seconds(0.5), Seconds(simTime));
+ *   ...
+ *   mem.PrintReport(std::cout);
+ */
+
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <malloc.h>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// HEAP HOOKS
+// ============================================================================
+
+struct MemoryAccountingHeap
+{
+    static inline std::atomic<bool> enabled{false};
+    static inline std::atomic<int64_t> liveBlocks{0};
+    static inline std::atomic<int64_t> liveBytes{0};
+
+    static void OnAlloc(void* p)
+    {
+        liveBlocks.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    }
+
+    static void OnFree(void* p)
+    {
+        liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+        liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+    }
+};
+
+} // namespace ns3
+
+#ifdef MEMORY_ACCOUNTING_HOOKS
+// Replacement allocation functions must be defined exactly once per
+// program and cannot be inline. The default nothrow forms route through
+// these; over-aligned allocations are not counted
+void* operator new(std::size_t n)
+{
+    void* p = std::malloc(n ? n : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    ns3::MemoryAccountingHeap::enabled.store(true, std::memory_order_relaxed);
+    ns3::MemoryAccountingHeap::OnAlloc(p);
+    return p;
+}
+
+void* operator new[](std::size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p)
+    {
+        ns3::MemoryAccountingHeap::OnFree(p);
+        std::free(p);
+    }
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+#endif /* MEMORY_ACCOUNTING_HOOKS */
+
+namespace ns3
+{
+
+// ============================================================================
+// ACCOUNTING
+// ============================================================================
+
+class MemoryAccounting
+{
+public:
+    struct Usage
+    {
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    typedef std::function<Usage()> Sampler;
+
+    // Packet object, Buffer::Data header and typical headroom on top of the
+    // packet's own bytes
+    static constexpr uint32_t PACKET_OVERHEAD = sizeof(Packet) + 64;
+    // Red-black tree / hash node links and allocator header
+    static constexpr uint32_t NODE_OVERHEAD = 48;
+
+    MemoryAccounting();
+
+    void AddSource(std::string name, Sampler sampler);
+    // Packets held in every device queue and root queue disc of the NodeList
+    void AddQueues();
+    void AddFlowMonitor(Ptr<FlowMonitor> monitor);
+
+    template <class K, class V, class C, class A>
+    void AddContainer(std::string name, const std::map<K, V, C, A>& container);
+    template <class K, class V, class H, class E, class A>
+    void AddContainer(std::string name, const std::unordered_map<K, V, H, E, A>& container);
+    template <class T, class A>
+    void AddContainer(std::string name, const std::vector<T, A>& container);
+
+    void EnableSampling(Time interval, Time stop);
+    // Take one sample now (also done by PrintReport)
+    void Sample();
+
+    void PrintReport(std::ostream& os);
+
+    static uint64_t GetResidentBytes();
+    static uint64_t GetPeakResidentBytes();
+
+private:
+    struct Source
+    {
+        std::string name;
+        Sampler sampler;
+        Usage current;
+        Usage peak;           // peak bytes, with the count at that moment
+        uint64_t peakCount;
+        Time peakTime;
+    };
+
+    void PeriodicSample(Time interval, Time stop);
+    static std::string FormatBytes(uint64_t bytes);
+
+    std::vector<Source> m_sources;
+    uint32_t m_nSamples;
+    Time m_interval;
+};
+
+inline MemoryAccounting::MemoryAccounting()
+    : m_nSamples(0),
+      m_interval(Seconds(0))
+{
+    AddSource("heap (operator new)", []() {
+        if (!MemoryAccountingHeap::enabled.load(std::memory_order_relaxed))
+        {
+            return Usage{0, 0};
+        }
+        return Usage{uint64_t(std::max<int64_t>(MemoryAccountingHeap::liveBlocks.load(), 0)),
+                     uint64_t(std::max<int64_t>(MemoryAccountingHeap::liveBytes.load(), 0))};
+    });
+    AddSource("process RSS", []() { return Usage{0, GetResidentBytes()}; });
+}
+
+inline void MemoryAccounting::AddSource(std::string name, Sampler sampler)
+{
+    Source s;
+    s.name = name;
+    s.sampler = sampler;
+    s.current = Usage{0, 0};
+    s.peak = Usage{0, 0};
+    s.peakCount = 0;
+    s.peakTime = Seconds(0);
+    m_sources.push_back(s);
+}
+
+inline void MemoryAccounting::AddQueues()
+{
+    std::vector<Ptr<Queue<Packet>>> queues;
+    std::vector<Ptr<QueueDisc>> qdiscs;
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> device = node->GetDevice(d);
+            if (Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device))
+            {
+                queues.push_back(p2p->GetQueue());
+            }
+            if (Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : Ptr<QueueDisc>())
+            {
+                qdiscs.push_back(qdisc);
+            }
+        }
+    }
+    AddSource("queued packets", [queues, qdiscs]() {
+        Usage u{0, 0};
+        for (const Ptr<Queue<Packet>>& q : queues)
+        {
+            u.count += q->GetNPackets();
+            u.bytes += q->GetNBytes();
+        }
+        for (const Ptr<QueueDisc>& q : qdiscs)
+        {
+            u.count += q->GetNPackets();
+            u.bytes += q->GetNBytes();
+        }
+        u.bytes += u.count * PACKET_OVERHEAD;
+        return u;
+    });
+}
+
+inline void MemoryAccounting::AddFlowMonitor(Ptr<FlowMonitor> monitor)
+{
+    AddSource("flow monitor records", [monitor]() {
+        Usage u{0, 0};
+        for (const auto& kv : monitor->GetFlowStats())
+        {
+            const FlowMonitor::FlowStats& s = kv.second;
+            u.count++;
+            u.bytes += sizeof(FlowId) + sizeof(FlowMonitor::FlowStats) + NODE_OVERHEAD;
+            u.bytes += (s.delayHistogram.GetNBins() + s.jitterHistogram.GetNBins() +
+                        s.packetSizeHistogram.GetNBins() + s.flowInterruptionsHistogram.GetNBins()) *
+                       sizeof(uint32_t);
+            u.bytes += s.packetsDropped.size() * sizeof(uint32_t) + s.bytesDropped.size() * sizeof(uint64_t);
+        }
+        return u;
+    });
+    // One tracked-packet entry (timestamps, size, hop count) per packet in flight
+    AddSource("flow monitor in-flight", [monitor]() {
+        Usage u{0, 0};
+        for (const auto& kv : monitor->GetFlowStats())
+        {
+            const FlowMonitor::FlowStats& s = kv.second;
+            uint64_t done = uint64_t(s.rxPackets) + s.lostPackets;
+            u.count += s.txPackets > done ? s.txPackets - done : 0;
+        }
+        u.bytes = u.count * (3 * sizeof(Time) + 2 * sizeof(uint32_t) + NODE_OVERHEAD);
+        return u;
+    });
+}
+
+template <class K, class V, class C, class A>
+void MemoryAccounting::AddContainer(std::string name, const std::map<K, V, C, A>& container)
+{
+    const std::map<K, V, C, A>* c = &container;
+    AddSource(name, [c]() {
+        return Usage{c->size(), c->size() * (sizeof(std::pair<const K, V>) + NODE_OVERHEAD)};
+    });
+}
+
+template <class K, class V, class H, class E, class A>
+void MemoryAccounting::AddContainer(std::string name, const std::unordered_map<K, V, H, E, A>& container)
+{
+    const std::unordered_map<K, V, H, E, A>* c = &container;
+    AddSource(name, [c]() {
+        return Usage{c->size(),
+                     c->size() * (sizeof(std::pair<const K, V>) + NODE_OVERHEAD) +
+                         c->bucket_count() * sizeof(void*)};
+    });
+}
+
+template <class T, class A>
+void MemoryAccounting::AddContainer(std::string name, const std::vector<T, A>& container)
+{
+    const std::vector<T, A>* c = &container;
+    AddSource(name, [c]() { return Usage{c->size(), c->capacity() * sizeof(T)}; });
+}
+
+inline void MemoryAccounting::EnableSampling(Time interval, Time stop)
+{
+    m_interval = interval;
+    Simulator::Schedule(interval, &MemoryAccounting::PeriodicSample, this, interval, stop);
+}
+
+inline void MemoryAccounting::PeriodicSample(Time interval, Time stop)
+{
+    Sample();
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &MemoryAccounting::PeriodicSample, this, interval, stop);
+    }
+}
+
+inline void MemoryAccounting::Sample()
+{
+    m_nSamples++;
+    for (Source& s : m_sources)
+    {
+        s.current = s.sampler();
+        if (s.current.bytes > s.peak.bytes || m_nSamples == 1)
+        {
+            s.peak = s.current;
+            s.peakTime = Simulator::Now();
+        }
+        s.peakCount = std::max(s.peakCount, s.current.count);
+    }
+}
+
+inline uint64_t MemoryAccounting::GetResidentBytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (!(statm >> size >> resident))
+    {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// VmHWM: the kernel's high-water mark, including anything between samples
+inline uint64_t MemoryAccounting::GetPeakResidentBytes()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return std::stoull(line.substr(6)) * 1024;
+        }
+    }
+    return 0;
+}
+
+inline std::string MemoryAccounting::FormatBytes(uint64_t bytes)
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    if (bytes >= (1ULL << 30))
+    {
+        os << bytes / double(1ULL << 30) << " GiB";
+    }
+    else if (bytes >= (1ULL << 20))
+    {
+        os << bytes / double(1ULL << 20) << " MiB";
+    }
+    else if (bytes >= 1024)
+    {
+        os << bytes / 1024.0 << " KiB";
+    }
+    else
+    {
+        os << bytes << " B";
+    }
+    return os.str();
+}
+
+inline void MemoryAccounting::PrintReport(std::ostream& os)
+{
+    Sample();
+    os << "\n=== Memory accounting (" << m_nSamples << " samples";
+    if (m_interval.IsStrictlyPositive())
+    {
+        os << ", every " << m_interval.GetSeconds() << " s";
+    }
+    os << ") ===\n";
+    os << "  " << std::left << std::setw(24) << "source" << std::right << std::setw(10) << "count"
+       << std::setw(12) << "bytes" << std::setw(12) << "peak count" << std::setw(12) << "peak bytes"
+       << std::setw(10) << "at t (s)" << "\n";
+    for (const Source& s : m_sources)
+    {
+        bool hasCount = s.name != "process RSS";
+        os << "  " << std::left << std::setw(24) << s.name << std::right << std::setw(10)
+           << (hasCount ? std::to_string(s.current.count) : "-") << std::setw(12)
+           << FormatBytes(s.current.bytes) << std::setw(12)
+           << (hasCount ? std::to_string(s.peakCount) : "-") << std::setw(12)
+           << FormatBytes(s.peak.bytes) << std::setw(10) << s.peakTime.GetSeconds() << "\n";
+    }
+    if (!MemoryAccountingHeap::enabled.load(std::memory_order_relaxed))
+    {
+        os << "  (heap row needs a build with -DMEMORY_ACCOUNTING_HOOKS)\n";
+    }
+    os << "  Process peak RSS (VmHWM): " << FormatBytes(GetPeakResidentBytes()) << "\n";
+}
+
+} // namespace ns3
+
+#endif /* MEMORY_ACCOUNTING_H */
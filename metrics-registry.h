@@ -0,0 +1,574 @@
+/*
+ * Live metrics registry with OpenMetrics text export
+ * Counters, gauges and histograms that scenarios and modules publish into
+ * while the simulation runs, written out periodically in the OpenMetrics
+ * text format so a long run can be watched (node_exporter textfile
+ * collector, a Prometheus scrape of the file, or plain `watch cat`).
+ *
+ * Series are addressed by metric name plus labels and are created on first
+ * use. Modules that already keep their own counters (DropAccounting,
+ * RouteChangeLog) register a collector instead, which copies their state
+ * into the registry right before each export, so the hot paths stay as
+ * they are. Built-in gauges report sim time, wall time and events run.
+ *
+ * Each export is written to <file>.tmp and renamed over <file>, so readers
+ * never see a partial file. Exports run inside the simulation as ordinary
+ * events (ns-3 objects are not thread-safe), either every `interval` of sim
+ * time or, in wall-clock mode, at the first event after `interval` of wall
+ * time has passed; the wall clock is polled at a sim-time step that adapts
+ * to the current simulation speed.
+ *
+ * Usage:
+ *   MetricsRegistry metrics;
+ *   metrics.AddQueueDepth();
+ *   drops.PublishMetrics(metrics);
+ *   metrics.GetCounter("wan_voip_calls", "Calls set up", {{"site", "A"}}).Inc();
+ *   metrics.GetHistogram("wan_rtt_seconds", "Echo RTT", MetricsRegistry::DelayBuckets())
+ *       .Observe(rtt.GetSeconds());
+ *   metrics.EnableExport("run.prom", Seconds(1), Seconds(simTime));
+ *   // or metrics.EnableWallClockExport("run.prom", 2.0, Seconds(simTime));
+ *   ...
+ *   Simulator::Run();
+ *   metrics.Export();                       // final values
+ */
+
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace ns3
+{
+
+class MetricsRegistry
+{
+public:
+    enum Type
+    {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    typedef std::vector<std::pair<std::string, std::string>> Labels;
+    typedef std::function<void(MetricsRegistry&)> Collector;
+
+    // One labelled time series. Counters use Inc (or Set when mirroring a
+    // counter kept elsewhere), gauges Set/Add, histograms Observe.
+    class Series
+    {
+    public:
+        void Inc(double v = 1) { m_value += v; }
+        void Set(double v) { m_value = v; }
+        void Add(double v) { m_value += v; }
+        double Get() const { return m_value; }
+
+        void Observe(double v);
+        // Replace the histogram with per-bucket (not cumulative) counts,
+        // one per bound plus +Inf, e.g. when mirroring FlowMonitor bins
+        void SetBuckets(const std::vector<uint64_t>& counts, double sum);
+
+    private:
+        friend class MetricsRegistry;
+
+        double m_value = 0;
+        const std::vector<double>* m_bounds = nullptr;
+        std::vector<uint64_t> m_buckets;
+        double m_sum = 0;
+        uint64_t m_count = 0;
+    };
+
+    MetricsRegistry();
+
+    Series& GetCounter(const std::string& name, const std::string& help, const Labels& labels = {});
+    Series& GetGauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    // Bounds are upper bucket limits in increasing order; +Inf is implicit
+    Series& GetHistogram(const std::string& name,
+                         const std::string& help,
+                         const std::vector<double>& bounds,
+                         const Labels& labels = {});
+
+    // Called before every export to copy external state into the registry
+    void AddCollector(Collector collector) { m_collectors.push_back(collector); }
+
+    // Queue depth gauges (packets, bytes) for every device queue and root
+    // queue disc that exists now
+    void AddQueueDepth();
+    // Per-class flow counters and delay histograms from a FlowMonitor;
+    // classOf maps a flow to its class label (e.g. by destination port)
+    void AddFlowMonitor(Ptr<FlowMonitor> monitor,
+                        Ptr<Ipv4FlowClassifier> classifier,
+                        std::function<std::string(const Ipv4FlowClassifier::FiveTuple&)> classOf);
+
+    // 1 ms .. 2 s, for packet delay and RTT in seconds
+    static const std::vector<double>& DelayBuckets();
+
+    void EnableExport(std::string filename, Time interval, Time stop);
+    void EnableWallClockExport(std::string filename, double wallSeconds, Time stop);
+
+    // Run collectors and write the file now; false if it cannot be written
+    bool Export();
+    void Write(std::ostream& os);
+
+    uint64_t GetNExports() const { return m_nExports; }
+
+private:
+    struct Family
+    {
+        Type type;
+        std::string help;
+        std::vector<double> bounds;
+        std::map<std::string, Series> series;   // key: rendered label set
+    };
+
+    Series& GetSeries(const std::string& name,
+                      Type type,
+                      const std::string& help,
+                      const std::vector<double>* bounds,
+                      const Labels& labels);
+    void ExportTick(Time interval, Time stop);
+    void WallClockTick(Time stop);
+    double WallSeconds() const;
+
+    static std::string RenderLabels(const Labels& labels);
+    static std::string Escape(const std::string& value);
+    static std::string Number(double v);
+    static std::string WithLabel(const std::string& labels, const std::string& extra);
+
+    std::map<std::string, Family> m_families;
+    std::vector<Collector> m_collectors;
+
+    std::string m_filename;
+    std::chrono::steady_clock::time_point m_wallStart;
+    uint64_t m_nExports;
+
+    // Wall-clock mode
+    double m_wallInterval;
+    double m_nextWall;
+    Time m_poll;                 // sim-time step between wall clock checks
+    Time m_lastPollSim;
+    double m_lastPollWall;
+};
+
+inline void MetricsRegistry::Series::Observe(double v)
+{
+    std::size_t bucket = std::lower_bound(m_bounds->begin(), m_bounds->end(), v) - m_bounds->begin();
+    m_buckets[bucket]++;
+    m_sum += v;
+    m_count++;
+}
+
+inline void MetricsRegistry::Series::SetBuckets(const std::vector<uint64_t>& counts, double sum)
+{
+    m_count = 0;
+    for (std::size_t i = 0; i < m_buckets.size(); i++)
+    {
+        m_buckets[i] = i < counts.size() ? counts[i] : 0;
+        m_count += m_buckets[i];
+    }
+    m_sum = sum;
+}
+
+inline MetricsRegistry::MetricsRegistry()
+    : m_wallStart(std::chrono::steady_clock::now()),
+      m_nExports(0),
+      m_wallInterval(0),
+      m_nextWall(0),
+      m_lastPollWall(0)
+{
+}
+
+inline const std::vector<double>& MetricsRegistry::DelayBuckets()
+{
+    static const std::vector<double> bounds =
+        {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0};
+    return bounds;
+}
+
+inline MetricsRegistry::Series& MetricsRegistry::GetCounter(const std::string& name,
+                                                            const std::string& help,
+                                                            const Labels& labels)
+{
+    return GetSeries(name, COUNTER, help, nullptr, labels);
+}
+
+inline MetricsRegistry::Series& MetricsRegistry::GetGauge(const std::string& name,
+                                                          const std::string& help,
+                                                          const Labels& labels)
+{
+    return GetSeries(name, GAUGE, help, nullptr, labels);
+}
+
+inline MetricsRegistry::Series& MetricsRegistry::GetHistogram(const std::string& name,
+                                                              const std::string& help,
+                                                              const std::vector<double>& bounds,
+                                                              const Labels& labels)
+{
+    return GetSeries(name, HISTOGRAM, help, &bounds, labels);
+}
+
+// std::map never moves its elements, so the returned reference stays valid
+inline MetricsRegistry::Series& MetricsRegistry::GetSeries(const std::string& name,
+                                                           Type type,
+                                                           const std::string& help,
+                                                           const std::vector<double>* bounds,
+                                                           const Labels& labels)
+{
+    auto it = m_families.find(name);
+    if (it == m_families.end())
+    {
+        Family family;
+        family.type = type;
+        family.help = help;
+        if (bounds)
+        {
+            family.bounds = *bounds;
+        }
+        it = m_families.emplace(name, family).first;
+    }
+    Family& family = it->second;
+    NS_ABORT_MSG_IF(family.type != type, "metric " << name << " registered with another type");
+
+    auto result = family.series.emplace(RenderLabels(labels), Series());
+    Series& series = result.first->second;
+    if (result.second && type == HISTOGRAM)
+    {
+        series.m_bounds = &family.bounds;
+        series.m_buckets.assign(family.bounds.size() + 1, 0);
+    }
+    return series;
+}
+
+inline void MetricsRegistry::AddQueueDepth()
+{
+    struct Target
+    {
+        Labels labels;
+        Ptr<Queue<Packet>> queue;
+        Ptr<QueueDisc> qdisc;
+    };
+    std::vector<Target> targets;
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> device = node->GetDevice(d);
+            Labels where = {{"node", std::to_string(n)}, {"device", std::to_string(d)}};
+            if (Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device))
+            {
+                Labels labels = where;
+                labels.emplace_back("layer", "device");
+                targets.push_back({labels, p2p->GetQueue(), nullptr});
+            }
+            if (Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : Ptr<QueueDisc>())
+            {
+                Labels labels = where;
+                labels.emplace_back("layer", "qdisc");
+                targets.push_back({labels, nullptr, qdisc});
+            }
+        }
+    }
+    AddCollector([targets](MetricsRegistry& r) {
+        for (const Target& t : targets)
+        {
+            uint32_t packets = t.queue ? t.queue->GetNPackets() : t.qdisc->GetNPackets();
+            uint32_t bytes = t.queue ? t.queue->GetNBytes() : t.qdisc->GetNBytes();
+            r.GetGauge("wan_queue_packets", "Packets waiting in the queue", t.labels).Set(packets);
+            r.GetGauge("wan_queue_bytes", "Bytes waiting in the queue", t.labels).Set(bytes);
+        }
+    });
+}
+
+// FlowMonitor delay bins are re-binned into DelayBuckets by their midpoint
+inline void MetricsRegistry::AddFlowMonitor(
+    Ptr<FlowMonitor> monitor,
+    Ptr<Ipv4FlowClassifier> classifier,
+    std::function<std::string(const Ipv4FlowClassifier::FiveTuple&)> classOf)
+{
+    AddCollector([monitor, classifier, classOf](MetricsRegistry& r) {
+        struct ClassStats
+        {
+            uint64_t tx = 0, rx = 0, lost = 0, rxBytes = 0;
+            std::vector<uint64_t> buckets;
+            double delaySum = 0;
+        };
+        const std::vector<double>& bounds = DelayBuckets();
+        std::map<std::string, ClassStats> classes;
+        for (const auto& kv : monitor->GetFlowStats())
+        {
+            ClassStats& c = classes[classOf(classifier->FindFlow(kv.first))];
+            const FlowMonitor::FlowStats& stats = kv.second;
+            // Histogram's bin accessors are not const-qualified
+            Histogram& delay = const_cast<Histogram&>(stats.delayHistogram);
+            c.tx += stats.txPackets;
+            c.rx += stats.rxPackets;
+            c.lost += stats.lostPackets;
+            c.rxBytes += stats.rxBytes;
+            c.delaySum += stats.delaySum.GetSeconds();
+            c.buckets.resize(bounds.size() + 1, 0);
+            for (uint32_t b = 0; b < delay.GetNBins(); b++)
+            {
+                uint32_t count = delay.GetBinCount(b);
+                if (count == 0)
+                {
+                    continue;
+                }
+                double mid = 0.5 * (delay.GetBinStart(b) + delay.GetBinEnd(b));
+                c.buckets[std::lower_bound(bounds.begin(), bounds.end(), mid) - bounds.begin()] +=
+                    count;
+            }
+        }
+        for (const auto& kv : classes)
+        {
+            Labels labels = {{"class", kv.first}};
+            r.GetCounter("wan_flow_tx_packets", "Packets sent by flows of the class", labels)
+                .Set(kv.second.tx);
+            r.GetCounter("wan_flow_rx_packets", "Packets received by flows of the class", labels)
+                .Set(kv.second.rx);
+            r.GetCounter("wan_flow_lost_packets", "Packets declared lost by FlowMonitor", labels)
+                .Set(kv.second.lost);
+            r.GetCounter("wan_flow_rx_bytes", "Bytes received by flows of the class", labels)
+                .Set(kv.second.rxBytes);
+            r.GetHistogram("wan_flow_delay_seconds",
+                           "One-way packet delay by traffic class",
+                           bounds,
+                           labels)
+                .SetBuckets(kv.second.buckets, kv.second.delaySum);
+        }
+    });
+}
+
+inline void MetricsRegistry::EnableExport(std::string filename, Time interval, Time stop)
+{
+    m_filename = filename;
+    Simulator::Schedule(interval, &MetricsRegistry::ExportTick, this, interval, stop);
+}
+
+inline void MetricsRegistry::ExportTick(Time interval, Time stop)
+{
+    Export();
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &MetricsRegistry::ExportTick, this, interval, stop);
+    }
+}
+
+inline void MetricsRegistry::EnableWallClockExport(std::string filename, double wallSeconds, Time stop)
+{
+    m_filename = filename;
+    m_wallInterval = wallSeconds;
+    m_nextWall = WallSeconds() + wallSeconds;
+    m_poll = MilliSeconds(1);
+    m_lastPollSim = Simulator::Now();
+    m_lastPollWall = WallSeconds();
+    Simulator::Schedule(m_poll, &MetricsRegistry::WallClockTick, this, stop);
+}
+
+// Aim for about 20 wall clock checks per export interval at the current
+// sim/wall speed; a check is one clock read, so the overhead stays small
+// even when the estimate is off
+inline void MetricsRegistry::WallClockTick(Time stop)
+{
+    double wall = WallSeconds();
+    if (wall >= m_nextWall)
+    {
+        Export();
+        m_nextWall = wall + m_wallInterval;
+    }
+
+    double simElapsed = (Simulator::Now() - m_lastPollSim).GetSeconds();
+    double wallElapsed = wall - m_lastPollWall;
+    if (wallElapsed > 0)
+    {
+        double step = simElapsed / wallElapsed * m_wallInterval / 20;
+        m_poll = Seconds(std::min(std::max(step, 1e-6), 10.0));
+    }
+    else
+    {
+        m_poll = std::min(m_poll + m_poll, Seconds(10));
+    }
+    m_lastPollSim = Simulator::Now();
+    m_lastPollWall = wall;
+
+    if (Simulator::Now() + m_poll <= stop)
+    {
+        Simulator::Schedule(m_poll, &MetricsRegistry::WallClockTick, this, stop);
+    }
+}
+
+inline double MetricsRegistry::WallSeconds() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+}
+
+inline bool MetricsRegistry::Export()
+{
+    if (m_filename.empty())
+    {
+        return false;
+    }
+    std::string tmp = m_filename + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out)
+        {
+            std::cerr << "MetricsRegistry: cannot write " << tmp << "\n";
+            return false;
+        }
+        Write(out);
+        out.flush();
+        if (!out)
+        {
+            std::cerr << "MetricsRegistry: write to " << tmp << " failed\n";
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), m_filename.c_str()) != 0)
+    {
+        std::cerr << "MetricsRegistry: cannot rename " << tmp << " to " << m_filename << "\n";
+        return false;
+    }
+    m_nExports++;
+    return true;
+}
+
+inline void MetricsRegistry::Write(std::ostream& os)
+{
+    for (const Collector& collector : m_collectors)
+    {
+        collector(*this);
+    }
+    GetGauge("wan_sim_time_seconds", "Current simulation time").Set(Simulator::Now().GetSeconds());
+    GetGauge("wan_wall_time_seconds", "Wall time since the registry was created").Set(WallSeconds());
+    GetCounter("wan_sim_events", "Events executed by the simulator")
+        .Set(double(Simulator::GetEventCount()));
+
+    for (const auto& kv : m_families)
+    {
+        const std::string& name = kv.first;
+        const Family& family = kv.second;
+        const char* type = family.type == COUNTER ? "counter"
+                           : family.type == GAUGE ? "gauge"
+                                                  : "histogram";
+        os << "# TYPE " << name << " " << type << "\n";
+        os << "# HELP " << name << " " << family.help << "\n";
+        for (const auto& s : family.series)
+        {
+            const Series& series = s.second;
+            if (family.type == COUNTER)
+            {
+                os << name << "_total" << s.first << " " << Number(series.m_value) << "\n";
+            }
+            else if (family.type == GAUGE)
+            {
+                os << name << s.first << " " << Number(series.m_value) << "\n";
+            }
+            else
+            {
+                uint64_t cumulative = 0;
+                for (std::size_t b = 0; b < series.m_buckets.size(); b++)
+                {
+                    cumulative += series.m_buckets[b];
+                    std::string le = b < family.bounds.size() ? Number(family.bounds[b]) : "+Inf";
+                    os << name << "_bucket" << WithLabel(s.first, "le=\"" + le + "\"") << " "
+                       << cumulative << "\n";
+                }
+                os << name << "_count" << s.first << " " << series.m_count << "\n";
+                os << name << "_sum" << s.first << " " << Number(series.m_sum) << "\n";
+            }
+        }
+    }
+    os << "# EOF\n";
+}
+
+inline std::string MetricsRegistry::RenderLabels(const Labels& labels)
+{
+    if (labels.empty())
+    {
+        return "";
+    }
+    std::string out = "{";
+    for (std::size_t i = 0; i < labels.size(); i++)
+    {
+        out += (i ? "," : "") + labels[i].first + "=\"" + Escape(labels[i].second) + "\"";
+    }
+    return out + "}";
+}
+
+inline std::string MetricsRegistry::WithLabel(const std::string& labels, const std::string& extra)
+{
+    return labels.empty() ? "{" + extra + "}" : labels.substr(0, labels.size() - 1) + "," + extra + "}";
+}
+
+inline std::string MetricsRegistry::Escape(const std::string& value)
+{
+    std::string out;
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Integers print exactly; everything else with the fewest digits that
+// round-trip, so bucket bounds read 0.1 rather than 0.10000000000000001
+inline std::string MetricsRegistry::Number(double v)
+{
+    if (std::isnan(v))
+    {
+        return "NaN";
+    }
+    if (std::isinf(v))
+    {
+        return v > 0 ? "+Inf" : "-Inf";
+    }
+    std::ostringstream os;
+    if (v == std::floor(v) && std::fabs(v) < 1e15)
+    {
+        os << int64_t(v);
+    }
+    else
+    {
+        os << std::setprecision(15) << v;
+        if (std::stod(os.str()) != v)
+        {
+            os.str("");
+            os << std::setprecision(17) << v;
+        }
+    }
+    return os.str();
+}
+
+} // namespace ns3
+
+#endif /* METRICS_REGISTRY_H */
@@ -0,0 +1,350 @@
+/*
+ * Packet trace converter
+ * Turns a binary packet trace (packet-trace-format.h) into CSV, pcap or
+ * NetAnim XML after the run.
+ *
+ *   csv      one line per record, all fields
+ *   pcap     raw-IP capture (DLT_RAW) of the IPv4 records; each packet is an
+ *            IPv4 header plus UDP/TCP ports rebuilt from the record, the
+ *            original length is kept so Wireshark statistics stay correct.
+ *            Use --event=TX --node=N for a single-vantage-point capture.
+ *   netanim  node and link elements plus one <p> per hop, pairing every RX
+ *            with the preceding TX of the same packet uid
+ *
+ * Examples:
+ *   packet-trace-convert --in=qos.ptr --format=csv --out=qos.csv
+ *   packet-trace-convert --in=qos.ptr --format=pcap --event=TX --node=3 --out=edge.pcap
+ *   packet-trace-convert --in=qos.ptr --format=netanim --out=qos-anim.xml
+ *   packet-trace-convert --in=qos.ptr --summary
+ */
+
+#include "ns3/core-module.h"
+
+#include "packet-trace-format.h"
+
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("PacketTraceConvert");
+
+// ============================================================================
+// CSV
+// ============================================================================
+
+static void WriteCsvHeader(std::ostream& os)
+{
+    os << "time_ns,event,node,device,uid,size,src,dst,protocol,src_port,dst_port,dscp,ttl,"
+          "ip_id,ip_length,drop_layer,drop_reason\n";
+}
+
+static void WriteCsv(std::ostream& os, const PacketTraceRecord& r)
+{
+    os << r.time << "," << PacketTraceEventName(r.event) << "," << r.node << "," << r.device << ","
+       << r.uid << "," << r.size << ",";
+    if (r.source || r.destination)
+    {
+        os << Ipv4Address(r.source) << "," << Ipv4Address(r.destination);
+    }
+    else
+    {
+        os << ",";
+    }
+    os << "," << uint32_t(r.protocol) << "," << r.srcPort << "," << r.dstPort << ","
+       << uint32_t(r.dscp) << "," << uint32_t(r.ttl) << "," << r.ipId << "," << r.ipLength << ",";
+    if (r.event == PacketTraceRecord::DROP)
+    {
+        os << DropAccounting::LayerName(r.layer) << "," << DropAccounting::ReasonName(r.reason);
+    }
+    else
+    {
+        os << ",";
+    }
+    os << "\n";
+}
+
+// ============================================================================
+// PCAP
+// ============================================================================
+
+static void Put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+static void Put32(uint8_t* p, uint32_t v)
+{
+    Put16(p, v >> 16);
+    Put16(p + 2, v & 0xffff);
+}
+
+static void WritePcapHeader(std::ostream& os)
+{
+    struct
+    {
+        uint32_t magic;
+        uint16_t major;
+        uint16_t minor;
+        int32_t zone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+    } header = {0xa1b2c3d4, 2, 4, 0, 0, 65535, 101}; // LINKTYPE_RAW
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+// Returns false for records without an IPv4 header
+static bool WritePcap(std::ostream& os, const PacketTraceRecord& r)
+{
+    if (r.ipLength < 20)
+    {
+        return false;
+    }
+    uint8_t b[40];
+    std::memset(b, 0, sizeof(b));
+    b[0] = 0x45;
+    b[1] = r.dscp << 2;
+    Put16(b + 2, r.ipLength);
+    Put16(b + 4, r.ipId);
+    b[8] = r.ttl;
+    b[9] = r.protocol;
+    Put32(b + 12, r.source);
+    Put32(b + 16, r.destination);
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2)
+    {
+        sum += (b[i] << 8) | b[i + 1];
+    }
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    Put16(b + 10, ~sum & 0xffff);
+
+    uint32_t capLength = 20;
+    if (r.protocol == 17 && r.ipLength >= 28)
+    {
+        Put16(b + 20, r.srcPort);
+        Put16(b + 22, r.dstPort);
+        Put16(b + 24, r.ipLength - 20);
+        capLength = 28;
+    }
+    else if (r.protocol == 6 && r.ipLength >= 40)
+    {
+        Put16(b + 20, r.srcPort);
+        Put16(b + 22, r.dstPort);
+        b[32] = 5 << 4; // data offset, no options
+        capLength = 40;
+    }
+
+    uint32_t record[4] = {uint32_t(r.time / 1000000000),
+                          uint32_t((r.time % 1000000000) / 1000),
+                          capLength,
+                          r.ipLength};
+    os.write(reinterpret_cast<const char*>(record), sizeof(record));
+    os.write(reinterpret_cast<const char*>(b), capLength);
+    return true;
+}
+
+// ============================================================================
+// NETANIM
+// ============================================================================
+
+static uint64_t WriteNetAnim(std::ostream& os,
+                             const PacketTraceReader& reader,
+                             const std::function<bool(const PacketTraceRecord&)>& accept)
+{
+    // Topology is inferred from the hops seen in the trace
+    std::set<uint32_t> nodes;
+    std::set<std::pair<uint32_t, uint32_t>> links;
+    std::unordered_map<uint64_t, uint64_t> pendingTx; // uid -> record index
+    std::vector<std::pair<uint64_t, uint64_t>> hops;    // (tx, rx) record indices
+
+    for (uint64_t i = 0; i < reader.GetNRecords(); i++)
+    {
+        const PacketTraceRecord& r = reader.Get(i);
+        nodes.insert(r.node);
+        if (r.event == PacketTraceRecord::TX)
+        {
+            pendingTx[r.uid] = i;
+        }
+        else if (r.event == PacketTraceRecord::RX)
+        {
+            auto it = pendingTx.find(r.uid);
+            if (it == pendingTx.end())
+            {
+                continue;
+            }
+            const PacketTraceRecord& tx = reader.Get(it->second);
+            if (tx.node != r.node && accept(tx))
+            {
+                hops.emplace_back(it->second, i);
+                links.insert(std::minmax(tx.node, r.node));
+            }
+            pendingTx.erase(it);
+        }
+    }
+
+    os << "<anim ver=\"netanim-3.108\" filetype=\"animation\" >\n";
+    os << "<info info=\"Converted by packet-trace-convert\" />\n";
+    uint32_t n = 0;
+    double radius = 20.0 + 4.0 * nodes.size();
+    for (uint32_t id : nodes)
+    {
+        double angle = 2 * M_PI * n++ / nodes.size();
+        os << "<node id=\"" << id << "\" sysId=\"0\" locX=\"" << radius * (1 + std::cos(angle))
+           << "\" locY=\"" << radius * (1 + std::sin(angle)) << "\" />\n";
+    }
+    for (const auto& link : links)
+    {
+        os << "<link fromId=\"" << link.first << "\" toId=\"" << link.second
+           << "\" fd=\"\" td=\"\" ld=\"\" />\n";
+    }
+    os.precision(9);
+    for (const auto& hop : hops)
+    {
+        const PacketTraceRecord& tx = reader.Get(hop.first);
+        const PacketTraceRecord& rx = reader.Get(hop.second);
+        double txTime = tx.time * 1e-9;
+        double rxTime = rx.time * 1e-9;
+        os << "<p fId=\"" << tx.node << "\" fbTx=\"" << txTime << "\" lbTx=\"" << txTime
+           << "\" tId=\"" << rx.node << "\" fbRx=\"" << rxTime << "\" lbRx=\"" << rxTime
+           << "\" />\n";
+    }
+    os << "</anim>\n";
+    return hops.size();
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+    std::string inFile = "packets.ptr";
+    std::string outFile = "";
+    std::string format = "csv";
+    std::string event = "all";
+    int32_t nodeId = -1;
+    bool summary = false;
+
+    CommandLine cmd;
+    cmd.AddValue("in", "Binary packet trace to read", inFile);
+    cmd.AddValue("out", "Output file (default: input name with the format's extension)", outFile);
+    cmd.AddValue("format", "Output format: csv, pcap or netanim", format);
+    cmd.AddValue("event", "Only convert this event (TX, RX, ENQUEUE, DEQUEUE, DROP or all)", event);
+    cmd.AddValue("node", "Only convert records from this node (-1 = all nodes)", nodeId);
+    cmd.AddValue("summary", "Print record counts per event and node instead of converting", summary);
+    cmd.Parse(argc, argv);
+
+    PacketTraceReader reader;
+    if (!reader.Open(inFile))
+    {
+        return 1;
+    }
+
+    int32_t eventId = -1;
+    for (uint32_t e = 0; e < PacketTraceRecord::N_EVENTS; e++)
+    {
+        if (event == PacketTraceEventName(e))
+        {
+            eventId = e;
+        }
+    }
+    if (eventId < 0 && event != "all")
+    {
+        std::cerr << "Unknown event '" << event << "'\n";
+        return 1;
+    }
+    auto accept = [&](const PacketTraceRecord& r) {
+        return (eventId < 0 || r.event == uint32_t(eventId)) &&
+               (nodeId < 0 || r.node == uint32_t(nodeId));
+    };
+
+    if (summary)
+    {
+        std::map<uint32_t, std::vector<uint64_t>> perNode;
+        for (uint64_t i = 0; i < reader.GetNRecords(); i++)
+        {
+            const PacketTraceRecord& r = reader.Get(i);
+            std::vector<uint64_t>& counts = perNode[r.node];
+            counts.resize(PacketTraceRecord::N_EVENTS);
+            counts[std::min<uint32_t>(r.event, PacketTraceRecord::N_EVENTS - 1)]++;
+        }
+        std::cout << reader.GetNRecords() << " records in " << inFile << "\n";
+        std::cout << "  node";
+        for (uint32_t e = 0; e < PacketTraceRecord::N_EVENTS; e++)
+        {
+            std::cout << std::setw(10) << PacketTraceEventName(e);
+        }
+        std::cout << "\n";
+        for (const auto& kv : perNode)
+        {
+            std::cout << std::setw(6) << kv.first;
+            for (uint64_t c : kv.second)
+            {
+                std::cout << std::setw(10) << c;
+            }
+            std::cout << "\n";
+        }
+        return 0;
+    }
+
+    if (format != "csv" && format != "pcap" && format != "netanim")
+    {
+        std::cerr << "Unknown format '" << format << "' (expected csv, pcap or netanim)\n";
+        return 1;
+    }
+    if (outFile.empty())
+    {
+        std::string stem = inFile.substr(0, inFile.rfind('.'));
+        outFile = stem + (format == "csv" ? ".csv" : format == "pcap" ? ".pcap" : "-anim.xml");
+    }
+    std::ofstream out(outFile, format == "pcap" ? std::ios::binary : std::ios::out);
+    if (!out)
+    {
+        std::cerr << "Cannot write " << outFile << "\n";
+        return 1;
+    }
+
+    uint64_t written = 0;
+    if (format == "netanim")
+    {
+        written = WriteNetAnim(out, reader, accept);
+    }
+    else
+    {
+        if (format == "csv")
+        {
+            WriteCsvHeader(out);
+        }
+        else
+        {
+            WritePcapHeader(out);
+        }
+        for (uint64_t i = 0; i < reader.GetNRecords(); i++)
+        {
+            const PacketTraceRecord& r = reader.Get(i);
+            if (!accept(r))
+            {
+                continue;
+            }
+            if (format == "csv")
+            {
+                WriteCsv(out, r);
+                written++;
+            }
+            else if (WritePcap(out, r))
+            {
+                written++;
+            }
+        }
+    }
+
+    std::cout << "Converted " << written << (format == "netanim" ? " hops" : " records") << " of "
+              << reader.GetNRecords() << " from " << inFile << " to " << outFile << "\n";
+    return 0;
+}
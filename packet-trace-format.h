@@ -0,0 +1,568 @@
+/*
+ * Compact binary packet trace
+ * One fixed 48-byte record per tx, rx, enqueue, dequeue or drop event,
+ * appended to a memory-mapped file, as an alternative to AnimationInterface
+ * packet XML and ASCII/pcap traces for million-packet runs (roughly 20x
+ * smaller than the equivalent NetAnim XML, and no formatting cost during
+ * the run). packet-trace-convert turns a trace into CSV, pcap or NetAnim
+ * XML afterwards.
+ *
+ * File layout: a 32-byte PacketTraceFileHeader followed by records in
+ * event order. Fields are stored in host byte order; the header carries a
+ * byte-order mark so readers can reject a foreign-endian file.
+ *
+ * Events and where they come from:
+ *   TX       device PhyTxBegin (packet on the wire)
+ *   RX       device MacRx
+ *   ENQUEUE  point-to-point device queue Enqueue
+ *   DEQUEUE  point-to-point device queue Dequeue
+ *   DROP     the same sources as DropAccounting, with its layer and reason
+ *
+ * Usage (after addresses are assigned, so the default queue discs exist):
+ *   PacketTracer tracer;
+ *   tracer.Open("run.ptr");
+ *   tracer.InstallAll();
+ *   ...
+ *   Simulator::Run();
+ *   tracer.Close();
+ */
+
+#ifndef PACKET_TRACE_FORMAT_H
+#define PACKET_TRACE_FORMAT_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include "drop-accounting.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+// ============================================================================
+// RECORD FORMAT
+// ============================================================================
+
+struct PacketTraceRecord
+{
+    enum Event
+    {
+        TX,
+        RX,
+        ENQUEUE,
+        DEQUEUE,
+        DROP,
+        N_EVENTS
+    };
+
+    int64_t time;        // ns
+    uint64_t uid;        // Packet::GetUid
+    uint32_t node;
+    uint32_t size;       // bytes as seen by the traced layer
+    uint32_t source;     // IPv4, 0 if the packet is not IPv4
+    uint32_t destination;
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint16_t device;     // node-local device index
+    uint8_t event;
+    uint8_t protocol;
+    uint8_t dscp;
+    uint8_t ttl;
+    uint8_t layer;       // DropAccounting::Layer, DROP only
+    uint8_t reason;      // DropAccounting::Reason, DROP only
+    uint16_t ipId;
+    uint16_t ipLength;   // IPv4 total length
+};
+
+static_assert(sizeof(PacketTraceRecord) == 48, "PacketTraceRecord must stay 48 bytes");
+
+struct PacketTraceFileHeader
+{
+    char magic[8];       // "PKTTRC01"
+    uint32_t recordSize;
+    uint32_t byteOrder;  // 0x01020304 as written by the producer
+    uint64_t nRecords;   // filled in on Close
+    uint64_t reserved;
+};
+
+static_assert(sizeof(PacketTraceFileHeader) == 32, "PacketTraceFileHeader must stay 32 bytes");
+
+inline const char* PacketTraceEventName(uint32_t event)
+{
+    static const char* names[PacketTraceRecord::N_EVENTS] = {"TX", "RX", "ENQUEUE", "DEQUEUE", "DROP"};
+    return event < PacketTraceRecord::N_EVENTS ? names[event] : "?";
+}
+
+// Fills the IPv4/L4 fields from the first bytes of a packet; a leading PPP
+// header (protocol 0x0021) is skipped
+inline void PacketTraceParseIpv4(const uint8_t* b, uint32_t n, PacketTraceRecord& r)
+{
+    if (n >= 2 && b[0] == 0x00 && b[1] == 0x21)
+    {
+        b += 2;
+        n -= 2;
+    }
+    if (n < 20 || (b[0] >> 4) != 4)
+    {
+        return;
+    }
+    uint32_t ihl = (b[0] & 0x0f) * 4;
+    r.dscp = b[1] >> 2;
+    r.ipLength = (b[2] << 8) | b[3];
+    r.ipId = (b[4] << 8) | b[5];
+    r.ttl = b[8];
+    r.protocol = b[9];
+    r.source = (uint32_t(b[12]) << 24) | (b[13] << 16) | (b[14] << 8) | b[15];
+    r.destination = (uint32_t(b[16]) << 24) | (b[17] << 16) | (b[18] << 8) | b[19];
+    bool firstFragment = (((b[6] << 8) | b[7]) & 0x1fff) == 0;
+    if ((r.protocol == 6 || r.protocol == 17) && firstFragment && n >= ihl + 4)
+    {
+        r.srcPort = (b[ihl] << 8) | b[ihl + 1];
+        r.dstPort = (b[ihl + 2] << 8) | b[ihl + 3];
+    }
+}
+
+// ============================================================================
+// WRITER
+// ============================================================================
+
+// Records are copied straight into a shared mapping of the output file,
+// which grows one window (WindowRecords) at a time; the page cache does the
+// buffering and writeback. The default simulator runs every event on one
+// thread, so one writer per process suffices (distributed runs write one
+// file per rank).
+class PacketTraceWriter
+{
+public:
+    PacketTraceWriter();
+    ~PacketTraceWriter();
+
+    bool Open(std::string filename, uint32_t windowRecords = 1 << 20);
+    void Write(const PacketTraceRecord& record);
+    void Close();
+
+    bool IsOpen() const { return m_fd >= 0; }
+    uint64_t GetNRecords() const { return m_nRecords; }
+
+private:
+    void Remap();
+    void Unmap();
+
+    int m_fd;
+    uint8_t* m_base;         // current mapping
+    std::size_t m_mapLength;
+    uint8_t* m_cursor;
+    uint8_t* m_end;
+    uint64_t m_fileOffset;   // bytes written so far
+    uint64_t m_windowBytes;
+    uint64_t m_nRecords;
+};
+
+inline PacketTraceWriter::PacketTraceWriter()
+    : m_fd(-1),
+      m_base(nullptr),
+      m_mapLength(0),
+      m_cursor(nullptr),
+      m_end(nullptr),
+      m_fileOffset(0),
+      m_windowBytes(0),
+      m_nRecords(0)
+{
+}
+
+inline PacketTraceWriter::~PacketTraceWriter()
+{
+    Close();
+}
+
+inline bool PacketTraceWriter::Open(std::string filename, uint32_t windowRecords)
+{
+    Close();
+    m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        std::cerr << "PacketTraceWriter: cannot create " << filename << "\n";
+        return false;
+    }
+    m_windowBytes = uint64_t(std::max<uint32_t>(windowRecords, 1)) * sizeof(PacketTraceRecord);
+    m_fileOffset = 0;
+    m_nRecords = 0;
+    Remap();
+    if (m_fd < 0)
+    {
+        return false;
+    }
+
+    PacketTraceFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "PKTTRC01", 8);
+    header.recordSize = sizeof(PacketTraceRecord);
+    header.byteOrder = 0x01020304;
+    std::memcpy(m_cursor, &header, sizeof(header));
+    m_cursor += sizeof(header);
+    m_fileOffset += sizeof(header);
+    return true;
+}
+
+inline void PacketTraceWriter::Write(const PacketTraceRecord& record)
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    if (m_cursor + sizeof(PacketTraceRecord) > m_end)
+    {
+        Remap();
+        if (m_fd < 0)
+        {
+            return;
+        }
+    }
+    std::memcpy(m_cursor, &record, sizeof(PacketTraceRecord));
+    m_cursor += sizeof(PacketTraceRecord);
+    m_fileOffset += sizeof(PacketTraceRecord);
+    m_nRecords++;
+}
+
+// Extend the file by one window and map it from the page holding the
+// current offset
+inline void PacketTraceWriter::Remap()
+{
+    Unmap();
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t size = m_fileOffset + m_windowBytes;
+    if (::ftruncate(m_fd, size) != 0)
+    {
+        std::cerr << "PacketTraceWriter: cannot grow trace file\n";
+        Close();
+        return;
+    }
+    uint64_t mapOffset = m_fileOffset / page * page;
+    m_mapLength = size - mapOffset;
+    void* base = ::mmap(nullptr, m_mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, mapOffset);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "PacketTraceWriter: mmap failed\n";
+        m_base = nullptr;
+        Close();
+        return;
+    }
+    m_base = static_cast<uint8_t*>(base);
+    m_cursor = m_base + (m_fileOffset - mapOffset);
+    m_end = m_base + m_mapLength;
+}
+
+inline void PacketTraceWriter::Unmap()
+{
+    if (m_base)
+    {
+        ::munmap(m_base, m_mapLength);
+        m_base = nullptr;
+        m_cursor = nullptr;
+        m_end = nullptr;
+    }
+}
+
+inline void PacketTraceWriter::Close()
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    Unmap();
+    if (::pwrite(m_fd, &m_nRecords, sizeof(m_nRecords), offsetof(PacketTraceFileHeader, nRecords)) !=
+            sizeof(m_nRecords) ||
+        ::ftruncate(m_fd, m_fileOffset) != 0)
+    {
+        std::cerr << "PacketTraceWriter: could not finalize trace file\n";
+    }
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+// ============================================================================
+// READER
+// ============================================================================
+
+class PacketTraceReader
+{
+public:
+    PacketTraceReader() : m_base(nullptr), m_length(0), m_nRecords(0) {}
+    ~PacketTraceReader() { Close(); }
+
+    bool Open(std::string filename);
+    void Close();
+
+    uint64_t GetNRecords() const { return m_nRecords; }
+    const PacketTraceRecord& Get(uint64_t i) const
+    {
+        return reinterpret_cast<const PacketTraceRecord*>(m_base + sizeof(PacketTraceFileHeader))[i];
+    }
+
+private:
+    const uint8_t* m_base;
+    std::size_t m_length;
+    uint64_t m_nRecords;
+};
+
+inline bool PacketTraceReader::Open(std::string filename)
+{
+    Close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(PacketTraceFileHeader))
+    {
+        std::cerr << "PacketTraceReader: cannot read " << filename << "\n";
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "PacketTraceReader: mmap failed for " << filename << "\n";
+        return false;
+    }
+    m_base = static_cast<const uint8_t*>(base);
+    m_length = st.st_size;
+
+    const PacketTraceFileHeader* header = reinterpret_cast<const PacketTraceFileHeader*>(m_base);
+    if (std::memcmp(header->magic, "PKTTRC01", 8) != 0 || header->byteOrder != 0x01020304 ||
+        header->recordSize != sizeof(PacketTraceRecord))
+    {
+        std::cerr << "PacketTraceReader: " << filename
+                  << " is not a packet trace (or was written on a different-endian host)\n";
+        Close();
+        return false;
+    }
+    // A run that crashed before Close leaves nRecords at 0; trust the size
+    uint64_t available = (m_length - sizeof(PacketTraceFileHeader)) / sizeof(PacketTraceRecord);
+    m_nRecords = header->nRecords > 0 ? std::min(header->nRecords, available) : available;
+    return true;
+}
+
+inline void PacketTraceReader::Close()
+{
+    if (m_base)
+    {
+        ::munmap(const_cast<uint8_t*>(m_base), m_length);
+        m_base = nullptr;
+        m_length = 0;
+        m_nRecords = 0;
+    }
+}
+
+// ============================================================================
+// TRACER
+// ============================================================================
+
+class PacketTracer
+{
+public:
+    bool Open(std::string filename) { return m_writer.Open(filename); }
+    void Close() { m_writer.Close(); }
+    bool IsOpen() const { return m_writer.IsOpen(); }
+
+    // Connect trace sinks on every node and device of the current NodeList
+    void InstallAll();
+
+    uint64_t GetNRecords() const { return m_writer.GetNRecords(); }
+
+private:
+    void Emit(PacketTraceRecord::Event event,
+              uint32_t slot,
+              Ptr<const Packet> packet,
+              uint8_t layer = 0,
+              uint8_t reason = 0);
+
+    static void Tx(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void Rx(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void Enqueue(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void Dequeue(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void PhyRxDrop(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void MacTxDrop(PacketTracer* self, Ptr<NetDevice> device, Ptr<const Packet> packet);
+    static void QueueDrop(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet);
+    static void QdiscDrop(PacketTracer* self,
+                          uint32_t slot,
+                          Ptr<const QueueDiscItem> item,
+                          const char* reason);
+    static void Ipv4Drop(PacketTracer* self,
+                         uint32_t node,
+                         const Ipv4Header& header,
+                         Ptr<const Packet> packet,
+                         Ipv4L3Protocol::DropReason reason,
+                         Ptr<Ipv4> ipv4,
+                         uint32_t interface);
+
+    // slot = node << 16 | device
+    static uint32_t Slot(uint32_t node, uint32_t device) { return (node << 16) | device; }
+
+    PacketTraceWriter m_writer;
+};
+
+inline void PacketTracer::InstallAll()
+{
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> device = node->GetDevice(d);
+            uint32_t slot = Slot(n, d);
+            device->TraceConnectWithoutContext("PhyTxBegin",
+                                               MakeBoundCallback(&PacketTracer::Tx, this, slot));
+            device->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&PacketTracer::Rx, this, slot));
+            device->TraceConnectWithoutContext("PhyRxDrop",
+                                               MakeBoundCallback(&PacketTracer::PhyRxDrop, this, slot));
+            device->TraceConnectWithoutContext("MacTxDrop",
+                                               MakeBoundCallback(&PacketTracer::MacTxDrop, this, device));
+
+            if (Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device))
+            {
+                Ptr<Queue<Packet>> queue = p2p->GetQueue();
+                queue->TraceConnectWithoutContext("Enqueue",
+                                                  MakeBoundCallback(&PacketTracer::Enqueue, this, slot));
+                queue->TraceConnectWithoutContext("Dequeue",
+                                                  MakeBoundCallback(&PacketTracer::Dequeue, this, slot));
+                queue->TraceConnectWithoutContext("Drop",
+                                                  MakeBoundCallback(&PacketTracer::QueueDrop, this, slot));
+            }
+            if (Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : Ptr<QueueDisc>())
+            {
+                qdisc->TraceConnectWithoutContext("DropBeforeEnqueue",
+                                                  MakeBoundCallback(&PacketTracer::QdiscDrop, this, slot));
+                qdisc->TraceConnectWithoutContext("DropAfterDequeue",
+                                                  MakeBoundCallback(&PacketTracer::QdiscDrop, this, slot));
+            }
+        }
+
+        if (Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>())
+        {
+            ipv4->TraceConnectWithoutContext("Drop", MakeBoundCallback(&PacketTracer::Ipv4Drop, this, n));
+        }
+    }
+}
+
+inline void PacketTracer::Emit(PacketTraceRecord::Event event,
+                               uint32_t slot,
+                               Ptr<const Packet> packet,
+                               uint8_t layer,
+                               uint8_t reason)
+{
+    PacketTraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.time = Simulator::Now().GetNanoSeconds();
+    r.uid = packet->GetUid();
+    r.node = slot >> 16;
+    r.device = slot & 0xffff;
+    r.size = packet->GetSize();
+    r.event = event;
+    r.layer = layer;
+    r.reason = reason;
+    uint8_t bytes[64];
+    PacketTraceParseIpv4(bytes, packet->CopyData(bytes, sizeof(bytes)), r);
+    m_writer.Write(r);
+}
+
+inline void PacketTracer::Tx(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::TX, slot, packet);
+}
+
+inline void PacketTracer::Rx(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::RX, slot, packet);
+}
+
+inline void PacketTracer::Enqueue(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::ENQUEUE, slot, packet);
+}
+
+inline void PacketTracer::Dequeue(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::DEQUEUE, slot, packet);
+}
+
+inline void PacketTracer::PhyRxDrop(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::DROP,
+               slot,
+               packet,
+               DropAccounting::LAYER_PHY,
+               DropAccounting::PHY_ERROR);
+}
+
+// A full queue also fires MacTxDrop; the queue's own Drop trace records it
+inline void PacketTracer::MacTxDrop(PacketTracer* self, Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    if (device->IsLinkUp())
+    {
+        return;
+    }
+    self->Emit(PacketTraceRecord::DROP,
+               Slot(device->GetNode()->GetId(), device->GetIfIndex()),
+               packet,
+               DropAccounting::LAYER_DEVICE,
+               DropAccounting::INTERFACE_DOWN);
+}
+
+inline void PacketTracer::QueueDrop(PacketTracer* self, uint32_t slot, Ptr<const Packet> packet)
+{
+    self->Emit(PacketTraceRecord::DROP,
+               slot,
+               packet,
+               DropAccounting::LAYER_QUEUE,
+               DropAccounting::QUEUE_FULL);
+}
+
+inline void PacketTracer::QdiscDrop(PacketTracer* self,
+                                    uint32_t slot,
+                                    Ptr<const QueueDiscItem> item,
+                                    const char* reason)
+{
+    bool overflow = std::strstr(reason, "limit") || std::strstr(reason, "full") ||
+                    std::strstr(reason, "Overlimit");
+    // Queue disc items hold the IPv4 header outside the packet
+    Ptr<Packet> packet = item->GetPacket()->Copy();
+    if (Ptr<const Ipv4QueueDiscItem> ipItem = DynamicCast<const Ipv4QueueDiscItem>(item))
+    {
+        packet->AddHeader(ipItem->GetHeader());
+    }
+    self->Emit(PacketTraceRecord::DROP,
+               slot,
+               packet,
+               DropAccounting::LAYER_QDISC,
+               overflow ? DropAccounting::QUEUE_FULL : DropAccounting::POLICER);
+}
+
+inline void PacketTracer::Ipv4Drop(PacketTracer* self,
+                                   uint32_t node,
+                                   const Ipv4Header& header,
+                                   Ptr<const Packet> packet,
+                                   Ipv4L3Protocol::DropReason reason,
+                                   Ptr<Ipv4> ipv4,
+                                   uint32_t interface)
+{
+    DropAccounting::Reason r = DropAccounting::FromIpv4(reason);
+    uint32_t device = interface < ipv4->GetNInterfaces() ? ipv4->GetNetDevice(interface)->GetIfIndex() : 0;
+    Ptr<Packet> copy = packet->Copy();
+    copy->AddHeader(header);
+    self->Emit(PacketTraceRecord::DROP, Slot(node, device), copy, DropAccounting::LAYER_IP, r);
+}
+
+} // namespace ns3
+
+#endif /* PACKET_TRACE_FORMAT_H */
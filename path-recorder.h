@@ -0,0 +1,562 @@
+/*
+ * Per-packet path recording
+ * Tags every IPv4 packet with its flow and the route it has taken so far,
+ * and counts packets per (flow, path, outcome) when they are delivered or
+ * dropped. This shows whether traffic after a failure really took the
+ * backup route or was lost, and where.
+ *
+ * The tag is 8 bytes: a flow index and a path id. Paths are interned in a
+ * trie of (parent path, node), so extending a path by one hop is one hash
+ * lookup and the tag never grows with the hop count. Memory scales with the
+ * number of distinct flows and paths, not with packets.
+ *
+ * Trace sources per node:
+ *   Ipv4L3Protocol SendOutgoing    tag at the source (flow lookup, first hop)
+ *   Ipv4L3Protocol UnicastForward  append the forwarding router
+ *   Ipv4L3Protocol LocalDeliver    count DELIVERED
+ *   Ipv4L3Protocol Drop            count the IP drop reason
+ *   NetDevice MacTxDrop            count DEVICE_DROP (link down, queue full)
+ * Packets that were sent but have no outcome were in flight at the end or
+ * dropped where no trace is connected (queue discs, PHY errors).
+ *
+ * Node names come from ns3::Names, falling back to "node <id>".
+ *
+ * Usage (after the internet stack is installed):
+ *   PathRecorder paths;
+ *   paths.InstallAll();
+ *   ...
+ *   paths.PrintReport(std::cout);
+ */
+
+#ifndef PATH_RECORDER_H
+#define PATH_RECORDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include "drop-accounting.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// PATH TAG
+// ============================================================================
+
+class PathTag : public Tag
+{
+public:
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+
+    PathTag() : m_flow(0), m_path(0) {}
+    PathTag(uint32_t flow, uint32_t path) : m_flow(flow), m_path(path) {}
+
+    uint32_t GetFlow() const { return m_flow; }
+    uint32_t GetPath() const { return m_path; }
+
+    uint32_t GetSerializedSize() const override { return 8; }
+    void Serialize(TagBuffer i) const override
+    {
+        i.WriteU32(m_flow);
+        i.WriteU32(m_path);
+    }
+    void Deserialize(TagBuffer i) override
+    {
+        m_flow = i.ReadU32();
+        m_path = i.ReadU32();
+    }
+    void Print(std::ostream& os) const override { os << "flow=" << m_flow << " path=" << m_path; }
+
+private:
+    uint32_t m_flow;
+    uint32_t m_path;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PathTag);
+
+inline TypeId PathTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::PathTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<PathTag>();
+    return tid;
+}
+
+// ============================================================================
+// PATH RECORDER
+// ============================================================================
+
+class PathRecorder
+{
+public:
+    enum Outcome
+    {
+        DELIVERED,
+        NO_ROUTE,
+        INTERFACE_DOWN,
+        TTL_EXPIRED,
+        DEVICE_DROP,
+        OTHER_DROP,
+        N_OUTCOMES
+    };
+
+    static const char* OutcomeName(uint32_t outcome);
+
+    PathRecorder();
+
+    void Install(NodeContainer nodes);
+    void InstallAll();
+
+    // Flows shown in the report, by packets sent (default 20)
+    void SetReportFlows(uint32_t n) { m_reportFlows = n; }
+
+    uint32_t GetNFlows() const { return m_flows.size(); }
+    uint32_t GetNPaths() const { return m_paths.size() - 1; }
+    // Packets of a flow with this outcome over a path given as node ids
+    uint64_t GetCount(uint32_t flow, const std::vector<uint32_t>& nodes, Outcome outcome) const;
+
+    void PrintReport(std::ostream& os) const;
+
+private:
+    struct PathNode
+    {
+        uint32_t parent;
+        uint32_t node;
+    };
+
+    struct Flow
+    {
+        Ipv4Address source;
+        Ipv4Address destination;
+        uint16_t sourcePort;
+        uint16_t destinationPort;
+        uint8_t protocol;
+        uint64_t sent;
+        uint32_t lastPath;       // last delivered path, 0 before
+        uint32_t nChanges;
+    };
+
+    struct FlowKey
+    {
+        uint64_t addresses;    // source, destination
+        uint64_t ports;        // source port, destination port, protocol
+
+        bool operator==(const FlowKey& o) const { return addresses == o.addresses && ports == o.ports; }
+    };
+
+    struct FlowKeyHash
+    {
+        size_t operator()(const FlowKey& k) const
+        {
+            return std::hash<uint64_t>()(k.addresses * 0x9e3779b97f4a7c15ULL ^ k.ports);
+        }
+    };
+
+    struct PathChange
+    {
+        Time time;
+        uint32_t from;
+        uint32_t to;
+    };
+
+    struct PathStats
+    {
+        uint64_t packets;
+        uint64_t bytes;
+        Time first;
+        Time last;
+    };
+
+    // Path changes kept per flow; later ones are only counted
+    static const uint32_t MAX_CHANGES = 16;
+
+    uint32_t Extend(uint32_t path, uint32_t node);
+    uint32_t FindFlow(const Ipv4Header& header, Ptr<const Packet> payload);
+    // The packet's tag, or a new one (counted as sent) for packets from
+    // untracked nodes and packets carrying another flow's tag
+    PathTag GetTag(const Ipv4Header& header, Ptr<const Packet> payload);
+    static void SetTag(Ptr<const Packet> packet, const PathTag& tag);
+    void Count(const PathTag& tag, Outcome outcome, uint32_t bytes);
+    std::string PathName(uint32_t path) const;
+
+    static uint64_t Key(uint32_t flow, uint32_t path, uint32_t outcome)
+    {
+        return (uint64_t(flow) << 32) | (uint64_t(path) << 3) | outcome;
+    }
+
+    // Trace sinks; the node id is bound at connect time
+    static void SendOutgoing(PathRecorder* self,
+                             uint32_t node,
+                             const Ipv4Header& header,
+                             Ptr<const Packet> packet,
+                             uint32_t interface);
+    static void UnicastForward(PathRecorder* self,
+                               uint32_t node,
+                               const Ipv4Header& header,
+                               Ptr<const Packet> packet,
+                               uint32_t interface);
+    static void LocalDeliver(PathRecorder* self,
+                             uint32_t node,
+                             const Ipv4Header& header,
+                             Ptr<const Packet> packet,
+                             uint32_t interface);
+    static void Ipv4Drop(PathRecorder* self,
+                         uint32_t node,
+                         const Ipv4Header& header,
+                         Ptr<const Packet> packet,
+                         Ipv4L3Protocol::DropReason reason,
+                         Ptr<Ipv4> ipv4,
+                         uint32_t interface);
+    static void MacTxDrop(PathRecorder* self, Ptr<const Packet> packet);
+
+    std::vector<PathNode> m_paths;                        // id 0 is the empty path
+    std::unordered_map<uint64_t, uint32_t> m_children;    // (parent, node) -> path
+    std::vector<Flow> m_flows;
+    std::unordered_map<FlowKey, uint32_t, FlowKeyHash> m_flowIndex;
+    std::vector<std::vector<PathChange>> m_changes;       // per flow
+    std::unordered_map<uint64_t, PathStats> m_stats;      // Key(flow, path, outcome)
+    uint32_t m_reportFlows;
+};
+
+inline const char* PathRecorder::OutcomeName(uint32_t outcome)
+{
+    static const char* names[N_OUTCOMES] =
+        {"delivered", "no route", "interface down", "TTL expired", "device drop", "dropped"};
+    return outcome < N_OUTCOMES ? names[outcome] : "?";
+}
+
+inline PathRecorder::PathRecorder()
+    : m_reportFlows(20)
+{
+    m_paths.push_back({0, 0});
+}
+
+inline void PathRecorder::Install(NodeContainer nodes)
+{
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        uint32_t n = node->GetId();
+        Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+        if (!ipv4)
+        {
+            continue;
+        }
+        ipv4->TraceConnectWithoutContext("SendOutgoing",
+                                         MakeBoundCallback(&PathRecorder::SendOutgoing, this, n));
+        ipv4->TraceConnectWithoutContext("UnicastForward",
+                                         MakeBoundCallback(&PathRecorder::UnicastForward, this, n));
+        ipv4->TraceConnectWithoutContext("LocalDeliver",
+                                         MakeBoundCallback(&PathRecorder::LocalDeliver, this, n));
+        ipv4->TraceConnectWithoutContext("Drop", MakeBoundCallback(&PathRecorder::Ipv4Drop, this, n));
+        for (uint32_t d = 0; d < node->GetNDevices(); d++)
+        {
+            node->GetDevice(d)->TraceConnectWithoutContext("MacTxDrop",
+                                                           MakeBoundCallback(&PathRecorder::MacTxDrop, this));
+        }
+    }
+}
+
+inline void PathRecorder::InstallAll()
+{
+    Install(NodeContainer::GetGlobal());
+}
+
+// A path already ending at this node is returned unchanged, so a packet
+// dropped after its hop was recorded does not visit the node twice
+inline uint32_t PathRecorder::Extend(uint32_t path, uint32_t node)
+{
+    if (path != 0 && m_paths[path].node == node)
+    {
+        return path;
+    }
+    uint64_t key = (uint64_t(path) << 32) | node;
+    auto it = m_children.find(key);
+    if (it != m_children.end())
+    {
+        return it->second;
+    }
+    uint32_t id = m_paths.size();
+    m_paths.push_back({path, node});
+    m_children[key] = id;
+    return id;
+}
+
+inline uint32_t PathRecorder::FindFlow(const Ipv4Header& header, Ptr<const Packet> payload)
+{
+    // The payload starts with the TCP/UDP header; its first four bytes are
+    // the ports
+    uint8_t ports[4] = {0, 0, 0, 0};
+    uint8_t protocol = header.GetProtocol();
+    if ((protocol == 6 || protocol == 17) && header.GetFragmentOffset() == 0)
+    {
+        payload->CopyData(ports, 4);
+    }
+    uint32_t portPair = (uint32_t(ports[0]) << 24) | (ports[1] << 16) | (ports[2] << 8) | ports[3];
+    FlowKey key = {(uint64_t(header.GetSource().Get()) << 32) | header.GetDestination().Get(),
+                   (uint64_t(portPair) << 8) | protocol};
+
+    auto it = m_flowIndex.find(key);
+    if (it != m_flowIndex.end())
+    {
+        return it->second;
+    }
+    Flow flow;
+    flow.source = header.GetSource();
+    flow.destination = header.GetDestination();
+    flow.sourcePort = portPair >> 16;
+    flow.destinationPort = portPair & 0xffff;
+    flow.protocol = protocol;
+    flow.sent = 0;
+    flow.lastPath = 0;
+    flow.nChanges = 0;
+    uint32_t index = m_flows.size();
+    m_flows.push_back(flow);
+    m_changes.emplace_back();
+    m_flowIndex[key] = index;
+    return index;
+}
+
+inline PathTag PathRecorder::GetTag(const Ipv4Header& header, Ptr<const Packet> payload)
+{
+    // A tag whose flow does not match the headers is left over from an
+    // earlier trip (e.g. copied along by an application) and is not trusted
+    uint32_t flow = FindFlow(header, payload);
+    PathTag tag;
+    if (payload->PeekPacketTag(tag) && tag.GetFlow() == flow)
+    {
+        return tag;
+    }
+    m_flows[flow].sent++;
+    return PathTag(flow, 0);
+}
+
+// The traced packets are the ones about to be sent (SendOutgoing before the
+// copy handed to the device, UnicastForward on IpForward's own copy), so
+// the tag is updated in place
+inline void PathRecorder::SetTag(Ptr<const Packet> packet, const PathTag& tag)
+{
+    Packet* p = const_cast<Packet*>(PeekPointer(packet));
+    PathTag old;
+    p->RemovePacketTag(old);
+    p->AddPacketTag(tag);
+}
+
+inline void PathRecorder::Count(const PathTag& tag, Outcome outcome, uint32_t bytes)
+{
+    PathStats& s = m_stats[Key(tag.GetFlow(), tag.GetPath(), outcome)];
+    if (s.packets == 0)
+    {
+        s.first = Simulator::Now();
+    }
+    s.packets++;
+    s.bytes += bytes;
+    s.last = Simulator::Now();
+
+    Flow& flow = m_flows[tag.GetFlow()];
+    if (outcome == DELIVERED && flow.lastPath != tag.GetPath())
+    {
+        if (flow.lastPath != 0 && flow.nChanges++ < MAX_CHANGES)
+        {
+            m_changes[tag.GetFlow()].push_back({Simulator::Now(), flow.lastPath, tag.GetPath()});
+        }
+        flow.lastPath = tag.GetPath();
+    }
+}
+
+inline void PathRecorder::SendOutgoing(PathRecorder* self,
+                                       uint32_t node,
+                                       const Ipv4Header& header,
+                                       Ptr<const Packet> packet,
+                                       uint32_t interface)
+{
+    // A fresh packet from this node's stack: any tag is left over from an
+    // earlier trip (an application re-sending what it received)
+    uint32_t flow = self->FindFlow(header, packet);
+    self->m_flows[flow].sent++;
+    SetTag(packet, PathTag(flow, self->Extend(0, node)));
+}
+
+inline void PathRecorder::UnicastForward(PathRecorder* self,
+                                         uint32_t node,
+                                         const Ipv4Header& header,
+                                         Ptr<const Packet> packet,
+                                         uint32_t interface)
+{
+    PathTag tag = self->GetTag(header, packet);
+    SetTag(packet, PathTag(tag.GetFlow(), self->Extend(tag.GetPath(), node)));
+}
+
+inline void PathRecorder::LocalDeliver(PathRecorder* self,
+                                       uint32_t node,
+                                       const Ipv4Header& header,
+                                       Ptr<const Packet> packet,
+                                       uint32_t interface)
+{
+    PathTag tag = self->GetTag(header, packet);
+    self->Count(PathTag(tag.GetFlow(), self->Extend(tag.GetPath(), node)), DELIVERED, packet->GetSize());
+}
+
+inline void PathRecorder::Ipv4Drop(PathRecorder* self,
+                                   uint32_t node,
+                                   const Ipv4Header& header,
+                                   Ptr<const Packet> packet,
+                                   Ipv4L3Protocol::DropReason reason,
+                                   Ptr<Ipv4> ipv4,
+                                   uint32_t interface)
+{
+    Outcome outcome = OTHER_DROP;
+    switch (DropAccounting::FromIpv4(reason))
+    {
+    case DropAccounting::TTL_EXPIRED:
+        outcome = TTL_EXPIRED;
+        break;
+    case DropAccounting::NO_ROUTE:
+        outcome = NO_ROUTE;
+        break;
+    case DropAccounting::INTERFACE_DOWN:
+        outcome = INTERFACE_DOWN;
+        break;
+    default:
+        break;
+    }
+    // Packets dropped before SendOutgoing (no route at the source) are not
+    // tagged or counted as sent yet; GetTag does both
+    PathTag tag = self->GetTag(header, packet);
+    self->Count(PathTag(tag.GetFlow(), self->Extend(tag.GetPath(), node)), outcome, packet->GetSize());
+}
+
+// Below IP the packet carries its headers, so only tagged packets are
+// counted; the tag already ends at the sending node
+inline void PathRecorder::MacTxDrop(PathRecorder* self, Ptr<const Packet> packet)
+{
+    PathTag tag;
+    if (packet->PeekPacketTag(tag))
+    {
+        self->Count(tag, DEVICE_DROP, packet->GetSize());
+    }
+}
+
+inline uint64_t PathRecorder::GetCount(uint32_t flow, const std::vector<uint32_t>& nodes, Outcome outcome) const
+{
+    uint32_t path = 0;
+    for (uint32_t node : nodes)
+    {
+        auto it = m_children.find((uint64_t(path) << 32) | node);
+        if (it == m_children.end())
+        {
+            return 0;
+        }
+        path = it->second;
+    }
+    auto it = m_stats.find(Key(flow, path, outcome));
+    return it == m_stats.end() ? 0 : it->second.packets;
+}
+
+inline std::string PathRecorder::PathName(uint32_t path) const
+{
+    std::vector<uint32_t> nodes;
+    for (; path != 0; path = m_paths[path].parent)
+    {
+        nodes.push_back(m_paths[path].node);
+    }
+    std::string name;
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+    {
+        std::string node = Names::FindName(NodeList::GetNode(*it));
+        name += (name.empty() ? "" : " -> ") + (node.empty() ? "node " + std::to_string(*it) : node);
+    }
+    return name;
+}
+
+inline void PathRecorder::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Packet Paths (" << m_flows.size() << " flows, " << m_paths.size() - 1 << " paths) ===\n";
+
+    std::vector<uint32_t> order(m_flows.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_flows[a].sent > m_flows[b].sent;
+    });
+    if (order.size() > m_reportFlows)
+    {
+        order.resize(m_reportFlows);
+    }
+
+    // Group the counters by flow once instead of scanning them per flow
+    std::vector<std::vector<std::pair<uint64_t, const PathStats*>>> byFlow(m_flows.size());
+    for (const auto& kv : m_stats)
+    {
+        byFlow[kv.first >> 32].push_back({kv.first, &kv.second});
+    }
+
+    os << std::fixed << std::setprecision(3);
+    for (uint32_t f : order)
+    {
+        const Flow& flow = m_flows[f];
+        os << "Flow " << flow.source;
+        if (flow.sourcePort)
+        {
+            os << ":" << flow.sourcePort;
+        }
+        os << " -> " << flow.destination;
+        if (flow.destinationPort)
+        {
+            os << ":" << flow.destinationPort;
+        }
+        os << (flow.protocol == 6 ? " TCP" : flow.protocol == 17 ? " UDP" : " proto " + std::to_string(flow.protocol))
+           << ", " << flow.sent << " sent\n";
+
+        std::vector<std::pair<uint64_t, const PathStats*>>& entries = byFlow[f];
+        std::sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, const PathStats*>& a,
+                                                     const std::pair<uint64_t, const PathStats*>& b) {
+            return a.second->first < b.second->first;
+        });
+        uint64_t accounted = 0;
+        for (const auto& e : entries)
+        {
+            const PathStats& s = *e.second;
+            accounted += s.packets;
+            os << "  " << std::left << std::setw(15) << OutcomeName(e.first & 7) << std::setw(32)
+               << PathName(uint32_t(e.first) >> 3) << std::right << std::setw(8) << s.packets << " pkts "
+               << std::setw(10) << s.bytes << " B  " << s.first.GetSeconds() << "-" << s.last.GetSeconds()
+               << " s\n";
+        }
+        if (flow.sent > accounted)
+        {
+            os << "  unaccounted    " << flow.sent - accounted
+               << " (in flight, or dropped in a queue disc or by a PHY error)\n";
+        }
+        for (const PathChange& c : m_changes[f])
+        {
+            os << "  path change at " << c.time.GetSeconds() << " s: " << PathName(c.from) << "  =>  "
+               << PathName(c.to) << "\n";
+        }
+        if (flow.nChanges > MAX_CHANGES)
+        {
+            os << "  ... " << flow.nChanges - MAX_CHANGES << " more path changes\n";
+        }
+    }
+    if (m_flows.size() > m_reportFlows)
+    {
+        os << "(" << m_flows.size() - m_reportFlows << " smaller flows not shown)\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+} // namespace ns3
+
+#endif /* PATH_RECORDER_H */
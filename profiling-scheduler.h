@@ -0,0 +1,348 @@
+/*
+ * Event profiler
+ * A Scheduler wrapper that breaks simulator cost down by event callback.
+ * Every event is counted by callback (the EventImpl type MakeEvent builds
+ * for it: a member function signature, a free function or a lambda) and
+ * by node context. For a random 1-in-SamplePeriod subset the wall time
+ * until the next event is dequeued is measured and charged to the event,
+ * so a sampled event pays for its own execution plus the events it
+ * schedules; the estimate per callback is sampled time x SamplePeriod.
+ *
+ * Usage (before Simulator::Run, any time after Parse):
+ *   ProfilingScheduler::Install();
+ *   ...
+ *   Simulator::Run();
+ *   ProfilingScheduler::GetInstance()->PrintReport(std::cout, 15);
+ *   ProfilingScheduler::GetInstance()->WriteFolded("run.folded");
+ *
+ * The folded file has one "callback;node N <ns>" line per pair and feeds
+ * flamegraph.pl or speedscope directly.
+ */
+
+#ifndef PROFILING_SCHEDULER_H
+#define PROFILING_SCHEDULER_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cxxabi.h>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace ns3
+{
+
+class ProfilingScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId();
+    ProfilingScheduler();
+    ~ProfilingScheduler() override;
+
+    // Replace the simulator's scheduler with a profiling wrapper around
+    // innerType
+    static void Install(uint32_t samplePeriod = 8, std::string innerType = "ns3::MapScheduler");
+    // The installed profiler, or null
+    static ProfilingScheduler* GetInstance() { return s_instance; }
+
+    void Insert(const Event& ev) override;
+    bool IsEmpty() const override;
+    Event PeekNext() const override;
+    Event RemoveNext() override;
+    void Remove(const Event& ev) override;
+
+    uint64_t GetNEvents() const { return m_nEvents; }
+    void PrintReport(std::ostream& os, uint32_t topN = 20) const;
+    bool WriteFolded(std::string filename) const;
+
+protected:
+    void DoDispose() override;
+
+private:
+    struct Key
+    {
+        const std::type_info* type;
+        uint32_t context;
+
+        bool operator==(const Key& o) const { return type == o.type && context == o.context; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& k) const
+        {
+            return std::hash<const void*>()(k.type) ^ (std::size_t(k.context) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    struct Stats
+    {
+        uint64_t events = 0;
+        uint64_t cancelled = 0;
+        uint64_t samples = 0;
+        uint64_t sampledNs = 0;
+    };
+
+    void SetInnerType(TypeId tid);
+    TypeId GetInnerType() const { return m_innerType; }
+    static std::string Label(const std::type_info& type);
+    static std::string ContextName(uint32_t context);
+
+    static ProfilingScheduler* s_instance;
+
+    Ptr<Scheduler> m_inner;
+    TypeId m_innerType;
+    uint32_t m_samplePeriod;
+    uint64_t m_rng;          // xorshift, independent of the simulation's streams
+    uint64_t m_nEvents;
+    std::unordered_map<Key, Stats, KeyHash> m_stats;
+    Stats* m_open;           // sampled event still running
+    std::chrono::steady_clock::time_point m_openSince;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingScheduler);
+
+inline ProfilingScheduler* ProfilingScheduler::s_instance = nullptr;
+
+inline TypeId ProfilingScheduler::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::ProfilingScheduler")
+            .SetParent<Scheduler>()
+            .SetGroupName("Core")
+            .AddConstructor<ProfilingScheduler>()
+            .AddAttribute("Scheduler",
+                          "Scheduler that actually holds the events",
+                          TypeIdValue(MapScheduler::GetTypeId()),
+                          MakeTypeIdAccessor(&ProfilingScheduler::SetInnerType,
+                                             &ProfilingScheduler::GetInnerType),
+                          MakeTypeIdChecker())
+            .AddAttribute("SamplePeriod",
+                          "Time one event in this many, chosen at random (1 = every event)",
+                          UintegerValue(8),
+                          MakeUintegerAccessor(&ProfilingScheduler::m_samplePeriod),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline ProfilingScheduler::ProfilingScheduler()
+    : m_samplePeriod(8),
+      m_rng(0x2545f4914f6cdd1dULL),
+      m_nEvents(0),
+      m_open(nullptr)
+{
+    s_instance = this;
+}
+
+inline ProfilingScheduler::~ProfilingScheduler()
+{
+    if (s_instance == this)
+    {
+        s_instance = nullptr;
+    }
+}
+
+inline void ProfilingScheduler::DoDispose()
+{
+    m_inner = nullptr;
+    if (s_instance == this)
+    {
+        s_instance = nullptr;
+    }
+    Scheduler::DoDispose();
+}
+
+inline void ProfilingScheduler::Install(uint32_t samplePeriod, std::string innerType)
+{
+    ObjectFactory factory;
+    factory.SetTypeId("ns3::ProfilingScheduler");
+    factory.Set("Scheduler", TypeIdValue(TypeId::LookupByName(innerType)));
+    factory.Set("SamplePeriod", UintegerValue(samplePeriod));
+    Simulator::SetScheduler(factory);
+}
+
+// Events already queued move across, so the inner type can change at any time
+inline void ProfilingScheduler::SetInnerType(TypeId tid)
+{
+    ObjectFactory factory;
+    factory.SetTypeId(tid);
+    Ptr<Scheduler> inner = factory.Create<Scheduler>();
+    while (m_inner && !m_inner->IsEmpty())
+    {
+        inner->Insert(m_inner->RemoveNext());
+    }
+    m_inner = inner;
+    m_innerType = tid;
+}
+
+inline void ProfilingScheduler::Insert(const Event& ev)
+{
+    m_inner->Insert(ev);
+}
+
+inline bool ProfilingScheduler::IsEmpty() const
+{
+    return m_inner->IsEmpty();
+}
+
+inline Scheduler::Event ProfilingScheduler::PeekNext() const
+{
+    return m_inner->PeekNext();
+}
+
+inline void ProfilingScheduler::Remove(const Event& ev)
+{
+    m_inner->Remove(ev);
+}
+
+// The simulator dequeues an event right before running it, so the time
+// between two dequeues is the cost of the first event
+inline Scheduler::Event ProfilingScheduler::RemoveNext()
+{
+    Event ev = m_inner->RemoveNext();
+    if (m_open)
+    {
+        auto now = std::chrono::steady_clock::now();
+        m_open->sampledNs +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_openSince).count();
+        m_open->samples++;
+        m_open = nullptr;
+    }
+
+    Stats& s = m_stats[Key{&typeid(*ev.impl), ev.key.m_context}];
+    s.events++;
+    m_nEvents++;
+    if (ev.impl->IsCancelled())
+    {
+        s.cancelled++;
+    }
+
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    if (m_rng % m_samplePeriod == 0)
+    {
+        m_open = &s;
+        m_openSince = std::chrono::steady_clock::now();
+    }
+    return ev;
+}
+
+// MakeEvent wraps every callback in a local class of a function template;
+// its first template argument (member function signature, function or
+// lambda type) names the callback
+inline std::string ProfilingScheduler::Label(const std::type_info& type)
+{
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    std::string name = (status == 0 && demangled) ? demangled : type.name();
+    std::free(demangled);
+
+    std::size_t start = name.find("MakeEvent<");
+    if (start != std::string::npos)
+    {
+        start += 10;
+        int depth = 0;
+        std::size_t end = start;
+        for (; end < name.size(); end++)
+        {
+            char c = name[end];
+            if (c == '<' || c == '(')
+            {
+                depth++;
+            }
+            else if ((c == '>' || c == ')') && depth > 0)
+            {
+                depth--;
+            }
+            else if ((c == ',' || c == '>') && depth == 0)
+            {
+                break;
+            }
+        }
+        name = name.substr(start, end - start);
+    }
+    for (std::size_t at = name.find("ns3::"); at != std::string::npos; at = name.find("ns3::"))
+    {
+        name.erase(at, 5);
+    }
+    return name;
+}
+
+inline std::string ProfilingScheduler::ContextName(uint32_t context)
+{
+    return context == 0xffffffff ? "no context" : "node " + std::to_string(context);
+}
+
+inline void ProfilingScheduler::PrintReport(std::ostream& os, uint32_t topN) const
+{
+    std::map<std::string, Stats> byCallback;
+    double totalMs = 0;
+    for (const auto& kv : m_stats)
+    {
+        Stats& s = byCallback[Label(*kv.first.type)];
+        s.events += kv.second.events;
+        s.cancelled += kv.second.cancelled;
+        s.samples += kv.second.samples;
+        s.sampledNs += kv.second.sampledNs;
+        totalMs += kv.second.sampledNs * 1e-6 * m_samplePeriod;
+    }
+    std::vector<std::pair<std::string, Stats>> rows(byCallback.begin(), byCallback.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.second.sampledNs > b.second.sampledNs ||
+               (a.second.sampledNs == b.second.sampledNs && a.second.events > b.second.events);
+    });
+
+    os << "\n=== Event profile: " << m_nEvents << " events, " << rows.size()
+       << " callbacks, ~" << std::fixed << std::setprecision(1) << totalMs
+       << " ms wall (1 in " << m_samplePeriod << " timed) ===\n";
+    os << "  share    events  cancelled   est ms  ns/event  callback\n";
+    for (std::size_t i = 0; i < rows.size() && i < topN; i++)
+    {
+        const Stats& s = rows[i].second;
+        double ms = s.sampledNs * 1e-6 * m_samplePeriod;
+        os << std::setw(6) << std::setprecision(1) << (totalMs > 0 ? 100.0 * ms / totalMs : 0.0) << "%"
+           << std::setw(10) << s.events << std::setw(11) << s.cancelled << std::setw(9)
+           << std::setprecision(1) << ms << std::setw(10) << std::setprecision(0)
+           << (s.samples ? double(s.sampledNs) / s.samples : 0.0) << "  " << rows[i].first << "\n";
+    }
+    if (rows.size() > topN)
+    {
+        os << "  (" << rows.size() - topN << " more callbacks in the folded output)\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+inline bool ProfilingScheduler::WriteFolded(std::string filename) const
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cerr << "ProfilingScheduler: cannot write " << filename << "\n";
+        return false;
+    }
+    std::map<std::string, uint64_t> folded;
+    for (const auto& kv : m_stats)
+    {
+        std::string frame = Label(*kv.first.type);
+        std::replace(frame.begin(), frame.end(), ';', ',');
+        folded[frame + ";" + ContextName(kv.first.context)] += kv.second.sampledNs * m_samplePeriod;
+    }
+    for (const auto& kv : folded)
+    {
+        if (kv.second > 0)
+        {
+            out << kv.first << " " << kv.second << "\n";
+        }
+    }
+    return bool(out);
+}
+
+} // namespace ns3
+
+#endif /* PROFILING_SCHEDULER_H */
@@ -0,0 +1,369 @@
+/*
+ * Real-time emulation with file-descriptor endpoints
+ * Runs a scenario under RealtimeSimulatorImpl and attaches FdNetDevice
+ * endpoints to its nodes, so real software on the same machine can send
+ * traffic through the simulated WAN. An endpoint spec is one of
+ *   tap:<name>          a tap interface created through ns-3's tap-creator
+ *                       (needs root or the suid helper); the host side gets
+ *                       the .2 address of the endpoint subnet
+ *   exec:<command>      a child process given one end of a SOCK_DGRAM
+ *                       socketpair carrying Ethernet (DIX) frames, one per
+ *                       datagram; {fd}, {addr}, {gw} and {mask} in the
+ *                       command are replaced by the descriptor, the
+ *                       process's address, the ns-3 side's address and the
+ *                       prefix length
+ * The ns-3 side of every endpoint gets the .1 address and is announced by
+ * global routing like any other subnet. Hosts must route the scenario's
+ * subnets via that address; to keep two tap endpoints from being short-cut
+ * by the host kernel, put each in its own network namespace. Frames from
+ * outside carry no socket priority tag, so a PrioQueueDisc maps them with
+ * priomap[0].
+ *
+ * A lag monitor compares sim time with wall time at a fixed interval and
+ * counts endpoint frames, so the report shows at which frame rate the
+ * simulator stops keeping up.
+ *
+ * Usage (Enable before anything touches the Simulator, including
+ * SelectScheduler):
+ *   RealtimeEmulation::Enable(MilliSeconds(hardLimitMs));   // 0 = best effort
+ *   ...stack installed, before PopulateRoutingTables...
+ *   RealtimeEmulation rt;
+ *   rt.AddEndpoint(router, "tap:wan0", "10.99.1.0", "255.255.255.0");
+ *   rt.AddEndpoint(server, "exec:./peer --fd {fd} --ip {addr}", "10.99.2.0", "255.255.255.0");
+ *   rt.EnableLagMonitor(MilliSeconds(100), Seconds(simTime));
+ *   ...
+ *   rt.PrintReport(std::cout);
+ */
+
+#ifndef REALTIME_EMULATION_H
+#define REALTIME_EMULATION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/fd-net-device-module.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+class RealtimeEmulation
+{
+public:
+    // Select RealtimeSimulatorImpl and enable checksums (real stacks drop
+    // packets without them). hardLimit > 0 aborts the run once the
+    // simulator falls further behind wall time than that.
+    static void Enable(Time hardLimit = Time(0));
+
+    RealtimeEmulation();
+    ~RealtimeEmulation();
+
+    // Attach a tap: or exec: endpoint to node in its own subnet; false if
+    // the spec is malformed or the endpoint cannot be created
+    bool AddEndpoint(Ptr<Node> node, const std::string& spec, Ipv4Address network, Ipv4Mask mask);
+
+    // Sample sim time against wall time every interval
+    void EnableLagMonitor(Time interval, Time stop);
+    // Lag above which a sample counts as falling behind (default 1 ms)
+    void SetLagThreshold(Time threshold) { m_threshold = threshold; }
+
+    // Terminate exec: endpoints; also done on destruction
+    void StopProcesses();
+
+    void PrintReport(std::ostream& os) const;
+
+private:
+    struct Endpoint
+    {
+        std::string spec;
+        uint32_t node;
+        Ipv4Address address;  // ns-3 side
+        pid_t pid;            // exec: child, or 0
+        uint64_t framesIn;    // from the real side into the simulation
+        uint64_t framesOut;
+    };
+
+    struct Sample
+    {
+        double simTime;
+        double lagMs;
+        uint64_t frames;      // endpoint frames since the previous sample
+    };
+
+    Ptr<FdNetDevice> CreateTap(Ptr<Node> node, const std::string& name, Ipv4Address host, Ipv4Mask mask);
+    Ptr<FdNetDevice> CreateProcess(Ptr<Node> node, std::string command, Endpoint& endpoint, Ipv4Mask mask);
+    void Probe(Time interval, Time stop);
+
+    static void CountFrame(uint64_t* counter, Ptr<const Packet> packet) { (*counter)++; }
+
+    // Heap-allocated so the trace sinks can keep pointers to the counters
+    std::vector<Endpoint*> m_endpoints;
+
+    std::vector<Sample> m_samples;
+    Time m_threshold;
+    Time m_interval;
+    bool m_started;
+    std::chrono::steady_clock::time_point m_wallStart;
+    Time m_simStart;
+    uint64_t m_lastFrames;
+};
+
+inline void RealtimeEmulation::Enable(Time hardLimit)
+{
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
+    if (hardLimit.IsStrictlyPositive())
+    {
+        Config::SetDefault("ns3::RealtimeSimulatorImpl::SynchronizationMode", StringValue("HardLimit"));
+        Config::SetDefault("ns3::RealtimeSimulatorImpl::HardLimit", TimeValue(hardLimit));
+    }
+}
+
+inline RealtimeEmulation::RealtimeEmulation()
+    : m_threshold(MilliSeconds(1)),
+      m_started(false),
+      m_lastFrames(0)
+{
+}
+
+inline RealtimeEmulation::~RealtimeEmulation()
+{
+    StopProcesses();
+    for (Endpoint* endpoint : m_endpoints)
+    {
+        delete endpoint;
+    }
+}
+
+inline bool RealtimeEmulation::AddEndpoint(Ptr<Node> node,
+                                           const std::string& spec,
+                                           Ipv4Address network,
+                                           Ipv4Mask mask)
+{
+    std::size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string arg = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if ((kind != "tap" && kind != "exec") || arg.empty())
+    {
+        std::cerr << "RealtimeEmulation: endpoint '" << spec << "' is not tap:<name> or exec:<command>\n";
+        return false;
+    }
+
+    Endpoint* endpoint = new Endpoint{spec, node->GetId(), Ipv4Address(network.Get() + 1), 0, 0, 0};
+    Ptr<FdNetDevice> device = kind == "tap"
+                                  ? CreateTap(node, arg, Ipv4Address(network.Get() + 2), mask)
+                                  : CreateProcess(node, arg, *endpoint, mask);
+    if (!device)
+    {
+        delete endpoint;
+        return false;
+    }
+    m_endpoints.push_back(endpoint);
+
+    Ipv4AddressHelper address;
+    address.SetBase(network, mask);
+    address.Assign(NetDeviceContainer(device));
+
+    device->TraceConnectWithoutContext("MacRx",
+                                       MakeBoundCallback(&RealtimeEmulation::CountFrame,
+                                                         &endpoint->framesIn));
+    device->TraceConnectWithoutContext("MacTx",
+                                       MakeBoundCallback(&RealtimeEmulation::CountFrame,
+                                                         &endpoint->framesOut));
+    return true;
+}
+
+inline Ptr<FdNetDevice> RealtimeEmulation::CreateTap(Ptr<Node> node,
+                                                     const std::string& name,
+                                                     Ipv4Address host,
+                                                     Ipv4Mask mask)
+{
+    TapFdNetDeviceHelper tap;
+    tap.SetDeviceName(name);
+    tap.SetModePi(false);
+    tap.SetTapIpv4Address(host);
+    tap.SetTapIpv4Mask(mask);
+    NetDeviceContainer devices = tap.Install(node);
+    return DynamicCast<FdNetDevice>(devices.Get(0));
+}
+
+// The child keeps fds[1] across exec; the simulation reads and writes fds[0]
+inline Ptr<FdNetDevice> RealtimeEmulation::CreateProcess(Ptr<Node> node,
+                                                         std::string command,
+                                                         Endpoint& endpoint,
+                                                         Ipv4Mask mask)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0)
+    {
+        std::cerr << "RealtimeEmulation: socketpair failed: " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    std::ostringstream addr;
+    std::ostringstream gw;
+    addr << Ipv4Address(endpoint.address.Get() + 1);
+    gw << endpoint.address;
+    const std::pair<std::string, std::string> fields[] = {{"{fd}", std::to_string(fds[1])},
+                                                          {"{addr}", addr.str()},
+                                                          {"{gw}", gw.str()},
+                                                          {"{mask}", std::to_string(mask.GetPrefixLength())}};
+    for (const auto& field : fields)
+    {
+        for (std::size_t at = command.find(field.first); at != std::string::npos;
+             at = command.find(field.first, at + field.second.size()))
+        {
+            command.replace(at, field.first.size(), field.second);
+        }
+    }
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::cerr << "RealtimeEmulation: fork failed: " << std::strerror(errno) << "\n";
+        close(fds[0]);
+        close(fds[1]);
+        return nullptr;
+    }
+    if (pid == 0)
+    {
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(fds[1]);
+    endpoint.pid = pid;
+
+    FdNetDeviceHelper helper;
+    helper.SetAttribute("EncapsulationMode", StringValue("Dix"));
+    Ptr<FdNetDevice> device = DynamicCast<FdNetDevice>(helper.Install(node).Get(0));
+    device->SetFileDescriptor(fds[0]);
+    return device;
+}
+
+inline void RealtimeEmulation::StopProcesses()
+{
+    for (Endpoint* endpoint : m_endpoints)
+    {
+        if (endpoint->pid > 0)
+        {
+            kill(endpoint->pid, SIGTERM);
+            waitpid(endpoint->pid, nullptr, 0);
+            endpoint->pid = 0;
+        }
+    }
+}
+
+inline void RealtimeEmulation::EnableLagMonitor(Time interval, Time stop)
+{
+    m_interval = interval;
+    Simulator::ScheduleNow(&RealtimeEmulation::Probe, this, interval, stop);
+}
+
+// The first probe pins wall time to sim time; lag is how far wall time
+// has run ahead of sim time since then
+inline void RealtimeEmulation::Probe(Time interval, Time stop)
+{
+    auto now = std::chrono::steady_clock::now();
+    uint64_t frames = 0;
+    for (const Endpoint* endpoint : m_endpoints)
+    {
+        frames += endpoint->framesIn + endpoint->framesOut;
+    }
+    if (!m_started)
+    {
+        m_started = true;
+        m_wallStart = now;
+        m_simStart = Simulator::Now();
+    }
+    else
+    {
+        double wall = std::chrono::duration<double>(now - m_wallStart).count();
+        double sim = (Simulator::Now() - m_simStart).GetSeconds();
+        m_samples.push_back({Simulator::Now().GetSeconds(), (wall - sim) * 1e3, frames - m_lastFrames});
+    }
+    m_lastFrames = frames;
+
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &RealtimeEmulation::Probe, this, interval, stop);
+    }
+}
+
+inline void RealtimeEmulation::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Real-time Emulation ===\n";
+    for (const Endpoint* endpoint : m_endpoints)
+    {
+        os << "  node " << endpoint->node << " " << endpoint->address << "  " << endpoint->spec
+           << ": " << endpoint->framesIn << " frames in, " << endpoint->framesOut << " out\n";
+    }
+    if (m_samples.empty())
+    {
+        os << "No lag samples\n";
+        return;
+    }
+
+    std::vector<double> lags;
+    double sum = 0;
+    double peakRate = 0;
+    double peakRateLag = 0;
+    double firstBehind = -1;
+    uint32_t behind = 0;
+    for (const Sample& s : m_samples)
+    {
+        lags.push_back(s.lagMs);
+        sum += s.lagMs;
+        double rate = s.frames / m_interval.GetSeconds();
+        if (rate > peakRate)
+        {
+            peakRate = rate;
+            peakRateLag = s.lagMs;
+        }
+        if (s.lagMs > m_threshold.GetSeconds() * 1e3)
+        {
+            behind++;
+            if (firstBehind < 0)
+            {
+                firstBehind = s.simTime;
+            }
+        }
+    }
+    std::sort(lags.begin(), lags.end());
+    double p99 = lags[std::min<std::size_t>(lags.size() - 1, lags.size() * 99 / 100)];
+
+    os << std::fixed << std::setprecision(3);
+    os << "Lag behind wall clock over " << m_samples.size() << " samples: mean " << sum / lags.size()
+       << " ms, p99 " << p99 << " ms, max " << lags.back() << " ms\n";
+    os << "Peak endpoint rate " << std::setprecision(0) << peakRate << " frames/s (lag "
+       << std::setprecision(3) << peakRateLag << " ms)\n";
+    if (behind == 0)
+    {
+        os << "Kept up with wall clock: no sample more than " << m_threshold.GetSeconds() * 1e3
+           << " ms behind\n";
+    }
+    else
+    {
+        os << "FELL BEHIND wall clock in " << behind << " of " << m_samples.size()
+           << " samples (threshold " << m_threshold.GetSeconds() * 1e3 << " ms), first at t="
+           << firstBehind << "s\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+}
+
+} // namespace ns3
+
+#endif /* REALTIME_EMULATION_H */
@@ -0,0 +1,398 @@
+/*
+ * Event-driven route change log
+ * Replaces AnimationInterface::EnableIpv4RouteTracking, which polls and
+ * serializes every routing table on a fixed period. RouteChangeLog instead
+ * reacts to the events that change routes:
+ *   - interface up/down and address changes, observed by a RouteChangeWatcher
+ *     added at the lowest priority of each node's Ipv4ListRouting
+ *   - the Ipv4FibRouting RouteChange trace
+ *   - global route recomputation through RecomputeGlobalRoutes()
+ *   - Trigger(node) after routes are edited by hand
+ * Affected nodes are diffed once per instant at the exact event time and the
+ * changes are appended to a RoutingSnapshot log (routing-snapshot.h), so
+ * routing-snapshot-replay can rebuild any table at any time. Optionally a
+ * per-node "Route changes" counter is mirrored into NetAnim.
+ *
+ * Usage:
+ *   RouteChangeLog routeLog("routes.rlog");
+ *   routeLog.InstallAll();                  // after the stack is installed
+ *   routeLog.EnableAnimation(&anim);
+ *   routeLog.PublishMetrics(metrics);       // wan_route_changes{node}
+ *   Simulator::Schedule(t, &RouteChangeLog::RecomputeGlobalRoutes, &routeLog);
+ *   ...
+ *   routeLog.PrintSummary(std::cout);
+ */
+
+#ifndef ROUTE_CHANGE_LOG_H
+#define ROUTE_CHANGE_LOG_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/netanim-module.h"
+
+#include "metrics-registry.h"
+#include "routing-snapshot.h"
+#include "wan-fib-routing.h"
+
+#include <limits>
+#include <set>
+
+namespace ns3
+{
+
+// ============================================================================
+// INTERFACE EVENT WATCHER
+// ============================================================================
+
+// Never routes anything; it only forwards the interface notifications that
+// Ipv4ListRouting hands to every protocol. At the lowest priority it is
+// notified after the real protocols have updated their tables.
+class RouteChangeWatcher : public Ipv4RoutingProtocol
+{
+public:
+    static TypeId GetTypeId();
+
+    void SetNotifyCallback(Callback<void, uint32_t> cb) { m_notify = cb; }
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override { Notify(); }
+    void NotifyInterfaceDown(uint32_t interface) override { Notify(); }
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override { Notify(); }
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override { Notify(); }
+    void SetIpv4(Ptr<Ipv4> ipv4) override { m_ipv4 = ipv4; }
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override
+    {
+    }
+
+protected:
+    void DoDispose() override;
+
+private:
+    void Notify();
+
+    Ptr<Ipv4> m_ipv4;
+    Callback<void, uint32_t> m_notify;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RouteChangeWatcher);
+
+inline TypeId RouteChangeWatcher::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::RouteChangeWatcher")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<RouteChangeWatcher>();
+    return tid;
+}
+
+inline Ptr<Ipv4Route> RouteChangeWatcher::RouteOutput(Ptr<Packet> p,
+                                                      const Ipv4Header& header,
+                                                      Ptr<NetDevice> oif,
+                                                      Socket::SocketErrno& sockerr)
+{
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    return 0;
+}
+
+inline bool RouteChangeWatcher::RouteInput(Ptr<const Packet> p,
+                                           const Ipv4Header& header,
+                                           Ptr<const NetDevice> idev,
+                                           const UnicastForwardCallback& ucb,
+                                           const MulticastForwardCallback& mcb,
+                                           const LocalDeliverCallback& lcb,
+                                           const ErrorCallback& ecb)
+{
+    return false;
+}
+
+inline void RouteChangeWatcher::DoDispose()
+{
+    m_ipv4 = 0;
+    m_notify = MakeNullCallback<void, uint32_t>();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline void RouteChangeWatcher::Notify()
+{
+    if (m_ipv4 && !m_notify.IsNull())
+    {
+        m_notify(m_ipv4->GetObject<Node>()->GetId());
+    }
+}
+
+// ============================================================================
+// ROUTE CHANGE LOG
+// ============================================================================
+
+class RouteChangeLog
+{
+public:
+    RouteChangeLog(std::string filename);
+
+    // Attach watchers; the full baseline is logged when the simulation starts
+    void Install(NodeContainer nodes);
+    void InstallAll();
+
+    // Diff a node (or all nodes) at the current instant
+    void Trigger(Ptr<Node> node);
+    void TriggerAll();
+
+    // Ipv4GlobalRoutingHelper::RecomputeRoutingTables, then log the result
+    void RecomputeGlobalRoutes();
+
+    // Mirror per-node change counts into a NetAnim node counter
+    void EnableAnimation(AnimationInterface* anim);
+    // Export per-node change counts on every registry export
+    void PublishMetrics(MetricsRegistry& registry);
+
+    void PrintSummary(std::ostream& os) const;
+
+private:
+    struct NodeStats
+    {
+        uint64_t changes;
+        Time first;
+        Time last;
+    };
+
+    void WatcherNotify(uint32_t nodeId);
+    void FibRouteChange(std::string context, const Ipv4FibRoute& route, bool installed);
+    void Schedule(uint32_t nodeId);
+    void Flush();
+    void Baseline();
+    void RecordChange(const RoutingLogRecord& record);
+
+    RoutingSnapshot m_snapshot;
+    std::set<uint32_t> m_pending;       // nodes to diff at the end of this instant
+    bool m_flushScheduled;
+    bool m_baselineScheduled;
+    bool m_inBaseline;                  // initial full snapshot is not a change
+    std::set<uint32_t> m_globalNodes;   // nodes running Ipv4GlobalRouting
+
+    std::map<uint32_t, NodeStats> m_stats;
+    std::vector<RoutingLogRecord> m_timeline; // first changes, kept for the summary
+    std::vector<Time> m_timelineTimes;
+    uint64_t m_nEvents;
+
+    AnimationInterface* m_anim;
+    uint32_t m_animCounter;
+
+    static const uint32_t MAX_TIMELINE = 50;
+};
+
+inline RouteChangeLog::RouteChangeLog(std::string filename)
+    : m_snapshot(filename),
+      m_flushScheduled(false),
+      m_baselineScheduled(false),
+      m_inBaseline(false),
+      m_nEvents(0),
+      m_anim(nullptr),
+      m_animCounter(0)
+{
+    m_snapshot.SetChangeCallback(MakeCallback(&RouteChangeLog::RecordChange, this));
+}
+
+inline void RouteChangeLog::InstallAll()
+{
+    Install(NodeContainer::GetGlobal());
+}
+
+inline void RouteChangeLog::Install(NodeContainer nodes)
+{
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = ipv4 ? DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol())
+                                         : Ptr<Ipv4ListRouting>();
+        if (!list)
+        {
+            std::cerr << "RouteChangeLog: node " << node->GetId()
+                      << " has no Ipv4ListRouting; only Trigger() will log it\n";
+            continue;
+        }
+
+        std::string context = std::to_string(node->GetId());
+        for (uint32_t p = 0; p < list->GetNRoutingProtocols(); p++)
+        {
+            int16_t priority;
+            Ptr<Ipv4RoutingProtocol> protocol = list->GetRoutingProtocol(p, priority);
+            if (DynamicCast<Ipv4GlobalRouting>(protocol))
+            {
+                m_globalNodes.insert(node->GetId());
+            }
+            else if (Ptr<Ipv4FibRouting> fib = DynamicCast<Ipv4FibRouting>(protocol))
+            {
+                fib->TraceConnect("RouteChange",
+                                  context,
+                                  MakeCallback(&RouteChangeLog::FibRouteChange, this));
+            }
+        }
+
+        Ptr<RouteChangeWatcher> watcher = CreateObject<RouteChangeWatcher>();
+        watcher->SetNotifyCallback(MakeCallback(&RouteChangeLog::WatcherNotify, this));
+        list->AddRoutingProtocol(watcher, std::numeric_limits<int16_t>::min());
+    }
+
+    if (!m_baselineScheduled)
+    {
+        m_baselineScheduled = true;
+        Simulator::ScheduleNow(&RouteChangeLog::Baseline, this);
+    }
+}
+
+inline void RouteChangeLog::Baseline()
+{
+    m_inBaseline = true;
+    m_snapshot.Snapshot();
+    m_inBaseline = false;
+}
+
+inline void RouteChangeLog::WatcherNotify(uint32_t nodeId)
+{
+    m_nEvents++;
+    // Global routing may recompute every node's routes on an interface event
+    if (m_globalNodes.count(nodeId))
+    {
+        for (uint32_t id : m_globalNodes)
+        {
+            Schedule(id);
+        }
+    }
+    Schedule(nodeId);
+}
+
+inline void RouteChangeLog::FibRouteChange(std::string context,
+                                           const Ipv4FibRoute& route,
+                                           bool installed)
+{
+    m_nEvents++;
+    Schedule(std::stoul(context));
+}
+
+inline void RouteChangeLog::Trigger(Ptr<Node> node)
+{
+    m_nEvents++;
+    Schedule(node->GetId());
+}
+
+inline void RouteChangeLog::TriggerAll()
+{
+    m_nEvents++;
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Schedule(n);
+    }
+}
+
+inline void RouteChangeLog::RecomputeGlobalRoutes()
+{
+    Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
+    TriggerAll();
+}
+
+// Several events in the same instant (both ends of a link going down, a
+// burst of FIB updates) collapse into one diff at that same timestamp
+inline void RouteChangeLog::Schedule(uint32_t nodeId)
+{
+    m_pending.insert(nodeId);
+    if (!m_flushScheduled)
+    {
+        m_flushScheduled = true;
+        Simulator::ScheduleNow(&RouteChangeLog::Flush, this);
+    }
+}
+
+inline void RouteChangeLog::Flush()
+{
+    m_flushScheduled = false;
+    std::vector<uint32_t> nodes(m_pending.begin(), m_pending.end());
+    m_pending.clear();
+    m_snapshot.SnapshotNodes(nodes);
+}
+
+inline void RouteChangeLog::RecordChange(const RoutingLogRecord& record)
+{
+    if (m_inBaseline)
+    {
+        return;
+    }
+    Time now = Simulator::Now();
+    auto result = m_stats.emplace(record.node, NodeStats{0, now, now});
+    NodeStats& stats = result.first->second;
+    stats.changes++;
+    stats.last = now;
+
+    if (m_timeline.size() < MAX_TIMELINE)
+    {
+        m_timeline.push_back(record);
+        m_timelineTimes.push_back(now);
+    }
+    if (m_anim)
+    {
+        m_anim->UpdateNodeCounter(m_animCounter, record.node, stats.changes);
+    }
+}
+
+inline void RouteChangeLog::EnableAnimation(AnimationInterface* anim)
+{
+    m_anim = anim;
+    m_animCounter = anim->AddNodeCounter("Route changes", AnimationInterface::UINT32_COUNTER);
+}
+
+inline void RouteChangeLog::PublishMetrics(MetricsRegistry& registry)
+{
+    registry.AddCollector([this](MetricsRegistry& r) {
+        r.GetCounter("wan_routing_events", "Events that may change routes").Set(m_nEvents);
+        for (const auto& kv : m_stats)
+        {
+            r.GetCounter("wan_route_changes",
+                         "Routing table entries added, removed or changed",
+                         {{"node", std::to_string(kv.first)}})
+                .Set(kv.second.changes);
+        }
+    });
+}
+
+inline void RouteChangeLog::PrintSummary(std::ostream& os) const
+{
+    os << "\n=== Route Change Log ===\n";
+    os << "Routing events: " << m_nEvents << ", diffs logged: " << m_snapshot.GetNSnapshots()
+       << ", records: " << m_snapshot.GetNRecords() << "\n";
+
+    for (const auto& kv : m_stats)
+    {
+        os << "  Node " << kv.first << ": " << kv.second.changes << " changes, first at "
+           << kv.second.first.GetSeconds() << "s, last at " << kv.second.last.GetSeconds()
+           << "s\n";
+    }
+
+    os << "Timeline" << (m_timeline.size() == MAX_TIMELINE ? " (first changes only)" : "")
+       << ":\n";
+    for (uint32_t i = 0; i < m_timeline.size(); i++)
+    {
+        const RoutingLogRecord& r = m_timeline[i];
+        const char* op = r.type == RoutingLogRecord::ADD   ? "+"
+                         : r.type == RoutingLogRecord::DEL ? "-"
+                                                           : "~";
+        os << "  t=" << m_timelineTimes[i].As(Time::MS) << " node " << r.node << " " << op
+           << Ipv4Address(r.dest) << "/" << uint32_t(r.prefixLength) << " via "
+           << Ipv4Address(r.gateway) << " if " << r.interface << " metric " << r.metric << " ("
+           << RoutingLogProtocolName(r.protocol) << ")\n";
+    }
+}
+
+} // namespace ns3
+
+#endif // ROUTE_CHANGE_LOG_H
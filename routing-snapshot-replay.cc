@@ -0,0 +1,64 @@
+/*
+ * Routing snapshot replay
+ * Rebuilds routing tables from a RoutingSnapshot log (routing-snapshot.h).
+ *
+ * Examples:
+ *   routing-snapshot-replay --log=multi-hop-routes.rlog --list
+ *   routing-snapshot-replay --log=multi-hop-routes.rlog --time=16 --node=2
+ *   routing-snapshot-replay --log=multi-hop-routes.rlog --time=16   (all nodes)
+ */
+
+#include "ns3/core-module.h"
+
+#include "routing-snapshot.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("RoutingSnapshotReplay");
+
+int main(int argc, char *argv[])
+{
+    std::string logFile = "routes.rlog";
+    double time = 1e9;
+    int32_t nodeId = -1;
+    bool list = false;
+
+    CommandLine cmd;
+    cmd.AddValue("log", "Routing snapshot log to read", logFile);
+    cmd.AddValue("time", "Rebuild tables as of this simulation time (seconds)", time);
+    cmd.AddValue("node", "Node to print (-1 = all nodes)", nodeId);
+    cmd.AddValue("list", "List snapshot times instead of printing tables", list);
+    cmd.Parse(argc, argv);
+
+    RoutingLogReader reader;
+    if (!reader.Open(logFile))
+    {
+        return 1;
+    }
+
+    if (list)
+    {
+        std::vector<Time> times = reader.GetSnapshotTimes();
+        std::cout << times.size() << " snapshots in " << logFile << "\n";
+        for (const Time& t : times)
+        {
+            std::cout << "  t=" << t.GetSeconds() << "s\n";
+        }
+        return 0;
+    }
+
+    reader.ReplayTo(Seconds(time));
+    std::cout << "Routing tables as of t=" << reader.GetTime().GetSeconds()
+              << "s (last snapshot at or before " << time << "s)\n";
+
+    for (const auto& kv : reader.GetTables())
+    {
+        if (nodeId >= 0 && kv.first != static_cast<uint32_t>(nodeId))
+        {
+            continue;
+        }
+        std::cout << "\nNode: " << kv.first << "\n";
+        PrintRoutingLogTable(std::cout, kv.second);
+    }
+    return 0;
+}
@@ -0,0 +1,508 @@
+/*
+ * Diff-based routing table snapshots
+ * RoutingSnapshot walks the static, global and FIB routing tables of every
+ * node and writes only the entries added, removed or changed since the
+ * previous snapshot to a compact binary log (fixed 24-byte records), instead
+ * of the full text dump of Ipv4RoutingHelper::PrintRoutingTableAllAt.
+ * RoutingLogReader replays such a log to rebuild any node's table at any
+ * time; routing-snapshot-replay is the command-line front end.
+ *
+ * Usage:
+ *   RoutingSnapshot snapshot("routes.rlog");
+ *   snapshot.SnapshotAt(Seconds(2.0));
+ *   snapshot.SnapshotEvery(Seconds(1.0), Seconds(0.5), Seconds(simTime));
+ *   ...
+ *   Simulator::Run();
+ *   snapshot.PrintSummary(std::cout);
+ */
+
+#ifndef ROUTING_SNAPSHOT_H
+#define ROUTING_SNAPSHOT_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include "wan-fib-routing.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// LOG FORMAT
+// ============================================================================
+
+// File layout: 8-byte magic "RTSNAP01", then a stream of records. A TIME
+// record opens every snapshot; the ADD/DEL/CHG records after it belong to
+// that instant. Records are written in host byte order.
+struct RoutingLogRecord
+{
+    enum Type : uint8_t
+    {
+        TIME = 0,
+        ADD = 1,
+        DEL = 2,
+        CHG = 3  // same destination, gateway and interface, new metric
+    };
+
+    enum Protocol : uint8_t
+    {
+        PROTO_OTHER = 0,
+        PROTO_STATIC = 1,
+        PROTO_GLOBAL = 2,
+        PROTO_FIB = 3
+    };
+
+    uint8_t type;
+    uint8_t protocol;
+    uint8_t prefixLength;
+    uint8_t reserved;
+    uint32_t node;
+    uint32_t dest;       // TIME: high 32 bits of the timestamp in ns
+    uint32_t gateway;    // TIME: low 32 bits of the timestamp in ns
+    uint32_t interface;
+    uint32_t metric;
+};
+
+static_assert(sizeof(RoutingLogRecord) == 24, "RoutingLogRecord must stay 24 bytes");
+
+static const char ROUTING_LOG_MAGIC[8] = {'R', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+
+// (protocol, destination, prefix length, gateway, interface) -> metric
+typedef std::tuple<uint8_t, uint32_t, uint8_t, uint32_t, uint32_t> RoutingLogKey;
+typedef std::map<RoutingLogKey, uint32_t> RoutingLogTable;
+
+inline const char* RoutingLogProtocolName(uint8_t protocol)
+{
+    switch (protocol)
+    {
+    case RoutingLogRecord::PROTO_STATIC:
+        return "static";
+    case RoutingLogRecord::PROTO_GLOBAL:
+        return "global";
+    case RoutingLogRecord::PROTO_FIB:
+        return "fib";
+    default:
+        return "other";
+    }
+}
+
+inline Ipv4Mask RoutingLogMask(uint8_t prefixLength)
+{
+    return Ipv4Mask(prefixLength == 0 ? 0 : 0xffffffffu << (32 - prefixLength));
+}
+
+// Prints a table in the column layout of Ipv4StaticRouting::PrintRoutingTable
+inline void PrintRoutingLogTable(std::ostream& os, const RoutingLogTable& table)
+{
+    os << "Destination     Gateway         Genmask         Metric Iface Proto\n";
+    for (const auto& kv : table)
+    {
+        std::ostringstream dest, gw, mask;
+        dest << Ipv4Address(std::get<1>(kv.first));
+        gw << Ipv4Address(std::get<3>(kv.first));
+        mask << RoutingLogMask(std::get<2>(kv.first));
+        os << std::setiosflags(std::ios::left) << std::setw(16) << dest.str() << std::setw(16)
+           << gw.str() << std::setw(16) << mask.str() << std::setw(7) << kv.second << std::setw(6)
+           << std::get<4>(kv.first) << RoutingLogProtocolName(std::get<0>(kv.first))
+           << std::resetiosflags(std::ios::left) << "\n";
+    }
+}
+
+// ============================================================================
+// SNAPSHOT WRITER
+// ============================================================================
+
+class RoutingSnapshot
+{
+public:
+    RoutingSnapshot(std::string filename);
+    ~RoutingSnapshot();
+
+    // Diff all nodes now / at an absolute time / periodically until stop
+    void Snapshot();
+    void SnapshotAt(Time when);
+    void SnapshotEvery(Time start, Time interval, Time stop);
+    // Diff only the given node ids; logs nothing if none of them changed.
+    // Returns the number of change records written.
+    uint32_t SnapshotNodes(const std::vector<uint32_t>& nodes);
+
+    // Called for every ADD/DEL/CHG record once it has been written
+    void SetChangeCallback(Callback<void, const RoutingLogRecord&> cb) { m_changeCallback = cb; }
+
+    void Close();
+    void PrintSummary(std::ostream& os) const;
+
+    uint64_t GetNSnapshots() const { return m_nSnapshots; }
+    uint64_t GetNRecords() const { return m_nRecords; }
+
+private:
+    void Collect(Ptr<Ipv4RoutingProtocol> protocol, RoutingLogTable& table) const;
+    uint32_t Diff(const std::vector<uint32_t>& nodes, bool full);
+    void Emit(uint8_t type, uint32_t node, const RoutingLogKey& key, uint32_t metric);
+    void PeriodicSnapshot(Time interval, Time stop);
+
+    std::string m_filename;
+    std::ofstream m_out;
+    std::vector<RoutingLogRecord> m_buffer;
+    std::map<uint32_t, RoutingLogTable> m_last;  // node id -> table at last snapshot
+    Callback<void, const RoutingLogRecord&> m_changeCallback;
+
+    uint64_t m_nSnapshots;
+    uint64_t m_nRecords;
+    uint64_t m_nAdd;
+    uint64_t m_nDel;
+    uint64_t m_nChg;
+    uint64_t m_maxEntries;
+};
+
+inline RoutingSnapshot::RoutingSnapshot(std::string filename)
+    : m_filename(filename),
+      m_out(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+      m_nSnapshots(0),
+      m_nRecords(0),
+      m_nAdd(0),
+      m_nDel(0),
+      m_nChg(0),
+      m_maxEntries(0)
+{
+    if (!m_out)
+    {
+        std::cerr << "RoutingSnapshot: cannot open " << filename << "\n";
+        return;
+    }
+    m_out.write(ROUTING_LOG_MAGIC, sizeof(ROUTING_LOG_MAGIC));
+}
+
+inline RoutingSnapshot::~RoutingSnapshot()
+{
+    Close();
+}
+
+inline void RoutingSnapshot::Close()
+{
+    if (m_out.is_open())
+    {
+        m_out.close();
+    }
+}
+
+inline void RoutingSnapshot::SnapshotAt(Time when)
+{
+    Simulator::Schedule(when - Simulator::Now(), &RoutingSnapshot::Snapshot, this);
+}
+
+inline void RoutingSnapshot::SnapshotEvery(Time start, Time interval, Time stop)
+{
+    Simulator::Schedule(start - Simulator::Now(), &RoutingSnapshot::PeriodicSnapshot, this,
+                        interval, stop);
+}
+
+inline void RoutingSnapshot::PeriodicSnapshot(Time interval, Time stop)
+{
+    Snapshot();
+    if (Simulator::Now() + interval <= stop)
+    {
+        Simulator::Schedule(interval, &RoutingSnapshot::PeriodicSnapshot, this, interval, stop);
+    }
+}
+
+inline void RoutingSnapshot::Collect(Ptr<Ipv4RoutingProtocol> protocol,
+                                     RoutingLogTable& table) const
+{
+    if (Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol))
+    {
+        for (uint32_t i = 0; i < list->GetNRoutingProtocols(); i++)
+        {
+            int16_t priority;
+            Collect(list->GetRoutingProtocol(i, priority), table);
+        }
+    }
+    else if (Ptr<Ipv4StaticRouting> routing = DynamicCast<Ipv4StaticRouting>(protocol))
+    {
+        for (uint32_t i = 0; i < routing->GetNRoutes(); i++)
+        {
+            Ipv4RoutingTableEntry e = routing->GetRoute(i);
+            table[RoutingLogKey(RoutingLogRecord::PROTO_STATIC,
+                                e.GetDestNetwork().Get(),
+                                e.GetDestNetworkMask().GetPrefixLength(),
+                                e.GetGateway().Get(),
+                                e.GetInterface())] = routing->GetMetric(i);
+        }
+    }
+    else if (Ptr<Ipv4GlobalRouting> routing = DynamicCast<Ipv4GlobalRouting>(protocol))
+    {
+        // Global routing entries carry no metric
+        for (uint32_t i = 0; i < routing->GetNRoutes(); i++)
+        {
+            Ipv4RoutingTableEntry* e = routing->GetRoute(i);
+            table[RoutingLogKey(RoutingLogRecord::PROTO_GLOBAL,
+                                e->GetDestNetwork().Get(),
+                                e->GetDestNetworkMask().GetPrefixLength(),
+                                e->GetGateway().Get(),
+                                e->GetInterface())] = 0;
+        }
+    }
+    else if (Ptr<Ipv4FibRouting> routing = DynamicCast<Ipv4FibRouting>(protocol))
+    {
+        for (uint32_t i = 0; i < routing->GetNRoutes(); i++)
+        {
+            Ipv4RoutingTableEntry e = routing->GetRoute(i);
+            table[RoutingLogKey(RoutingLogRecord::PROTO_FIB,
+                                e.GetDestNetwork().Get(),
+                                e.GetDestNetworkMask().GetPrefixLength(),
+                                e.GetGateway().Get(),
+                                e.GetInterface())] = routing->GetMetric(i);
+        }
+    }
+}
+
+inline void RoutingSnapshot::Emit(uint8_t type, uint32_t node, const RoutingLogKey& key,
+                                  uint32_t metric)
+{
+    RoutingLogRecord r;
+    r.type = type;
+    r.protocol = std::get<0>(key);
+    r.prefixLength = std::get<2>(key);
+    r.reserved = 0;
+    r.node = node;
+    r.dest = std::get<1>(key);
+    r.gateway = std::get<3>(key);
+    r.interface = std::get<4>(key);
+    r.metric = metric;
+    m_buffer.push_back(r);
+}
+
+inline void RoutingSnapshot::Snapshot()
+{
+    std::vector<uint32_t> nodes;
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        nodes.push_back(n);
+    }
+    Diff(nodes, true);
+}
+
+inline uint32_t RoutingSnapshot::SnapshotNodes(const std::vector<uint32_t>& nodes)
+{
+    return Diff(nodes, false);
+}
+
+inline uint32_t RoutingSnapshot::Diff(const std::vector<uint32_t>& nodes, bool full)
+{
+    if (!m_out.is_open())
+    {
+        return 0;
+    }
+
+    m_buffer.clear();
+    uint64_t now = static_cast<uint64_t>(Simulator::Now().GetNanoSeconds());
+    RoutingLogRecord stamp;
+    std::memset(&stamp, 0, sizeof(stamp));
+    stamp.type = RoutingLogRecord::TIME;
+    stamp.dest = static_cast<uint32_t>(now >> 32);
+    stamp.gateway = static_cast<uint32_t>(now);
+    m_buffer.push_back(stamp);
+
+    uint64_t entries = 0;
+    for (uint32_t id : nodes)
+    {
+        Ptr<Node> node = NodeList::GetNode(id);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        if (!ipv4 || !ipv4->GetRoutingProtocol())
+        {
+            continue;
+        }
+
+        RoutingLogTable current;
+        Collect(ipv4->GetRoutingProtocol(), current);
+        entries += current.size();
+
+        // Both tables are sorted by key, so one merge pass yields the diff
+        RoutingLogTable& last = m_last[id];
+        auto oldIt = last.begin();
+        auto newIt = current.begin();
+        while (oldIt != last.end() || newIt != current.end())
+        {
+            if (newIt == current.end() || (oldIt != last.end() && oldIt->first < newIt->first))
+            {
+                Emit(RoutingLogRecord::DEL, id, oldIt->first, oldIt->second);
+                m_nDel++;
+                ++oldIt;
+            }
+            else if (oldIt == last.end() || newIt->first < oldIt->first)
+            {
+                Emit(RoutingLogRecord::ADD, id, newIt->first, newIt->second);
+                m_nAdd++;
+                ++newIt;
+            }
+            else
+            {
+                if (oldIt->second != newIt->second)
+                {
+                    Emit(RoutingLogRecord::CHG, id, newIt->first, newIt->second);
+                    m_nChg++;
+                }
+                ++oldIt;
+                ++newIt;
+            }
+        }
+        last.swap(current);
+    }
+
+    uint32_t changes = m_buffer.size() - 1;
+    if (!full && changes == 0)
+    {
+        return 0;
+    }
+
+    m_out.write(reinterpret_cast<const char*>(m_buffer.data()),
+                m_buffer.size() * sizeof(RoutingLogRecord));
+    m_out.flush();
+    m_nSnapshots++;
+    m_nRecords += m_buffer.size();
+    if (full)
+    {
+        m_maxEntries = std::max(m_maxEntries, entries);
+    }
+    if (!m_changeCallback.IsNull())
+    {
+        for (uint32_t i = 1; i < m_buffer.size(); i++)
+        {
+            m_changeCallback(m_buffer[i]);
+        }
+    }
+    return changes;
+}
+
+inline void RoutingSnapshot::PrintSummary(std::ostream& os) const
+{
+    uint64_t bytes = sizeof(ROUTING_LOG_MAGIC) + m_nRecords * sizeof(RoutingLogRecord);
+    os << "\n=== Routing Snapshots (" << m_filename << ") ===\n";
+    os << "Snapshots: " << m_nSnapshots << "\n";
+    os << "Records: " << m_nRecords << " (add " << m_nAdd << ", del " << m_nDel << ", chg "
+       << m_nChg << ")\n";
+    os << "Log size: " << bytes << " bytes\n";
+    os << "Largest snapshot: " << m_maxEntries << " entries across all nodes\n";
+}
+
+// ============================================================================
+// LOG READER
+// ============================================================================
+
+// Applies a log record by record; tables always reflect the last snapshot
+// at or before the time passed to ReplayTo.
+class RoutingLogReader
+{
+public:
+    RoutingLogReader() : m_pending(false) {}
+
+    bool Open(std::string filename);
+
+    // Apply all snapshots taken at or before the given time
+    void ReplayTo(Time until);
+
+    Time GetTime() const { return m_time; }
+    const std::map<uint32_t, RoutingLogTable>& GetTables() const { return m_tables; }
+    // Timestamps of the snapshots not applied yet
+    std::vector<Time> GetSnapshotTimes();
+
+private:
+    bool Next(RoutingLogRecord& r);
+
+    std::ifstream m_in;
+    std::map<uint32_t, RoutingLogTable> m_tables;
+    Time m_time;
+    bool m_pending;              // m_next holds a TIME record not yet applied
+    RoutingLogRecord m_next;
+};
+
+inline bool RoutingLogReader::Open(std::string filename)
+{
+    m_in.open(filename, std::ios::in | std::ios::binary);
+    char magic[sizeof(ROUTING_LOG_MAGIC)];
+    if (!m_in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, ROUTING_LOG_MAGIC, sizeof(magic)) != 0)
+    {
+        std::cerr << "RoutingLogReader: " << filename << " is not a routing snapshot log\n";
+        return false;
+    }
+    m_tables.clear();
+    m_time = Seconds(0);
+    m_pending = false;
+    return true;
+}
+
+inline bool RoutingLogReader::Next(RoutingLogRecord& r)
+{
+    return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&r), sizeof(r)));
+}
+
+inline void RoutingLogReader::ReplayTo(Time until)
+{
+    RoutingLogRecord r;
+    while (m_pending || Next(r))
+    {
+        if (m_pending)
+        {
+            r = m_next;
+            m_pending = false;
+        }
+
+        if (r.type == RoutingLogRecord::TIME)
+        {
+            Time stamp = NanoSeconds((uint64_t(r.dest) << 32) | r.gateway);
+            if (stamp > until)
+            {
+                m_next = r;
+                m_pending = true;
+                return;
+            }
+            m_time = stamp;
+            continue;
+        }
+
+        RoutingLogKey key(r.protocol, r.dest, r.prefixLength, r.gateway, r.interface);
+        RoutingLogTable& table = m_tables[r.node];
+        if (r.type == RoutingLogRecord::DEL)
+        {
+            table.erase(key);
+        }
+        else
+        {
+            table[key] = r.metric;
+        }
+    }
+}
+
+inline std::vector<Time> RoutingLogReader::GetSnapshotTimes()
+{
+    std::vector<Time> times;
+    if (m_pending)
+    {
+        times.push_back(NanoSeconds((uint64_t(m_next.dest) << 32) | m_next.gateway));
+    }
+    std::streampos pos = m_in.tellg();
+    RoutingLogRecord r;
+    while (Next(r))
+    {
+        if (r.type == RoutingLogRecord::TIME)
+        {
+            times.push_back(NanoSeconds((uint64_t(r.dest) << 32) | r.gateway));
+        }
+    }
+    m_in.clear();
+    m_in.seekg(pos);
+    return times;
+}
+
+} // namespace ns3
+
+#endif // ROUTING_SNAPSHOT_H
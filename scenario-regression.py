@@ -0,0 +1,369 @@
+#!/usr/bin/env python3
+"""
+Golden-result and speed regression harness for the WAN exercises.
+
+Runs every scenario with a fixed RngRun and compares its key results
+with the values stored in a golden file:
+  - exercise2 QoS: per-flow rx/lost packets, loss and mean delay, plus the
+    VoIP/FTP summary
+  - exercise3 security: legitimate and attack packets, blocked packets
+  - the other exercises: per-flow rx/lost packets or controller compliance
+Wall-clock time (median of --repeat runs) and peak RSS of each run are
+compared against the stored baselines as well. Results must match within
+--tolerance; time and memory fail only when they grow by more than
+--wall-tolerance / --rss-tolerance, since getting faster is the point.
+
+The programs are run straight from the ns-3 build tree, not through
+./ns3 run, so the timing and peak RSS belong to the simulation itself.
+
+Usage (from anywhere, after ./ns3 build):
+  scenario-regression.py --ns3 ~/ns-3-dev --update     # record goldens
+  scenario-regression.py --ns3 ~/ns-3-dev              # check
+  scenario-regression.py --ns3 ~/ns-3-dev --only qos,security --no-perf
+  scenario-regression.py --ns3 ~/ns-3-dev --schedulers map,heap,calendar,ladder
+
+--schedulers runs every scenario once per event scheduler (the exercises'
+--scheduler option) and prints wall time and peak RSS side by side. All
+schedulers must give identical results, since ties are broken by event
+uid in all of them.
+
+--update records only scenarios that ran cleanly, produced their results
+and repeated them exactly; nothing is written for a failed run. Speed and
+memory baselines are only meaningful on the machine that recorded them,
+so the host name is stored and a mismatch skips those checks.
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import socket
+import statistics
+import subprocess
+import sys
+import time
+
+RNG_RUN = 1
+
+FLOW_HEADER = re.compile(r"^Flow (\d+)")
+FLOW_FIELDS = {
+    "Rx Packets": "rx_packets",
+    "Lost Packets": "lost_packets",
+    "Packet Loss": "loss_pct",
+    "Avg Delay": "mean_delay_ms",
+}
+NUMBER = r"(-?[0-9.]+(?:e[-+]?[0-9]+)?)"
+
+
+def parse_flows(output):
+    """Per-flow counters from the FlowMonitor blocks every exercise prints"""
+    results = {}
+    flow = None
+    for line in output.splitlines():
+        m = FLOW_HEADER.match(line)
+        if m:
+            flow = m.group(1)
+            continue
+        if not line.strip():
+            flow = None
+            continue
+        if flow is None:
+            continue
+        for label, key in FLOW_FIELDS.items():
+            m = re.match(r"^\s+" + label + r": " + NUMBER, line)
+            if m:
+                results["flow%s.%s" % (flow, key)] = float(m.group(1))
+    return results
+
+
+def parse_sections(patterns):
+    """Results read from labelled summary lines inside named sections.
+    patterns: list of (section heading, line label, result key)"""
+    def parse(output):
+        results = {}
+        section = None
+        for line in output.splitlines():
+            stripped = line.strip()
+            if stripped and not line.startswith(" "):
+                section = stripped
+            for heading, label, key in patterns:
+                if section and section.startswith(heading):
+                    m = re.match(r"^\s+" + re.escape(label) + r": " + NUMBER, line)
+                    if m:
+                        results[key] = float(m.group(1))
+        return results
+    return parse
+
+
+def parse_compliance(output):
+    """exercise5: SLA compliance per traffic class and controller mode"""
+    results = {}
+    cls = None
+    for line in output.splitlines():
+        m = re.match(r"^(\S.*?) \(delay <= ", line)
+        if m:
+            cls = m.group(1).replace(" ", "_")
+            continue
+        m = re.match(r"^\s+(\w+): " + NUMBER + r"% compliant .*mean delay " + NUMBER
+                     + r" ms, loss " + NUMBER, line)
+        if m and cls:
+            prefix = "%s.%s." % (cls, m.group(1))
+            results[prefix + "compliant_pct"] = float(m.group(2))
+            results[prefix + "mean_delay_ms"] = float(m.group(3))
+            results[prefix + "loss_pct"] = float(m.group(4))
+        m = re.match(r"^Route changes \((\w+)\): (\d+),.*no-route drops (\d+)", line)
+        if m:
+            results["%s.route_changes" % m.group(1)] = float(m.group(2))
+            results["%s.no_route_drops" % m.group(1)] = float(m.group(3))
+    return results
+
+
+def combine(*parsers):
+    def parse(output):
+        results = {}
+        for p in parsers:
+            results.update(p(output))
+        return results
+    return parse
+
+
+QOS_SUMMARY = parse_sections([
+    ("VoIP", "Avg Delay", "voip.mean_delay_ms"),
+    ("VoIP", "Avg Jitter", "voip.mean_jitter_ms"),
+    ("VoIP", "Avg Loss", "voip.loss_pct"),
+    ("FTP", "Total Throughput", "ftp.throughput_mbps"),
+    ("FTP", "Avg Loss", "ftp.loss_pct"),
+])
+
+SECURITY_SUMMARY = parse_sections([
+    ("LEGITIMATE TRAFFIC", "Packets Sent", "legitimate.tx_packets"),
+    ("LEGITIMATE TRAFFIC", "Packets Received", "legitimate.rx_packets"),
+    ("LEGITIMATE TRAFFIC", "Avg Delay", "legitimate.mean_delay_ms"),
+    ("ATTACK TRAFFIC", "Packets Sent", "attack.tx_packets"),
+    ("ATTACK TRAFFIC", "Packets Received", "attack.rx_packets"),
+    ("ATTACK TRAFFIC", "Blocked", "attack.blocked_packets"),
+])
+
+# name: (program, arguments, result parser)
+SCENARIOS = {
+    "triangle": ("exercise1-Triangle-WAN-Topolog", [], None),
+    "multi-site": ("exercise1_multi_site_wan", [], parse_flows),
+    "qos": ("exercise2_qos_implementation", [], combine(parse_flows, QOS_SUMMARY)),
+    "qos-off": ("exercise2_qos_implementation", ["--qos=0"], combine(parse_flows, QOS_SUMMARY)),
+    "qos-fluid": ("exercise2_qos_implementation", ["--fluid=1"], combine(parse_flows, QOS_SUMMARY)),
+    "qos-off-fluid": ("exercise2_qos_implementation", ["--qos=0", "--fluid=1"],
+                      combine(parse_flows, QOS_SUMMARY)),
+    "security": ("exercise3_wan_security", ["--ddos=1", "--ratelimit=1", "--ipsec=1"],
+                 SECURITY_SUMMARY),
+    "security-open": ("exercise3_wan_security", ["--ddos=1"], SECURITY_SUMMARY),
+    "policy": ("exercise4", [], None),
+    "multi-hop": ("exercise4_multi_hop_wan", ["--dynamic=1"], parse_flows),
+    "sdwan": ("exercise5", ["--mode=all"], parse_compliance),
+}
+
+
+def find_program(ns3, program):
+    """Built executable of a scratch program, e.g. build/scratch/ns3.41-exercise4-default"""
+    candidates = []
+    for pattern in ("build/scratch/ns3*-%s-*" % program,
+                    "build/scratch/*/ns3*-%s-*" % program,
+                    "build/scratch/%s" % program):
+        candidates += [p for p in glob.glob(os.path.join(ns3, pattern))
+                       if os.path.isfile(p) and os.access(p, os.X_OK)]
+    return max(candidates, key=os.path.getmtime) if candidates else None
+
+
+def run_once(ns3, executable, args, workdir, rng_run=RNG_RUN):
+    """Run one simulation; returns (exit code, output, wall seconds, peak RSS kB)"""
+    env = dict(os.environ)
+    env["LD_LIBRARY_PATH"] = os.pathsep.join(
+        filter(None, [os.path.join(ns3, "build", "lib"), env.get("LD_LIBRARY_PATH")]))
+    cmd = [executable, "--RngRun=%d" % rng_run] + args
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, cwd=workdir, env=env, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+    output = proc.stdout.read()
+    # wait4 reports this child's own peak RSS, not the maximum over all
+    # children as RUSAGE_CHILDREN would
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+    code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+    return code, output, wall, usage.ru_maxrss
+
+
+def run_scenario(ns3, name, repeat, workdir, extra_args=()):
+    program, args, parser = SCENARIOS[name]
+    args = args + list(extra_args)
+    executable = find_program(ns3, program)
+    if executable is None:
+        return {"error": "no built executable for %s under %s/build" % (program, ns3)}
+
+    walls, rss, results = [], [], None
+    for i in range(repeat):
+        code, output, wall, maxrss = run_once(ns3, executable, args, workdir)
+        if code != 0:
+            tail = "\n".join(output.splitlines()[-10:])
+            return {"error": "%s exited with %d:\n%s" % (program, code, tail)}
+        run_results = parser(output) if parser else {}
+        if results is not None and run_results != results:
+            return {"error": "results differ between runs with the same RngRun"}
+        results = run_results
+        walls.append(wall)
+        rss.append(maxrss)
+
+    if parser and not results:
+        return {"error": "no results found in the output of %s" % program}
+    return {
+        "program": program,
+        "args": args,
+        "rng_run": RNG_RUN,
+        "results": results,
+        "wall_s": round(statistics.median(walls), 3),
+        "max_rss_kb": max(rss),
+    }
+
+
+def within(value, golden, tolerance):
+    return abs(value - golden) <= max(tolerance * abs(golden), 1e-9)
+
+
+def compare(name, run, golden, opts, same_host):
+    """List of (ok, message) lines"""
+    lines = []
+    if golden.get("args") != run["args"] or golden.get("rng_run") != run["rng_run"]:
+        lines.append((False, "golden was recorded with other arguments; run with --update"))
+        return lines
+
+    for key in sorted(set(golden["results"]) | set(run["results"])):
+        if key not in run["results"]:
+            lines.append((False, "%s: missing from output (golden %g)" % (key, golden["results"][key])))
+        elif key not in golden["results"]:
+            lines.append((False, "%s: %g has no golden value" % (key, run["results"][key])))
+        elif not within(run["results"][key], golden["results"][key], opts.tolerance):
+            lines.append((False, "%s: %g, golden %g" % (key, run["results"][key], golden["results"][key])))
+
+    if opts.no_perf:
+        return lines
+    if not same_host:
+        lines.append((True, "speed/memory not compared: baseline from %s" % golden.get("host")))
+        return lines
+
+    wall, base_wall = run["wall_s"], golden["wall_s"]
+    change = (wall - base_wall) / base_wall * 100 if base_wall > 0 else 0.0
+    lines.append((wall <= base_wall * (1 + opts.wall_tolerance) or wall - base_wall < opts.min_wall,
+                  "wall %.3fs vs %.3fs (%+.1f%%)" % (wall, base_wall, change)))
+    rss, base_rss = run["max_rss_kb"], golden["max_rss_kb"]
+    change = (rss - base_rss) / base_rss * 100 if base_rss > 0 else 0.0
+    lines.append((rss <= base_rss * (1 + opts.rss_tolerance),
+                  "peak RSS %d kB vs %d kB (%+.1f%%)" % (rss, base_rss, change)))
+    return lines
+
+
+def compare_schedulers(opts, names, workdir):
+    """Wall time per scenario and scheduler; results must not depend on the scheduler"""
+    schedulers = [s for s in opts.schedulers.split(",") if s]
+    print("%-14s %s" % ("scenario", "".join("%12s" % s for s in schedulers)))
+    failed = 0
+    for name in names:
+        runs = [run_scenario(opts.ns3, name, max(1, opts.repeat), workdir, ["--scheduler=" + s])
+                for s in schedulers]
+        errors = [(s, r["error"]) for s, r in zip(schedulers, runs) if "error" in r]
+        if errors:
+            for s, error in errors:
+                print("FAIL %-14s %s: %s" % (name, s, error))
+            failed += 1
+            continue
+        fastest = min(r["wall_s"] for r in runs)
+        print("%-14s %s" % (name, "".join("%11.3fs%s" % (r["wall_s"], "*" if r["wall_s"] == fastest else " ")
+                                        for r in runs)))
+        print("%-14s %s" % ("  peak MB", "".join("%12.1f" % (r["max_rss_kb"] / 1024.0) for r in runs)))
+        differing = [s for s, r in zip(schedulers, runs) if r["results"] != runs[0]["results"]]
+        if differing:
+            print("FAIL %-14s results with %s differ from %s" % (name, ", ".join(differing), schedulers[0]))
+            failed += 1
+    print("* fastest; %d of %d scenarios failed" % (failed, len(names)))
+    return 1 if failed else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("--ns3", required=True, help="ns-3 tree the exercises were built in")
+    ap.add_argument("--golden", default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                     "scenario-golden.json"),
+                    help="golden results file")
+    ap.add_argument("--only", default="", help="comma separated scenarios (default: all)")
+    ap.add_argument("--update", action="store_true", help="record goldens from this run")
+    ap.add_argument("--repeat", type=int, default=3, help="runs per scenario; wall time is the median")
+    ap.add_argument("--tolerance", type=float, default=0.01, help="relative tolerance for results")
+    ap.add_argument("--wall-tolerance", type=float, default=0.20,
+                    help="allowed relative wall time increase")
+    ap.add_argument("--min-wall", type=float, default=0.05,
+                    help="ignore wall time increases below this many seconds")
+    ap.add_argument("--rss-tolerance", type=float, default=0.10,
+                    help="allowed relative peak RSS increase")
+    ap.add_argument("--no-perf", action="store_true", help="compare results only")
+    ap.add_argument("--schedulers", default="",
+                    help="compare wall time across these event schedulers instead of checking goldens")
+    ap.add_argument("--workdir", default=None,
+                    help="directory the scenarios write their output files to (default: a temp dir)")
+    opts = ap.parse_args()
+
+    names = [n for n in opts.only.split(",") if n] or list(SCENARIOS)
+    unknown = [n for n in names if n not in SCENARIOS]
+    if unknown:
+        ap.error("unknown scenario(s) %s; known: %s" % (", ".join(unknown), ", ".join(SCENARIOS)))
+
+    workdir = opts.workdir
+    if workdir is None:
+        import tempfile
+        workdir = tempfile.mkdtemp(prefix="scenario-regression-")
+    os.makedirs(workdir, exist_ok=True)
+    if opts.schedulers:
+        return compare_schedulers(opts, names, workdir)
+
+    golden = {}
+    if os.path.exists(opts.golden):
+        with open(opts.golden) as f:
+            golden = json.load(f)
+    host = socket.gethostname()
+
+    failed = 0
+    for name in names:
+        run = run_scenario(opts.ns3, name, max(1, opts.repeat), workdir)
+        if "error" in run:
+            print("FAIL %-14s %s" % (name, run["error"]))
+            failed += 1
+            continue
+
+        if opts.update:
+            run["host"] = host
+            golden[name] = run
+            print("REC  %-14s %d results, wall %.3fs, peak RSS %d kB"
+                  % (name, len(run["results"]), run["wall_s"], run["max_rss_kb"]))
+            continue
+
+        if name not in golden:
+            print("FAIL %-14s no golden values; record them with --update" % name)
+            failed += 1
+            continue
+        lines = compare(name, run, golden[name], opts, golden[name].get("host") == host)
+        ok = all(l[0] for l in lines)
+        failed += not ok
+        print("%s %-14s %d results checked" % ("ok  " if ok else "FAIL", name, len(run["results"])))
+        for good, message in lines:
+            print("       %s %s" % (" " if good else "!", message))
+
+    if opts.update:
+        with open(opts.golden + ".tmp", "w") as f:
+            json.dump(golden, f, indent=2, sort_keys=True)
+            f.write("\n")
+        os.replace(opts.golden + ".tmp", opts.golden)
+        print("Wrote %s" % opts.golden)
+
+    print("%d of %d scenarios failed" % (failed, len(names)))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
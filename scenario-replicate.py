@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""
+Monte-Carlo replication of a WAN exercise with sequential stopping.
+
+Runs one scenario over independent random streams (--RngRun=1, 2, ...)
+in parallel processes, parses each run's per-class and per-flow results
+with the same parsers as scenario-regression.py, and keeps adding
+replications until the Student-t confidence interval of every selected
+metric is narrower than the target, or --max-reps is reached. Runs are
+started in order of RngRun and all finished runs are used, so the same
+command line gives the same replication set on any number of --jobs,
+apart from the runs still in flight when the target is met.
+
+Usage (after ./ns3 build):
+  scenario-replicate.py --ns3 ~/ns-3-dev --scenario qos
+  scenario-replicate.py --ns3 ~/ns-3-dev --scenario qos-off --metrics 'voip\\.|ftp\\.' \\
+      --rel-width 0.02 --max-reps 200 --jobs 8 --json qos-off-reps.json
+  scenario-replicate.py --ns3 ~/ns-3-dev --scenario security -- --attackers=10
+
+Arguments after -- are passed to the scenario on top of its own.
+"""
+
+import argparse
+import concurrent.futures
+import importlib.util
+import json
+import math
+import os
+import re
+import shutil
+import sys
+import tempfile
+
+
+def load_regression():
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scenario-regression.py")
+    spec = importlib.util.spec_from_file_location("scenario_regression", path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def betacf(a, b, x):
+    """Continued fraction of the incomplete beta function (Lentz)"""
+    tiny = 1e-300
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def betainc(a, b, x):
+    """Regularized incomplete beta I_x(a, b)"""
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    lbeta = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+    front = math.exp(lbeta + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1.0 - x) / b
+
+
+def t_quantile(p, df):
+    """Two-sided Student-t critical value: P(|T| <= t) = p"""
+    def tail(t):
+        return betainc(df / 2.0, 0.5, df / (df + t * t))   # P(|T| > t)
+    lo, hi = 0.0, 1.0
+    while tail(hi) > 1.0 - p:
+        hi *= 2.0
+    for _ in range(100):
+        mid = 0.5 * (lo + hi)
+        if tail(mid) > 1.0 - p:
+            lo = mid
+        else:
+            hi = mid
+    return 0.5 * (lo + hi)
+
+
+class Estimate:
+    """Running mean and variance (Welford)"""
+
+    def __init__(self):
+        self.n = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+
+    def add(self, x):
+        self.n += 1
+        delta = x - self.mean
+        self.mean += delta / self.n
+        self.m2 += delta * (x - self.mean)
+
+    def stddev(self):
+        return math.sqrt(self.m2 / (self.n - 1)) if self.n > 1 else float("nan")
+
+    def half_width(self, confidence):
+        if self.n < 2:
+            return float("inf")
+        return t_quantile(confidence, self.n - 1) * self.stddev() / math.sqrt(self.n)
+
+
+def converged(est, opts):
+    hw = est.half_width(opts.confidence)
+    return hw <= opts.abs_width or hw <= opts.rel_width * abs(est.mean)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("--ns3", required=True, help="ns-3 tree the exercises were built in")
+    ap.add_argument("--scenario", required=True, help="scenario name from scenario-regression.py")
+    ap.add_argument("--metrics", default="", help="regex selecting the metrics that must converge (default: all)")
+    ap.add_argument("--confidence", type=float, default=0.95, help="confidence level")
+    ap.add_argument("--rel-width", type=float, default=0.05,
+                    help="target CI half-width relative to the mean")
+    ap.add_argument("--abs-width", type=float, default=1e-9,
+                    help="target CI half-width in absolute terms, for metrics with a mean near 0")
+    ap.add_argument("--min-reps", type=int, default=5, help="replications before stopping is considered")
+    ap.add_argument("--max-reps", type=int, default=100, help="hard limit on replications")
+    ap.add_argument("--first-run", type=int, default=1, help="RngRun of the first replication")
+    ap.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="parallel processes")
+    ap.add_argument("--json", default="", help="write per-run results and the summary to this file")
+    ap.add_argument("--keep", action="store_true", help="keep each run's output files")
+    ap.add_argument("extra", nargs="*", help="arguments for the scenario (after --)")
+    opts = ap.parse_args()
+
+    regression = load_regression()
+    if opts.scenario not in regression.SCENARIOS:
+        ap.error("unknown scenario %s; known: %s" % (opts.scenario, ", ".join(regression.SCENARIOS)))
+    program, args, parser = regression.SCENARIOS[opts.scenario]
+    if parser is None:
+        ap.error("scenario %s prints no results to replicate" % opts.scenario)
+    executable = regression.find_program(opts.ns3, program)
+    if executable is None:
+        ap.error("no built executable for %s under %s/build" % (program, opts.ns3))
+    args = args + opts.extra
+    selected = re.compile(opts.metrics) if opts.metrics else None
+
+    # Each run writes its NetAnim/FlowMonitor files into its own directory
+    root = tempfile.mkdtemp(prefix="scenario-replicate-")
+
+    def replicate(rng_run):
+        workdir = os.path.join(root, "run%d" % rng_run)
+        os.makedirs(workdir)
+        code, output, wall, maxrss = regression.run_once(opts.ns3, executable, args, workdir, rng_run)
+        if not opts.keep:
+            shutil.rmtree(workdir, ignore_errors=True)
+        if code != 0:
+            raise RuntimeError("RngRun=%d exited with %d:\n%s"
+                               % (rng_run, code, "\n".join(output.splitlines()[-10:])))
+        return {"rng_run": rng_run, "results": parser(output), "wall_s": wall, "max_rss_kb": maxrss}
+
+    estimates = {}
+    runs = []
+    next_run = opts.first_run
+    stop_reason = "reached --max-reps=%d" % opts.max_reps
+    cpu_s = 0.0
+
+    def done():
+        if len(runs) < opts.min_reps:
+            return False
+        keys = [k for k in estimates if selected is None or selected.search(k)]
+        return bool(keys) and all(converged(estimates[k], opts) for k in keys)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, opts.jobs)) as pool:
+        pending = set()
+        while True:
+            stop = done()
+            while not stop and len(pending) < opts.jobs and next_run < opts.first_run + opts.max_reps:
+                pending.add(pool.submit(replicate, next_run))
+                next_run += 1
+            if not pending:
+                if stop:
+                    stop_reason = "all selected intervals within target"
+                break
+            finished, pending = concurrent.futures.wait(pending,
+                                                        return_when=concurrent.futures.FIRST_COMPLETED)
+            for future in finished:
+                try:
+                    run = future.result()
+                except RuntimeError as e:
+                    print("FAIL %s" % e, file=sys.stderr)
+                    for other in pending:
+                        other.cancel()
+                    return 1
+                runs.append(run)
+                cpu_s += run["wall_s"]
+                for key, value in run["results"].items():
+                    estimates.setdefault(key, Estimate()).add(value)
+            print("  %d replications done" % len(runs), file=sys.stderr)
+
+    if not opts.keep:
+        shutil.rmtree(root, ignore_errors=True)
+
+    runs.sort(key=lambda r: r["rng_run"])
+    print("\n=== %s: %d replications (RngRun %d-%d), %s ===" % (
+        opts.scenario, len(runs), runs[0]["rng_run"], runs[-1]["rng_run"], stop_reason))
+    print("%.1f s of run time in total; %d%% confidence, target half-width %.1f%% of mean"
+          % (cpu_s, round(opts.confidence * 100), opts.rel_width * 100))
+    print("%-36s %5s %12s %12s %25s %8s" % ("metric", "n", "mean", "stddev", "confidence interval", "width"))
+    summary = {}
+    for key in sorted(estimates):
+        est = estimates[key]
+        hw = est.half_width(opts.confidence)
+        rel = hw / abs(est.mean) * 100 if est.mean else 0.0
+        flag = "" if converged(est, opts) else "  (open)"
+        if selected is not None and not selected.search(key):
+            flag = "  (not selected)"
+        if est.n < len(runs):
+            flag += "  (missing in %d runs)" % (len(runs) - est.n)
+        print("%-36s %5d %12.4g %12.4g %12.4g - %-12.4g %7.1f%%%s"
+              % (key, est.n, est.mean, est.stddev(), est.mean - hw, est.mean + hw, rel, flag))
+        summary[key] = {"n": est.n, "mean": est.mean, "stddev": est.stddev(),
+                        "ci_low": est.mean - hw, "ci_high": est.mean + hw}
+
+    if opts.json:
+        with open(opts.json, "w") as f:
+            json.dump({"scenario": opts.scenario, "program": program, "args": args,
+                       "confidence": opts.confidence, "stop_reason": stop_reason,
+                       "summary": summary, "runs": runs}, f, indent=2, sort_keys=True)
+            f.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
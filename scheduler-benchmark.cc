@@ -0,0 +1,158 @@
+/*
+ * Event scheduler benchmark
+ * Drives each ns-3 scheduler (and LadderScheduler) directly with the
+ * classic hold model: fill the queue with N pending events, then repeat
+ * "remove the next event, insert one at now + delay" M times, then drain.
+ * Reports the cost per insert (fill), per hold operation and per remove
+ * (drain) for several delay distributions, so the cheapest scheduler can
+ * be picked for a given queue size and workload shape.
+ *
+ * Total runtime of the real scenarios with each scheduler comes from the
+ * regression harness: scenario-regression.py --schedulers map,heap,ladder
+ *
+ * Example: scheduler-benchmark --pending=100000 --holds=2000000 --schedulers=map,heap,ladder
+ */
+
+#include "ns3/core-module.h"
+
+#include "ladder-scheduler.h"
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SchedulerBenchmark");
+
+// Never invoked; the schedulers only store the pointer
+class BenchmarkEvent : public EventImpl
+{
+protected:
+    void Notify() override
+    {
+    }
+};
+
+// Delay until the next event, in ns. "bursty" puts a third of the events
+// at the current time, like many packets forwarded in the same instant
+static uint64_t DrawDelay(const std::string& dist, std::mt19937_64& rng)
+{
+    if (dist == "uniform")
+    {
+        return rng() % 2000000;
+    }
+    if (dist == "bimodal")
+    {
+        return rng() % 10 == 0 ? 100000000 + rng() % 1000000 : rng() % 10000;
+    }
+    if (dist == "bursty")
+    {
+        return rng() % 3 == 0 ? 0 : rng() % 2000000;
+    }
+    return uint64_t(std::exponential_distribution<double>(1e-6)(rng));
+}
+
+static double ElapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t nPending = 100000;
+    uint32_t nHolds = 1000000;
+    std::string schedulers = "map,heap,calendar,priority,ladder";
+    std::string distributions = "exponential,uniform,bimodal,bursty";
+    uint32_t seed = 1;
+
+    CommandLine cmd;
+    cmd.AddValue("pending", "Events kept pending during the hold phase", nPending);
+    cmd.AddValue("holds", "Remove-then-insert operations", nHolds);
+    cmd.AddValue("schedulers", "Comma separated: map, heap, list, calendar, priority, ladder", schedulers);
+    cmd.AddValue("distributions", "Comma separated: exponential, uniform, bimodal, bursty", distributions);
+    cmd.AddValue("seed", "Seed for the event times", seed);
+    cmd.Parse(argc, argv);
+
+    std::vector<std::string> names;
+    std::vector<std::string> dists;
+    std::istringstream schedulerList(schedulers);
+    for (std::string name; std::getline(schedulerList, name, ',');)
+    {
+        if (SchedulerTypeName(name).empty())
+        {
+            std::cerr << "Unknown scheduler '" << name << "'\n";
+            return 1;
+        }
+        names.push_back(name);
+    }
+    std::istringstream distList(distributions);
+    for (std::string dist; std::getline(distList, dist, ',');)
+    {
+        dists.push_back(dist);
+    }
+
+    Ptr<BenchmarkEvent> impl = Create<BenchmarkEvent>();
+
+    std::cout << "\n=== Event Scheduler Benchmark ===\n";
+    std::cout << "Pending events: " << nPending << ", hold operations: " << nHolds << "\n";
+    std::cout << "Cost in ns per operation (insert = fill, hold = remove + insert, remove = drain)\n";
+
+    for (const std::string& dist : dists)
+    {
+        std::cout << "\n" << dist << " delays:\n";
+        std::cout << "  scheduler     insert      hold    remove\n";
+        for (const std::string& name : names)
+        {
+            ObjectFactory factory(SchedulerTypeName(name));
+            Ptr<Scheduler> scheduler = factory.Create<Scheduler>();
+            std::mt19937_64 rng(seed);
+            uint32_t uid = 0;
+            uint64_t now = 0;
+
+            Scheduler::Event ev;
+            ev.impl = PeekPointer(impl);
+            ev.key.m_context = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < nPending; i++)
+            {
+                ev.key.m_ts = DrawDelay(dist, rng);
+                ev.key.m_uid = uid++;
+                scheduler->Insert(ev);
+            }
+            double fill = ElapsedSeconds(start);
+
+            start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < nHolds; i++)
+            {
+                now = scheduler->RemoveNext().key.m_ts;
+                ev.key.m_ts = now + DrawDelay(dist, rng);
+                ev.key.m_uid = uid++;
+                scheduler->Insert(ev);
+            }
+            double hold = ElapsedSeconds(start);
+
+            start = std::chrono::steady_clock::now();
+            uint64_t last = 0;
+            bool ordered = true;
+            while (!scheduler->IsEmpty())
+            {
+                uint64_t ts = scheduler->RemoveNext().key.m_ts;
+                ordered = ordered && ts >= last;
+                last = ts;
+            }
+            double drain = ElapsedSeconds(start);
+
+            std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(10) << fill * 1e9 / std::max(nPending, 1u)
+                      << std::setw(10) << hold * 1e9 / std::max(nHolds, 1u) << std::setw(10)
+                      << drain * 1e9 / std::max(nPending, 1u) << (ordered ? "" : "  OUT OF ORDER")
+                      << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+
+    return 0;
+}
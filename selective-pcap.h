@@ -0,0 +1,565 @@
+/*
+ * Selective pcap capture
+ * A bounded replacement for PointToPointHelper::EnablePcapAll:
+ *   - only the selected devices ("all", "2" for every device of node 2,
+ *     "2/1" for device 1 of node 2, comma separated)
+ *   - a tcpdump-like filter on the IPv4 5-tuple and DSCP, e.g.
+ *       "udp and dst port 5060", "src net 10.1.0.0/16 and dscp ef",
+ *       "tcp and not port 22 or icmp"
+ *     ("and" binds tighter than "or"; "not" negates one primitive)
+ *   - a snap length, so only headers reach the disk
+ *   - ring-buffer rotation by file size and/or simulated time, keeping the
+ *     last RingFiles files per device
+ *
+ * Files are named <prefix>-<node>-<device>.pcap like EnablePcapAll, or
+ * <prefix>-<node>-<device>-<k>.pcap when rotating, and are only created
+ * once a packet matches. Packets are captured from the device's
+ * PromiscSniffer trace, with the link-layer header (PPP on point-to-point).
+ *
+ * Usage:
+ *   SelectivePcap pcap("multi-site-wan");
+ *   pcap.SetFilter("udp and port 9");
+ *   pcap.SetSnapLen(96);
+ *   pcap.SetRotation(10 * 1024 * 1024, Seconds(60), 4);
+ *   pcap.Enable("0/2,2/1");
+ *   ...
+ *   pcap.PrintSummary(std::cout);
+ */
+
+#ifndef SELECTIVE_PCAP_H
+#define SELECTIVE_PCAP_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "packet-trace-format.h"
+
+#include <arpa/inet.h>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// FILTER
+// ============================================================================
+
+class PcapFilter
+{
+public:
+    // Returns false (and leaves the filter unchanged) on a syntax error
+    bool Parse(std::string expression, std::string* error = nullptr);
+    bool IsEmpty() const { return m_clauses.empty(); }
+    bool Match(const PacketTraceRecord& r) const;
+
+private:
+    struct Term
+    {
+        enum Field
+        {
+            SRC,
+            DST,
+            HOST,    // either address
+            SPORT,
+            DPORT,
+            PORT,    // either port
+            PROTO,
+            DSCP
+        };
+
+        Field field;
+        uint32_t value;
+        uint32_t mask;
+        bool negate;
+    };
+
+    static bool ParseNet(std::string text, uint32_t& address, uint32_t& mask);
+    static bool ParseDscp(std::string text, uint32_t& dscp);
+
+    std::vector<std::vector<Term>> m_clauses;  // OR of ANDs
+};
+
+inline bool PcapFilter::ParseNet(std::string text, uint32_t& address, uint32_t& mask)
+{
+    std::size_t slash = text.find('/');
+    uint32_t length = 32;
+    if (slash != std::string::npos)
+    {
+        length = std::atoi(text.substr(slash + 1).c_str());
+        text = text.substr(0, slash);
+    }
+    in_addr parsed;
+    if (length > 32 || inet_pton(AF_INET, text.c_str(), &parsed) != 1)
+    {
+        return false;
+    }
+    mask = length == 0 ? 0 : ~0u << (32 - length);
+    address = ntohl(parsed.s_addr) & mask;
+    return true;
+}
+
+inline bool PcapFilter::ParseDscp(std::string text, uint32_t& dscp)
+{
+    if (text == "be")
+    {
+        dscp = 0;
+    }
+    else if (text == "ef")
+    {
+        dscp = 46;
+    }
+    else if (text.size() == 4 && text.compare(0, 2, "af") == 0)
+    {
+        dscp = 8 * (text[2] - '0') + 2 * (text[3] - '0');
+    }
+    else if (text.size() == 3 && text.compare(0, 2, "cs") == 0)
+    {
+        dscp = 8 * (text[2] - '0');
+    }
+    else if (!text.empty() && text.find_first_not_of("0123456789") == std::string::npos)
+    {
+        dscp = std::atoi(text.c_str());
+    }
+    else
+    {
+        return false;
+    }
+    return dscp < 64;
+}
+
+inline bool PcapFilter::Parse(std::string expression, std::string* error)
+{
+    std::istringstream in(expression);
+    std::vector<std::string> tokens;
+    for (std::string t; in >> t;)
+    {
+        tokens.push_back(t);
+    }
+
+    std::vector<std::vector<Term>> clauses;
+    std::vector<Term> clause;
+    bool expectTerm = true;
+    auto fail = [&](std::string why) {
+        if (error)
+        {
+            *error = why;
+        }
+        return false;
+    };
+
+    for (std::size_t i = 0; i < tokens.size();)
+    {
+        if (!expectTerm)
+        {
+            if (tokens[i] == "or")
+            {
+                clauses.push_back(clause);
+                clause.clear();
+            }
+            else if (tokens[i] != "and")
+            {
+                return fail("expected 'and' or 'or' before '" + tokens[i] + "'");
+            }
+            expectTerm = true;
+            i++;
+            continue;
+        }
+
+        Term term;
+        term.negate = false;
+        term.mask = ~0u;
+        if (tokens[i] == "not")
+        {
+            term.negate = true;
+            i++;
+        }
+        if (i >= tokens.size())
+        {
+            return fail("expression ends early");
+        }
+
+        std::string dir = "";
+        if (tokens[i] == "src" || tokens[i] == "dst")
+        {
+            dir = tokens[i++];
+        }
+        std::string kind = i < tokens.size() ? tokens[i] : "";
+        auto argument = [&](std::string& out) {
+            if (i + 1 >= tokens.size())
+            {
+                return false;
+            }
+            out = tokens[i + 1];
+            i += 2;
+            return true;
+        };
+        std::string arg;
+
+        if (kind == "host" || kind == "net")
+        {
+            if (!argument(arg) || !ParseNet(arg, term.value, term.mask) ||
+                (kind == "host" && term.mask != ~0u))
+            {
+                return fail("bad address after '" + kind + "'");
+            }
+            term.field = dir == "src" ? Term::SRC : dir == "dst" ? Term::DST : Term::HOST;
+        }
+        else if (kind == "port")
+        {
+            if (!argument(arg) || arg.find_first_not_of("0123456789") != std::string::npos ||
+                std::atoi(arg.c_str()) > 65535)
+            {
+                return fail("bad port number");
+            }
+            term.value = std::atoi(arg.c_str());
+            term.field = dir == "src" ? Term::SPORT : dir == "dst" ? Term::DPORT : Term::PORT;
+        }
+        else if (!dir.empty() && ParseNet(kind, term.value, term.mask))
+        {
+            // "src 10.1.1.1" is short for "src host 10.1.1.1"
+            term.field = dir == "src" ? Term::SRC : Term::DST;
+            i++;
+        }
+        else if (!dir.empty())
+        {
+            return fail("expected host, net or port after '" + dir + "'");
+        }
+        else if (kind == "udp" || kind == "tcp" || kind == "icmp")
+        {
+            term.field = Term::PROTO;
+            term.value = kind == "udp" ? 17 : kind == "tcp" ? 6 : 1;
+            i++;
+        }
+        else if (kind == "proto")
+        {
+            if (!argument(arg) || arg.find_first_not_of("0123456789") != std::string::npos)
+            {
+                return fail("bad protocol number");
+            }
+            term.field = Term::PROTO;
+            term.value = std::atoi(arg.c_str());
+        }
+        else if (kind == "dscp")
+        {
+            if (!argument(arg) || !ParseDscp(arg, term.value))
+            {
+                return fail("bad DSCP value (number, be, ef, afXY or csN)");
+            }
+            term.field = Term::DSCP;
+        }
+        else
+        {
+            return fail("unknown primitive '" + kind + "'");
+        }
+        clause.push_back(term);
+        expectTerm = false;
+    }
+    if (expectTerm && !tokens.empty())
+    {
+        return fail("expression ends early");
+    }
+    if (!clause.empty())
+    {
+        clauses.push_back(clause);
+    }
+    m_clauses = clauses;
+    return true;
+}
+
+inline bool PcapFilter::Match(const PacketTraceRecord& r) const
+{
+    if (m_clauses.empty())
+    {
+        return true;
+    }
+    if (r.ipLength == 0)
+    {
+        return false;  // not IPv4
+    }
+    for (const std::vector<Term>& clause : m_clauses)
+    {
+        bool all = true;
+        for (const Term& t : clause)
+        {
+            bool hit = false;
+            switch (t.field)
+            {
+            case Term::SRC:
+                hit = (r.source & t.mask) == t.value;
+                break;
+            case Term::DST:
+                hit = (r.destination & t.mask) == t.value;
+                break;
+            case Term::HOST:
+                hit = (r.source & t.mask) == t.value || (r.destination & t.mask) == t.value;
+                break;
+            case Term::SPORT:
+                hit = r.srcPort == t.value;
+                break;
+            case Term::DPORT:
+                hit = r.dstPort == t.value;
+                break;
+            case Term::PORT:
+                hit = r.srcPort == t.value || r.dstPort == t.value;
+                break;
+            case Term::PROTO:
+                hit = r.protocol == t.value;
+                break;
+            case Term::DSCP:
+                hit = r.dscp == t.value;
+                break;
+            }
+            if (hit == t.negate)
+            {
+                all = false;
+                break;
+            }
+        }
+        if (all)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// CAPTURE
+// ============================================================================
+
+class SelectivePcap
+{
+public:
+    explicit SelectivePcap(std::string prefix);
+
+    bool SetFilter(std::string expression);
+    // Bytes kept per packet (0 = whole packet)
+    void SetSnapLen(uint32_t snapLen) { m_snapLen = snapLen; }
+    // Start a new file after maxBytes and/or maxDuration (0 = no limit),
+    // keeping the last ringFiles files per device (0 = keep all)
+    void SetRotation(uint64_t maxBytes, Time maxDuration, uint32_t ringFiles);
+
+    void Enable(Ptr<NetDevice> device);
+    void Enable(NetDeviceContainer devices);
+    // "all", or comma-separated "node" / "node/device" selectors; false if
+    // a selector names nothing
+    bool Enable(std::string selection);
+
+    void PrintSummary(std::ostream& os) const;
+
+private:
+    struct Capture
+    {
+        SelectivePcap* owner;
+        std::string base;
+        uint32_t linkType;
+        std::ofstream out;
+        uint32_t fileIndex;
+        uint32_t nFiles;
+        uint64_t fileBytes;
+        Time fileStart;
+        uint64_t seen;
+        uint64_t captured;
+        uint64_t written;
+    };
+
+    static void Sniff(Capture* capture, Ptr<const Packet> packet);
+    void Open(Capture& capture);
+
+    std::string m_prefix;
+    PcapFilter m_filter;
+    uint32_t m_snapLen;
+    uint64_t m_maxBytes;
+    Time m_maxDuration;
+    uint32_t m_ringFiles;
+    std::vector<std::unique_ptr<Capture>> m_captures;
+};
+
+inline SelectivePcap::SelectivePcap(std::string prefix)
+    : m_prefix(prefix),
+      m_snapLen(0),
+      m_maxBytes(0),
+      m_maxDuration(Seconds(0)),
+      m_ringFiles(0)
+{
+}
+
+inline bool SelectivePcap::SetFilter(std::string expression)
+{
+    std::string error;
+    if (!m_filter.Parse(expression, &error))
+    {
+        std::cerr << "SelectivePcap: filter \"" << expression << "\": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+inline void SelectivePcap::SetRotation(uint64_t maxBytes, Time maxDuration, uint32_t ringFiles)
+{
+    m_maxBytes = maxBytes;
+    m_maxDuration = maxDuration;
+    m_ringFiles = ringFiles;
+}
+
+inline void SelectivePcap::Enable(Ptr<NetDevice> device)
+{
+    std::unique_ptr<Capture> c(new Capture());
+    c->owner = this;
+    c->base = m_prefix + "-" + std::to_string(device->GetNode()->GetId()) + "-" +
+              std::to_string(device->GetIfIndex());
+    c->linkType = DynamicCast<PointToPointNetDevice>(device) ? 9 : 1;  // DLT_PPP : DLT_EN10MB
+    c->fileIndex = 0;
+    c->nFiles = 0;
+    c->fileBytes = 0;
+    c->seen = 0;
+    c->captured = 0;
+    c->written = 0;
+    device->TraceConnectWithoutContext("PromiscSniffer", MakeBoundCallback(&SelectivePcap::Sniff, c.get()));
+    m_captures.push_back(std::move(c));
+}
+
+inline void SelectivePcap::Enable(NetDeviceContainer devices)
+{
+    for (uint32_t i = 0; i < devices.GetN(); i++)
+    {
+        Enable(devices.Get(i));
+    }
+}
+
+inline bool SelectivePcap::Enable(std::string selection)
+{
+    std::istringstream in(selection);
+    for (std::string item; std::getline(in, item, ',');)
+    {
+        uint32_t before = m_captures.size();
+        for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+        {
+            Ptr<Node> node = NodeList::GetNode(n);
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                std::string id = std::to_string(n);
+                if (item == "all" || item == id || item == id + "/" + std::to_string(d))
+                {
+                    // Loopback has no sniffer and nothing worth capturing
+                    if (!DynamicCast<LoopbackNetDevice>(node->GetDevice(d)))
+                    {
+                        Enable(node->GetDevice(d));
+                    }
+                }
+            }
+        }
+        if (m_captures.size() == before)
+        {
+            std::cerr << "SelectivePcap: no device matches \"" << item << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void SelectivePcap::Open(Capture& c)
+{
+    c.out.close();
+    std::string name = c.base;
+    if (m_maxBytes > 0 || m_maxDuration.IsStrictlyPositive())
+    {
+        name += "-" + std::to_string(c.fileIndex);
+        c.fileIndex = m_ringFiles > 0 ? (c.fileIndex + 1) % m_ringFiles : c.fileIndex + 1;
+    }
+    c.out.open(name + ".pcap", std::ios::binary | std::ios::trunc);
+    struct
+    {
+        uint32_t magic;
+        uint16_t major;
+        uint16_t minor;
+        int32_t zone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+    } header = {0xa1b2c3d4, 2, 4, 0, 0, m_snapLen ? m_snapLen : 65535, c.linkType};
+    c.out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    c.fileBytes = sizeof(header);
+    c.fileStart = Simulator::Now();
+    c.nFiles++;
+}
+
+inline void SelectivePcap::Sniff(Capture* c, Ptr<const Packet> packet)
+{
+    SelectivePcap* self = c->owner;
+    c->seen++;
+    if (!self->m_filter.IsEmpty())
+    {
+        uint8_t bytes[64];
+        PacketTraceRecord r;
+        std::memset(&r, 0, sizeof(r));
+        uint32_t n = packet->CopyData(bytes, sizeof(bytes));
+        // Skip an Ethernet header (IPv4 ethertype) the way PPP is skipped
+        if (c->linkType == 1 && n >= 14 && bytes[12] == 0x08 && bytes[13] == 0x00)
+        {
+            PacketTraceParseIpv4(bytes + 14, n - 14, r);
+        }
+        else
+        {
+            PacketTraceParseIpv4(bytes, n, r);
+        }
+        if (!self->m_filter.Match(r))
+        {
+            return;
+        }
+    }
+    c->captured++;
+
+    uint32_t size = packet->GetSize();
+    uint32_t caplen = self->m_snapLen ? std::min(size, self->m_snapLen) : size;
+    uint64_t recordBytes = 16 + caplen;
+    bool rotate = !c->out.is_open() ||
+                  (self->m_maxBytes > 0 && c->fileBytes + recordBytes > self->m_maxBytes &&
+                   c->fileBytes > 24) ||
+                  (self->m_maxDuration.IsStrictlyPositive() &&
+                   Simulator::Now() - c->fileStart >= self->m_maxDuration);
+    if (rotate)
+    {
+        self->Open(*c);
+    }
+
+    int64_t ns = Simulator::Now().GetNanoSeconds();
+    uint32_t record[4] = {uint32_t(ns / 1000000000), uint32_t((ns % 1000000000) / 1000), caplen, size};
+    c->out.write(reinterpret_cast<const char*>(record), sizeof(record));
+    std::vector<uint8_t> data(caplen);
+    packet->CopyData(data.data(), caplen);
+    c->out.write(reinterpret_cast<const char*>(data.data()), caplen);
+    c->fileBytes += recordBytes;
+    c->written += recordBytes;
+}
+
+inline void SelectivePcap::PrintSummary(std::ostream& os) const
+{
+    uint64_t seen = 0;
+    uint64_t captured = 0;
+    uint64_t written = 0;
+    uint32_t files = 0;
+    for (const std::unique_ptr<Capture>& c : m_captures)
+    {
+        seen += c->seen;
+        captured += c->captured;
+        written += c->written;
+        files += c->nFiles;
+    }
+    os << "\n=== Packet capture (" << m_prefix << "-*.pcap) ===\n";
+    os << "  Devices: " << m_captures.size() << ", packets seen: " << seen << ", captured: " << captured
+       << ", bytes written: " << written << ", files opened: " << files << "\n";
+    if (m_ringFiles > 0)
+    {
+        os << "  Ring of " << m_ringFiles << " files per device; older files were overwritten\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* SELECTIVE_PCAP_H */
@@ -0,0 +1,1039 @@
+/*
+ * Topology loader for NetAnim-style XML, GraphML and Topology Zoo files
+ * Parses the hand-written topology files shipped with the exercises
+ * (<ns3-animation> with <node>, <link> and <event> elements) as well as
+ * GraphML, including the Topology Zoo dialect (Latitude/Longitude on nodes,
+ * LinkSpeed/LinkSpeedUnits/LinkSpeedRaw on edges), into nodes, links, rates
+ * and delays, then builds the matching point-to-point network.
+ *
+ * The parser is a streaming SAX-style scanner: the file is read in 1 MB
+ * chunks and each tag is handed to the loader as it is found, so no
+ * document tree is built and 10k-node files load in milliseconds.
+ *
+ * NetAnim files without <link> elements get one link per node pair seen in
+ * their packet records (<p fId tId>, or <packet> with <tx nodeId> and
+ * <rx nodeId>). These are the packets' end points, so a multi-hop trace
+ * yields direct links; a warning says so.
+ *
+ * Rates and delays come from link attributes when present (NetAnim:
+ * dataRate="10Mbps" delay="5ms"; GraphML: LinkSpeedRaw, LinkSpeed, bandwidth,
+ * delay, latency). Otherwise the delay is the great-circle distance between
+ * geo-located nodes at 2/3 c, and the remaining gaps use the defaults.
+ *
+ * Usage:
+ *   TopologyLoader topo;
+ *   topo.Load("exercise4.xml");
+ *   NodeContainer nodes = topo.Build(p2p);
+ *   stack.Install(nodes);
+ *   topo.AssignAddresses("10.0.0.0");
+ *   topo.ScheduleEvents();                 // link-down/link-up events
+ *   topo.ApplyAnimation(anim);
+ */
+
+#ifndef TOPOLOGY_LOADER_H
+#define TOPOLOGY_LOADER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/netanim-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// STREAMING XML PARSER
+// ============================================================================
+
+// Attributes of the current element. Slots are reused between elements, so
+// steady-state parsing does not allocate.
+class XmlAttributes
+{
+public:
+    XmlAttributes() : m_n(0) {}
+
+    uint32_t GetN() const { return m_n; }
+    const std::string& GetName(uint32_t i) const { return m_items[i].first; }
+    const std::string& GetValue(uint32_t i) const { return m_items[i].second; }
+
+    const std::string* Find(const char* name) const
+    {
+        for (uint32_t i = 0; i < m_n; i++)
+        {
+            if (m_items[i].first == name)
+            {
+                return &m_items[i].second;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    friend class XmlSaxParser;
+
+    std::vector<std::pair<std::string, std::string>> m_items;
+    uint32_t m_n;
+};
+
+class XmlSaxHandler
+{
+public:
+    virtual ~XmlSaxHandler() {}
+    virtual void StartElement(const std::string& name, const XmlAttributes& attributes) = 0;
+    virtual void EndElement(const std::string& name) {}
+    // Text between tags; only called for non-whitespace text
+    virtual void Characters(const std::string& text) {}
+};
+
+// Handles elements, attributes, comments, CDATA, processing instructions,
+// DOCTYPE and the five predefined entities; it does not validate.
+class XmlSaxParser
+{
+public:
+    bool Parse(std::istream& in, XmlSaxHandler& handler);
+    bool ParseFile(const std::string& filename, XmlSaxHandler& handler);
+    const std::string& GetError() const { return m_error; }
+
+private:
+    static const std::size_t CHUNK = 1 << 20;
+
+    bool Fill(std::istream& in);
+    std::size_t FindTagEnd(std::size_t from) const;
+    bool ParseTag(const char* begin, const char* end, XmlSaxHandler& handler);
+    void EmitText(const char* begin, const char* end, bool raw, XmlSaxHandler& handler);
+    static void Decode(const char* begin, const char* end, std::string& out);
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    std::string m_buffer;
+    std::vector<char> m_chunk;
+    std::string m_name;
+    std::string m_text;
+    XmlAttributes m_attributes;
+    std::string m_error;
+};
+
+inline bool XmlSaxParser::ParseFile(const std::string& filename, XmlSaxHandler& handler)
+{
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in)
+    {
+        m_error = "cannot open " + filename;
+        return false;
+    }
+    return Parse(in, handler);
+}
+
+inline bool XmlSaxParser::Fill(std::istream& in)
+{
+    m_chunk.resize(CHUNK);
+    in.read(m_chunk.data(), CHUNK);
+    std::streamsize n = in.gcount();
+    m_buffer.append(m_chunk.data(), n);
+    return n > 0;
+}
+
+// '>' that is not inside a quoted attribute value
+inline std::size_t XmlSaxParser::FindTagEnd(std::size_t from) const
+{
+    char quote = 0;
+    for (std::size_t i = from; i < m_buffer.size(); i++)
+    {
+        char c = m_buffer[i];
+        if (quote)
+        {
+            if (c == quote)
+            {
+                quote = 0;
+            }
+        }
+        else if (c == '"' || c == '\'')
+        {
+            quote = c;
+        }
+        else if (c == '>')
+        {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+inline bool XmlSaxParser::Parse(std::istream& in, XmlSaxHandler& handler)
+{
+    m_buffer.clear();
+    m_error.clear();
+    std::size_t pos = 0;
+    bool eof = !Fill(in);
+
+    while (true)
+    {
+        std::size_t lt = m_buffer.find('<', pos);
+        // Need the whole tag plus enough lookahead to classify it
+        std::size_t end = std::string::npos;
+        std::size_t termLength = 1;
+        bool cdata = false;
+        bool skip = false;
+        if (lt != std::string::npos && (m_buffer.size() - lt >= 9 || eof))
+        {
+            const char* p = m_buffer.c_str() + lt;
+            if (std::strncmp(p, "<!--", 4) == 0)
+            {
+                end = m_buffer.find("-->", lt + 4);
+                termLength = 3;
+                skip = true;
+            }
+            else if (std::strncmp(p, "<![CDATA[", 9) == 0)
+            {
+                end = m_buffer.find("]]>", lt + 9);
+                termLength = 3;
+                cdata = true;
+            }
+            else if (p[1] == '?' || p[1] == '!')
+            {
+                end = FindTagEnd(lt + 1);
+                skip = true;
+            }
+            else
+            {
+                end = FindTagEnd(lt + 1);
+            }
+        }
+
+        if (end == std::string::npos)
+        {
+            if (eof)
+            {
+                if (lt != std::string::npos)
+                {
+                    m_error = "unterminated tag at end of file";
+                    return false;
+                }
+                EmitText(m_buffer.c_str() + pos, m_buffer.c_str() + m_buffer.size(), false, handler);
+                return true;
+            }
+            // Keep the unfinished text/tag and read the next chunk after it
+            m_buffer.erase(0, pos);
+            pos = 0;
+            eof = !Fill(in);
+            continue;
+        }
+
+        EmitText(m_buffer.c_str() + pos, m_buffer.c_str() + lt, false, handler);
+        if (cdata)
+        {
+            EmitText(m_buffer.c_str() + lt + 9, m_buffer.c_str() + end, true, handler);
+        }
+        else if (!skip && !ParseTag(m_buffer.c_str() + lt + 1, m_buffer.c_str() + end, handler))
+        {
+            return false;
+        }
+        pos = end + termLength;
+    }
+}
+
+inline void XmlSaxParser::EmitText(const char* begin,
+                                   const char* end,
+                                   bool raw,
+                                   XmlSaxHandler& handler)
+{
+    while (begin < end && IsSpace(*begin))
+    {
+        begin++;
+    }
+    while (end > begin && IsSpace(end[-1]))
+    {
+        end--;
+    }
+    if (begin == end)
+    {
+        return;
+    }
+    if (raw)
+    {
+        m_text.assign(begin, end);
+    }
+    else
+    {
+        Decode(begin, end, m_text);
+    }
+    handler.Characters(m_text);
+}
+
+inline void XmlSaxParser::Decode(const char* begin, const char* end, std::string& out)
+{
+    out.clear();
+    for (const char* p = begin; p < end; p++)
+    {
+        if (*p != '&')
+        {
+            out.push_back(*p);
+            continue;
+        }
+        const char* semi = std::find(p, end, ';');
+        std::string entity(p + 1, semi);
+        if (entity == "amp")
+            out.push_back('&');
+        else if (entity == "lt")
+            out.push_back('<');
+        else if (entity == "gt")
+            out.push_back('>');
+        else if (entity == "quot")
+            out.push_back('"');
+        else if (entity == "apos")
+            out.push_back('\'');
+        else if (!entity.empty() && entity[0] == '#')
+            out.push_back(static_cast<char>(entity[1] == 'x' ? std::strtol(entity.c_str() + 2, nullptr, 16)
+                                                             : std::strtol(entity.c_str() + 1, nullptr, 10)));
+        else
+            out.append(p, semi == end ? end : semi + 1);
+        p = semi == end ? end - 1 : semi;
+    }
+}
+
+inline bool XmlSaxParser::ParseTag(const char* p, const char* end, XmlSaxHandler& handler)
+{
+    if (p < end && *p == '/')
+    {
+        const char* nameEnd = ++p;
+        while (nameEnd < end && !IsSpace(*nameEnd))
+        {
+            nameEnd++;
+        }
+        m_name.assign(p, nameEnd);
+        handler.EndElement(m_name);
+        return true;
+    }
+
+    bool selfClosing = end > p && end[-1] == '/';
+    if (selfClosing)
+    {
+        end--;
+    }
+
+    const char* nameEnd = p;
+    while (nameEnd < end && !IsSpace(*nameEnd))
+    {
+        nameEnd++;
+    }
+    m_name.assign(p, nameEnd);
+
+    m_attributes.m_n = 0;
+    p = nameEnd;
+    while (true)
+    {
+        while (p < end && IsSpace(*p))
+        {
+            p++;
+        }
+        if (p >= end)
+        {
+            break;
+        }
+        const char* attrName = p;
+        while (p < end && *p != '=' && !IsSpace(*p))
+        {
+            p++;
+        }
+        const char* attrNameEnd = p;
+        while (p < end && (IsSpace(*p) || *p == '='))
+        {
+            p++;
+        }
+        if (p >= end || (*p != '"' && *p != '\''))
+        {
+            m_error = "malformed attribute in <" + m_name + ">";
+            return false;
+        }
+        char quote = *p++;
+        const char* value = p;
+        while (p < end && *p != quote)
+        {
+            p++;
+        }
+        if (m_attributes.m_n == m_attributes.m_items.size())
+        {
+            m_attributes.m_items.emplace_back();
+        }
+        auto& item = m_attributes.m_items[m_attributes.m_n++];
+        item.first.assign(attrName, attrNameEnd);
+        Decode(value, p, item.second);
+        p++;
+    }
+
+    handler.StartElement(m_name, m_attributes);
+    if (selfClosing)
+    {
+        handler.EndElement(m_name);
+    }
+    return true;
+}
+
+// ============================================================================
+// TOPOLOGY MODEL
+// ============================================================================
+
+struct TopologyNode
+{
+    std::string name;
+    double x;
+    double y;
+    bool hasPosition;
+    double latitude;
+    double longitude;
+    bool hasGeo;
+};
+
+struct TopologyLink
+{
+    uint32_t from;
+    uint32_t to;
+    std::string id;
+    uint64_t dataRate;  // bit/s, 0 = use default
+    double delay;       // seconds, < 0 = derive or use default
+};
+
+struct TopologyEvent
+{
+    double time;
+    std::string type;  // "link-down", "link-up", others are kept for the caller
+    int32_t link;      // index into the links, -1 if the event names none
+    std::string description;
+};
+
+// Parses "10Mbps", "1.5Gb/s", "100k", "45000000" (bit/s); 0 if unparsable
+inline uint64_t ParseTopologyRate(const std::string& text, const std::string& units = "")
+{
+    char* rest;
+    double value = std::strtod(text.c_str(), &rest);
+    if (rest == text.c_str() || value < 0)
+    {
+        return 0;
+    }
+    std::string unit = units.empty() ? std::string(rest) : units;
+    while (!unit.empty() && unit[0] == ' ')
+    {
+        unit.erase(0, 1);
+    }
+    double scale = 1;
+    if (!unit.empty())
+    {
+        switch (unit[0])
+        {
+        case 'k':
+        case 'K':
+            scale = 1e3;
+            break;
+        case 'M':
+            scale = 1e6;
+            break;
+        case 'G':
+            scale = 1e9;
+            break;
+        case 'T':
+            scale = 1e12;
+            break;
+        default:
+            break;
+        }
+        if (unit.find('B') != std::string::npos && unit.find("bps") == std::string::npos)
+        {
+            scale *= 8;  // bytes per second
+        }
+    }
+    return static_cast<uint64_t>(value * scale);
+}
+
+// Parses "5ms", "250us", "0.01s", "0.01" (seconds); < 0 if unparsable
+inline double ParseTopologyDelay(const std::string& text)
+{
+    char* rest;
+    double value = std::strtod(text.c_str(), &rest);
+    if (rest == text.c_str() || value < 0)
+    {
+        return -1;
+    }
+    std::string unit(rest);
+    if (unit == "ms")
+        return value * 1e-3;
+    if (unit == "us")
+        return value * 1e-6;
+    if (unit == "ns")
+        return value * 1e-9;
+    return value;
+}
+
+// ============================================================================
+// TOPOLOGY LOADER
+// ============================================================================
+
+class TopologyLoader : private XmlSaxHandler
+{
+public:
+    TopologyLoader();
+
+    // Detects the format from the root element; false on parse errors
+    bool Load(std::string filename);
+
+    void SetDefaultDataRate(DataRate rate) { m_defaultRate = rate.GetBitRate(); }
+    void SetDefaultDelay(Time delay) { m_defaultDelay = delay.GetSeconds(); }
+
+    const std::vector<TopologyNode>& GetNodes() const { return m_nodes; }
+    const std::vector<TopologyLink>& GetLinks() const { return m_links; }
+    const std::vector<TopologyEvent>& GetEvents() const { return m_events; }
+    std::string GetFormat() const { return m_format; }
+    double GetParseSeconds() const { return m_parseSeconds; }
+
+    // Effective rate/delay after geo derivation and defaults
+    uint64_t GetLinkDataRate(uint32_t link) const;
+    double GetLinkDelay(uint32_t link) const;
+
+    // Creates one ns-3 node per topology node and one p2p link per edge;
+    // the helper's other attributes (queues, MTU) apply to every link
+    NodeContainer Build(PointToPointHelper& p2p);
+    NetDeviceContainer GetLinkDevices(uint32_t link) const { return m_devices[link]; }
+
+    // One /30 per link starting at base; needs the Internet stack installed
+    void AssignAddresses(Ipv4Address base);
+    Ipv4InterfaceContainer GetLinkInterfaces(uint32_t link) const { return m_interfaces[link]; }
+
+    // Schedules the file's link-down/link-up events with Ipv4::SetDown/SetUp
+    uint32_t ScheduleEvents();
+
+    void ApplyAnimation(AnimationInterface& anim) const;
+    void PrintSummary(std::ostream& os) const;
+
+private:
+    void StartElement(const std::string& name, const XmlAttributes& attributes) override;
+    void EndElement(const std::string& name) override;
+    void Characters(const std::string& text) override;
+
+    void NetAnimElement(const std::string& name, const XmlAttributes& attributes);
+    void GraphMLStartElement(const std::string& name, const XmlAttributes& attributes);
+    void GraphMLData(const std::string& key, const std::string& value);
+    int32_t FindLink(uint32_t from, uint32_t to, const std::string& id) const;
+    uint32_t NodeIndex(const std::string& id);
+    void SetLinkState(uint32_t link, bool up);
+    void AddPacketLink(uint32_t from, uint32_t to);
+
+    std::string m_format;
+    std::vector<TopologyNode> m_nodes;
+    std::vector<TopologyLink> m_links;
+    std::vector<TopologyEvent> m_events;
+    std::unordered_map<std::string, uint32_t> m_nodeIndex;
+    double m_parseSeconds;
+
+    // GraphML parse state
+    struct GraphMLKey
+    {
+        std::string name;
+        bool forEdge;
+    };
+    std::unordered_map<std::string, GraphMLKey> m_keys;
+    int32_t m_currentNode;
+    int32_t m_currentEdge;
+    std::string m_currentKey;
+    std::string m_text;
+    std::string m_linkSpeed;        // Topology Zoo LinkSpeed + LinkSpeedUnits
+    std::string m_linkSpeedUnits;
+
+    // NetAnim packet records, for files without <link> elements
+    std::vector<std::pair<uint32_t, uint32_t>> m_packetLinks;
+    std::unordered_set<uint64_t> m_packetPairs;
+    int32_t m_packetFrom;
+
+    uint64_t m_defaultRate;
+    double m_defaultDelay;
+
+    NodeContainer m_container;
+    std::vector<NetDeviceContainer> m_devices;
+    std::vector<Ipv4InterfaceContainer> m_interfaces;
+};
+
+inline TopologyLoader::TopologyLoader()
+    : m_parseSeconds(0),
+      m_currentNode(-1),
+      m_currentEdge(-1),
+      m_packetFrom(-1),
+      m_defaultRate(100000000),
+      m_defaultDelay(0.002)
+{
+}
+
+inline bool TopologyLoader::Load(std::string filename)
+{
+    m_format.clear();
+    m_nodes.clear();
+    m_links.clear();
+    m_events.clear();
+    m_nodeIndex.clear();
+    m_keys.clear();
+    m_packetLinks.clear();
+    m_packetPairs.clear();
+    m_packetFrom = -1;
+
+    auto start = std::chrono::steady_clock::now();
+    XmlSaxParser parser;
+    bool ok = parser.ParseFile(filename, *this);
+    m_parseSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ok)
+    {
+        std::cerr << "TopologyLoader: " << filename << ": " << parser.GetError() << "\n";
+        return false;
+    }
+    if (m_format.empty())
+    {
+        std::cerr << "TopologyLoader: " << filename << ": unknown root element\n";
+        return false;
+    }
+    if (m_links.empty() && !m_packetLinks.empty())
+    {
+        for (const auto& pair : m_packetLinks)
+        {
+            m_links.push_back({pair.first, pair.second, "", 0, -1});
+        }
+        std::cerr << "TopologyLoader: " << filename << ": no links, inferred " << m_links.size()
+                  << " from packet end points (intermediate hops are not recorded)\n";
+    }
+    else if (m_links.empty())
+    {
+        std::cerr << "TopologyLoader: " << filename << ": no links found, only nodes\n";
+    }
+    return true;
+}
+
+inline uint32_t TopologyLoader::NodeIndex(const std::string& id)
+{
+    auto result = m_nodeIndex.emplace(id, m_nodes.size());
+    if (result.second)
+    {
+        m_nodes.push_back({id, 0, 0, false, 0, 0, false});
+    }
+    return result.first->second;
+}
+
+inline void TopologyLoader::StartElement(const std::string& name, const XmlAttributes& attributes)
+{
+    if (m_format.empty())
+    {
+        if (name == "ns3-animation" || name == "anim")
+        {
+            m_format = "netanim";
+        }
+        else if (name == "graphml")
+        {
+            m_format = "graphml";
+        }
+        return;
+    }
+    m_text.clear();
+    if (m_format == "netanim")
+    {
+        NetAnimElement(name, attributes);
+    }
+    else
+    {
+        GraphMLStartElement(name, attributes);
+    }
+}
+
+inline void TopologyLoader::NetAnimElement(const std::string& name, const XmlAttributes& attributes)
+{
+    const std::string* v;
+    if (name == "node" && (v = attributes.Find("id")))
+    {
+        TopologyNode& node = m_nodes[NodeIndex(*v)];
+        if ((v = attributes.Find("description")))
+        {
+            node.name = *v;
+        }
+        if ((v = attributes.Find("location")))
+        {
+            node.hasPosition = std::sscanf(v->c_str(), "%lf,%lf", &node.x, &node.y) == 2;
+        }
+        // NetAnim trace files use locX/locY
+        if ((v = attributes.Find("locX")))
+        {
+            node.x = std::atof(v->c_str());
+            node.hasPosition = true;
+        }
+        if ((v = attributes.Find("locY")))
+        {
+            node.y = std::atof(v->c_str());
+        }
+    }
+    else if (name == "link" && attributes.Find("fromId") && attributes.Find("toId"))
+    {
+        TopologyLink link{NodeIndex(*attributes.Find("fromId")),
+                          NodeIndex(*attributes.Find("toId")),
+                          "",
+                          0,
+                          -1};
+        if ((v = attributes.Find("id")))
+        {
+            link.id = *v;
+        }
+        if ((v = attributes.Find("dataRate")))
+        {
+            link.dataRate = ParseTopologyRate(*v);
+        }
+        if ((v = attributes.Find("delay")))
+        {
+            link.delay = ParseTopologyDelay(*v);
+        }
+        m_links.push_back(link);
+    }
+    else if (name == "p" && attributes.Find("fId") && attributes.Find("tId"))
+    {
+        AddPacketLink(NodeIndex(*attributes.Find("fId")), NodeIndex(*attributes.Find("tId")));
+    }
+    else if (name == "packet")
+    {
+        m_packetFrom = -1;
+    }
+    else if (name == "tx" && (v = attributes.Find("nodeId")))
+    {
+        m_packetFrom = NodeIndex(*v);
+    }
+    else if (name == "rx" && (v = attributes.Find("nodeId")) && m_packetFrom >= 0)
+    {
+        AddPacketLink(m_packetFrom, NodeIndex(*v));
+    }
+    else if (name == "event" && (v = attributes.Find("time")))
+    {
+        TopologyEvent event{std::atof(v->c_str()), "", -1, ""};
+        if ((v = attributes.Find("type")))
+        {
+            event.type = *v;
+        }
+        if ((v = attributes.Find("description")))
+        {
+            event.description = *v;
+        }
+        const std::string* from = attributes.Find("fromId");
+        const std::string* to = attributes.Find("toId");
+        if (from && to)
+        {
+            const std::string* id = attributes.Find("id");
+            event.link = FindLink(NodeIndex(*from), NodeIndex(*to), id ? *id : "");
+        }
+        m_events.push_back(event);
+    }
+}
+
+inline void TopologyLoader::AddPacketLink(uint32_t from, uint32_t to)
+{
+    if (from == to)
+    {
+        return;
+    }
+    uint64_t key = (uint64_t(std::min(from, to)) << 32) | std::max(from, to);
+    if (m_packetPairs.insert(key).second)
+    {
+        m_packetLinks.push_back({from, to});
+    }
+}
+
+inline void TopologyLoader::GraphMLStartElement(const std::string& name,
+                                                const XmlAttributes& attributes)
+{
+    const std::string* v;
+    if (name == "key" && (v = attributes.Find("id")))
+    {
+        const std::string* attrName = attributes.Find("attr.name");
+        const std::string* forWhat = attributes.Find("for");
+        m_keys[*v] = {attrName ? *attrName : *v, forWhat && *forWhat == "edge"};
+    }
+    else if (name == "node" && (v = attributes.Find("id")))
+    {
+        m_currentNode = NodeIndex(*v);
+    }
+    else if (name == "edge" && attributes.Find("source") && attributes.Find("target"))
+    {
+        m_currentEdge = m_links.size();
+        m_links.push_back({NodeIndex(*attributes.Find("source")),
+                           NodeIndex(*attributes.Find("target")),
+                           attributes.Find("id") ? *attributes.Find("id") : "",
+                           0,
+                           -1});
+        m_linkSpeed.clear();
+        m_linkSpeedUnits.clear();
+    }
+    else if (name == "data" && (v = attributes.Find("key")))
+    {
+        m_currentKey = *v;
+    }
+}
+
+inline void TopologyLoader::Characters(const std::string& text)
+{
+    m_text += text;
+}
+
+inline void TopologyLoader::EndElement(const std::string& name)
+{
+    if (m_format != "graphml")
+    {
+        return;
+    }
+    if (name == "data")
+    {
+        GraphMLData(m_currentKey, m_text);
+        m_currentKey.clear();
+    }
+    else if (name == "node")
+    {
+        m_currentNode = -1;
+    }
+    else if (name == "edge")
+    {
+        TopologyLink& link = m_links[m_currentEdge];
+        if (link.dataRate == 0 && !m_linkSpeed.empty())
+        {
+            link.dataRate = ParseTopologyRate(m_linkSpeed, m_linkSpeedUnits);
+        }
+        m_currentEdge = -1;
+    }
+    m_text.clear();
+}
+
+inline void TopologyLoader::GraphMLData(const std::string& key, const std::string& value)
+{
+    auto it = m_keys.find(key);
+    const std::string& attr = it != m_keys.end() ? it->second.name : key;
+
+    if (m_currentNode >= 0)
+    {
+        TopologyNode& node = m_nodes[m_currentNode];
+        if (attr == "label" || attr == "name")
+        {
+            node.name = value;
+        }
+        else if (attr == "Latitude" || attr == "latitude")
+        {
+            node.latitude = std::atof(value.c_str());
+            node.hasGeo = true;
+        }
+        else if (attr == "Longitude" || attr == "longitude")
+        {
+            node.longitude = std::atof(value.c_str());
+        }
+        else if (attr == "x")
+        {
+            node.x = std::atof(value.c_str());
+            node.hasPosition = true;
+        }
+        else if (attr == "y")
+        {
+            node.y = std::atof(value.c_str());
+        }
+    }
+    else if (m_currentEdge >= 0)
+    {
+        TopologyLink& link = m_links[m_currentEdge];
+        if (attr == "LinkSpeedRaw" || attr == "bandwidth" || attr == "capacity" || attr == "rate")
+        {
+            link.dataRate = ParseTopologyRate(value);
+        }
+        else if (attr == "LinkSpeed")
+        {
+            m_linkSpeed = value;
+        }
+        else if (attr == "LinkSpeedUnits")
+        {
+            m_linkSpeedUnits = value;
+        }
+        else if (attr == "delay" || attr == "latency")
+        {
+            link.delay = ParseTopologyDelay(value);
+        }
+    }
+}
+
+inline int32_t TopologyLoader::FindLink(uint32_t from, uint32_t to, const std::string& id) const
+{
+    for (uint32_t i = 0; i < m_links.size(); i++)
+    {
+        const TopologyLink& link = m_links[i];
+        bool ends = (link.from == from && link.to == to) || (link.from == to && link.to == from);
+        if (ends && (id.empty() || link.id == id))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+inline uint64_t TopologyLoader::GetLinkDataRate(uint32_t link) const
+{
+    return m_links[link].dataRate > 0 ? m_links[link].dataRate : m_defaultRate;
+}
+
+inline double TopologyLoader::GetLinkDelay(uint32_t link) const
+{
+    const TopologyLink& l = m_links[link];
+    if (l.delay >= 0)
+    {
+        return l.delay;
+    }
+    const TopologyNode& a = m_nodes[l.from];
+    const TopologyNode& b = m_nodes[l.to];
+    if (a.hasGeo && b.hasGeo)
+    {
+        // Haversine distance, propagation at 2e8 m/s (light in fibre)
+        const double rad = M_PI / 180.0;
+        double dLat = (b.latitude - a.latitude) * rad;
+        double dLon = (b.longitude - a.longitude) * rad;
+        double h = std::sin(dLat / 2) * std::sin(dLat / 2) +
+                   std::cos(a.latitude * rad) * std::cos(b.latitude * rad) * std::sin(dLon / 2) *
+                       std::sin(dLon / 2);
+        double meters = 2 * 6371000.0 * std::asin(std::sqrt(h));
+        return std::max(meters / 2e8, 1e-6);
+    }
+    return m_defaultDelay;
+}
+
+inline NodeContainer TopologyLoader::Build(PointToPointHelper& p2p)
+{
+    m_container = NodeContainer();
+    m_container.Create(m_nodes.size());
+    m_devices.assign(m_links.size(), NetDeviceContainer());
+    for (uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        if (!m_nodes[i].name.empty())
+        {
+            Names::Add(m_nodes[i].name + "#" + std::to_string(i), m_container.Get(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < m_links.size(); i++)
+    {
+        const TopologyLink& link = m_links[i];
+        if (link.from == link.to)
+        {
+            continue;
+        }
+        p2p.SetDeviceAttribute("DataRate", DataRateValue(DataRate(GetLinkDataRate(i))));
+        p2p.SetChannelAttribute("Delay", TimeValue(Seconds(GetLinkDelay(i))));
+        m_devices[i] = p2p.Install(m_container.Get(link.from), m_container.Get(link.to));
+    }
+    return m_container;
+}
+
+inline void TopologyLoader::AssignAddresses(Ipv4Address base)
+{
+    Ipv4AddressHelper address;
+    address.SetBase(base, "255.255.255.252");
+    m_interfaces.assign(m_links.size(), Ipv4InterfaceContainer());
+    for (uint32_t i = 0; i < m_links.size(); i++)
+    {
+        if (m_devices[i].GetN() == 0)
+        {
+            continue;
+        }
+        m_interfaces[i] = address.Assign(m_devices[i]);
+        address.NewNetwork();
+    }
+}
+
+inline void TopologyLoader::SetLinkState(uint32_t link, bool up)
+{
+    for (uint32_t end = 0; end < m_devices[link].GetN(); end++)
+    {
+        Ptr<NetDevice> device = m_devices[link].Get(end);
+        Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+        int32_t interface = ipv4 ? ipv4->GetInterfaceForDevice(device) : -1;
+        if (interface < 0)
+        {
+            continue;
+        }
+        if (up)
+        {
+            ipv4->SetUp(interface);
+        }
+        else
+        {
+            ipv4->SetDown(interface);
+        }
+    }
+}
+
+inline uint32_t TopologyLoader::ScheduleEvents()
+{
+    uint32_t scheduled = 0;
+    for (const TopologyEvent& event : m_events)
+    {
+        if (event.link < 0 || m_devices.empty() || (event.type != "link-down" && event.type != "link-up"))
+        {
+            continue;
+        }
+        Simulator::Schedule(Seconds(event.time),
+                            &TopologyLoader::SetLinkState,
+                            this,
+                            uint32_t(event.link),
+                            event.type == "link-up");
+        scheduled++;
+    }
+    return scheduled;
+}
+
+inline void TopologyLoader::ApplyAnimation(AnimationInterface& anim) const
+{
+    for (uint32_t i = 0; i < m_nodes.size() && i < m_container.GetN(); i++)
+    {
+        const TopologyNode& node = m_nodes[i];
+        if (node.hasPosition)
+        {
+            anim.SetConstantPosition(m_container.Get(i), node.x, node.y);
+        }
+        else if (node.hasGeo)
+        {
+            // Equirectangular projection onto NetAnim's canvas
+            anim.SetConstantPosition(m_container.Get(i), node.longitude + 180.0, 90.0 - node.latitude);
+        }
+        if (!node.name.empty())
+        {
+            anim.UpdateNodeDescription(m_container.Get(i), node.name);
+        }
+    }
+}
+
+inline void TopologyLoader::PrintSummary(std::ostream& os) const
+{
+    uint32_t withRate = 0;
+    uint32_t withDelay = 0;
+    uint32_t geo = 0;
+    for (const TopologyLink& link : m_links)
+    {
+        withRate += link.dataRate > 0;
+        withDelay += link.delay >= 0;
+    }
+    for (const TopologyNode& node : m_nodes)
+    {
+        geo += node.hasGeo;
+    }
+    os << "\n=== Topology (" << m_format << ") ===\n";
+    os << "Nodes: " << m_nodes.size() << " (" << geo << " geo-located)\n";
+    os << "Links: " << m_links.size() << " (" << withRate << " with rate, " << withDelay
+       << " with delay)\n";
+    os << "Events: " << m_events.size() << "\n";
+    os << "Parse time: " << m_parseSeconds * 1e3 << " ms\n";
+}
+
+} // namespace ns3
+
+#endif // TOPOLOGY_LOADER_H
@@ -0,0 +1,675 @@
+/*
+ * Flow-trace replay over memory-mapped input
+ * Drives a scenario with production traffic instead of synthetic
+ * OnOff/BulkSend/UdpEcho applications. The input is either
+ *   a flow log   one flow per line, comma separated:
+ *                  start,src,dst,sport,dport,proto,bytes,dscp[,duration]
+ *                start and duration in seconds (any epoch), proto tcp/udp
+ *                or 6/17, bytes of payload; lines that do not start with a
+ *                digit (headers, # comments) are skipped
+ *   a pcap file  classic libpcap, µs or ns timestamps, Ethernet (with
+ *                802.1Q), raw IPv4, PPP or Linux cooked link types
+ * detected by the pcap magic number.
+ *
+ * Replay semantics:
+ *   TCP flow-log entries open a TCP connection that sends the byte count
+ *   (closed loop, like BulkSend with MaxBytes); UDP entries send 1472-byte
+ *   datagrams spread over the duration, or paced at the UDP rate when the
+ *   line has none. Every pcap packet becomes one UDP datagram with the same
+ *   IP length (open loop). DSCP is kept; ports are not, since traffic goes
+ *   to the replay port, where every site runs a UDP and a TCP sink.
+ *
+ * Trace addresses map to sites by prefix ("hq=10.10.0.0/16,..."); addresses
+ * outside every prefix are spread over the sites by hash, so any trace
+ * replays on any topology. Flows within one site are skipped.
+ *
+ * The file is mapped read-only and parsed in place. Every window of sim
+ * time only the records starting in the next window are scheduled, and the
+ * pages already parsed are handed back to the kernel, so memory stays
+ * constant for multi-gigabyte traces. Records must be in start-time order
+ * (pcap files are); earlier records found later start at once and are
+ * counted as late.
+ *
+ * Usage (after addresses are assigned):
+ *   TraceReplay replay;
+ *   replay.AddSite("hq", hq, ifHqDc.GetAddress(0));
+ *   replay.AddSite("dc", dc, ifHqDc.GetAddress(1));
+ *   if (!replay.SetPrefixes("hq=10.10.0.0/16,dc=10.30.0.0/16") || !replay.Open("flows.csv")) ...
+ *   replay.Start(Seconds(2.0), Seconds(simTime));
+ *   ...
+ *   replay.PrintReport(std::cout);
+ */
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+class TraceReplay
+{
+public:
+    TraceReplay();
+    ~TraceReplay();
+
+    // A site sends from node and receives at address
+    void AddSite(const std::string& name, Ptr<Node> node, Ipv4Address address);
+    // "name=prefix/len,..." for sites added before; false on a bad spec
+    bool SetPrefixes(const std::string& spec);
+    // Map a flow log or pcap file; false if it cannot be read
+    bool Open(const std::string& filename);
+
+    // Sim time scheduled ahead of the clock (default 1 s)
+    void SetWindow(Time window) { m_window = window; }
+    // Pace of flow-log UDP flows without a duration (default 1 Mbps)
+    void SetUdpRate(DataRate rate) { m_udpRate = rate; }
+    void SetPort(uint16_t port) { m_port = port; }
+
+    // Install the sinks and replay the trace from start, its first record
+    // at start, until stop
+    void Start(Time start, Time stop);
+
+    void PrintReport(std::ostream& os) const;
+
+private:
+    struct Record
+    {
+        double time;         // s, trace clock
+        uint32_t source;
+        uint32_t destination;
+        uint8_t protocol;
+        uint8_t dscp;
+        uint64_t bytes;      // payload (flow log) or IP length (pcap)
+        double duration;     // s, 0 = paced at the UDP rate
+    };
+
+    struct Site
+    {
+        std::string name;
+        Ptr<Node> node;
+        Ipv4Address address;
+        std::vector<std::pair<uint32_t, uint32_t>> prefixes;  // network, mask
+        Ptr<Socket> udp;
+        ApplicationContainer sinks;
+        uint64_t recordsOut;
+        uint64_t bytesOut;
+    };
+
+    bool Next(Record& r);
+    bool NextFlowLog(Record& r);
+    bool NextPcap(Record& r);
+    bool ParseIpv4(const uint8_t* b, uint32_t n, Record& r) const;
+    uint32_t Read32(const uint8_t* p) const;
+    uint32_t SiteOf(uint32_t address) const;
+    void Refill();
+    void Release();
+    void StartRecord(Record r);
+    void SendDatagrams(uint32_t src, uint32_t dst, uint8_t dscp, uint64_t remaining, Time interval);
+    void TcpConnected(Ptr<Socket> socket);
+    void TcpFailed(Ptr<Socket> socket);
+    void TcpSend(Ptr<Socket> socket, uint32_t available);
+    void Unmap();
+
+    static const uint32_t DATAGRAM = 1472;   // UDP payload of a 1500-byte IP packet
+
+    std::vector<Site> m_sites;
+    std::string m_filename;
+    const uint8_t* m_base;
+    std::size_t m_length;
+    std::size_t m_cursor;
+    std::size_t m_released;     // bytes handed back to the kernel
+    bool m_pcap;
+    bool m_swapped;             // pcap written on the other endianness
+    bool m_nanoseconds;
+    uint32_t m_linkType;
+
+    Time m_window;
+    DataRate m_udpRate;
+    uint16_t m_port;
+    Time m_start;
+    Time m_stop;
+    double m_first;             // trace time replayed at m_start, -1 before the first record
+    double m_last;
+    Record m_lookahead;
+    bool m_haveLookahead;
+
+    // Bytes still to send per open TCP flow
+    std::unordered_map<Socket*, std::pair<uint32_t, uint64_t>> m_tcp;   // source site, bytes
+
+    uint64_t m_records;
+    uint64_t m_late;
+    uint64_t m_skippedLocal;
+    uint64_t m_skippedOther;    // unparseable lines, non-IPv4 packets
+    uint64_t m_datagrams;
+    uint64_t m_tcpFlows;
+    uint64_t m_tcpFailed;
+    uint64_t m_windowRecords;
+    uint64_t m_peakWindow;      // records scheduled in one window
+    std::size_t m_peakTcp;      // TCP flows open at once
+};
+
+inline TraceReplay::TraceReplay()
+    : m_base(nullptr),
+      m_length(0),
+      m_cursor(0),
+      m_released(0),
+      m_pcap(false),
+      m_swapped(false),
+      m_nanoseconds(false),
+      m_linkType(0),
+      m_window(Seconds(1)),
+      m_udpRate(DataRate("1Mbps")),
+      m_port(9999),
+      m_first(-1),
+      m_last(0),
+      m_haveLookahead(false),
+      m_records(0),
+      m_late(0),
+      m_skippedLocal(0),
+      m_skippedOther(0),
+      m_datagrams(0),
+      m_tcpFlows(0),
+      m_tcpFailed(0),
+      m_windowRecords(0),
+      m_peakWindow(0),
+      m_peakTcp(0)
+{
+}
+
+inline TraceReplay::~TraceReplay()
+{
+    Unmap();
+}
+
+inline void TraceReplay::AddSite(const std::string& name, Ptr<Node> node, Ipv4Address address)
+{
+    Site site;
+    site.name = name;
+    site.node = node;
+    site.address = address;
+    site.recordsOut = 0;
+    site.bytesOut = 0;
+    m_sites.push_back(site);
+}
+
+inline bool TraceReplay::SetPrefixes(const std::string& spec)
+{
+    std::istringstream list(spec);
+    for (std::string item; std::getline(list, item, ',');)
+    {
+        std::size_t eq = item.find('=');
+        std::size_t slash = item.find('/');
+        auto site = std::find_if(m_sites.begin(), m_sites.end(), [&](const Site& s) {
+            return eq != std::string::npos && s.name == item.substr(0, eq);
+        });
+        int length = slash != std::string::npos ? std::atoi(item.c_str() + slash + 1) : -1;
+        if (site == m_sites.end() || slash == std::string::npos || slash < eq || length < 0 || length > 32)
+        {
+            std::cerr << "TraceReplay: bad site prefix '" << item << "' (expected <site>=<network>/<length>)\n";
+            return false;
+        }
+        uint32_t mask = length == 0 ? 0 : ~uint32_t(0) << (32 - length);
+        Ipv4Address network(item.substr(eq + 1, slash - eq - 1).c_str());
+        site->prefixes.emplace_back(network.Get() & mask, mask);
+    }
+    return true;
+}
+
+inline bool TraceReplay::Open(const std::string& filename)
+{
+    Unmap();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        std::cerr << "TraceReplay: cannot read " << filename << "\n";
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "TraceReplay: mmap failed for " << filename << "\n";
+        return false;
+    }
+    ::madvise(base, st.st_size, MADV_SEQUENTIAL);
+    m_base = static_cast<const uint8_t*>(base);
+    m_length = st.st_size;
+    m_filename = filename;
+
+    uint32_t magic = m_length >= 24 ? *reinterpret_cast<const uint32_t*>(m_base) : 0;
+    m_pcap = magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 || magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+    m_swapped = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+    m_nanoseconds = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+    m_cursor = 0;
+    if (m_pcap)
+    {
+        m_linkType = Read32(m_base + 20) & 0xffff;
+        if (m_linkType != 1 && m_linkType != 9 && m_linkType != 101 && m_linkType != 113 && m_linkType != 228)
+        {
+            std::cerr << "TraceReplay: " << filename << " has unsupported pcap link type " << m_linkType
+                      << "\n";
+            Unmap();
+            return false;
+        }
+        m_cursor = 24;
+    }
+    return true;
+}
+
+inline void TraceReplay::Unmap()
+{
+    if (m_base)
+    {
+        ::munmap(const_cast<uint8_t*>(m_base), m_length);
+        m_base = nullptr;
+        m_length = 0;
+    }
+}
+
+inline uint32_t TraceReplay::Read32(const uint8_t* p) const
+{
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return m_swapped ? __builtin_bswap32(v) : v;
+}
+
+// ============================================================================
+// PARSING
+// ============================================================================
+
+inline bool TraceReplay::Next(Record& r)
+{
+    while (m_base && m_cursor < m_length)
+    {
+        if (m_pcap ? NextPcap(r) : NextFlowLog(r))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One line; false (and the cursor past the line) if it holds no flow
+inline bool TraceReplay::NextFlowLog(Record& r)
+{
+    const char* begin = reinterpret_cast<const char*>(m_base) + m_cursor;
+    const void* newline = std::memchr(begin, '\n', m_length - m_cursor);
+    std::size_t n = newline ? static_cast<const char*>(newline) - begin : m_length - m_cursor;
+    m_cursor += n + 1;
+
+    if (n == 0 || !(begin[0] >= '0' && begin[0] <= '9'))
+    {
+        return false;
+    }
+    // The mapping is not NUL-terminated, so fields are parsed from a copy
+    char line[512];
+    n = std::min(n, sizeof(line) - 1);
+    std::memcpy(line, begin, n);
+    line[n] = '\0';
+
+    char* fields[9] = {};
+    int count = 0;
+    for (char* p = line; p && count < 9; count++)
+    {
+        fields[count] = p;
+        p = std::strchr(p, ',');
+        if (p)
+        {
+            *p++ = '\0';
+        }
+    }
+    if (count < 8)
+    {
+        m_skippedOther++;
+        return false;
+    }
+
+    r.time = std::strtod(fields[0], nullptr);
+    r.source = Ipv4Address(fields[1]).Get();
+    r.destination = Ipv4Address(fields[2]).Get();
+    const char* proto = fields[5];
+    r.protocol = (std::strncmp(proto, "tcp", 3) == 0 || std::strncmp(proto, "TCP", 3) == 0) ? 6
+                 : (std::strncmp(proto, "udp", 3) == 0 || std::strncmp(proto, "UDP", 3) == 0)
+                     ? 17
+                     : std::atoi(proto);
+    r.bytes = std::strtoull(fields[6], nullptr, 10);
+    r.dscp = std::atoi(fields[7]) & 0x3f;
+    r.duration = count > 8 ? std::strtod(fields[8], nullptr) : 0;
+    if (r.protocol != 6 && r.protocol != 17)
+    {
+        m_skippedOther++;
+        return false;
+    }
+    return true;
+}
+
+// One pcap record; false for packets that are not IPv4
+inline bool TraceReplay::NextPcap(Record& r)
+{
+    if (m_cursor + 16 > m_length)
+    {
+        m_cursor = m_length;
+        return false;
+    }
+    const uint8_t* header = m_base + m_cursor;
+    uint32_t captured = Read32(header + 8);
+    if (m_cursor + 16 + captured > m_length)
+    {
+        m_cursor = m_length;   // truncated last record
+        return false;
+    }
+    m_cursor += 16 + captured;
+    r.time = Read32(header) + Read32(header + 4) * (m_nanoseconds ? 1e-9 : 1e-6);
+    r.duration = 0;
+
+    const uint8_t* b = header + 16;
+    uint32_t n = captured;
+    uint32_t skip = 0;
+    uint16_t etherType = 0x0800;
+    switch (m_linkType)
+    {
+    case 1:   // Ethernet
+        if (n >= 14)
+        {
+            etherType = (b[12] << 8) | b[13];
+            skip = 14;
+            if (etherType == 0x8100 && n >= 18)
+            {
+                etherType = (b[16] << 8) | b[17];
+                skip = 18;
+            }
+        }
+        break;
+    case 9:   // PPP
+        etherType = n >= 2 && b[0] == 0x00 && b[1] == 0x21 ? 0x0800 : 0;
+        skip = 2;
+        break;
+    case 113: // Linux cooked
+        etherType = n >= 16 ? (b[14] << 8) | b[15] : 0;
+        skip = 16;
+        break;
+    default:  // raw IPv4
+        break;
+    }
+    if (etherType != 0x0800 || n < skip || !ParseIpv4(b + skip, n - skip, r))
+    {
+        m_skippedOther++;
+        return false;
+    }
+    return true;
+}
+
+inline bool TraceReplay::ParseIpv4(const uint8_t* b, uint32_t n, Record& r) const
+{
+    if (n < 20 || (b[0] >> 4) != 4)
+    {
+        return false;
+    }
+    r.dscp = b[1] >> 2;
+    r.bytes = (b[2] << 8) | b[3];
+    r.protocol = b[9];
+    r.source = (uint32_t(b[12]) << 24) | (b[13] << 16) | (b[14] << 8) | b[15];
+    r.destination = (uint32_t(b[16]) << 24) | (b[17] << 16) | (b[18] << 8) | b[19];
+    return true;
+}
+
+// ============================================================================
+// SCHEDULING
+// ============================================================================
+
+inline uint32_t TraceReplay::SiteOf(uint32_t address) const
+{
+    for (uint32_t i = 0; i < m_sites.size(); i++)
+    {
+        for (const auto& prefix : m_sites[i].prefixes)
+        {
+            if ((address & prefix.second) == prefix.first)
+            {
+                return i;
+            }
+        }
+    }
+    return (address * 2654435761u >> 8) % m_sites.size();
+}
+
+inline void TraceReplay::Start(Time start, Time stop)
+{
+    if (!m_base || m_sites.empty())
+    {
+        std::cerr << "TraceReplay: Start needs an open trace and at least one site\n";
+        return;
+    }
+    m_start = start;
+    m_stop = stop;
+    for (Site& site : m_sites)
+    {
+        PacketSinkHelper udpSink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        PacketSinkHelper tcpSink("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        site.sinks.Add(udpSink.Install(site.node));
+        site.sinks.Add(tcpSink.Install(site.node));
+        site.sinks.Start(start);
+        site.sinks.Stop(stop);
+        site.udp = Socket::CreateSocket(site.node, UdpSocketFactory::GetTypeId());
+        site.udp->Bind();
+    }
+    Simulator::Schedule(start - Simulator::Now(), &TraceReplay::Refill, this);
+}
+
+// Schedule every record that starts before the end of the next window
+inline void TraceReplay::Refill()
+{
+    Time horizon = Simulator::Now() + m_window;
+    m_windowRecords = 0;
+    Record r;
+    while (m_haveLookahead || Next(r))
+    {
+        if (m_haveLookahead)
+        {
+            r = m_lookahead;
+            m_haveLookahead = false;
+        }
+        if (m_first < 0)
+        {
+            m_first = r.time;
+        }
+        Time at = m_start + Seconds(r.time - m_first);
+        if (at >= horizon)
+        {
+            m_lookahead = r;
+            m_haveLookahead = true;
+            break;
+        }
+        m_records++;
+        m_windowRecords++;
+        if (r.time < m_last)
+        {
+            m_late++;
+        }
+        m_last = std::max(m_last, r.time);
+        if (at >= m_stop)
+        {
+            continue;
+        }
+        Simulator::Schedule(std::max(Time(0), at - Simulator::Now()), &TraceReplay::StartRecord, this, r);
+    }
+    m_peakWindow = std::max(m_peakWindow, m_windowRecords);
+    Release();
+
+    if (m_haveLookahead && horizon < m_stop)
+    {
+        Simulator::Schedule(m_window, &TraceReplay::Refill, this);
+    }
+}
+
+// Drop the pages parsed so far from this process; they are re-read from
+// the file if ever touched again
+inline void TraceReplay::Release()
+{
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t upTo = m_cursor / page * page;
+    if (upTo > m_released)
+    {
+        ::madvise(const_cast<uint8_t*>(m_base) + m_released, upTo - m_released, MADV_DONTNEED);
+        m_released = upTo;
+    }
+}
+
+inline void TraceReplay::StartRecord(Record r)
+{
+    uint32_t src = SiteOf(r.source);
+    uint32_t dst = SiteOf(r.destination);
+    if (src == dst)
+    {
+        m_skippedLocal++;
+        return;
+    }
+    Site& site = m_sites[src];
+    site.recordsOut++;
+
+    if (m_pcap)
+    {
+        // Same IP length as captured: 20 bytes IPv4 + 8 bytes UDP
+        SendDatagrams(src, dst, r.dscp, r.bytes > 28 ? r.bytes - 28 : 0, Time(0));
+        return;
+    }
+    if (r.protocol == 17)
+    {
+        uint64_t datagrams = std::max<uint64_t>(1, (r.bytes + DATAGRAM - 1) / DATAGRAM);
+        Time interval = r.duration > 0 ? Seconds(r.duration / datagrams)
+                                       : m_udpRate.CalculateBytesTxTime(DATAGRAM);
+        SendDatagrams(src, dst, r.dscp, r.bytes, interval);
+        return;
+    }
+
+    Ptr<Socket> socket = Socket::CreateSocket(site.node, TcpSocketFactory::GetTypeId());
+    socket->SetIpTos(r.dscp << 2);
+    socket->Bind();
+    socket->SetConnectCallback(MakeCallback(&TraceReplay::TcpConnected, this),
+                               MakeCallback(&TraceReplay::TcpFailed, this));
+    socket->SetSendCallback(MakeCallback(&TraceReplay::TcpSend, this));
+    socket->Connect(InetSocketAddress(m_sites[dst].address, m_port));
+    m_tcp[PeekPointer(socket)] = std::make_pair(src, r.bytes);
+    m_tcpFlows++;
+    m_peakTcp = std::max(m_peakTcp, m_tcp.size());
+}
+
+// One datagram now and, while bytes remain, the next one after interval;
+// a pcap packet (or a zero-byte flow) is a single datagram
+inline void TraceReplay::SendDatagrams(uint32_t src, uint32_t dst, uint8_t dscp, uint64_t remaining, Time interval)
+{
+    uint32_t size = uint32_t(std::min<uint64_t>(remaining, m_pcap ? 65507 : DATAGRAM));
+    Ptr<Packet> packet = Create<Packet>(size);
+    SocketIpTosTag tos;
+    tos.SetTos(dscp << 2);
+    packet->AddPacketTag(tos);
+    Site& site = m_sites[src];
+    site.udp->SendTo(packet, 0, InetSocketAddress(m_sites[dst].address, m_port));
+    site.bytesOut += size;
+    m_datagrams++;
+
+    remaining -= size;
+    if (remaining > 0 && Simulator::Now() + interval < m_stop)
+    {
+        Simulator::Schedule(interval, &TraceReplay::SendDatagrams, this, src, dst, dscp, remaining, interval);
+    }
+}
+
+inline void TraceReplay::TcpConnected(Ptr<Socket> socket)
+{
+    TcpSend(socket, socket->GetTxAvailable());
+}
+
+inline void TraceReplay::TcpFailed(Ptr<Socket> socket)
+{
+    m_tcpFailed++;
+    m_tcp.erase(PeekPointer(socket));
+}
+
+// Fill the send buffer until the flow's bytes are out, then close
+inline void TraceReplay::TcpSend(Ptr<Socket> socket, uint32_t available)
+{
+    auto it = m_tcp.find(PeekPointer(socket));
+    if (it == m_tcp.end())
+    {
+        return;
+    }
+    Site& site = m_sites[it->second.first];
+    uint64_t& remaining = it->second.second;
+    while (remaining > 0 && socket->GetTxAvailable() > 0)
+    {
+        uint32_t size = uint32_t(std::min<uint64_t>(remaining, socket->GetTxAvailable()));
+        int sent = socket->Send(Create<Packet>(size));
+        if (sent <= 0)
+        {
+            return;
+        }
+        remaining -= sent;
+        site.bytesOut += sent;
+    }
+    if (remaining == 0)
+    {
+        socket->Close();
+        m_tcp.erase(it);
+    }
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+inline void TraceReplay::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Trace Replay ===\n";
+    os << m_filename << " (" << (m_pcap ? "pcap" : "flow log") << ", " << m_length / (1024 * 1024)
+       << " MB): " << m_records << " records replayed";
+    if (m_first >= 0)
+    {
+        os << ", trace time " << std::fixed << std::setprecision(3) << m_first << " - " << m_last << " s";
+        os.unsetf(std::ios::floatfield);
+        os << std::setprecision(6);
+    }
+    os << "\n";
+    os << "  " << m_datagrams << " UDP datagrams, " << m_tcpFlows << " TCP flows (" << m_tcpFailed
+       << " failed to connect, " << m_tcp.size() << " unfinished)\n";
+    os << "  skipped: " << m_skippedLocal << " within one site, " << m_skippedOther
+       << " unparseable or not IPv4; " << m_late << " out of order\n";
+    os << "  peak " << m_peakWindow << " records scheduled per " << m_window.GetSeconds() << " s window, "
+       << m_peakTcp << " TCP flows open at once\n";
+    os << "  site          records   bytes out    bytes in\n";
+    for (const Site& site : m_sites)
+    {
+        uint64_t in = 0;
+        for (uint32_t i = 0; i < site.sinks.GetN(); i++)
+        {
+            in += DynamicCast<PacketSink>(site.sinks.Get(i))->GetTotalRx();
+        }
+        os << "  " << std::left << std::setw(10) << site.name << std::right << std::setw(11) << site.recordsOut
+           << std::setw(12) << site.bytesOut << std::setw(12) << in << "\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* TRACE_REPLAY_H */
@@ -0,0 +1,585 @@
+/*
+ * TWAMP-light active path measurement
+ * A TwampLightSender sends small timestamped UDP test packets at a fixed
+ * rate to a TwampLightReflector, which stamps its receive and transmit
+ * times and returns them (RFC 5357 TWAMP-light, without the control
+ * protocol). The sender keeps loss, round-trip and one-way delay, IPDV
+ * jitter, reordering, duplicate and late counters, both for the whole run
+ * and per measurement interval.
+ *
+ * The sender tracks outstanding packets in a fixed ring (Window attribute)
+ * instead of a map and expires them lazily, so each test packet costs two
+ * events (send, receive) and no allocation beyond the packet itself; all
+ * nodes share the simulator clock, so one-way delays are exact.
+ *
+ * Usage:
+ *   TwampLightHelper twamp;
+ *   twamp.SetAttribute("Interval", TimeValue(MilliSeconds(100)));
+ *   twamp.InstallReflector(nodes);
+ *   Ptr<TwampLightSender> probe = twamp.InstallSender(a, Ipv4Address("10.1.1.2"));
+ *   ...
+ *   TwampLightStats s = probe->TakeIntervalStats();
+ *   s.GetLoss(); s.GetMeanForwardDelay(); s.GetJitter();
+ */
+
+#ifndef TWAMP_LIGHT_H
+#define TWAMP_LIGHT_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// TEST PACKET HEADER
+// ============================================================================
+
+// Timestamps are simulator nanoseconds
+class TwampLightHeader : public Header
+{
+public:
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+
+    TwampLightHeader()
+        : m_seq(0),
+          m_senderTs(0),
+          m_receiveTs(0),
+          m_reflectorTs(0),
+          m_reflectorSeq(0)
+    {
+    }
+
+    uint32_t GetSerializedSize() const override { return 32; }
+    void Serialize(Buffer::Iterator i) const override;
+    uint32_t Deserialize(Buffer::Iterator i) override;
+    void Print(std::ostream& os) const override;
+
+    void SetSequence(uint32_t seq) { m_seq = seq; }
+    uint32_t GetSequence() const { return m_seq; }
+    void SetSenderTimestamp(int64_t ns) { m_senderTs = ns; }
+    int64_t GetSenderTimestamp() const { return m_senderTs; }
+    void SetReceiveTimestamp(int64_t ns) { m_receiveTs = ns; }
+    int64_t GetReceiveTimestamp() const { return m_receiveTs; }
+    void SetReflectorTimestamp(int64_t ns) { m_reflectorTs = ns; }
+    int64_t GetReflectorTimestamp() const { return m_reflectorTs; }
+    void SetReflectorSequence(uint32_t seq) { m_reflectorSeq = seq; }
+    uint32_t GetReflectorSequence() const { return m_reflectorSeq; }
+
+private:
+    uint32_t m_seq;
+    int64_t m_senderTs;
+    int64_t m_receiveTs;
+    int64_t m_reflectorTs;
+    uint32_t m_reflectorSeq;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TwampLightHeader);
+
+inline TypeId TwampLightHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::TwampLightHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Applications")
+                            .AddConstructor<TwampLightHeader>();
+    return tid;
+}
+
+inline void TwampLightHeader::Serialize(Buffer::Iterator i) const
+{
+    i.WriteHtonU32(m_seq);
+    i.WriteHtonU64(m_senderTs);
+    i.WriteHtonU64(m_receiveTs);
+    i.WriteHtonU64(m_reflectorTs);
+    i.WriteHtonU32(m_reflectorSeq);
+}
+
+inline uint32_t TwampLightHeader::Deserialize(Buffer::Iterator i)
+{
+    m_seq = i.ReadNtohU32();
+    m_senderTs = i.ReadNtohU64();
+    m_receiveTs = i.ReadNtohU64();
+    m_reflectorTs = i.ReadNtohU64();
+    m_reflectorSeq = i.ReadNtohU32();
+    return GetSerializedSize();
+}
+
+inline void TwampLightHeader::Print(std::ostream& os) const
+{
+    os << "seq=" << m_seq << " tx=" << m_senderTs << " rrx=" << m_receiveTs
+       << " rtx=" << m_reflectorTs << " rseq=" << m_reflectorSeq;
+}
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+struct TwampLightStats
+{
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t lost = 0;        // not back within Timeout
+    uint64_t late = 0;        // back after being counted lost
+    uint64_t reordered = 0;   // arrived after a higher sequence number
+    uint64_t duplicates = 0;
+    double rttSum = 0;        // seconds
+    double rttMin = 0;
+    double rttMax = 0;
+    double forwardSum = 0;    // sender -> reflector
+    double backwardSum = 0;   // reflector -> sender
+    double ipdvSum = 0;       // |difference of consecutive forward delays|
+    uint64_t ipdvSamples = 0;
+
+    double GetLoss() const { return received + lost > 0 ? double(lost) / (received + lost) : 0; }
+    double GetMeanRtt() const { return received > 0 ? rttSum / received : 0; }
+    double GetMeanForwardDelay() const { return received > 0 ? forwardSum / received : 0; }
+    double GetMeanBackwardDelay() const { return received > 0 ? backwardSum / received : 0; }
+    double GetJitter() const { return ipdvSamples > 0 ? ipdvSum / ipdvSamples : 0; }
+};
+
+// ============================================================================
+// REFLECTOR
+// ============================================================================
+
+class TwampLightReflector : public Application
+{
+public:
+    static TypeId GetTypeId();
+    TwampLightReflector();
+
+    uint64_t GetNReflected() const { return m_nReflected; }
+
+protected:
+    void DoDispose() override;
+
+private:
+    void StartApplication() override;
+    void StopApplication() override;
+    void HandleRead(Ptr<Socket> socket);
+
+    uint16_t m_port;
+    Ptr<Socket> m_socket;
+    uint32_t m_seq;
+    uint64_t m_nReflected;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TwampLightReflector);
+
+inline TypeId TwampLightReflector::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::TwampLightReflector")
+                            .SetParent<Application>()
+                            .SetGroupName("Applications")
+                            .AddConstructor<TwampLightReflector>()
+                            .AddAttribute("Port",
+                                          "UDP port to reflect test packets on",
+                                          UintegerValue(862),
+                                          MakeUintegerAccessor(&TwampLightReflector::m_port),
+                                          MakeUintegerChecker<uint16_t>());
+    return tid;
+}
+
+inline TwampLightReflector::TwampLightReflector()
+    : m_port(862),
+      m_seq(0),
+      m_nReflected(0)
+{
+}
+
+inline void TwampLightReflector::DoDispose()
+{
+    m_socket = 0;
+    Application::DoDispose();
+}
+
+inline void TwampLightReflector::StartApplication()
+{
+    if (!m_socket)
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    }
+    m_socket->SetRecvCallback(MakeCallback(&TwampLightReflector::HandleRead, this));
+}
+
+inline void TwampLightReflector::StopApplication()
+{
+    if (m_socket)
+    {
+        m_socket->Close();
+        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_socket = 0;
+    }
+}
+
+inline void TwampLightReflector::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom(from)))
+    {
+        TwampLightHeader header;
+        if (packet->GetSize() < header.GetSerializedSize())
+        {
+            continue;
+        }
+        packet->RemoveHeader(header);
+        header.SetReceiveTimestamp(Simulator::Now().GetNanoSeconds());
+        header.SetReflectorSequence(m_seq++);
+        header.SetReflectorTimestamp(Simulator::Now().GetNanoSeconds());
+        packet->AddHeader(header);
+        socket->SendTo(packet, 0, from);
+        m_nReflected++;
+    }
+}
+
+// ============================================================================
+// SENDER
+// ============================================================================
+
+class TwampLightSender : public Application
+{
+public:
+    static TypeId GetTypeId();
+    TwampLightSender();
+
+    void SetRemote(Ipv4Address address, uint16_t port = 862);
+    // Pin test packets to one outgoing device (e.g. one path of a multi-homed
+    // router); by default the routing table decides
+    void SetOutputDevice(Ptr<NetDevice> device) { m_device = device; }
+
+    // Counters for the whole run
+    TwampLightStats GetTotalStats();
+    // Counters since the previous call, then reset
+    TwampLightStats TakeIntervalStats();
+
+    // Signature of the Sample trace: one returned test packet
+    typedef void (*SampleTracedCallback)(uint32_t seq, Time rtt, Time forward, Time backward);
+
+protected:
+    void DoDispose() override;
+
+private:
+    enum SlotState
+    {
+        FREE,
+        PENDING,
+        RECEIVED,
+        LOST,
+    };
+
+    struct Slot
+    {
+        uint32_t seq;
+        int64_t sent;   // ns
+        uint8_t state;
+    };
+
+    void StartApplication() override;
+    void StopApplication() override;
+    void Send();
+    void HandleRead(Ptr<Socket> socket);
+    void Expire();
+    void CountLost();
+
+    Ipv4Address m_remote;
+    uint16_t m_port;
+    Time m_interval;
+    uint32_t m_packetSize;
+    Time m_timeout;
+    uint32_t m_window;
+    Ptr<NetDevice> m_device;
+
+    Ptr<Socket> m_socket;
+    EventId m_sendEvent;
+    std::vector<Slot> m_slots;
+    uint32_t m_nextSeq;
+    uint32_t m_expireSeq;      // oldest sequence not yet expired
+    uint32_t m_highestSeq;
+    bool m_anyReceived;
+    double m_lastForward;
+    bool m_haveLastForward;
+    TwampLightStats m_total;
+    TwampLightStats m_current;
+
+    TracedCallback<uint32_t, Time, Time, Time> m_sampleTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TwampLightSender);
+
+inline TypeId TwampLightSender::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::TwampLightSender")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<TwampLightSender>()
+            .AddAttribute("RemotePort",
+                          "UDP port of the reflector",
+                          UintegerValue(862),
+                          MakeUintegerAccessor(&TwampLightSender::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("Interval",
+                          "Time between test packets",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&TwampLightSender::m_interval),
+                          MakeTimeChecker())
+            .AddAttribute("PacketSize",
+                          "UDP payload size of a test packet (at least the 32-byte header)",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&TwampLightSender::m_packetSize),
+                          MakeUintegerChecker<uint32_t>(32))
+            .AddAttribute("Timeout",
+                          "A test packet not back after this long is counted lost",
+                          TimeValue(Seconds(1.0)),
+                          MakeTimeAccessor(&TwampLightSender::m_timeout),
+                          MakeTimeChecker())
+            .AddAttribute("Window",
+                          "Test packets tracked at once; must cover Timeout / Interval",
+                          UintegerValue(256),
+                          MakeUintegerAccessor(&TwampLightSender::m_window),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddTraceSource("Sample",
+                            "A test packet came back",
+                            MakeTraceSourceAccessor(&TwampLightSender::m_sampleTrace),
+                            "ns3::TwampLightSender::SampleTracedCallback");
+    return tid;
+}
+
+inline TwampLightSender::TwampLightSender()
+    : m_port(862),
+      m_interval(MilliSeconds(100)),
+      m_packetSize(64),
+      m_timeout(Seconds(1.0)),
+      m_window(256),
+      m_nextSeq(0),
+      m_expireSeq(0),
+      m_highestSeq(0),
+      m_anyReceived(false),
+      m_lastForward(0),
+      m_haveLastForward(false)
+{
+}
+
+inline void TwampLightSender::DoDispose()
+{
+    m_socket = 0;
+    m_device = 0;
+    Application::DoDispose();
+}
+
+inline void TwampLightSender::SetRemote(Ipv4Address address, uint16_t port)
+{
+    m_remote = address;
+    m_port = port;
+}
+
+inline void TwampLightSender::StartApplication()
+{
+    m_slots.assign(m_window, Slot{0, 0, FREE});
+    if (!m_socket)
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+        if (m_device)
+        {
+            m_socket->BindToNetDevice(m_device);
+        }
+        m_socket->Connect(InetSocketAddress(m_remote, m_port));
+    }
+    m_socket->SetRecvCallback(MakeCallback(&TwampLightSender::HandleRead, this));
+    Send();
+}
+
+inline void TwampLightSender::StopApplication()
+{
+    Simulator::Cancel(m_sendEvent);
+    if (m_socket)
+    {
+        m_socket->Close();
+        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_socket = 0;
+    }
+}
+
+inline void TwampLightSender::Send()
+{
+    Expire();
+    Slot& slot = m_slots[m_nextSeq % m_window];
+    if (slot.state == PENDING)
+    {
+        // Window smaller than Timeout / Interval: give up on the oldest one
+        slot.state = LOST;
+        CountLost();
+    }
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    slot = {m_nextSeq, now, PENDING};
+
+    TwampLightHeader header;
+    header.SetSequence(m_nextSeq);
+    header.SetSenderTimestamp(now);
+    Ptr<Packet> packet = Create<Packet>(m_packetSize - header.GetSerializedSize());
+    packet->AddHeader(header);
+    m_socket->Send(packet);
+
+    m_nextSeq++;
+    m_total.sent++;
+    m_current.sent++;
+    m_sendEvent = Simulator::Schedule(m_interval, &TwampLightSender::Send, this);
+}
+
+inline void TwampLightSender::CountLost()
+{
+    m_total.lost++;
+    m_current.lost++;
+}
+
+inline void TwampLightSender::Expire()
+{
+    int64_t deadline = (Simulator::Now() - m_timeout).GetNanoSeconds();
+    while (m_expireSeq != m_nextSeq)
+    {
+        Slot& slot = m_slots[m_expireSeq % m_window];
+        if (slot.seq == m_expireSeq && slot.state == PENDING)
+        {
+            if (slot.sent > deadline)
+            {
+                break;
+            }
+            slot.state = LOST;
+            CountLost();
+        }
+        m_expireSeq++;
+    }
+}
+
+inline void TwampLightSender::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        TwampLightHeader header;
+        if (packet->GetSize() < header.GetSerializedSize())
+        {
+            continue;
+        }
+        packet->RemoveHeader(header);
+        uint32_t seq = header.GetSequence();
+        Slot& slot = m_slots[seq % m_window];
+        if (slot.seq != seq || slot.state == LOST || slot.state == FREE)
+        {
+            m_total.late++;
+            m_current.late++;
+            continue;
+        }
+        if (slot.state == RECEIVED)
+        {
+            m_total.duplicates++;
+            m_current.duplicates++;
+            continue;
+        }
+        slot.state = RECEIVED;
+
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        double rtt = (now - slot.sent) * 1e-9;
+        double forward = (header.GetReceiveTimestamp() - header.GetSenderTimestamp()) * 1e-9;
+        double backward = (now - header.GetReflectorTimestamp()) * 1e-9;
+        bool reordered = m_anyReceived && seq < m_highestSeq;
+        if (!m_anyReceived || seq > m_highestSeq)
+        {
+            m_highestSeq = seq;
+        }
+        m_anyReceived = true;
+
+        for (TwampLightStats* s : {&m_total, &m_current})
+        {
+            s->rttMin = s->received == 0 ? rtt : std::min(s->rttMin, rtt);
+            s->rttMax = s->received == 0 ? rtt : std::max(s->rttMax, rtt);
+            s->received++;
+            s->reordered += reordered ? 1 : 0;
+            s->rttSum += rtt;
+            s->forwardSum += forward;
+            s->backwardSum += backward;
+            if (m_haveLastForward)
+            {
+                s->ipdvSum += std::fabs(forward - m_lastForward);
+                s->ipdvSamples++;
+            }
+        }
+        m_lastForward = forward;
+        m_haveLastForward = true;
+        m_sampleTrace(seq, Seconds(rtt), Seconds(forward), Seconds(backward));
+    }
+}
+
+inline TwampLightStats TwampLightSender::GetTotalStats()
+{
+    if (!m_slots.empty())
+    {
+        Expire();
+    }
+    return m_total;
+}
+
+inline TwampLightStats TwampLightSender::TakeIntervalStats()
+{
+    if (!m_slots.empty())
+    {
+        Expire();
+    }
+    TwampLightStats s = m_current;
+    m_current = TwampLightStats();
+    return s;
+}
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+class TwampLightHelper
+{
+public:
+    TwampLightHelper() { m_factory.SetTypeId(TwampLightSender::GetTypeId()); }
+
+    // Sender attributes (Interval, PacketSize, Timeout, Window, RemotePort)
+    void SetAttribute(std::string name, const AttributeValue& value) { m_factory.Set(name, value); }
+
+    ApplicationContainer InstallReflector(NodeContainer nodes, uint16_t port = 862) const
+    {
+        ApplicationContainer apps;
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Ptr<TwampLightReflector> reflector = CreateObject<TwampLightReflector>();
+            reflector->SetAttribute("Port", UintegerValue(port));
+            nodes.Get(i)->AddApplication(reflector);
+            apps.Add(reflector);
+        }
+        return apps;
+    }
+
+    Ptr<TwampLightSender> InstallSender(Ptr<Node> node,
+                                        Ipv4Address remote,
+                                        Ptr<NetDevice> device = 0) const
+    {
+        Ptr<TwampLightSender> sender = m_factory.Create<TwampLightSender>();
+        UintegerValue port;
+        sender->GetAttribute("RemotePort", port);
+        sender->SetRemote(remote, port.Get());
+        sender->SetOutputDevice(device);
+        node->AddApplication(sender);
+        return sender;
+    }
+
+private:
+    ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* TWAMP_LIGHT_H */
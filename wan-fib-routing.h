@@ -0,0 +1,1135 @@
+/*
+ * Longest-prefix-match FIB for large static route tables
+ * Ipv4FibRouting keeps its routes in a DIR-24-8 table (one 2^24 first-level
+ * array plus 256-entry second-level groups for prefixes longer than /24), so
+ * a lookup costs at most two memory reads regardless of table size.
+ * WAN edge routers can carry full-table-sized route sets (100k-800k prefixes).
+ *
+ * Usage: put it ahead of static routing in an Ipv4ListRouting
+ *   Ipv4FibRoutingHelper fibHelper;
+ *   Ipv4StaticRoutingHelper staticHelper;
+ *   Ipv4ListRoutingHelper list;
+ *   list.Add(fibHelper, 10);
+ *   list.Add(staticHelper, 0);
+ *   stack.SetRoutingHelper(list);
+ *   ...
+ *   fibHelper.GetFibRouting(ipv4)->LoadRoutes("edge-routes.txt");
+ */
+
+#ifndef WAN_FIB_ROUTING_H
+#define WAN_FIB_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// DIR-24-8 TABLE
+// ============================================================================
+
+// Maps prefixes to 24-bit next-hop indices. Below DirectTableThreshold
+// prefixes the table probes one hash map per prefix length in use; above it
+// the 64 MB first-level array is allocated, so small routers stay cheap.
+class Dir248Fib
+{
+public:
+    static const uint32_t NO_ROUTE = 0xffffffff;
+
+    struct Prefix
+    {
+        uint32_t prefix;
+        uint8_t length;
+        uint32_t nextHop;
+    };
+
+    Dir248Fib();
+
+    void SetDirectTableThreshold(uint32_t prefixes) { m_threshold = prefixes; }
+    uint32_t GetDirectTableThreshold() const { return m_threshold; }
+
+    // Insert or replace one prefix
+    void Insert(uint32_t prefix, uint8_t length, uint32_t nextHop);
+    // Remove one prefix; cells fall back to the longest covering prefix
+    bool Remove(uint32_t prefix, uint8_t length);
+    // Replace the whole table (sorted by length in O(n), then block-filled)
+    void Build(const std::vector<Prefix>& prefixes);
+    void Clear();
+
+    uint32_t Lookup(uint32_t address) const;
+    uint32_t GetNPrefixes() const { return m_nPrefixes; }
+    bool IsDirect() const { return !m_tbl24.empty(); }
+    std::size_t GetMemoryUsage() const;
+
+private:
+    // Entry layout: valid(1) extended(1) depth(6) value(24)
+    static const uint32_t VALID = 0x80000000;
+    static const uint32_t EXTENDED = 0x40000000;
+    static const uint32_t DEPTH_SHIFT = 24;
+    static const uint32_t VALUE_MASK = 0x00ffffff;
+    static const uint32_t TBL24_SIZE = 1u << 24;
+
+    static uint32_t MakeEntry(uint8_t depth, uint32_t value)
+    {
+        return VALID | (uint32_t(depth) << DEPTH_SHIFT) | value;
+    }
+
+    static uint8_t Depth(uint32_t entry) { return (entry >> DEPTH_SHIFT) & 0x3f; }
+
+    static bool Replaceable(uint32_t entry, uint8_t length)
+    {
+        return !(entry & VALID) || Depth(entry) <= length;
+    }
+
+    static uint32_t Mask(uint8_t length) { return length == 0 ? 0 : 0xffffffffu << (32 - length); }
+
+    void CountLength(uint8_t length, int delta);
+    void AllocateDirect();
+    void Install(uint32_t prefix, uint8_t length, uint32_t nextHop);
+    uint32_t AllocateGroup(uint32_t fill);
+    void TryCollapse(uint32_t index);
+    bool FindCovering(uint32_t prefix, uint8_t length, uint8_t& depth, uint32_t& nextHop) const;
+
+    uint32_t m_threshold;
+    uint32_t m_nPrefixes;
+    std::vector<uint32_t> m_tbl24;
+    std::vector<uint32_t> m_tbl8;
+    std::vector<uint32_t> m_freeGroups;
+    std::vector<std::unordered_map<uint32_t, uint32_t>> m_rules; // per prefix length
+    uint32_t m_lengthCount[33];
+    std::vector<uint8_t> m_lengths; // lengths in use, longest first
+};
+
+inline Dir248Fib::Dir248Fib()
+    : m_threshold(1024),
+      m_nPrefixes(0),
+      m_rules(33)
+{
+    std::fill(m_lengthCount, m_lengthCount + 33, 0);
+}
+
+inline uint32_t Dir248Fib::Lookup(uint32_t address) const
+{
+    if (!m_tbl24.empty())
+    {
+        uint32_t entry = m_tbl24[address >> 8];
+        if (entry & EXTENDED)
+        {
+            entry = m_tbl8[((entry & VALUE_MASK) << 8) | (address & 0xff)];
+        }
+        return (entry & VALID) ? (entry & VALUE_MASK) : NO_ROUTE;
+    }
+
+    for (uint8_t length : m_lengths)
+    {
+        auto it = m_rules[length].find(address & Mask(length));
+        if (it != m_rules[length].end())
+        {
+            return it->second;
+        }
+    }
+    return NO_ROUTE;
+}
+
+inline void Dir248Fib::CountLength(uint8_t length, int delta)
+{
+    m_lengthCount[length] += delta;
+    if (m_lengthCount[length] == 0 || (delta > 0 && m_lengthCount[length] == 1))
+    {
+        m_lengths.clear();
+        for (int l = 32; l >= 0; --l)
+        {
+            if (m_lengthCount[l] > 0)
+            {
+                m_lengths.push_back(l);
+            }
+        }
+    }
+}
+
+inline void Dir248Fib::Insert(uint32_t prefix, uint8_t length, uint32_t nextHop)
+{
+    NS_ASSERT(length <= 32 && nextHop <= VALUE_MASK);
+    prefix &= Mask(length);
+
+    auto result = m_rules[length].emplace(prefix, nextHop);
+    if (result.second)
+    {
+        m_nPrefixes++;
+        CountLength(length, 1);
+    }
+    else
+    {
+        result.first->second = nextHop;
+    }
+
+    if (!m_tbl24.empty())
+    {
+        Install(prefix, length, nextHop);
+    }
+    else if (m_nPrefixes > m_threshold)
+    {
+        AllocateDirect();
+    }
+}
+
+inline void Dir248Fib::Install(uint32_t prefix, uint8_t length, uint32_t nextHop)
+{
+    uint32_t entry = MakeEntry(length, nextHop);
+
+    if (length <= 24)
+    {
+        uint32_t first = prefix >> 8;
+        uint32_t last = first + (1u << (24 - length));
+        for (uint32_t i = first; i < last; ++i)
+        {
+            uint32_t current = m_tbl24[i];
+            if (current & EXTENDED)
+            {
+                uint32_t* group = &m_tbl8[(current & VALUE_MASK) << 8];
+                for (uint32_t j = 0; j < 256; ++j)
+                {
+                    if (Replaceable(group[j], length))
+                    {
+                        group[j] = entry;
+                    }
+                }
+            }
+            else if (Replaceable(current, length))
+            {
+                m_tbl24[i] = entry;
+            }
+        }
+        return;
+    }
+
+    uint32_t index = prefix >> 8;
+    uint32_t group;
+    if (m_tbl24[index] & EXTENDED)
+    {
+        group = m_tbl24[index] & VALUE_MASK;
+    }
+    else
+    {
+        // Fill the new group before publishing it, so lookups never see a hole
+        group = AllocateGroup(m_tbl24[index]);
+        m_tbl24[index] = VALID | EXTENDED | group;
+    }
+
+    uint32_t* cells = &m_tbl8[group << 8];
+    uint32_t first = prefix & 0xff;
+    uint32_t last = first + (1u << (32 - length));
+    for (uint32_t j = first; j < last; ++j)
+    {
+        if (Replaceable(cells[j], length))
+        {
+            cells[j] = entry;
+        }
+    }
+}
+
+inline bool Dir248Fib::Remove(uint32_t prefix, uint8_t length)
+{
+    prefix &= Mask(length);
+    auto it = m_rules[length].find(prefix);
+    if (it == m_rules[length].end())
+    {
+        return false;
+    }
+    m_rules[length].erase(it);
+    m_nPrefixes--;
+    CountLength(length, -1);
+
+    if (m_tbl24.empty())
+    {
+        return true;
+    }
+
+    uint8_t coverDepth = 0;
+    uint32_t coverHop = 0;
+    uint32_t replacement =
+        FindCovering(prefix, length, coverDepth, coverHop) ? MakeEntry(coverDepth, coverHop) : 0;
+
+    auto owned = [length](uint32_t entry) { return (entry & VALID) && Depth(entry) == length; };
+
+    if (length <= 24)
+    {
+        uint32_t first = prefix >> 8;
+        uint32_t last = first + (1u << (24 - length));
+        for (uint32_t i = first; i < last; ++i)
+        {
+            uint32_t current = m_tbl24[i];
+            if (current & EXTENDED)
+            {
+                uint32_t* group = &m_tbl8[(current & VALUE_MASK) << 8];
+                for (uint32_t j = 0; j < 256; ++j)
+                {
+                    if (owned(group[j]))
+                    {
+                        group[j] = replacement;
+                    }
+                }
+                TryCollapse(i);
+            }
+            else if (owned(current))
+            {
+                m_tbl24[i] = replacement;
+            }
+        }
+        return true;
+    }
+
+    uint32_t index = prefix >> 8;
+    NS_ASSERT(m_tbl24[index] & EXTENDED);
+    uint32_t* cells = &m_tbl8[(m_tbl24[index] & VALUE_MASK) << 8];
+    uint32_t first = prefix & 0xff;
+    uint32_t last = first + (1u << (32 - length));
+    for (uint32_t j = first; j < last; ++j)
+    {
+        if (owned(cells[j]))
+        {
+            cells[j] = replacement;
+        }
+    }
+    TryCollapse(index);
+    return true;
+}
+
+inline void Dir248Fib::Build(const std::vector<Prefix>& prefixes)
+{
+    Clear();
+
+    // Counting sort by length: shorter prefixes are written first and longer
+    // ones simply overwrite them, so no per-cell depth comparison is needed
+    std::vector<uint32_t> start(34, 0);
+    for (const Prefix& p : prefixes)
+    {
+        start[p.length + 1]++;
+    }
+    for (int l = 0; l < 33; ++l)
+    {
+        start[l + 1] += start[l];
+    }
+    std::vector<uint32_t> order(prefixes.size());
+    for (uint32_t i = 0; i < prefixes.size(); ++i)
+    {
+        order[start[prefixes[i].length]++] = i;
+    }
+
+    for (uint32_t i : order)
+    {
+        const Prefix& p = prefixes[i];
+        uint32_t prefix = p.prefix & Mask(p.length);
+        auto result = m_rules[p.length].emplace(prefix, p.nextHop);
+        if (result.second)
+        {
+            m_nPrefixes++;
+            CountLength(p.length, 1);
+        }
+        else
+        {
+            result.first->second = p.nextHop;
+        }
+    }
+
+    if (m_nPrefixes <= m_threshold)
+    {
+        return;
+    }
+
+    m_tbl24.assign(TBL24_SIZE, 0);
+    for (uint32_t i : order)
+    {
+        const Prefix& p = prefixes[i];
+        uint32_t prefix = p.prefix & Mask(p.length);
+        if (p.length <= 24)
+        {
+            uint32_t first = prefix >> 8;
+            std::fill(m_tbl24.begin() + first,
+                      m_tbl24.begin() + first + (1u << (24 - p.length)),
+                      MakeEntry(p.length, p.nextHop));
+        }
+        else
+        {
+            Install(prefix, p.length, p.nextHop);
+        }
+    }
+}
+
+inline void Dir248Fib::Clear()
+{
+    std::vector<uint32_t>().swap(m_tbl24);
+    std::vector<uint32_t>().swap(m_tbl8);
+    m_freeGroups.clear();
+    for (auto& rules : m_rules)
+    {
+        rules.clear();
+    }
+    std::fill(m_lengthCount, m_lengthCount + 33, 0);
+    m_lengths.clear();
+    m_nPrefixes = 0;
+}
+
+inline std::size_t Dir248Fib::GetMemoryUsage() const
+{
+    std::size_t bytes = (m_tbl24.capacity() + m_tbl8.capacity()) * sizeof(uint32_t);
+    for (const auto& rules : m_rules)
+    {
+        bytes += rules.bucket_count() * sizeof(void*) +
+                 rules.size() * (sizeof(std::pair<uint32_t, uint32_t>) + 2 * sizeof(void*));
+    }
+    return bytes;
+}
+
+inline void Dir248Fib::AllocateDirect()
+{
+    m_tbl24.assign(TBL24_SIZE, 0);
+    for (uint8_t length = 0; length <= 32; ++length)
+    {
+        for (const auto& rule : m_rules[length])
+        {
+            Install(rule.first, length, rule.second);
+        }
+    }
+}
+
+inline uint32_t Dir248Fib::AllocateGroup(uint32_t fill)
+{
+    uint32_t group;
+    if (!m_freeGroups.empty())
+    {
+        group = m_freeGroups.back();
+        m_freeGroups.pop_back();
+    }
+    else
+    {
+        group = m_tbl8.size() >> 8;
+        NS_ABORT_MSG_IF(group > VALUE_MASK, "Dir248Fib: out of tbl8 groups");
+        m_tbl8.resize(m_tbl8.size() + 256);
+    }
+    std::fill(m_tbl8.begin() + (group << 8), m_tbl8.begin() + ((group + 1) << 8), fill);
+    return group;
+}
+
+inline void Dir248Fib::TryCollapse(uint32_t index)
+{
+    uint32_t group = m_tbl24[index] & VALUE_MASK;
+    const uint32_t* cells = &m_tbl8[group << 8];
+    uint32_t first = cells[0];
+    if ((first & VALID) && Depth(first) > 24)
+    {
+        return;
+    }
+    for (uint32_t j = 1; j < 256; ++j)
+    {
+        if (cells[j] != first)
+        {
+            return;
+        }
+    }
+    m_tbl24[index] = first;
+    m_freeGroups.push_back(group);
+}
+
+inline bool Dir248Fib::FindCovering(uint32_t prefix,
+                                    uint8_t length,
+                                    uint8_t& depth,
+                                    uint32_t& nextHop) const
+{
+    for (int l = int(length) - 1; l >= 0; --l)
+    {
+        if (m_lengthCount[l] == 0)
+        {
+            continue;
+        }
+        auto it = m_rules[l].find(prefix & Mask(l));
+        if (it != m_rules[l].end())
+        {
+            depth = l;
+            nextHop = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// ROUTING PROTOCOL
+// ============================================================================
+
+struct Ipv4FibRoute
+{
+    Ipv4Address network;
+    uint8_t prefixLength;
+    Ipv4Address gateway; // Ipv4Address::GetZero() for directly connected
+    uint32_t interface;
+    uint32_t metric;
+};
+
+// Several routes may share a prefix (e.g. primary and metric-10 backup); the
+// FIB holds the lowest-metric one whose interface is up and re-resolves the
+// prefix when interfaces go down or come back.
+class Ipv4FibRouting : public Ipv4RoutingProtocol
+{
+public:
+    static TypeId GetTypeId();
+    Ipv4FibRouting();
+    virtual ~Ipv4FibRouting();
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
+
+    void AddNetworkRouteTo(Ipv4Address network,
+                           Ipv4Mask networkMask,
+                           Ipv4Address nextHop,
+                           uint32_t interface,
+                           uint32_t metric = 0);
+    void AddNetworkRouteTo(Ipv4Address network,
+                           Ipv4Mask networkMask,
+                           uint32_t interface,
+                           uint32_t metric = 0);
+    void AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0);
+    void SetDefaultRoute(Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0);
+    // Removes every route to the prefix; returns how many were removed
+    uint32_t RemoveNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask);
+    // Replace every route to the prefix by one via nextHop. The FIB entry is
+    // overwritten in place: lookups see the old next hop or the new one,
+    // never a missing route (unlike Remove followed by Add)
+    void ReplaceNextHop(Ipv4Address network,
+                        Ipv4Mask networkMask,
+                        Ipv4Address nextHop,
+                        uint32_t interface,
+                        uint32_t metric = 0);
+
+    // Append many routes and rebuild the table once
+    void BulkInstall(const std::vector<Ipv4FibRoute>& routes);
+    // Text file, one route per line: "a.b.c.d/len gateway interface [metric]"
+    uint32_t LoadRoutes(std::string filename);
+
+    uint32_t GetNRoutes() const { return m_routes.size(); }
+    Ipv4RoutingTableEntry GetRoute(uint32_t i) const;
+    uint32_t GetMetric(uint32_t i) const { return m_routes[i].metric; }
+    std::size_t GetMemoryUsage() const;
+    // FIB version, incremented by every change to the forwarding table
+    uint64_t GetGeneration() const { return m_generation; }
+
+    void SetDirectTableThreshold(uint32_t prefixes) { m_fib.SetDirectTableThreshold(prefixes); }
+    uint32_t GetDirectTableThreshold() const { return m_fib.GetDirectTableThreshold(); }
+
+    // Signature of the RouteChange trace: the route now selected for a
+    // prefix, or installed == false when the prefix was withdrawn
+    typedef void (*RouteChangeTracedCallback)(const Ipv4FibRoute& route, bool installed);
+
+protected:
+    void DoDispose() override;
+
+private:
+    struct NextHop
+    {
+        Ipv4Address gateway;
+        uint32_t interface;
+    };
+
+    static uint64_t Key(uint32_t prefix, uint8_t length) { return (uint64_t(prefix) << 6) | length; }
+
+    static uint32_t Mask(uint8_t length) { return length == 0 ? 0 : 0xffffffffu << (32 - length); }
+
+    bool AddRoute(Ipv4FibRoute route);
+    void RemoveRouteAt(uint32_t pos);
+    bool IsUsable(const Ipv4FibRoute& route) const;
+    const Ipv4FibRoute* SelectBest(uint64_t key) const;
+    void Resolve(uint32_t prefix, uint8_t length);
+    void ResolveInterface(uint32_t interface);
+    uint32_t GetNextHopIndex(Ipv4Address gateway, uint32_t interface);
+    Ipv4Address SourceAddressSelection(uint32_t interface, Ipv4Address dest) const;
+    Ptr<Ipv4Route> MakeRoute(uint32_t nextHop, Ipv4Address dest) const;
+
+    Ptr<Ipv4> m_ipv4;
+    Dir248Fib m_fib;
+    std::vector<Ipv4FibRoute> m_routes;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_index; // prefix -> positions in m_routes
+    std::vector<NextHop> m_nextHops;
+    std::unordered_map<uint64_t, uint32_t> m_nextHopIndex;
+    uint64_t m_generation;
+
+    TracedCallback<const Ipv4FibRoute&, bool> m_routeChangeTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4FibRouting);
+
+inline TypeId Ipv4FibRouting::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::Ipv4FibRouting")
+            .SetParent<Ipv4RoutingProtocol>()
+            .SetGroupName("Internet")
+            .AddConstructor<Ipv4FibRouting>()
+            .AddAttribute("DirectTableThreshold",
+                          "Number of prefixes above which the DIR-24-8 arrays are allocated",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&Ipv4FibRouting::SetDirectTableThreshold,
+                                               &Ipv4FibRouting::GetDirectTableThreshold),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("RouteChange",
+                            "A prefix was re-resolved after a route or interface change "
+                            "(not fired by BulkInstall)",
+                            MakeTraceSourceAccessor(&Ipv4FibRouting::m_routeChangeTrace),
+                            "ns3::Ipv4FibRouting::RouteChangeTracedCallback");
+    return tid;
+}
+
+inline Ipv4FibRouting::Ipv4FibRouting()
+    : m_generation(0)
+{
+}
+
+inline Ipv4FibRouting::~Ipv4FibRouting()
+{
+}
+
+inline void Ipv4FibRouting::DoDispose()
+{
+    m_ipv4 = 0;
+    m_fib.Clear();
+    m_routes.clear();
+    m_index.clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline Ptr<Ipv4Route> Ipv4FibRouting::RouteOutput(Ptr<Packet> p,
+                                                  const Ipv4Header& header,
+                                                  Ptr<NetDevice> oif,
+                                                  Socket::SocketErrno& sockerr)
+{
+    Ipv4Address dest = header.GetDestination();
+    uint32_t nextHop = dest.IsMulticast() ? Dir248Fib::NO_ROUTE : m_fib.Lookup(dest.Get());
+    if (nextHop == Dir248Fib::NO_ROUTE ||
+        (oif && m_ipv4->GetNetDevice(m_nextHops[nextHop].interface) != oif))
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return 0;
+    }
+    sockerr = Socket::ERROR_NOTERROR;
+    return MakeRoute(nextHop, dest);
+}
+
+inline bool Ipv4FibRouting::RouteInput(Ptr<const Packet> p,
+                                       const Ipv4Header& header,
+                                       Ptr<const NetDevice> idev,
+                                       const UnicastForwardCallback& ucb,
+                                       const MulticastForwardCallback& mcb,
+                                       const LocalDeliverCallback& lcb,
+                                       const ErrorCallback& ecb)
+{
+    NS_ASSERT(m_ipv4->GetInterfaceForDevice(idev) >= 0);
+    uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+    Ipv4Address dest = header.GetDestination();
+
+    if (dest.IsMulticast())
+    {
+        return false;
+    }
+
+    if (m_ipv4->IsDestinationAddress(dest, iif))
+    {
+        if (!lcb.IsNull())
+        {
+            lcb(p, header, iif);
+            return true;
+        }
+        return false;
+    }
+
+    if (!m_ipv4->IsForwarding(iif))
+    {
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+
+    uint32_t nextHop = m_fib.Lookup(dest.Get());
+    if (nextHop == Dir248Fib::NO_ROUTE)
+    {
+        return false;
+    }
+    ucb(MakeRoute(nextHop, dest), p, header);
+    return true;
+}
+
+inline void Ipv4FibRouting::NotifyInterfaceUp(uint32_t interface)
+{
+    for (uint32_t j = 0; j < m_ipv4->GetNAddresses(interface); j++)
+    {
+        Ipv4InterfaceAddress address = m_ipv4->GetAddress(interface, j);
+        if (address.GetLocal() != Ipv4Address() && address.GetMask() != Ipv4Mask())
+        {
+            Ipv4FibRoute route = {address.GetLocal().CombineMask(address.GetMask()),
+                                  uint8_t(address.GetMask().GetPrefixLength()),
+                                  Ipv4Address::GetZero(),
+                                  interface,
+                                  0};
+            AddRoute(route);
+        }
+    }
+    ResolveInterface(interface);
+}
+
+inline void Ipv4FibRouting::NotifyInterfaceDown(uint32_t interface)
+{
+    // Routes through the interface stay configured but drop out of the FIB
+    ResolveInterface(interface);
+}
+
+inline void Ipv4FibRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    if (!m_ipv4->IsUp(interface))
+    {
+        return;
+    }
+    Ipv4FibRoute route = {address.GetLocal().CombineMask(address.GetMask()),
+                          uint8_t(address.GetMask().GetPrefixLength()),
+                          Ipv4Address::GetZero(),
+                          interface,
+                          0};
+    if (AddRoute(route))
+    {
+        Resolve(route.network.Get(), route.prefixLength);
+    }
+}
+
+inline void Ipv4FibRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    uint32_t prefix = address.GetLocal().CombineMask(address.GetMask()).Get();
+    uint8_t length = address.GetMask().GetPrefixLength();
+    auto it = m_index.find(Key(prefix, length));
+    if (it == m_index.end())
+    {
+        return;
+    }
+    for (uint32_t pos : it->second)
+    {
+        const Ipv4FibRoute& route = m_routes[pos];
+        if (route.interface == interface && route.gateway == Ipv4Address::GetZero())
+        {
+            RemoveRouteAt(pos);
+            break;
+        }
+    }
+    Resolve(prefix, length);
+}
+
+inline void Ipv4FibRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+    for (uint32_t i = 0; i < m_ipv4->GetNInterfaces(); i++)
+    {
+        if (m_ipv4->IsUp(i))
+        {
+            NotifyInterfaceUp(i);
+        }
+        else
+        {
+            NotifyInterfaceDown(i);
+        }
+    }
+}
+
+inline void Ipv4FibRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Now().As(unit)
+        << ", Ipv4FibRouting table (" << m_fib.GetNPrefixes() << " prefixes, "
+        << (m_fib.IsDirect() ? "DIR-24-8" : "hashed") << ")" << std::endl;
+    if (m_routes.empty())
+    {
+        return;
+    }
+    *os << "Destination         Gateway         Flags Metric Iface" << std::endl;
+    for (const Ipv4FibRoute& route : m_routes)
+    {
+        std::ostringstream dest;
+        dest << route.network << "/" << uint32_t(route.prefixLength);
+        std::ostringstream gw;
+        gw << route.gateway;
+        std::string flags = IsUsable(route) ? "U" : "";
+        if (route.gateway != Ipv4Address::GetZero())
+        {
+            flags += "G";
+        }
+        if (route.prefixLength == 32)
+        {
+            flags += "H";
+        }
+        *os << std::setiosflags(std::ios::left) << std::setw(20) << dest.str() << std::setw(16)
+            << gw.str() << std::setw(6) << flags << std::setw(7) << route.metric
+            << route.interface << std::endl;
+    }
+    *os << std::endl;
+}
+
+inline void Ipv4FibRouting::AddNetworkRouteTo(Ipv4Address network,
+                                              Ipv4Mask networkMask,
+                                              Ipv4Address nextHop,
+                                              uint32_t interface,
+                                              uint32_t metric)
+{
+    Ipv4FibRoute route = {network.CombineMask(networkMask),
+                          uint8_t(networkMask.GetPrefixLength()),
+                          nextHop,
+                          interface,
+                          metric};
+    if (AddRoute(route))
+    {
+        Resolve(route.network.Get(), route.prefixLength);
+    }
+}
+
+inline void Ipv4FibRouting::AddNetworkRouteTo(Ipv4Address network,
+                                              Ipv4Mask networkMask,
+                                              uint32_t interface,
+                                              uint32_t metric)
+{
+    AddNetworkRouteTo(network, networkMask, Ipv4Address::GetZero(), interface, metric);
+}
+
+inline void Ipv4FibRouting::AddHostRouteTo(Ipv4Address dest,
+                                           Ipv4Address nextHop,
+                                           uint32_t interface,
+                                           uint32_t metric)
+{
+    AddNetworkRouteTo(dest, Ipv4Mask::GetOnes(), nextHop, interface, metric);
+}
+
+inline void Ipv4FibRouting::SetDefaultRoute(Ipv4Address nextHop, uint32_t interface, uint32_t metric)
+{
+    AddNetworkRouteTo(Ipv4Address::GetZero(), Ipv4Mask::GetZero(), nextHop, interface, metric);
+}
+
+inline uint32_t Ipv4FibRouting::RemoveNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask)
+{
+    uint32_t prefix = network.CombineMask(networkMask).Get();
+    uint8_t length = networkMask.GetPrefixLength();
+    auto it = m_index.find(Key(prefix, length));
+    if (it == m_index.end())
+    {
+        return 0;
+    }
+
+    // Highest position first, so swap-with-last never moves one of ours
+    std::vector<uint32_t> positions = it->second;
+    std::sort(positions.rbegin(), positions.rend());
+    for (uint32_t pos : positions)
+    {
+        RemoveRouteAt(pos);
+    }
+    Resolve(prefix, length);
+    return positions.size();
+}
+
+inline void Ipv4FibRouting::ReplaceNextHop(Ipv4Address network,
+                                           Ipv4Mask networkMask,
+                                           Ipv4Address nextHop,
+                                           uint32_t interface,
+                                           uint32_t metric)
+{
+    uint32_t prefix = network.CombineMask(networkMask).Get();
+    uint8_t length = networkMask.GetPrefixLength();
+    auto it = m_index.find(Key(prefix, length));
+    if (it == m_index.end())
+    {
+        AddNetworkRouteTo(network, networkMask, nextHop, interface, metric);
+        return;
+    }
+
+    // Rewrite the lowest-positioned route and drop the others, highest
+    // first, so swap-with-last never moves the one being kept
+    std::vector<uint32_t> positions = it->second;
+    std::sort(positions.rbegin(), positions.rend());
+    uint32_t keep = positions.back();
+    positions.pop_back();
+    for (uint32_t pos : positions)
+    {
+        RemoveRouteAt(pos);
+    }
+    m_routes[keep].gateway = nextHop;
+    m_routes[keep].interface = interface;
+    m_routes[keep].metric = metric;
+    Resolve(prefix, length);
+}
+
+inline void Ipv4FibRouting::BulkInstall(const std::vector<Ipv4FibRoute>& routes)
+{
+    m_routes.reserve(m_routes.size() + routes.size());
+    for (const Ipv4FibRoute& route : routes)
+    {
+        AddRoute(route);
+    }
+
+    std::vector<Dir248Fib::Prefix> prefixes;
+    prefixes.reserve(m_index.size());
+    for (const auto& entry : m_index)
+    {
+        if (const Ipv4FibRoute* best = SelectBest(entry.first))
+        {
+            prefixes.push_back({uint32_t(entry.first >> 6),
+                                uint8_t(entry.first & 0x3f),
+                                GetNextHopIndex(best->gateway, best->interface)});
+        }
+    }
+    m_fib.Build(prefixes);
+    m_generation++;
+}
+
+inline uint32_t Ipv4FibRouting::LoadRoutes(std::string filename)
+{
+    std::ifstream in(filename);
+    NS_ABORT_MSG_UNLESS(in, "Ipv4FibRouting: cannot open route file " << filename);
+
+    std::vector<Ipv4FibRoute> routes;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        unsigned a, b, c, d, length, g0, g1, g2, g3, interface, metric = 0;
+        if (line.empty() || line[0] == '#' ||
+            std::sscanf(line.c_str(),
+                        "%u.%u.%u.%u/%u %u.%u.%u.%u %u %u",
+                        &a, &b, &c, &d, &length, &g0, &g1, &g2, &g3, &interface, &metric) < 10 ||
+            length > 32)
+        {
+            continue;
+        }
+        routes.push_back({Ipv4Address((a << 24) | (b << 16) | (c << 8) | d),
+                          uint8_t(length),
+                          Ipv4Address((g0 << 24) | (g1 << 16) | (g2 << 8) | g3),
+                          interface,
+                          metric});
+    }
+    BulkInstall(routes);
+    return routes.size();
+}
+
+inline Ipv4RoutingTableEntry Ipv4FibRouting::GetRoute(uint32_t i) const
+{
+    const Ipv4FibRoute& route = m_routes[i];
+    bool direct = route.gateway == Ipv4Address::GetZero();
+    if (route.prefixLength == 32)
+    {
+        return direct ? Ipv4RoutingTableEntry::CreateHostRouteTo(route.network, route.interface)
+                      : Ipv4RoutingTableEntry::CreateHostRouteTo(route.network,
+                                                                 route.gateway,
+                                                                 route.interface);
+    }
+    Ipv4Mask mask(Mask(route.prefixLength));
+    return direct ? Ipv4RoutingTableEntry::CreateNetworkRouteTo(route.network, mask, route.interface)
+                  : Ipv4RoutingTableEntry::CreateNetworkRouteTo(route.network,
+                                                                mask,
+                                                                route.gateway,
+                                                                route.interface);
+}
+
+inline std::size_t Ipv4FibRouting::GetMemoryUsage() const
+{
+    return m_fib.GetMemoryUsage() + m_routes.capacity() * sizeof(Ipv4FibRoute) +
+           m_index.size() * (sizeof(uint64_t) + sizeof(std::vector<uint32_t>) + sizeof(uint32_t) +
+                             2 * sizeof(void*)) +
+           m_nextHops.capacity() * sizeof(NextHop);
+}
+
+inline bool Ipv4FibRouting::AddRoute(Ipv4FibRoute route)
+{
+    route.network = Ipv4Address(route.network.Get() & Mask(route.prefixLength));
+    std::vector<uint32_t>& positions = m_index[Key(route.network.Get(), route.prefixLength)];
+    for (uint32_t pos : positions)
+    {
+        const Ipv4FibRoute& other = m_routes[pos];
+        if (other.gateway == route.gateway && other.interface == route.interface &&
+            other.metric == route.metric)
+        {
+            return false;
+        }
+    }
+    positions.push_back(m_routes.size());
+    m_routes.push_back(route);
+    return true;
+}
+
+inline void Ipv4FibRouting::RemoveRouteAt(uint32_t pos)
+{
+    uint64_t key = Key(m_routes[pos].network.Get(), m_routes[pos].prefixLength);
+    std::vector<uint32_t>& positions = m_index[key];
+    positions.erase(std::find(positions.begin(), positions.end(), pos));
+    if (positions.empty())
+    {
+        m_index.erase(key);
+    }
+
+    uint32_t last = m_routes.size() - 1;
+    if (pos != last)
+    {
+        m_routes[pos] = m_routes[last];
+        std::vector<uint32_t>& moved =
+            m_index[Key(m_routes[pos].network.Get(), m_routes[pos].prefixLength)];
+        *std::find(moved.begin(), moved.end(), last) = pos;
+    }
+    m_routes.pop_back();
+}
+
+inline bool Ipv4FibRouting::IsUsable(const Ipv4FibRoute& route) const
+{
+    return !m_ipv4 || (route.interface < m_ipv4->GetNInterfaces() && m_ipv4->IsUp(route.interface));
+}
+
+inline const Ipv4FibRoute* Ipv4FibRouting::SelectBest(uint64_t key) const
+{
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        return nullptr;
+    }
+    const Ipv4FibRoute* best = nullptr;
+    for (uint32_t pos : it->second)
+    {
+        const Ipv4FibRoute& route = m_routes[pos];
+        if (IsUsable(route) && (!best || route.metric < best->metric))
+        {
+            best = &route;
+        }
+    }
+    return best;
+}
+
+inline void Ipv4FibRouting::Resolve(uint32_t prefix, uint8_t length)
+{
+    m_generation++;
+    if (const Ipv4FibRoute* best = SelectBest(Key(prefix, length)))
+    {
+        m_fib.Insert(prefix, length, GetNextHopIndex(best->gateway, best->interface));
+        m_routeChangeTrace(*best, true);
+    }
+    else
+    {
+        m_fib.Remove(prefix, length);
+        m_routeChangeTrace({Ipv4Address(prefix), length, Ipv4Address::GetZero(), 0, 0}, false);
+    }
+}
+
+inline void Ipv4FibRouting::ResolveInterface(uint32_t interface)
+{
+    std::unordered_set<uint64_t> keys;
+    for (const Ipv4FibRoute& route : m_routes)
+    {
+        if (route.interface == interface)
+        {
+            keys.insert(Key(route.network.Get(), route.prefixLength));
+        }
+    }
+    for (uint64_t key : keys)
+    {
+        Resolve(uint32_t(key >> 6), uint8_t(key & 0x3f));
+    }
+}
+
+inline uint32_t Ipv4FibRouting::GetNextHopIndex(Ipv4Address gateway, uint32_t interface)
+{
+    uint64_t key = (uint64_t(gateway.Get()) << 32) | interface;
+    auto result = m_nextHopIndex.emplace(key, m_nextHops.size());
+    if (result.second)
+    {
+        m_nextHops.push_back({gateway, interface});
+    }
+    return result.first->second;
+}
+
+inline Ipv4Address Ipv4FibRouting::SourceAddressSelection(uint32_t interface, Ipv4Address dest) const
+{
+    if (m_ipv4->GetNAddresses(interface) == 1)
+    {
+        return m_ipv4->GetAddress(interface, 0).GetLocal();
+    }
+    for (uint32_t j = 0; j < m_ipv4->GetNAddresses(interface); j++)
+    {
+        Ipv4InterfaceAddress address = m_ipv4->GetAddress(interface, j);
+        if (address.GetLocal().CombineMask(address.GetMask()) == dest.CombineMask(address.GetMask()))
+        {
+            return address.GetLocal();
+        }
+    }
+    return m_ipv4->GetAddress(interface, 0).GetLocal();
+}
+
+inline Ptr<Ipv4Route> Ipv4FibRouting::MakeRoute(uint32_t nextHop, Ipv4Address dest) const
+{
+    const NextHop& hop = m_nextHops[nextHop];
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(dest);
+    route->SetGateway(hop.gateway);
+    route->SetSource(SourceAddressSelection(hop.interface, dest));
+    route->SetOutputDevice(m_ipv4->GetNetDevice(hop.interface));
+    return route;
+}
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+class Ipv4FibRoutingHelper : public Ipv4RoutingHelper
+{
+public:
+    Ipv4FibRoutingHelper()
+    {
+        m_factory.SetTypeId(Ipv4FibRouting::GetTypeId());
+    }
+
+    Ipv4FibRoutingHelper* Copy() const override
+    {
+        return new Ipv4FibRoutingHelper(*this);
+    }
+
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        return m_factory.Create<Ipv4FibRouting>();
+    }
+
+    void Set(std::string name, const AttributeValue& value)
+    {
+        m_factory.Set(name, value);
+    }
+
+    Ptr<Ipv4FibRouting> GetFibRouting(Ptr<Ipv4> ipv4) const
+    {
+        return Ipv4RoutingHelper::GetRouting<Ipv4FibRouting>(ipv4->GetRoutingProtocol());
+    }
+
+private:
+    ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* WAN_FIB_ROUTING_H */
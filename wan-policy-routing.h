@@ -0,0 +1,544 @@
+/*
+ * Policy-based routing on 5-tuple and DSCP
+ * Ipv4PolicyRouting forwards packets by rules matching source/destination
+ * prefix, protocol, source/destination port and DSCP (each field optional)
+ * to an explicit next hop. Packets no rule matches fall through to the next
+ * protocol of the Ipv4ListRouting, so it sits ahead of static routing.
+ *
+ * Rules are compiled into a tuple-space classifier: one hash table per
+ * distinct combination of (prefix lengths, which fields are wildcards), so a
+ * lookup costs one hash probe per tuple in use, independent of the number of
+ * rules. Tuples are probed in order of their best rule priority and the
+ * search stops once no remaining tuple can beat the current match.
+ *
+ * ReplaceNextHop re-points a rule in place: the compiled tables refer to
+ * rules by id, so nothing is recompiled and no packet can fall between an
+ * old and a new rule. Every change bumps the generation number.
+ *
+ * Ports are only known for forwarded packets: for locally originated
+ * packets RouteOutput runs before the transport header is attached, so only
+ * rules without port fields match there.
+ *
+ * Usage:
+ *   Ipv4PolicyRoutingHelper policyHelper;
+ *   Ptr<Ipv4PolicyRouting> pbr = policyHelper.Install(router);   // priority 10
+ *   Ipv4PolicyRule video;
+ *   video.protocol = 17;
+ *   video.dstPort = 4000;
+ *   video.interface = 1;
+ *   video.gateway = Ipv4Address("10.100.1.2");
+ *   pbr->AddRule(video);
+ */
+
+#ifndef WAN_POLICY_ROUTING_H
+#define WAN_POLICY_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// RULES
+// ============================================================================
+
+// Zero / negative fields are wildcards
+struct Ipv4PolicyRule
+{
+    Ipv4Address source = Ipv4Address::GetZero();
+    uint8_t sourceLength = 0;
+    Ipv4Address destination = Ipv4Address::GetZero();
+    uint8_t destinationLength = 0;
+    uint8_t protocol = 0;      // 6 = TCP, 17 = UDP
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    int16_t dscp = -1;         // 0-63
+    uint32_t priority = 0;     // higher wins; ties go to the older rule
+
+    uint32_t interface = 0;
+    Ipv4Address gateway = Ipv4Address::GetZero();
+};
+
+// ============================================================================
+// POLICY ROUTING PROTOCOL
+// ============================================================================
+
+class Ipv4PolicyRouting : public Ipv4RoutingProtocol
+{
+public:
+    static TypeId GetTypeId();
+    Ipv4PolicyRouting();
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override {}
+    void NotifyInterfaceDown(uint32_t interface) override {}
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
+    void SetIpv4(Ptr<Ipv4> ipv4) override { m_ipv4 = ipv4; }
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
+
+    // Returns a rule id, stable until the rule is removed
+    uint32_t AddRule(const Ipv4PolicyRule& rule);
+    bool RemoveRule(uint32_t id);
+    // Atomically move a rule to a new next hop
+    bool ReplaceNextHop(uint32_t id, uint32_t interface, Ipv4Address gateway);
+    void Clear();
+
+    uint32_t GetNRules() const { return m_nRules; }
+    uint32_t GetNTuples();
+    uint64_t GetHits(uint32_t id) const { return id < m_rules.size() ? m_rules[id].hits : 0; }
+    // Rule set version, incremented by every add, remove or replace
+    uint64_t GetGeneration() const { return m_generation; }
+
+    // Matching rule for a packet, or 0; exposed for benchmarks
+    const Ipv4PolicyRule* Lookup(Ipv4Address src,
+                                 Ipv4Address dst,
+                                 uint8_t protocol,
+                                 uint16_t srcPort,
+                                 uint16_t dstPort,
+                                 uint8_t dscp);
+
+protected:
+    void DoDispose() override;
+
+private:
+    struct Slot
+    {
+        Ipv4PolicyRule rule;
+        bool active;
+        uint64_t hits;
+    };
+
+    // Which fields a tuple matches on
+    enum Field
+    {
+        F_PROTOCOL = 1,
+        F_SRC_PORT = 2,
+        F_DST_PORT = 4,
+        F_DSCP = 8,
+    };
+
+    struct Key
+    {
+        uint64_t addresses;
+        uint64_t rest;
+
+        bool operator==(const Key& o) const { return addresses == o.addresses && rest == o.rest; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& k) const
+        {
+            uint64_t h = k.addresses * 0x9e3779b97f4a7c15ULL ^ k.rest;
+            return std::size_t(h ^ (h >> 31));
+        }
+    };
+
+    struct Tuple
+    {
+        uint8_t sourceLength;
+        uint8_t destinationLength;
+        uint8_t fields;
+        uint32_t maxPriority;
+        std::unordered_map<Key, uint32_t, KeyHash> rules;  // -> rule id
+    };
+
+    static uint32_t Mask(uint8_t length) { return length == 0 ? 0 : 0xffffffffu << (32 - length); }
+    static uint8_t Fields(const Ipv4PolicyRule& rule);
+    static Key MakeKey(const Tuple& t,
+                       uint32_t src,
+                       uint32_t dst,
+                       uint8_t protocol,
+                       uint16_t srcPort,
+                       uint16_t dstPort,
+                       uint8_t dscp);
+    bool Better(uint32_t a, uint32_t b) const;
+    void Compile();
+    const Ipv4PolicyRule* Classify(const Ipv4Header& header, uint16_t srcPort, uint16_t dstPort);
+    Ptr<Ipv4Route> MakeRoute(const Ipv4PolicyRule& rule, Ipv4Address dest) const;
+
+    Ptr<Ipv4> m_ipv4;
+    std::vector<Slot> m_rules;   // indexed by id
+    std::vector<uint32_t> m_free;
+    uint32_t m_nRules;
+    std::vector<Tuple> m_tuples; // sorted by maxPriority, descending
+    bool m_dirty;
+    uint64_t m_generation;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4PolicyRouting);
+
+inline TypeId Ipv4PolicyRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4PolicyRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<Ipv4PolicyRouting>();
+    return tid;
+}
+
+inline Ipv4PolicyRouting::Ipv4PolicyRouting()
+    : m_nRules(0),
+      m_dirty(false),
+      m_generation(0)
+{
+}
+
+inline void Ipv4PolicyRouting::DoDispose()
+{
+    m_ipv4 = 0;
+    Clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline uint32_t Ipv4PolicyRouting::AddRule(const Ipv4PolicyRule& rule)
+{
+    uint32_t id;
+    if (!m_free.empty())
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        id = m_rules.size();
+        m_rules.push_back(Slot());
+    }
+    m_rules[id] = {rule, true, 0};
+    m_rules[id].rule.source = Ipv4Address(rule.source.Get() & Mask(rule.sourceLength));
+    m_rules[id].rule.destination = Ipv4Address(rule.destination.Get() & Mask(rule.destinationLength));
+    m_nRules++;
+    m_dirty = true;
+    m_generation++;
+    return id;
+}
+
+inline bool Ipv4PolicyRouting::RemoveRule(uint32_t id)
+{
+    if (id >= m_rules.size() || !m_rules[id].active)
+    {
+        return false;
+    }
+    m_rules[id].active = false;
+    m_free.push_back(id);
+    m_nRules--;
+    m_dirty = true;
+    m_generation++;
+    return true;
+}
+
+inline bool Ipv4PolicyRouting::ReplaceNextHop(uint32_t id, uint32_t interface, Ipv4Address gateway)
+{
+    if (id >= m_rules.size() || !m_rules[id].active)
+    {
+        return false;
+    }
+    m_rules[id].rule.interface = interface;
+    m_rules[id].rule.gateway = gateway;
+    m_generation++;
+    return true;
+}
+
+inline void Ipv4PolicyRouting::Clear()
+{
+    m_rules.clear();
+    m_free.clear();
+    m_tuples.clear();
+    m_nRules = 0;
+    m_dirty = false;
+    m_generation++;
+}
+
+inline uint32_t Ipv4PolicyRouting::GetNTuples()
+{
+    Compile();
+    return m_tuples.size();
+}
+
+inline uint8_t Ipv4PolicyRouting::Fields(const Ipv4PolicyRule& rule)
+{
+    return (rule.protocol ? F_PROTOCOL : 0) | (rule.srcPort ? F_SRC_PORT : 0) |
+           (rule.dstPort ? F_DST_PORT : 0) | (rule.dscp >= 0 ? F_DSCP : 0);
+}
+
+inline Ipv4PolicyRouting::Key Ipv4PolicyRouting::MakeKey(const Tuple& t,
+                                                         uint32_t src,
+                                                         uint32_t dst,
+                                                         uint8_t protocol,
+                                                         uint16_t srcPort,
+                                                         uint16_t dstPort,
+                                                         uint8_t dscp)
+{
+    Key k;
+    k.addresses = (uint64_t(src & Mask(t.sourceLength)) << 32) | (dst & Mask(t.destinationLength));
+    k.rest = (uint64_t(t.fields & F_PROTOCOL ? protocol : 0) << 40) |
+             (uint64_t(t.fields & F_SRC_PORT ? srcPort : 0) << 24) |
+             (uint64_t(t.fields & F_DST_PORT ? dstPort : 0) << 8) | (t.fields & F_DSCP ? dscp : 0);
+    return k;
+}
+
+inline bool Ipv4PolicyRouting::Better(uint32_t a, uint32_t b) const
+{
+    const Ipv4PolicyRule& ra = m_rules[a].rule;
+    const Ipv4PolicyRule& rb = m_rules[b].rule;
+    return ra.priority != rb.priority ? ra.priority > rb.priority : a < b;
+}
+
+inline void Ipv4PolicyRouting::Compile()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+    m_tuples.clear();
+    for (uint32_t id = 0; id < m_rules.size(); id++)
+    {
+        if (!m_rules[id].active)
+        {
+            continue;
+        }
+        const Ipv4PolicyRule& r = m_rules[id].rule;
+        uint8_t fields = Fields(r);
+        Tuple* tuple = nullptr;
+        for (Tuple& t : m_tuples)
+        {
+            if (t.sourceLength == r.sourceLength && t.destinationLength == r.destinationLength &&
+                t.fields == fields)
+            {
+                tuple = &t;
+                break;
+            }
+        }
+        if (!tuple)
+        {
+            m_tuples.push_back({r.sourceLength, r.destinationLength, fields, 0, {}});
+            tuple = &m_tuples.back();
+        }
+        Key k = MakeKey(*tuple,
+                        r.source.Get(),
+                        r.destination.Get(),
+                        r.protocol,
+                        r.srcPort,
+                        r.dstPort,
+                        r.dscp < 0 ? 0 : r.dscp);
+        auto it = tuple->rules.find(k);
+        if (it == tuple->rules.end() || Better(id, it->second))
+        {
+            tuple->rules[k] = id;
+        }
+        tuple->maxPriority = std::max(tuple->maxPriority, r.priority);
+    }
+    std::stable_sort(m_tuples.begin(), m_tuples.end(), [](const Tuple& a, const Tuple& b) {
+        return a.maxPriority > b.maxPriority;
+    });
+    m_dirty = false;
+}
+
+inline const Ipv4PolicyRule* Ipv4PolicyRouting::Lookup(Ipv4Address src,
+                                                       Ipv4Address dst,
+                                                       uint8_t protocol,
+                                                       uint16_t srcPort,
+                                                       uint16_t dstPort,
+                                                       uint8_t dscp)
+{
+    Compile();
+    int64_t best = -1;
+    for (const Tuple& t : m_tuples)
+    {
+        if (best >= 0 && m_rules[best].rule.priority > t.maxPriority)
+        {
+            break;
+        }
+        auto it = t.rules.find(MakeKey(t, src.Get(), dst.Get(), protocol, srcPort, dstPort, dscp));
+        if (it != t.rules.end() && (best < 0 || Better(it->second, best)))
+        {
+            best = it->second;
+        }
+    }
+    if (best < 0)
+    {
+        return 0;
+    }
+    m_rules[best].hits++;
+    return &m_rules[best].rule;
+}
+
+inline const Ipv4PolicyRule* Ipv4PolicyRouting::Classify(const Ipv4Header& header,
+                                                         uint16_t srcPort,
+                                                         uint16_t dstPort)
+{
+    if (m_nRules == 0)
+    {
+        return 0;
+    }
+    return Lookup(header.GetSource(),
+                  header.GetDestination(),
+                  header.GetProtocol(),
+                  srcPort,
+                  dstPort,
+                  header.GetDscp());
+}
+
+inline Ptr<Ipv4Route> Ipv4PolicyRouting::MakeRoute(const Ipv4PolicyRule& rule, Ipv4Address dest) const
+{
+    if (!m_ipv4->IsUp(rule.interface))
+    {
+        return 0;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(dest);
+    route->SetSource(m_ipv4->GetAddress(rule.interface, 0).GetLocal());
+    route->SetGateway(rule.gateway);
+    route->SetOutputDevice(m_ipv4->GetNetDevice(rule.interface));
+    return route;
+}
+
+inline Ptr<Ipv4Route> Ipv4PolicyRouting::RouteOutput(Ptr<Packet> p,
+                                                     const Ipv4Header& header,
+                                                     Ptr<NetDevice> oif,
+                                                     Socket::SocketErrno& sockerr)
+{
+    const Ipv4PolicyRule* rule = header.GetDestination().IsMulticast() ? 0 : Classify(header, 0, 0);
+    Ptr<Ipv4Route> route = rule ? MakeRoute(*rule, header.GetDestination()) : 0;
+    if (!route || (oif && route->GetOutputDevice() != oif))
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return 0;
+    }
+    sockerr = Socket::ERROR_NOTERROR;
+    return route;
+}
+
+inline bool Ipv4PolicyRouting::RouteInput(Ptr<const Packet> p,
+                                          const Ipv4Header& header,
+                                          Ptr<const NetDevice> idev,
+                                          const UnicastForwardCallback& ucb,
+                                          const MulticastForwardCallback& mcb,
+                                          const LocalDeliverCallback& lcb,
+                                          const ErrorCallback& ecb)
+{
+    Ipv4Address dest = header.GetDestination();
+    if (m_nRules == 0 || dest.IsMulticast() || dest.IsBroadcast() ||
+        m_ipv4->IsDestinationAddress(dest, m_ipv4->GetInterfaceForDevice(idev)))
+    {
+        return false;
+    }
+
+    // The payload starts with the TCP/UDP header on the first fragment
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    if ((header.GetProtocol() == 6 || header.GetProtocol() == 17) && header.GetFragmentOffset() == 0)
+    {
+        uint8_t ports[4];
+        if (p->CopyData(ports, 4) == 4)
+        {
+            srcPort = (ports[0] << 8) | ports[1];
+            dstPort = (ports[2] << 8) | ports[3];
+        }
+    }
+
+    const Ipv4PolicyRule* rule = Classify(header, srcPort, dstPort);
+    Ptr<Ipv4Route> route = rule ? MakeRoute(*rule, dest) : 0;
+    if (!route)
+    {
+        return false;
+    }
+    ucb(route, p, header);
+    return true;
+}
+
+inline void Ipv4PolicyRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Now().As(unit)
+        << ", Ipv4PolicyRouting table (" << m_nRules << " rules)\n";
+    *os << "Id    Prio  Source              Destination         Proto Sport Dport DSCP "
+           "Gateway         Iface Hits\n";
+    for (uint32_t id = 0; id < m_rules.size(); id++)
+    {
+        if (!m_rules[id].active)
+        {
+            continue;
+        }
+        const Ipv4PolicyRule& r = m_rules[id].rule;
+        std::ostringstream src, dst, gw;
+        src << r.source << "/" << uint32_t(r.sourceLength);
+        dst << r.destination << "/" << uint32_t(r.destinationLength);
+        gw << r.gateway;
+        auto any = [](int64_t v, bool set) { return set ? std::to_string(v) : std::string("*"); };
+        *os << std::setiosflags(std::ios::left) << std::setw(6) << id << std::setw(6) << r.priority
+            << std::setw(20) << src.str() << std::setw(20) << dst.str() << std::setw(6)
+            << any(r.protocol, r.protocol) << std::setw(6) << any(r.srcPort, r.srcPort)
+            << std::setw(6) << any(r.dstPort, r.dstPort) << std::setw(5) << any(r.dscp, r.dscp >= 0)
+            << std::setw(16) << gw.str() << std::setw(6) << r.interface << m_rules[id].hits
+            << std::resetiosflags(std::ios::left) << "\n";
+    }
+    *os << "\n";
+}
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+class Ipv4PolicyRoutingHelper : public Ipv4RoutingHelper
+{
+public:
+    Ipv4PolicyRoutingHelper()
+    {
+        m_factory.SetTypeId(Ipv4PolicyRouting::GetTypeId());
+    }
+
+    Ipv4PolicyRoutingHelper* Copy() const override
+    {
+        return new Ipv4PolicyRoutingHelper(*this);
+    }
+
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        return m_factory.Create<Ipv4PolicyRouting>();
+    }
+
+    // Add policy routing to a node whose stack is already installed with
+    // the default Ipv4ListRouting
+    Ptr<Ipv4PolicyRouting> Install(Ptr<Node> node, int16_t priority = 10) const
+    {
+        Ptr<Ipv4ListRouting> list =
+            DynamicCast<Ipv4ListRouting>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "Ipv4PolicyRoutingHelper: node " << node->GetId()
+                                                                   << " has no Ipv4ListRouting");
+        Ptr<Ipv4PolicyRouting> policy = m_factory.Create<Ipv4PolicyRouting>();
+        list->AddRoutingProtocol(policy, priority);
+        return policy;
+    }
+
+    Ptr<Ipv4PolicyRouting> GetPolicyRouting(Ptr<Ipv4> ipv4) const
+    {
+        return Ipv4RoutingHelper::GetRouting<Ipv4PolicyRouting>(ipv4->GetRoutingProtocol());
+    }
+
+private:
+    ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* WAN_POLICY_ROUTING_H */
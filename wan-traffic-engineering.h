@@ -0,0 +1,812 @@
+/*
+ * Bandwidth-aware traffic engineering for point-to-point WANs
+ * TeController discovers the p2p links of the simulation (capacity from the
+ * device DataRate, latency from the channel Delay), places a traffic matrix
+ * with CSPF (lowest-delay path whose residual bandwidth fits the demand,
+ * splitting onto the widest remaining paths when no single path fits) and
+ * installs the result as label-switched paths:
+ *   - the ingress router classifies a demand's packets, hashes each flow
+ *     onto one of the demand's LSPs by reserved bandwidth and attaches a
+ *     TeLabelTag
+ *   - every router on the path forwards labelled packets by label alone
+ *   - unlabelled traffic, local delivery and labels whose interface is down
+ *     fall through to the next routing protocol in the Ipv4ListRouting
+ * PrintReport compares maximum link utilization against plain shortest
+ * (lowest-delay) path routing of the same matrix.
+ *
+ * Usage:
+ *   TeController te;
+ *   te.Install(nodes);                       // adds Ipv4TeRouting, priority 20
+ *   te.AddDemand("bulk", branch, dr, Ipv4Address("172.16.1.0"), Ipv4Mask("/24"),
+ *                Ipv4Address("10.0.1.2"), Ipv4Mask("/32"), 55e6);
+ *   te.Compute();
+ *   te.PrintReport(std::cout);
+ *   Simulator::Schedule(failure + MilliSeconds(50), &TeController::Compute, &te);
+ */
+
+#ifndef WAN_TRAFFIC_ENGINEERING_H
+#define WAN_TRAFFIC_ENGINEERING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace ns3
+{
+
+// ============================================================================
+// LABEL TAG
+// ============================================================================
+
+class TeLabelTag : public Tag
+{
+public:
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+
+    TeLabelTag() : m_label(0) {}
+    TeLabelTag(uint32_t label) : m_label(label) {}
+
+    uint32_t GetLabel() const { return m_label; }
+
+    uint32_t GetSerializedSize() const override { return 4; }
+    void Serialize(TagBuffer i) const override { i.WriteU32(m_label); }
+    void Deserialize(TagBuffer i) override { m_label = i.ReadU32(); }
+    void Print(std::ostream& os) const override { os << "label=" << m_label; }
+
+private:
+    uint32_t m_label;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TeLabelTag);
+
+inline TypeId TeLabelTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::TeLabelTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<TeLabelTag>();
+    return tid;
+}
+
+// ============================================================================
+// LABEL-SWITCHED FORWARDING
+// ============================================================================
+
+class Ipv4TeRouting : public Ipv4RoutingProtocol
+{
+public:
+    static TypeId GetTypeId();
+
+    Ipv4TeRouting() : m_nLabelled(0), m_nSwitched(0) {}
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override {}
+    void NotifyInterfaceDown(uint32_t interface) override {}
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
+    void SetIpv4(Ptr<Ipv4> ipv4) override { m_ipv4 = ipv4; }
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
+
+    // Forward packets carrying this label out of interface via gateway
+    void AddLabel(uint32_t label, uint32_t interface, Ipv4Address gateway);
+    // Classify (source, destination) at this ingress onto labels, weighted
+    void AddIngress(Ipv4Address srcNetwork,
+                    Ipv4Mask srcMask,
+                    Ipv4Address dstNetwork,
+                    Ipv4Mask dstMask,
+                    uint32_t label,
+                    double weight);
+    void Clear();
+
+    uint64_t GetNLabelled() const { return m_nLabelled; }
+    uint64_t GetNSwitched() const { return m_nSwitched; }
+
+protected:
+    void DoDispose() override;
+
+private:
+    struct LabelEntry
+    {
+        uint32_t interface;
+        Ipv4Address gateway;
+    };
+
+    struct IngressEntry
+    {
+        Ipv4Address srcNetwork;
+        Ipv4Mask srcMask;
+        Ipv4Address dstNetwork;
+        Ipv4Mask dstMask;
+        std::vector<std::pair<uint32_t, double>> labels;  // label, cumulative weight
+    };
+
+    uint32_t Classify(const Ipv4Header& header, uint32_t ports) const;
+    Ptr<Ipv4Route> LabelRoute(uint32_t label, Ipv4Address dest) const;
+
+    Ptr<Ipv4> m_ipv4;
+    std::map<uint32_t, LabelEntry> m_labels;
+    std::vector<IngressEntry> m_ingress;
+    uint64_t m_nLabelled;
+    uint64_t m_nSwitched;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4TeRouting);
+
+inline TypeId Ipv4TeRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4TeRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<Ipv4TeRouting>();
+    return tid;
+}
+
+inline void Ipv4TeRouting::DoDispose()
+{
+    m_ipv4 = 0;
+    Clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline void Ipv4TeRouting::AddLabel(uint32_t label, uint32_t interface, Ipv4Address gateway)
+{
+    m_labels[label] = {interface, gateway};
+}
+
+inline void Ipv4TeRouting::AddIngress(Ipv4Address srcNetwork,
+                                      Ipv4Mask srcMask,
+                                      Ipv4Address dstNetwork,
+                                      Ipv4Mask dstMask,
+                                      uint32_t label,
+                                      double weight)
+{
+    IngressEntry* entry = nullptr;
+    for (IngressEntry& e : m_ingress)
+    {
+        if (e.srcNetwork == srcNetwork && e.srcMask == srcMask && e.dstNetwork == dstNetwork &&
+            e.dstMask == dstMask)
+        {
+            entry = &e;
+        }
+    }
+    if (!entry)
+    {
+        m_ingress.push_back({srcNetwork, srcMask, dstNetwork, dstMask, {}});
+        entry = &m_ingress.back();
+    }
+    double total = entry->labels.empty() ? 0 : entry->labels.back().second;
+    entry->labels.push_back({label, total + weight});
+}
+
+inline void Ipv4TeRouting::Clear()
+{
+    m_labels.clear();
+    m_ingress.clear();
+}
+
+// Picks the label for a flow; the same (addresses, protocol, ports) always
+// hashes to the same LSP, so a flow is never reordered across paths
+inline uint32_t Ipv4TeRouting::Classify(const Ipv4Header& header, uint32_t ports) const
+{
+    Ipv4Address src = header.GetSource();
+    Ipv4Address dst = header.GetDestination();
+    for (const IngressEntry& e : m_ingress)
+    {
+        if (!e.srcMask.IsMatch(src, e.srcNetwork) || !e.dstMask.IsMatch(dst, e.dstNetwork))
+        {
+            continue;
+        }
+        uint64_t h = (uint64_t(src.Get()) << 32) ^ dst.Get() ^ (uint64_t(header.GetProtocol()) << 16) ^
+                     (uint64_t(ports) * 0x9e3779b97f4a7c15ULL);
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 32;
+        double point = (h % 1000000) / 1e6 * e.labels.back().second;
+        for (const auto& label : e.labels)
+        {
+            if (point < label.second)
+            {
+                return label.first;
+            }
+        }
+        return e.labels.back().first;
+    }
+    return 0;
+}
+
+inline Ptr<Ipv4Route> Ipv4TeRouting::LabelRoute(uint32_t label, Ipv4Address dest) const
+{
+    auto it = m_labels.find(label);
+    if (it == m_labels.end() || !m_ipv4->IsUp(it->second.interface))
+    {
+        return 0;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(dest);
+    route->SetSource(m_ipv4->GetAddress(it->second.interface, 0).GetLocal());
+    route->SetGateway(it->second.gateway);
+    route->SetOutputDevice(m_ipv4->GetNetDevice(it->second.interface));
+    return route;
+}
+
+inline Ptr<Ipv4Route> Ipv4TeRouting::RouteOutput(Ptr<Packet> p,
+                                                 const Ipv4Header& header,
+                                                 Ptr<NetDevice> oif,
+                                                 Socket::SocketErrno& sockerr)
+{
+    // Locally originated traffic: the L4 header is not attached yet, so the
+    // flow hash only covers addresses and protocol
+    uint32_t label = (p && !oif) ? Classify(header, 0) : 0;
+    Ptr<Ipv4Route> route = label ? LabelRoute(label, header.GetDestination()) : 0;
+    if (!route)
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return 0;
+    }
+    p->AddPacketTag(TeLabelTag(label));
+    m_nLabelled++;
+    sockerr = Socket::ERROR_NOTERROR;
+    return route;
+}
+
+inline bool Ipv4TeRouting::RouteInput(Ptr<const Packet> p,
+                                      const Ipv4Header& header,
+                                      Ptr<const NetDevice> idev,
+                                      const UnicastForwardCallback& ucb,
+                                      const MulticastForwardCallback& mcb,
+                                      const LocalDeliverCallback& lcb,
+                                      const ErrorCallback& ecb)
+{
+    Ipv4Address dest = header.GetDestination();
+    if (dest.IsMulticast() || dest.IsBroadcast() ||
+        m_ipv4->IsDestinationAddress(dest, m_ipv4->GetInterfaceForDevice(idev)))
+    {
+        return false;
+    }
+
+    TeLabelTag tag;
+    if (p->PeekPacketTag(tag))
+    {
+        Ptr<Ipv4Route> route = LabelRoute(tag.GetLabel(), dest);
+        if (!route)
+        {
+            return false;
+        }
+        m_nSwitched++;
+        ucb(route, p, header);
+        return true;
+    }
+
+    if (m_ingress.empty())
+    {
+        return false;
+    }
+    // The payload starts with the TCP/UDP header; its first four bytes are
+    // the ports
+    uint8_t ports[4] = {0, 0, 0, 0};
+    if (header.GetProtocol() == 6 || header.GetProtocol() == 17)
+    {
+        p->CopyData(ports, 4);
+    }
+    uint32_t label = Classify(header, (uint32_t(ports[0]) << 24) | (ports[1] << 16) | (ports[2] << 8) | ports[3]);
+    Ptr<Ipv4Route> route = label ? LabelRoute(label, dest) : 0;
+    if (!route)
+    {
+        return false;
+    }
+    p->AddPacketTag(TeLabelTag(label));
+    m_nLabelled++;
+    ucb(route, p, header);
+    return true;
+}
+
+inline void Ipv4TeRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Now().As(unit)
+        << ", Ipv4TeRouting table\n";
+    *os << "Label   Gateway         Iface\n";
+    for (const auto& kv : m_labels)
+    {
+        std::ostringstream gw;
+        gw << kv.second.gateway;
+        *os << std::setiosflags(std::ios::left) << std::setw(8) << kv.first << std::setw(16)
+            << gw.str() << kv.second.interface << std::resetiosflags(std::ios::left) << "\n";
+    }
+    for (const IngressEntry& e : m_ingress)
+    {
+        *os << "Ingress " << e.srcNetwork << "/" << e.srcMask.GetPrefixLength() << " -> "
+            << e.dstNetwork << "/" << e.dstMask.GetPrefixLength() << ":";
+        double previous = 0;
+        for (const auto& label : e.labels)
+        {
+            *os << " " << label.first << "(" << label.second - previous << ")";
+            previous = label.second;
+        }
+        *os << "\n";
+    }
+    *os << "\n";
+}
+
+// ============================================================================
+// TE CONTROLLER
+// ============================================================================
+
+struct TeDemand
+{
+    std::string name;
+    uint32_t ingress;      // node ids
+    uint32_t egress;
+    Ipv4Address srcNetwork;
+    Ipv4Mask srcMask;
+    Ipv4Address dstNetwork;
+    Ipv4Mask dstMask;
+    uint64_t bandwidth;    // bit/s
+};
+
+class TeController
+{
+public:
+    TeController();
+
+    // Add an Ipv4TeRouting instance to each node's Ipv4ListRouting
+    void Install(NodeContainer nodes, int16_t priority = 20);
+
+    void AddDemand(std::string name,
+                   Ptr<Node> ingress,
+                   Ptr<Node> egress,
+                   Ipv4Address srcNetwork,
+                   Ipv4Mask srcMask,
+                   Ipv4Address dstNetwork,
+                   Ipv4Mask dstMask,
+                   uint64_t bandwidth);
+
+    // Rediscover links (skipping interfaces that are down), place every
+    // demand and reinstall the labels; call again after topology changes
+    void Compute();
+
+    double GetTeMaxUtilization() const;
+    double GetSpfMaxUtilization() const;
+    void PrintReport(std::ostream& os) const;
+
+private:
+    struct Link
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t interface;     // on "from"
+        Ipv4Address gateway;    // address of "to" on this link
+        uint64_t capacity;
+        double delay;
+        uint64_t reserved;      // CSPF reservations
+        uint64_t spfLoad;       // load under plain shortest-path routing
+    };
+
+    struct Lsp
+    {
+        uint32_t demand;
+        uint32_t label;
+        uint64_t bandwidth;
+        bool overbooked;
+        std::vector<uint32_t> links;
+    };
+
+    void DiscoverLinks();
+    // Lowest-delay path using only links with residual >= bandwidth
+    bool ShortestPath(uint32_t src, uint32_t dst, uint64_t bandwidth, std::vector<uint32_t>& path) const;
+    // Path maximizing the bottleneck residual; returns the bottleneck
+    uint64_t WidestPath(uint32_t src, uint32_t dst, std::vector<uint32_t>& path) const;
+    void Reserve(uint32_t demand, uint64_t bandwidth, const std::vector<uint32_t>& path, bool overbooked);
+    void InstallLsps();
+    std::string NodeName(uint32_t id) const;
+
+    std::vector<Ptr<Ipv4TeRouting>> m_routing;  // by node id, may be null
+    std::vector<TeDemand> m_demands;
+    std::vector<Link> m_links;
+    std::vector<std::vector<uint32_t>> m_adjacency;  // node -> outgoing links
+    std::vector<Lsp> m_lsps;
+    uint32_t m_nextLabel;
+    uint32_t m_nComputations;
+
+    static const uint32_t MAX_SPLITS = 4;
+};
+
+inline TeController::TeController()
+    : m_nextLabel(1000),
+      m_nComputations(0)
+{
+}
+
+inline void TeController::Install(NodeContainer nodes, int16_t priority)
+{
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        Ptr<Ipv4ListRouting> list =
+            DynamicCast<Ipv4ListRouting>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "TeController: node " << node->GetId() << " has no Ipv4ListRouting");
+        Ptr<Ipv4TeRouting> te = CreateObject<Ipv4TeRouting>();
+        list->AddRoutingProtocol(te, priority);
+        if (m_routing.size() <= node->GetId())
+        {
+            m_routing.resize(node->GetId() + 1);
+        }
+        m_routing[node->GetId()] = te;
+    }
+}
+
+inline void TeController::AddDemand(std::string name,
+                                    Ptr<Node> ingress,
+                                    Ptr<Node> egress,
+                                    Ipv4Address srcNetwork,
+                                    Ipv4Mask srcMask,
+                                    Ipv4Address dstNetwork,
+                                    Ipv4Mask dstMask,
+                                    uint64_t bandwidth)
+{
+    m_demands.push_back({name,
+                         ingress->GetId(),
+                         egress->GetId(),
+                         srcNetwork.CombineMask(srcMask),
+                         srcMask,
+                         dstNetwork.CombineMask(dstMask),
+                         dstMask,
+                         bandwidth});
+}
+
+inline void TeController::DiscoverLinks()
+{
+    m_links.clear();
+    m_adjacency.assign(NodeList::GetNNodes(), std::vector<uint32_t>());
+    for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+    {
+        Ptr<Node> node = NodeList::GetNode(n);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        for (uint32_t d = 0; ipv4 && d < node->GetNDevices(); d++)
+        {
+            Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice>(node->GetDevice(d));
+            if (!device || !device->GetChannel() || device->GetChannel()->GetNDevices() != 2)
+            {
+                continue;
+            }
+            Ptr<Channel> channel = device->GetChannel();
+            Ptr<NetDevice> peer = channel->GetDevice(channel->GetDevice(0) == device ? 1 : 0);
+            Ptr<Ipv4> peerIpv4 = peer->GetNode()->GetObject<Ipv4>();
+            int32_t interface = ipv4->GetInterfaceForDevice(device);
+            int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice(peer) : -1;
+            if (interface < 0 || peerInterface < 0 || !ipv4->IsUp(interface) ||
+                !peerIpv4->IsUp(peerInterface))
+            {
+                continue;
+            }
+
+            DataRateValue rate;
+            device->GetAttribute("DataRate", rate);
+            TimeValue delay;
+            channel->GetAttribute("Delay", delay);
+            m_adjacency[n].push_back(m_links.size());
+            m_links.push_back({n,
+                               peer->GetNode()->GetId(),
+                               uint32_t(interface),
+                               peerIpv4->GetAddress(peerInterface, 0).GetLocal(),
+                               rate.Get().GetBitRate(),
+                               delay.Get().GetSeconds(),
+                               0,
+                               0});
+        }
+    }
+}
+
+inline bool TeController::ShortestPath(uint32_t src,
+                                       uint32_t dst,
+                                       uint64_t bandwidth,
+                                       std::vector<uint32_t>& path) const
+{
+    std::vector<double> dist(m_adjacency.size(), std::numeric_limits<double>::infinity());
+    std::vector<int32_t> via(m_adjacency.size(), -1);
+    typedef std::pair<double, uint32_t> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    dist[src] = 0;
+    queue.push({0, src});
+    while (!queue.empty())
+    {
+        Item item = queue.top();
+        queue.pop();
+        if (item.first > dist[item.second])
+        {
+            continue;
+        }
+        for (uint32_t l : m_adjacency[item.second])
+        {
+            const Link& link = m_links[l];
+            if (link.capacity - std::min(link.capacity, link.reserved) < bandwidth)
+            {
+                continue;
+            }
+            double d = item.first + link.delay;
+            if (d < dist[link.to])
+            {
+                dist[link.to] = d;
+                via[link.to] = l;
+                queue.push({d, link.to});
+            }
+        }
+    }
+    if (via[dst] < 0)
+    {
+        return false;
+    }
+    path.clear();
+    for (uint32_t n = dst; n != src; n = m_links[via[n]].from)
+    {
+        path.push_back(via[n]);
+    }
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+inline uint64_t TeController::WidestPath(uint32_t src, uint32_t dst, std::vector<uint32_t>& path) const
+{
+    // Max-bottleneck Dijkstra; ties go to the lower-delay path
+    std::vector<uint64_t> width(m_adjacency.size(), 0);
+    std::vector<double> dist(m_adjacency.size(), std::numeric_limits<double>::infinity());
+    std::vector<int32_t> via(m_adjacency.size(), -1);
+    typedef std::pair<uint64_t, std::pair<double, uint32_t>> Item;
+    auto worse = [](const Item& a, const Item& b) {
+        return a.first != b.first ? a.first < b.first : a.second.first > b.second.first;
+    };
+    std::priority_queue<Item, std::vector<Item>, decltype(worse)> queue(worse);
+    width[src] = std::numeric_limits<uint64_t>::max();
+    dist[src] = 0;
+    queue.push({width[src], {0, src}});
+    while (!queue.empty())
+    {
+        Item item = queue.top();
+        queue.pop();
+        uint32_t n = item.second.second;
+        if (item.first < width[n] || (item.first == width[n] && item.second.first > dist[n]))
+        {
+            continue;
+        }
+        for (uint32_t l : m_adjacency[n])
+        {
+            const Link& link = m_links[l];
+            uint64_t w = std::min(item.first, link.capacity - std::min(link.capacity, link.reserved));
+            double d = item.second.first + link.delay;
+            if (w > width[link.to] || (w == width[link.to] && w > 0 && d < dist[link.to]))
+            {
+                width[link.to] = w;
+                dist[link.to] = d;
+                via[link.to] = l;
+                queue.push({w, {d, link.to}});
+            }
+        }
+    }
+    if (via[dst] < 0 || width[dst] == 0)
+    {
+        return 0;
+    }
+    path.clear();
+    for (uint32_t n = dst; n != src; n = m_links[via[n]].from)
+    {
+        path.push_back(via[n]);
+    }
+    std::reverse(path.begin(), path.end());
+    return width[dst];
+}
+
+inline void TeController::Reserve(uint32_t demand,
+                                  uint64_t bandwidth,
+                                  const std::vector<uint32_t>& path,
+                                  bool overbooked)
+{
+    for (uint32_t l : path)
+    {
+        m_links[l].reserved += bandwidth;
+    }
+    m_lsps.push_back({demand, m_nextLabel++, bandwidth, overbooked, path});
+}
+
+inline void TeController::Compute()
+{
+    DiscoverLinks();
+    m_lsps.clear();
+    m_nComputations++;
+
+    // Baseline: every demand on its unconstrained lowest-delay path
+    for (const TeDemand& d : m_demands)
+    {
+        std::vector<uint32_t> path;
+        if (ShortestPath(d.ingress, d.egress, 0, path))
+        {
+            for (uint32_t l : path)
+            {
+                m_links[l].spfLoad += d.bandwidth;
+            }
+        }
+    }
+
+    // CSPF, largest demands first
+    std::vector<uint32_t> order(m_demands.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_demands[a].bandwidth > m_demands[b].bandwidth;
+    });
+
+    for (uint32_t i : order)
+    {
+        const TeDemand& d = m_demands[i];
+        std::vector<uint32_t> path;
+        if (ShortestPath(d.ingress, d.egress, d.bandwidth, path))
+        {
+            Reserve(i, d.bandwidth, path, false);
+            continue;
+        }
+
+        // No single path fits: split over the widest remaining paths
+        uint64_t remaining = d.bandwidth;
+        for (uint32_t split = 0; split < MAX_SPLITS && remaining > 0; split++)
+        {
+            uint64_t width = WidestPath(d.ingress, d.egress, path);
+            if (width == 0)
+            {
+                break;
+            }
+            uint64_t amount = std::min(remaining, width);
+            Reserve(i, amount, path, false);
+            remaining -= amount;
+        }
+        // Whatever is left still has to go somewhere
+        if (remaining > 0 && ShortestPath(d.ingress, d.egress, 0, path))
+        {
+            Reserve(i, remaining, path, true);
+        }
+    }
+
+    InstallLsps();
+}
+
+inline void TeController::InstallLsps()
+{
+    for (Ptr<Ipv4TeRouting> routing : m_routing)
+    {
+        if (routing)
+        {
+            routing->Clear();
+        }
+    }
+    for (const Lsp& lsp : m_lsps)
+    {
+        const TeDemand& d = m_demands[lsp.demand];
+        for (uint32_t l : lsp.links)
+        {
+            const Link& link = m_links[l];
+            if (link.from < m_routing.size() && m_routing[link.from])
+            {
+                m_routing[link.from]->AddLabel(lsp.label, link.interface, link.gateway);
+            }
+        }
+        if (d.ingress < m_routing.size() && m_routing[d.ingress])
+        {
+            m_routing[d.ingress]->AddIngress(d.srcNetwork,
+                                             d.srcMask,
+                                             d.dstNetwork,
+                                             d.dstMask,
+                                             lsp.label,
+                                             double(lsp.bandwidth));
+        }
+    }
+}
+
+inline double TeController::GetTeMaxUtilization() const
+{
+    double mlu = 0;
+    for (const Link& link : m_links)
+    {
+        mlu = std::max(mlu, double(link.reserved) / link.capacity);
+    }
+    return mlu;
+}
+
+inline double TeController::GetSpfMaxUtilization() const
+{
+    double mlu = 0;
+    for (const Link& link : m_links)
+    {
+        mlu = std::max(mlu, double(link.spfLoad) / link.capacity);
+    }
+    return mlu;
+}
+
+inline std::string TeController::NodeName(uint32_t id) const
+{
+    std::string name = Names::FindName(NodeList::GetNode(id));
+    return name.empty() ? "node " + std::to_string(id) : name;
+}
+
+inline void TeController::PrintReport(std::ostream& os) const
+{
+    os << "\n=== Traffic Engineering (computation " << m_nComputations << " at t="
+       << Simulator::Now().GetSeconds() << "s) ===\n";
+
+    os << "Demands:\n";
+    for (uint32_t i = 0; i < m_demands.size(); i++)
+    {
+        const TeDemand& d = m_demands[i];
+        os << "  " << d.name << ": " << NodeName(d.ingress) << " -> " << NodeName(d.egress) << ", "
+           << d.bandwidth / 1e6 << " Mbps\n";
+        for (const Lsp& lsp : m_lsps)
+        {
+            if (lsp.demand != i)
+            {
+                continue;
+            }
+            os << "    LSP " << lsp.label << ": " << lsp.bandwidth / 1e6 << " Mbps"
+               << (lsp.overbooked ? " (OVERBOOKED)" : "") << " via " << NodeName(d.ingress);
+            for (uint32_t l : lsp.links)
+            {
+                os << " > " << NodeName(m_links[l].to);
+            }
+            os << "\n";
+        }
+    }
+
+    os << "Links (utilization):\n";
+    os << "  " << std::setiosflags(std::ios::left) << std::setw(28) << "link" << std::setw(12)
+       << "capacity" << std::setw(12) << "SPF" << "TE" << std::resetiosflags(std::ios::left) << "\n";
+    for (const Link& link : m_links)
+    {
+        if (link.spfLoad == 0 && link.reserved == 0)
+        {
+            continue;
+        }
+        std::ostringstream name, capacity, spf, te;
+        name << NodeName(link.from) << " -> " << NodeName(link.to);
+        capacity << link.capacity / 1e6 << " Mbps";
+        spf << 100.0 * link.spfLoad / link.capacity << "%";
+        te << 100.0 * link.reserved / link.capacity << "%";
+        os << "  " << std::setiosflags(std::ios::left) << std::setw(28) << name.str() << std::setw(12)
+           << capacity.str() << std::setw(12) << spf.str() << te.str()
+           << std::resetiosflags(std::ios::left) << "\n";
+    }
+    os << "Max link utilization: shortest path " << 100 * GetSpfMaxUtilization() << "%, TE "
+       << 100 * GetTeMaxUtilization() << "%\n";
+
+    uint64_t labelled = 0;
+    uint64_t switched = 0;
+    for (Ptr<Ipv4TeRouting> routing : m_routing)
+    {
+        if (routing)
+        {
+            labelled += routing->GetNLabelled();
+            switched += routing->GetNSwitched();
+        }
+    }
+    os << "Packets labelled at ingress: " << labelled << ", label-switched hops: " << switched
+       << "\n";
+}
+
+} // namespace ns3
+
+#endif // WAN_TRAFFIC_ENGINEERING_H